@@ -0,0 +1,180 @@
+#ifndef TRY_ARENA_H
+#define TRY_ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+
+namespace trycle
+{
+
+/**
+ * 单调分配器（arena）
+ *
+ * 从固定大小的块中按顺序切出内存，单个对象不释放，reset 时所有内存一起归还：
+ * 普通块从 SlabPool 分配、reset 时还回，之后的 arena 直接复用，稳定运行后基本不再向系统申请内存；
+ * 超过 LARGE_THRESHOLD 的分配单独占一块，同样交给 SlabPool（超过 SlabPool::MAX_SIZE 时由它 malloc）。
+ *
+ * 每个协程可以有自己的 arena（Arena::GetThis），协程执行结束或 reset 时自动释放，
+ * 处理一个请求时产生的大量短生命周期对象（字符串、容器、shared_ptr 控制块）都从这里分配，
+ * 请求结束时一次释放。从 arena 分配的对象不能在协程结束后继续使用。
+ * 线程主协程和调度器的 root/idle 协程永远不会结束或 reset，它们的 arena 只增不减，
+ * 因此 GetThis 只能在调度的协程（或自行 reset 的子协程）中调用，否则触发 ASSERT。
+ *
+ * 非线程安全，只在所属协程中使用。
+ */
+class Arena
+{
+public:
+    // 普通块的容量
+    static const size_t CHUNK_SIZE = 16 * 1024;
+    // 超过该大小的分配单独占一块，不占用普通块
+    static const size_t LARGE_THRESHOLD = CHUNK_SIZE / 4;
+
+    Arena();
+    ~Arena();
+
+    Arena(const Arena&)            = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /**
+     * @brief 分配 size 字节，按 align 对齐，失败时抛出 std::bad_alloc
+     */
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t))
+    {
+        uintptr_t p = ((uintptr_t)m_ptr + align - 1) & ~(uintptr_t)(align - 1);
+        if (p + size <= (uintptr_t)m_end)
+        {
+            m_ptr = (char*)(p + size);
+            m_used += size;
+            return (void*)p;
+        }
+        return allocateSlow(size, align);
+    }
+
+    /**
+     * @brief 在 arena 上构造对象，有非平凡析构函数的对象在 reset 时按构造的逆序析构
+     */
+    template <typename T, typename... Args>
+    T* create(Args&&... args)
+    {
+        void* mem = allocate(sizeof(T), alignof(T));
+        T* obj    = new (mem) T(std::forward<Args>(args)...);
+        if (!std::is_trivially_destructible<T>::value)
+        {
+            addCleanup(&Destroy<T>, obj);
+        }
+        return obj;
+    }
+
+    /**
+     * @brief 析构 create 的对象，释放所有内存，块还给 SlabPool
+     */
+    void reset();
+
+    // 已分配出去的字节数（不含对齐填充）
+    size_t getUsed() const { return m_used; }
+    // 持有的普通块数
+    size_t getChunkCount() const { return m_chunk_count; }
+
+public:
+    /**
+     * @brief 当前协程的 arena，第一次调用时创建
+     * @note 当前协程必须是会结束或 reset 的协程，在线程主协程、调度器 root/idle 协程中调用会触发 ASSERT，
+     *       这些场景请自己持有 Arena 并显式 reset
+     */
+    static Arena* GetThis();
+
+private:
+    struct Chunk
+    {
+        Chunk* next;
+        size_t size;
+    };
+
+    struct Cleanup
+    {
+        void (*fn)(void*);
+        void* obj;
+        Cleanup* next;
+    };
+
+    template <typename T>
+    static void Destroy(void* obj)
+    {
+        static_cast<T*>(obj)->~T();
+    }
+
+    void* allocateSlow(size_t size, size_t align);
+    void addCleanup(void (*fn)(void*), void* obj);
+    // 整串块还给 SlabPool
+    static void FreeChunks(Chunk* chunk);
+
+private:
+    char* m_ptr  = nullptr;
+    char* m_end  = nullptr;
+    // 普通块链表，头部是正在使用的块
+    Chunk* m_head        = nullptr;
+    size_t m_chunk_count = 0;
+    Chunk* m_large       = nullptr;
+    Cleanup* m_cleanups  = nullptr;
+    size_t m_used        = 0;
+};
+
+/**
+ * 使用 Arena 的 std 分配器，deallocate 什么都不做，内存在 arena reset 时统一释放
+ * 如 std::vector<int, ArenaAllocator<int>>、std::allocate_shared<T>(ArenaAllocator<T>())
+ */
+template <typename T>
+class ArenaAllocator
+{
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <typename U>
+    struct rebind
+    {
+        typedef ArenaAllocator<U> other;
+    };
+
+    // 默认使用当前协程的 arena，只能在调度的协程中构造，见 Arena::GetThis
+    ArenaAllocator()
+        : m_arena(Arena::GetThis()) {}
+    explicit ArenaAllocator(Arena* arena)
+        : m_arena(arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other)
+        : m_arena(other.getArena()) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T* p, size_t n) {}
+
+    Arena* getArena() const { return m_arena; }
+
+private:
+    Arena* m_arena;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs)
+{
+    return lhs.getArena() == rhs.getArena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs)
+{
+    return lhs.getArena() != rhs.getArena();
+}
+
+} // namespace trycle
+
+#endif // TRY_ARENA_H
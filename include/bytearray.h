@@ -0,0 +1,142 @@
+#ifndef TRY_BYTEARRAY_H
+#define TRY_BYTEARRAY_H
+
+#include <memory>
+#include <stdint.h>
+#include <string>
+
+#include "iobuffer.h"
+
+namespace trycle
+{
+
+/**
+ * 二进制序列化缓冲区
+ *
+ * 数据存放在 IOBuffer 的块链中，写入追加在末尾，读取从开头取出（先进先出），
+ * 编码好的消息可以直接通过 readv / writev 收发，或 splice 到连接的发送缓冲区。
+ *
+ *  - writeF* / readF*：定长整数，字节序由 setLittleEndian 决定，默认网络字节序（大端）
+ *  - writeInt* / writeUint*：varint 变长编码，有符号数先做 zigzag，绝对值小的负数也只占很少的字节
+ *  - writeString*：带长度前缀的字符串，长度可以是 16/32/64 位定长或 varint
+ *
+ * 读取时数据不足抛出 std::out_of_range，varint 超过 10 字节抛出 std::invalid_argument。
+ * 消息是否完整应由上层（如带长度的帧头）先判断，解码到一半失败时已读出的字段不会放回。
+ */
+class ByteArray
+{
+public:
+    typedef std::shared_ptr<ByteArray> ptr;
+
+    ByteArray(bool little_endian = false);
+
+    bool isLittleEndian() const { return m_little_endian; }
+    void setLittleEndian(bool val) { m_little_endian = val; }
+
+    // 可读的字节数
+    size_t getSize() const { return m_buffer.size(); }
+    IOBuffer& getBuffer() { return m_buffer; }
+    const IOBuffer& getBuffer() const { return m_buffer; }
+    void clear() { m_buffer.clear(); }
+
+    // 定长
+    void writeFint8(int8_t val);
+    void writeFuint8(uint8_t val);
+    void writeFint16(int16_t val);
+    void writeFuint16(uint16_t val);
+    void writeFint32(int32_t val);
+    void writeFuint32(uint32_t val);
+    void writeFint64(int64_t val);
+    void writeFuint64(uint64_t val);
+
+    // varint，有符号数使用 zigzag
+    void writeInt32(int32_t val);
+    void writeUint32(uint32_t val);
+    void writeInt64(int64_t val);
+    void writeUint64(uint64_t val);
+
+    void writeFloat(float val);
+    void writeDouble(double val);
+
+    // 长度前缀 + 数据，长度超出前缀能表示的范围时抛出 std::length_error
+    void writeStringF16(const std::string& val);
+    void writeStringF32(const std::string& val);
+    void writeStringF64(const std::string& val);
+    void writeStringVint(const std::string& val);
+    void writeStringWithoutLength(const std::string& val);
+
+    void write(const void* data, size_t len) { m_buffer.append(data, len); }
+
+    int8_t readFint8();
+    uint8_t readFuint8();
+    int16_t readFint16();
+    uint16_t readFuint16();
+    int32_t readFint32();
+    uint32_t readFuint32();
+    int64_t readFint64();
+    uint64_t readFuint64();
+
+    int32_t readInt32();
+    uint32_t readUint32();
+    int64_t readInt64();
+    uint64_t readUint64();
+
+    float readFloat();
+    double readDouble();
+
+    std::string readStringF16();
+    std::string readStringF32();
+    std::string readStringF64();
+    std::string readStringVint();
+
+    /**
+     * @brief 取出 len 字节，不足时抛出 std::out_of_range
+     */
+    void read(void* data, size_t len);
+
+    /**
+     * @brief 把全部数据写入文件（覆盖），不取出数据
+     */
+    bool writeToFile(const std::string& name) const;
+    /**
+     * @brief 把文件的全部内容追加到末尾
+     */
+    bool readFromFile(const std::string& name);
+
+    /**
+     * @brief 从 fd（socket）读取最多 len 字节追加到末尾，见 IOBuffer::readFd
+     */
+    ssize_t readFd(int fd, size_t len = 64 * 1024) { return m_buffer.readFd(fd, len); }
+    /**
+     * @brief 把开头最多 len 字节写入 fd，写出的部分被取出，见 IOBuffer::writeFd
+     */
+    ssize_t writeFd(int fd, size_t len = (size_t)-1) { return m_buffer.writeFd(fd, len); }
+
+    // 不取出数据
+    std::string toString() const { return m_buffer.toString(); }
+    std::string toHexString() const;
+
+public:
+    static uint32_t EncodeZigzag32(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+    static uint64_t EncodeZigzag64(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+    static int32_t DecodeZigzag32(uint32_t v) { return (int32_t)((v >> 1) ^ -(v & 1)); }
+    static int64_t DecodeZigzag64(uint64_t v) { return (int64_t)((v >> 1) ^ -(v & 1)); }
+
+private:
+    template <typename T>
+    void writeFixed(T val);
+    template <typename T>
+    T readFixed();
+
+    void writeVarint(uint64_t val);
+    uint64_t readVarint();
+    std::string readString(uint64_t len);
+
+private:
+    bool m_little_endian;
+    IOBuffer m_buffer;
+};
+
+} // namespace trycle
+
+#endif // TRY_BYTEARRAY_H
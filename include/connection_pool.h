@@ -0,0 +1,153 @@
+#ifndef TRY_CONNECTION_POOL_H
+#define TRY_CONNECTION_POOL_H
+
+#include <atomic>
+#include <deque>
+#include <list>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+#include "address.h"
+#include "fiber.h"
+#include "iomanager.h"
+#include "socket.h"
+#include "thread.h"
+
+namespace trycle
+{
+
+struct ConnectionPoolStats
+{
+    uint64_t created        = 0; // 新建的连接
+    uint64_t reused         = 0; // 从空闲列表取出复用的连接
+    uint64_t expired        = 0; // 空闲超时被关闭的连接
+    uint64_t dead           = 0; // 取出时检查发现已断开（或有未读数据）被丢弃的连接
+    uint64_t connect_failed = 0; // 建立连接失败次数
+    uint64_t wait_timeouts  = 0; // 达到连接数上限、等待归还超时的次数
+    uint64_t idle           = 0; // 当前空闲的连接
+    uint64_t total          = 0; // 当前的连接总数（空闲加借出）
+};
+
+/**
+ * 出站连接池
+ *
+ * 每个上游（host 字符串或 Address）有自己的空闲列表，get 优先取最近归还的连接（LIFO，连接最"热"），
+ * 取出前用 MSG_PEEK 检查对端是否已关闭，没有可用连接时才解析地址并 connect，
+ * 复用的连接不再经过 DNS 解析和握手。新建连接的地址解析走 Resolver 的缓存。
+ *
+ * get 返回的 Socket::ptr 带自定义删除器：最后一个引用释放时连接自动归还给连接池，
+ * 连接已 close 或池已销毁时直接关闭。协议出错、连接状态不确定时调用方应先 close 再释放。
+ * 归还时保留 socket 上设置的超时等选项。
+ *
+ *  - tcp.pool.max_idle：每个上游最多保留的空闲连接，超过的在归还时关闭
+ *  - tcp.pool.max_total：每个上游的连接总数上限，达到时 get 挂起等待归还，0 表示不限
+ *  - tcp.pool.idle_timeout_ms：空闲超过该时间的连接由 IOManager 上的定时器关闭
+ *  - tcp.pool.connect_timeout_ms：get 的默认超时（含等待归还和 connect）
+ *
+ * 配置在创建连接池时读取。连接池持有 IOManager 上的循环定时器，IOManager 停止前要先销毁连接池。
+ */
+class ConnectionPool : public std::enable_shared_from_this<ConnectionPool>
+{
+public:
+    typedef std::shared_ptr<ConnectionPool> ptr;
+    typedef Mutex MutexType;
+
+    /**
+     * @brief 创建连接池，并在 iom 上启动空闲连接的清理定时器
+     */
+    static ConnectionPool::ptr Create(IOManager* iom = IOManager::GetThis());
+
+    ~ConnectionPool();
+
+    /**
+     * @brief 取一个连到 host 的连接
+     * @param {string&} host 域名或 ip 加端口，如 www.baidu.com:80、[::1]:80
+     * @param {uint64_t} timeout_ms 超时时间，-1 表示使用 tcp.pool.connect_timeout_ms
+     * @return {*} 失败返回 nullptr 并设置 errno，超时为 ETIMEDOUT
+     */
+    Socket::ptr get(const std::string& host, uint64_t timeout_ms = (uint64_t)-1);
+    Socket::ptr get(Address::ptr addr, uint64_t timeout_ms = (uint64_t)-1);
+
+    /**
+     * @brief 预热：建立连接直到 host 的空闲连接数达到 count（不超过 max_idle 和 max_total）
+     * @return {*} 新建的连接数
+     */
+    size_t prewarm(const std::string& host, size_t count);
+    size_t prewarm(Address::ptr addr, size_t count);
+
+    // 关闭所有空闲连接，借出的连接归还时照常处理
+    void clear();
+
+    ConnectionPoolStats getStats();
+    std::ostream& dump(std::ostream& os);
+
+private:
+    struct Waiter
+    {
+        typedef std::shared_ptr<Waiter> ptr;
+        Scheduler* scheduler = nullptr;
+        Fiber::ptr fiber;
+    };
+
+    struct Idle
+    {
+        Socket* sock;
+        uint64_t since; // 归还的时间
+    };
+
+    // 一个上游的连接
+    struct Upstream
+    {
+        typedef std::shared_ptr<Upstream> ptr;
+
+        std::string host;   // 按 host 连接时每次新建连接都重新解析（命中 Resolver 缓存）
+        Address::ptr addr;  // 按地址连接
+        MutexType mutex;
+        std::deque<Idle> idle; // 尾部是最近归还的
+        uint32_t total = 0;    // 空闲加借出，包括正在 connect 的
+        std::list<Waiter::ptr> waiters;
+
+        // 唤醒一个等待的协程，调用方持有 mutex
+        void wakeOne();
+    };
+
+    ConnectionPool(IOManager* iom);
+
+    Upstream::ptr getUpstream(const std::string& key, Address::ptr addr);
+    Socket::ptr checkout(Upstream::ptr up, uint64_t timeout_ms);
+    size_t prewarm(Upstream::ptr up, size_t count);
+    // 新建连接，失败返回 nullptr
+    Socket* connect(Upstream::ptr up, uint64_t deadline);
+    // 包装成归还到池中的 Socket::ptr
+    Socket::ptr wrap(Upstream::ptr up, Socket* sock);
+    void release(Upstream::ptr up, Socket* sock);
+    // 关闭空闲超时的连接，由定时器调用
+    void sweep();
+
+    // 空闲连接是否还能用：对端没有关闭，也没有未读的数据
+    static bool IsAlive(Socket* sock);
+
+private:
+    IOManager* m_iom;
+    Timer::ptr m_timer;
+    // 创建时从配置读取
+    uint32_t m_max_idle;
+    uint32_t m_max_total;
+    uint64_t m_idle_timeout;
+    uint64_t m_connect_timeout;
+    RWMutex m_mutex;
+    std::unordered_map<std::string, Upstream::ptr> m_upstreams;
+
+    std::atomic<uint64_t> m_created{0};
+    std::atomic<uint64_t> m_reused{0};
+    std::atomic<uint64_t> m_expired{0};
+    std::atomic<uint64_t> m_dead{0};
+    std::atomic<uint64_t> m_connect_failed{0};
+    std::atomic<uint64_t> m_wait_timeouts{0};
+};
+
+} // namespace trycle
+
+#endif // TRY_CONNECTION_POOL_H
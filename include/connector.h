@@ -0,0 +1,32 @@
+#ifndef TRY_CONNECTOR_H
+#define TRY_CONNECTOR_H
+
+#include <string>
+#include <vector>
+
+#include "address.h"
+
+namespace trycle
+{
+
+/**
+ * @brief 解析 host 并按 Happy Eyeballs（RFC 8305）连接：
+ *        解析结果按地址族交替排列（IPv6、IPv4、IPv6……，以解析结果的第一个地址族开头），
+ *        在各自的协程中依次发起连接，每次间隔 tcp.connect.attempt_delay_ms（默认 250ms），
+ *        前一个连接失败时立即发起下一个；保留最先连上的 socket，其余的通过 IOManager::cancelEvent 取消
+ *        不在 IOManager 中时按同样的顺序逐个连接
+ * @param {string&} host 域名或 ip 加端口，如 www.baidu.com:80、[::1]:80
+ * @param {uint64_t} timeout_ms 整体超时时间，-1 表示使用 tcp.timeout.ms
+ * @param {Address::ptr*} peer 不为空时返回连上的地址
+ * @return {*} 连接好的 socket，失败返回 -1 并设置 errno，超时为 ETIMEDOUT
+ */
+int connectAny(const std::string& host, uint64_t timeout_ms = (uint64_t)-1, Address::ptr* peer = nullptr);
+
+/**
+ * @brief 与 connectAny(host) 相同，但使用给定的地址列表，顺序保持不变
+ */
+int connectAny(const std::vector<Address::ptr>& addrs, uint64_t timeout_ms = (uint64_t)-1, Address::ptr* peer = nullptr);
+
+} // namespace trycle
+
+#endif // TRY_CONNECTOR_H
@@ -0,0 +1,350 @@
+#ifndef TRY_COROUTINE_H
+#define TRY_COROUTINE_H
+
+/**
+ * 无栈协程（C++20 coroutine）支持
+ *
+ * 与 Fiber（有栈协程）共用同一套 Scheduler 队列和 IOManager 事件：
+ *  - co_await readable(fd) / writable(fd)  ->  IOManager::addEvent
+ *  - co_await sleep_for(ms)                ->  IOManager::addTimer
+ *  - co_await schedule_on(scheduler)       ->  Scheduler::schedule
+ * 协程恢复时总是以回调的方式进入调度队列，由 Scheduler::run 的 cb_fiber 执行，
+ * 所以同一个进程里两种模型可以混用。
+ *
+ * 需要 C++20，通过 CMake 选项 TRY_ENABLE_COROUTINE 打开 libconet_coro 目标。
+ */
+
+#if __cplusplus < 202002L
+#error "coroutine.h requires C++20, link the libconet_coro target (TRY_ENABLE_COROUTINE=ON)"
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+#include "iomanager.h"
+#include "log.h"
+#include "scheduler.h"
+
+namespace trycle
+{
+
+template <typename T = void>
+class Task;
+
+namespace detail
+{
+
+struct TaskPromiseBase
+{
+    struct FinalAwaiter
+    {
+        bool await_ready() noexcept { return false; }
+
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+        {
+            auto& promise = handle.promise();
+            // 有等待者时，对称转移回等待者
+            if (promise.m_continuation)
+            {
+                return promise.m_continuation;
+            }
+            // 分离执行的任务，没有所有者，结束时自行销毁
+            if (promise.m_detached)
+            {
+                if (promise.m_exception)
+                {
+                    LOG_ERROR(GET_LOGGER("system"), "detached Task finished with exception");
+                }
+                handle.destroy();
+            }
+            return std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    // 惰性启动，直到被 co_await 或 CoSpawn
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { m_exception = std::current_exception(); }
+
+    std::coroutine_handle<> m_continuation;
+    std::exception_ptr m_exception;
+    bool m_detached = false;
+};
+
+template <typename T>
+struct TaskPromise : public TaskPromiseBase
+{
+    Task<T> get_return_object() noexcept;
+
+    template <typename U>
+    void return_value(U&& val)
+    {
+        m_value.emplace(std::forward<U>(val));
+    }
+
+    T result()
+    {
+        if (m_exception)
+        {
+            std::rethrow_exception(m_exception);
+        }
+        return std::move(*m_value);
+    }
+
+    std::optional<T> m_value;
+};
+
+template <>
+struct TaskPromise<void> : public TaskPromiseBase
+{
+    Task<void> get_return_object() noexcept;
+
+    void return_void() noexcept {}
+
+    void result()
+    {
+        if (m_exception)
+        {
+            std::rethrow_exception(m_exception);
+        }
+    }
+};
+
+} // namespace detail
+
+// 无栈协程任务，只能移动，持有协程帧的所有权
+template <typename T>
+class Task
+{
+public:
+    typedef detail::TaskPromise<T> promise_type;
+    typedef std::coroutine_handle<promise_type> handle_type;
+
+    Task() = default;
+    explicit Task(handle_type handle)
+        : m_handle(handle) {}
+
+    Task(Task&& other) noexcept
+        : m_handle(std::exchange(other.m_handle, nullptr)) {}
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            destroy();
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+
+    Task(const Task&)            = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() { destroy(); }
+
+    bool valid() const { return static_cast<bool>(m_handle); }
+    bool done() const { return !m_handle || m_handle.done(); }
+
+    auto operator co_await() && noexcept
+    {
+        struct Awaiter
+        {
+            handle_type m_handle;
+
+            bool await_ready() noexcept { return !m_handle || m_handle.done(); }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+            {
+                m_handle.promise().m_continuation = awaiting;
+                return m_handle;
+            }
+
+            T await_resume() { return m_handle.promise().result(); }
+        };
+        return Awaiter{m_handle};
+    }
+
+    // 放弃所有权，任务结束时由 final_suspend 自行销毁；已被移走或已 detach 的任务返回空句柄
+    handle_type detach()
+    {
+        if (!m_handle)
+        {
+            return nullptr;
+        }
+        handle_type handle              = std::exchange(m_handle, nullptr);
+        handle.promise().m_detached     = true;
+        handle.promise().m_continuation = nullptr;
+        return handle;
+    }
+
+private:
+    void destroy()
+    {
+        if (m_handle)
+        {
+            m_handle.destroy();
+            m_handle = nullptr;
+        }
+    }
+
+private:
+    handle_type m_handle;
+};
+
+namespace detail
+{
+
+template <typename T>
+inline Task<T> TaskPromise<T>::get_return_object() noexcept
+{
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept
+{
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+// 等待 fd 的读写事件，事件触发后回调进入调度队列恢复协程
+class IoEventAwaiter
+{
+public:
+    IoEventAwaiter(int fd, IOManager::EventType event)
+        : m_fd(fd),
+          m_event(event) {}
+
+    bool await_ready() noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        IOManager* iom = IOManager::GetThis();
+        if (!iom)
+        {
+            m_ok = false;
+            return false;
+        }
+        m_ok = true;
+        // addEvent 成功后，回调可能已经在其它线程恢复协程，之后不能再访问 this
+        int rt = iom->addEvent(m_fd, m_event, [handle]()
+                               { handle.resume(); });
+        if (rt)
+        {
+            m_ok = false;
+            return false;
+        }
+        return true;
+    }
+
+    // 返回是否成功等待到事件（cancelEvent 同样会唤醒）
+    bool await_resume() noexcept { return m_ok; }
+
+private:
+    int m_fd;
+    IOManager::EventType m_event;
+    bool m_ok = false;
+};
+
+class SleepAwaiter
+{
+public:
+    explicit SleepAwaiter(uint64_t ms)
+        : m_ms(ms) {}
+
+    bool await_ready() noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        IOManager* iom = IOManager::GetThis();
+        if (!iom)
+        {
+            return false;
+        }
+        iom->addTimer(
+            m_ms, [handle]()
+            { handle.resume(); },
+            false);
+        return true;
+    }
+
+    void await_resume() noexcept {}
+
+private:
+    uint64_t m_ms;
+};
+
+class ScheduleAwaiter
+{
+public:
+    ScheduleAwaiter(Scheduler* scheduler, int thread)
+        : m_scheduler(scheduler),
+          m_thread(thread) {}
+
+    bool await_ready() noexcept { return !m_scheduler; }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        m_scheduler->schedule(std::function<void()>([handle]()
+                                                    { handle.resume(); }),
+                              m_thread);
+    }
+
+    void await_resume() noexcept {}
+
+private:
+    Scheduler* m_scheduler;
+    int m_thread;
+};
+
+} // namespace detail
+
+// 等待 fd 可读，返回 false 表示注册事件失败
+inline detail::IoEventAwaiter readable(int fd)
+{
+    return detail::IoEventAwaiter(fd, IOManager::READ);
+}
+
+// 等待 fd 可写，返回 false 表示注册事件失败
+inline detail::IoEventAwaiter writable(int fd)
+{
+    return detail::IoEventAwaiter(fd, IOManager::WRITE);
+}
+
+// 挂起当前协程 ms 毫秒，不占用线程
+inline detail::SleepAwaiter sleep_for(uint64_t ms)
+{
+    return detail::SleepAwaiter(ms);
+}
+
+// 切换到指定调度器（及线程）上继续执行
+inline detail::ScheduleAwaiter schedule_on(Scheduler* scheduler, int thread = -1)
+{
+    return detail::ScheduleAwaiter(scheduler, thread);
+}
+
+// 让出执行权，重新排到当前调度器的队尾
+inline detail::ScheduleAwaiter yield()
+{
+    return detail::ScheduleAwaiter(Scheduler::GetThis(), -1);
+}
+
+// 在调度器上分离启动一个任务
+inline void CoSpawn(Scheduler* scheduler, Task<void> task, int thread = -1)
+{
+    auto handle = task.detach();
+    if (!handle)
+    {
+        return;
+    }
+    scheduler->schedule(std::function<void()>([handle]()
+                                              { handle.resume(); }),
+                        thread);
+}
+
+} // namespace trycle
+
+#endif // TRY_COROUTINE_H
@@ -0,0 +1,104 @@
+#ifndef TRY_DATAGRAM_H
+#define TRY_DATAGRAM_H
+
+#include <memory>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <vector>
+
+namespace trycle
+{
+
+/**
+ * 批量收发 UDP 报文
+ *
+ * 构造时一次性分配 capacity 个 mmsghdr、iovec、地址、控制消息以及报文缓冲区，
+ * 之后每一批都循环复用这些槽位，收发过程中不再分配内存。
+ * recv/send 走 hook 过的 recvmmsg/sendmmsg，EAGAIN 时挂起当前协程而不是阻塞线程。
+ *
+ * recv 之后每个槽位的长度和地址就是收到的报文及其来源，直接 send 即可原样回发（echo）。
+ */
+class DatagramBatch
+{
+public:
+    typedef std::shared_ptr<DatagramBatch> ptr;
+
+    /**
+     * @brief 构造函数
+     * @param {size_t} capacity 一批最多的报文数
+     * @param {size_t} buffer_size 每个槽位的缓冲区大小，开启 GRO/GSO 时应足够容纳合并后的报文（最大 64KB）
+     */
+    DatagramBatch(size_t capacity = 64, size_t buffer_size = 2048);
+
+    DatagramBatch(const DatagramBatch&)            = delete;
+    DatagramBatch& operator=(const DatagramBatch&) = delete;
+
+    /**
+     * @brief 接收一批报文，至少收到一个才返回，之后能立即读到的都一起收下
+     * @param {int} fd UDP socket
+     * @param {int} flags recvmmsg 的 flags
+     * @return {*} 收到的报文数，出错返回 -1
+     */
+    int recv(int fd, int flags = 0);
+
+    /**
+     * @brief 把已有的报文全部发出，sendmmsg 一次没有发完时继续发送
+     * @param {int} fd UDP socket
+     * @param {int} flags sendmmsg 的 flags
+     * @return {*} 发出的报文数，一个都没有发出且出错时返回 -1；发送后清空批次
+     */
+    int send(int fd, int flags = 0);
+
+    /**
+     * @brief 追加一个待发送的报文（拷贝到槽位缓冲区）
+     * @param {uint16_t} gso_size 非 0 时按该长度交给内核做 UDP GSO 分段，不支持 GSO 时返回 false
+     * @return {*} 批次已满或数据超过槽位缓冲区时返回 false
+     */
+    bool push(const void* data, size_t len, const sockaddr* addr, socklen_t addr_len, uint16_t gso_size = 0);
+
+    void clear() { m_count = 0; }
+    bool full() const { return m_count == m_capacity; }
+
+    size_t size() const { return m_count; }
+    size_t capacity() const { return m_capacity; }
+    size_t bufferSize() const { return m_buffer_size; }
+
+    char* data(size_t i) { return &m_buffer[i * m_buffer_size]; }
+    size_t length(size_t i) const { return m_lengths[i]; }
+    void setLength(size_t i, size_t len) { m_lengths[i] = len; }
+    const sockaddr* addr(size_t i) const { return (const sockaddr*)&m_addrs[i]; }
+    socklen_t addrLen(size_t i) const { return m_msgs[i].msg_hdr.msg_namelen; }
+
+    /**
+     * @brief 开启 GRO 时，内核会把同一条流的多个报文合并到一个槽位，这里返回合并前每段的长度
+     * @return {*} 0 表示该槽位只有一个报文
+     */
+    uint16_t segmentSize(size_t i) const { return m_segments[i]; }
+
+public:
+    /**
+     * @brief 开启 UDP GRO（Linux 5.0+），内核或头文件不支持时返回 false
+     */
+    static bool EnableGro(int fd);
+
+    /**
+     * @brief 编译期是否支持 UDP GSO（UDP_SEGMENT）
+     */
+    static bool SupportGso();
+
+private:
+    size_t m_capacity;
+    size_t m_buffer_size;
+    size_t m_count = 0;
+    std::vector<mmsghdr> m_msgs;
+    std::vector<iovec> m_iovs;
+    std::vector<sockaddr_storage> m_addrs;
+    std::vector<size_t> m_lengths;
+    std::vector<uint16_t> m_segments;
+    std::vector<char> m_controls;
+    std::vector<char> m_buffer;
+};
+
+} // namespace trycle
+
+#endif // TRY_DATAGRAM_H
@@ -20,17 +20,25 @@ template <typename T>
 typename std::enable_if<sizeof(uint32_t) == sizeof(T), T>::type
 byteswap(T val)
 {
-    return bswap_32(val);
+    return (T)bswap_32((uint32_t)val);
 }
 
 template <typename T>
 typename std::enable_if<sizeof(uint16_t) == sizeof(T), T>::type
 byteswap(T val)
 {
-    return bswap_16(val);
+    return (T)bswap_16((uint16_t)val);
 }
 
-#if BYTE_ORDER == TRY_ORDER_LITTLE_ENDIAN
+template <typename T>
+typename std::enable_if<sizeof(uint8_t) == sizeof(T), T>::type
+byteswap(T val)
+{
+    return val;
+}
+
+// <endian.h> 中 BYTE_ORDER 的取值是 __LITTLE_ENDIAN(1234) / __BIG_ENDIAN(4321)
+#if BYTE_ORDER == LITTLE_ENDIAN
 #define TRY_BYTE_ORDER TRY_ORDER_LITTLE_ENDIAN
 #else
 #define TRY_BYTE_ORDER TRY_ORDER_BIG_ENDIAN
@@ -42,7 +50,7 @@ byteswap(T val)
  * @brief 在小端机器上执行 byteswap，在大端机器上什么都不用
  */
 template <typename T>
-T byteswapOnLittleEndian(t val)
+T byteswapOnLittleEndian(T val)
 {
     return byteswap(val);
 }
@@ -51,7 +59,7 @@ T byteswapOnLittleEndian(t val)
  * @brief 在大端机器上执行 byteswap，在小端机器上什么都不用
  */
 template <typename T>
-T byteswapOnBigEndian(t val)
+T byteswapOnBigEndian(T val)
 {
     return val;
 }
@@ -63,16 +71,16 @@ T byteswapOnBigEndian(t val)
 template <typename T>
 T byteswapOnLittleEndian(T val)
 {
-    return byteswap(val);
+    return val;
 }
 
 /**
- * @brief 在小端机器上执行 byteswap，在大端机器上什么都不用
+ * @brief 在大端机器上执行 byteswap，在小端机器上什么都不用
  */
 template <typename T>
 T byteswapOnBigEndian(T val)
 {
-    return val;
+    return byteswap(val);
 }
 
 #endif
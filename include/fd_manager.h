@@ -1,56 +1,112 @@
 #ifndef TRY_FD_MANAGER_H
 #define TRY_FD_MANAGER_H
 
+#include <atomic>
 #include <memory>
 #include <stdint.h>
 #include <unistd.h>
-#include <vector>
 
+#include "fd_table.h"
 #include "singleton.h"
 #include "thread.h"
 
 namespace trycle
 {
 
-class FdCtx : public std::enable_shared_from_this<FdCtx>
+class IOManager;
+
+/**
+ * fd 的 hook 属性，内联存放在 FdManager 的 FdTable 中，不会被释放
+ * m_generation 为奇数表示 fd 正在使用，del 之后变为偶数，
+ * 同一个 fd 被重新分配时代数继续增长，持有旧代数的调用方可以据此发现 fd 已经被复用
+ * 属性各自是原子变量，按顺序锁的方式读取：snapshot 读前读后各取一次代数，
+ * 两次相同且为奇数时读到的是同一代的完整属性
+ */
+class FdCtx
 {
 public:
-    typedef std::shared_ptr<FdCtx> ptr;
-
-    FdCtx(int fd);
+    // 同一代属性的一致快照
+    struct Snapshot
+    {
+        uint32_t generation   = 0;
+        bool is_socket        = false;
+        bool is_hookable      = false;
+        bool is_sys_nonblock  = false;
+        bool is_user_nonblock = false;
+        bool is_closed        = false;
+        uint64_t recv_timeout = -1;
+        uint64_t send_timeout = -1;
+
+        uint64_t getTimeout(int type) const;
+    };
+
+    FdCtx();
     ~FdCtx();
 
     bool init();
+    void reset(int fd);
+    void resetNonBlock(int fd, bool is_socket, bool user_nonblock);
+    void resetFrom(int fd, const FdCtx& other);
+    void retire();
+
+    /**
+     * @brief 无锁读取当前代的全部属性，读取期间被重置时重读
+     * @param {Snapshot&} snap
+     * @return {*} fd 不再存活时返回 false，此时 snap 无效
+     */
+    bool snapshot(Snapshot& snap) const;
 
     void setTimeout(int type, uint64_t val);
     uint64_t getTimeout(int type);
 
-    bool getIsInit() { return m_isInit; }
-    void setIsInit(bool isInit) { m_isInit = isInit; }
-    bool getIsSocket() { return m_isSocket; }
-    void setIsSocket(bool isSocket) { m_isSocket = isSocket; }
-    bool getIsSysNoBlock() { return m_isSysNoBlock; }
-    void setIsSysNoBlock(bool isSysNoBlock) { m_isSysNoBlock = isSysNoBlock; }
-    bool getIsUserNoBlock() { return m_isUserNoBlock; }
-    void setIsUserNoBlock(bool isUserNoBlock) { m_isUserNoBlock = isUserNoBlock; }
-    int getFd() { return m_fd; }
-    void gstFd(int fd) { m_fd = fd; }
-    // uint64_t getRecvTimeout() { return m_recvTimeout; }
-    // void getRecvTimeout(uint64_t recvTimeout) { m_recvTimeout = recvTimeout; }
-    // uint64_t getSendTimeout() { return m_sendTimeout; }
-    // void getSendTimeout(uint64_t sendTimeout) { m_sendTimeout = sendTimeout; }
-    bool isClosed() { return m_isClosed; }
-    void setClose(bool closed) { m_isClosed = closed; };
+    bool getIsInit() { return m_isInit.load(std::memory_order_relaxed); }
+    void setIsInit(bool isInit) { m_isInit.store(isInit, std::memory_order_relaxed); }
+    bool getIsSocket() { return m_isSocket.load(std::memory_order_relaxed); }
+    void setIsSocket(bool isSocket) { m_isSocket.store(isSocket, std::memory_order_relaxed); }
+    bool getIsFifo() { return m_isFifo.load(std::memory_order_relaxed); }
+    // socket 和管道的读写可以交给 epoll 等待，其它 fd 直接调用系统函数
+    bool isHookable() { return getIsSocket() || getIsFifo(); }
+    bool getIsSysNoBlock() { return m_isSysNoBlock.load(std::memory_order_relaxed); }
+    void setIsSysNoBlock(bool isSysNoBlock) { m_isSysNoBlock.store(isSysNoBlock, std::memory_order_relaxed); }
+    bool getIsUserNoBlock() { return m_isUserNoBlock.load(std::memory_order_relaxed); }
+    void setIsUserNoBlock(bool isUserNoBlock) { m_isUserNoBlock.store(isUserNoBlock, std::memory_order_relaxed); }
+    int getFd() { return m_fd.load(std::memory_order_relaxed); }
+    void setFd(int fd) { m_fd.store(fd, std::memory_order_relaxed); }
+    bool isClosed() { return m_isClosed.load(std::memory_order_relaxed); }
+    void setClose(bool closed) { m_isClosed.store(closed, std::memory_order_relaxed); };
+
+    uint32_t getGeneration() const { return m_generation.load(std::memory_order_acquire); }
+    bool isAlive() const { return getGeneration() & 1; }
+
+    // 主动取消：读写分别计数，在 cancelEvent 之前递增，hook 中被唤醒的读写发现本方向的计数变化后返回 ECANCELED 而不是继续等待
+    uint32_t getCancelCount(bool read) const { return (read ? m_read_cancel : m_write_cancel).load(); }
+    void cancel(bool read) { ++(read ? m_read_cancel : m_write_cancel); }
+
+    // hook 中挂起等待读/写的 IOManager，挂起前登记、唤醒后清除，其他线程取消时据此找到事件所在的 IOManager
+    // 与取消计数都用顺序一致的读写：取消方先递增计数再读登记，等待方先登记再读计数，至少一方能看到另一方
+    IOManager* getWaiter(bool read) const { return (read ? m_read_waiter : m_write_waiter).load(); }
+    void setWaiter(bool read, IOManager* iom) { (read ? m_read_waiter : m_write_waiter).store(iom); }
 
 private:
-    bool m_isInit : 1;
-    bool m_isSocket : 1;
-    bool m_isSysNoBlock : 1;
-    bool m_isUserNoBlock : 1;
-    bool m_isClosed : 1;
-    int m_fd               = -1;
-    uint64_t m_recvTimeout = -1;
-    uint64_t m_sendTimeout = -1;
+    void clear(int fd);
+    void publish();
+
+private:
+    // fcntl/ioctl 的 hook 与 close 可能在不同线程上同时写，每个属性单独原子，不用位域
+    std::atomic<bool> m_isInit{false};
+    std::atomic<bool> m_isSocket{false};
+    std::atomic<bool> m_isFifo{false};
+    std::atomic<bool> m_isSysNoBlock{false};
+    std::atomic<bool> m_isUserNoBlock{false};
+    std::atomic<bool> m_isClosed{false};
+    std::atomic<int> m_fd{-1};
+    std::atomic<uint64_t> m_recvTimeout{(uint64_t)-1};
+    std::atomic<uint64_t> m_sendTimeout{(uint64_t)-1};
+    std::atomic<uint32_t> m_generation{0};
+    std::atomic<uint32_t> m_read_cancel{0};
+    std::atomic<uint32_t> m_write_cancel{0};
+    std::atomic<IOManager*> m_read_waiter{nullptr};
+    std::atomic<IOManager*> m_write_waiter{nullptr};
 };
 
 class FdManager
@@ -58,17 +114,37 @@ class FdManager
 
 public:
     typedef std::shared_ptr<FdManager> ptr;
-    typedef RWMutex MutexType;
+    typedef Mutex MutexType;
 
     FdManager();
     ~FdManager();
 
-    FdCtx::ptr get(int fd, bool auto_create = false);
+    /**
+     * @brief 获取 fd 的上下文，查找路径无锁，不增加引用计数
+     * @param {int} fd
+     * @param {bool} auto_create 不存在时是否创建
+     * @return 未注册或超出 FdTable 容量时返回 nullptr
+     */
+    FdCtx* get(int fd, bool auto_create = false);
+
+    /**
+     * @brief 登记一个创建时已经是非阻塞（SOCK_NONBLOCK/O_NONBLOCK）的 socket 或管道，跳过 fstat 和 fcntl
+     * @param {int} fd
+     * @param {bool} is_socket true 为 socket，false 为管道
+     * @param {bool} user_nonblock 用户自己是否要求非阻塞
+     */
+    FdCtx* addNonBlock(int fd, bool is_socket, bool user_nonblock);
+
+    /**
+     * @brief dup 之后 newfd 与 oldfd 共享文件状态，复制 oldfd 的属性，oldfd 未登记时返回 nullptr
+     */
+    FdCtx* dup(int oldfd, int newfd);
+
     void del(int fd);
 
 private:
-    MutexType m_mutex;
-    std::vector<FdCtx::ptr> m_fd_ctx_list;
+    MutexType m_mutex; // 只串行化创建和删除
+    FdTable<FdCtx> m_fd_ctx_table;
 };
 
 typedef SingletonPtr<FdManager> FdMgr;
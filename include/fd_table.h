@@ -0,0 +1,112 @@
+#ifndef TRY_FD_TABLE_H
+#define TRY_FD_TABLE_H
+
+#include <atomic>
+#include <stddef.h>
+
+namespace trycle
+{
+
+/**
+ * 以 fd 为下标的分段表，查找无锁
+ *
+ * 表由 SEGMENT_COUNT 个段组成，每段内联 2^SEGMENT_SHIFT 个 T 对象，
+ * 段在第一次访问时分配，通过 CAS 发布，之后直到表析构都不会移动或释放，
+ * 所以拿到的 T* 在表的生命周期内一直有效，不需要引用计数，也不需要扩容锁。
+ *
+ * 默认 1024 * 1024 个槽位，覆盖 fd [0, 1048576)，超出范围返回 nullptr。
+ * 槽位被复用时（fd 关闭后又被分配）的旧状态由 T 自己的代数（generation）区分。
+ */
+template <typename T, size_t SEGMENT_SHIFT = 10, size_t SEGMENT_COUNT = 1024>
+class FdTable
+{
+public:
+    static const size_t SEGMENT_SIZE = (size_t)1 << SEGMENT_SHIFT;
+    static const size_t CAPACITY     = SEGMENT_SIZE * SEGMENT_COUNT;
+
+    FdTable()
+    {
+        for (size_t i = 0; i < SEGMENT_COUNT; ++i)
+        {
+            m_segments[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    ~FdTable()
+    {
+        for (size_t i = 0; i < SEGMENT_COUNT; ++i)
+        {
+            delete[] m_segments[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    FdTable(const FdTable&)            = delete;
+    FdTable& operator=(const FdTable&) = delete;
+
+    /**
+     * @brief 查找 fd 对应的槽位，所在段尚未分配时返回 nullptr
+     */
+    T* get(int fd) const
+    {
+        if (fd < 0 || (size_t)fd >= CAPACITY)
+        {
+            return nullptr;
+        }
+        T* segment = m_segments[(size_t)fd >> SEGMENT_SHIFT].load(std::memory_order_acquire);
+        if (!segment)
+        {
+            return nullptr;
+        }
+        return &segment[(size_t)fd & (SEGMENT_SIZE - 1)];
+    }
+
+    /**
+     * @brief 查找 fd 对应的槽位，所在段不存在时分配
+     * @param {int} fd
+     * @param {Init} init 新段中每个槽位发布前调用一次 init(T&, int fd)
+     */
+    template <typename Init>
+    T* getOrCreate(int fd, Init init)
+    {
+        if (fd < 0 || (size_t)fd >= CAPACITY)
+        {
+            return nullptr;
+        }
+        size_t index                 = (size_t)fd >> SEGMENT_SHIFT;
+        std::atomic<T*>& segment_ref = m_segments[index];
+        T* segment                   = segment_ref.load(std::memory_order_acquire);
+        if (!segment)
+        {
+            T* fresh = new T[SEGMENT_SIZE];
+            int base = (int)(index << SEGMENT_SHIFT);
+            for (size_t i = 0; i < SEGMENT_SIZE; ++i)
+            {
+                init(fresh[i], base + (int)i);
+            }
+            // 多个线程同时分配同一段时，只有一个能发布成功，其余的释放自己的副本
+            if (segment_ref.compare_exchange_strong(segment, fresh,
+                                                    std::memory_order_acq_rel,
+                                                    std::memory_order_acquire))
+            {
+                segment = fresh;
+            }
+            else
+            {
+                delete[] fresh;
+            }
+        }
+        return &segment[(size_t)fd & (SEGMENT_SIZE - 1)];
+    }
+
+    T* getOrCreate(int fd)
+    {
+        return getOrCreate(fd, [](T&, int) {});
+    }
+
+private:
+    std::atomic<T*> m_segments[SEGMENT_COUNT];
+};
+
+} // namespace trycle
+
+#endif // TRY_FD_TABLE_H
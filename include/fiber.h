@@ -1,16 +1,65 @@
 #ifndef TRY_FIBER_H
 #define TRY_FIBER_H
 
+#include <atomic>
 #include <functional>
 #include <memory>
+#include <string>
 #include <ucontext.h>
+#include <vector>
 
 namespace trycle
 {
 
+// 按 tag 聚合的协程耗时统计，对象创建后不会释放，协程直接持有指针做原子累加
+struct FiberTagStats
+{
+    explicit FiberTagStats(const std::string& name)
+        : tag(name) {}
+
+    std::string tag;
+    std::atomic<uint64_t> run_ns{0};   // 在线程上执行的时间
+    std::atomic<uint64_t> hold_ns{0};  // 处于 HOLD（等待 IO、定时器）的时间
+    std::atomic<uint64_t> ready_ns{0}; // 在队列中排队的时间（READY/INIT，及被唤醒入队后的 HOLD）
+    std::atomic<uint64_t> switches{0}; // 切入次数
+    std::atomic<uint64_t> overruns{0}; // 连续执行超过时间片的次数
+    std::atomic<uint64_t> fibers{0};   // 使用过该 tag 的协程数
+};
+
+// FiberTagStats 的快照
+struct FiberStatsSnapshot
+{
+    std::string tag;
+    uint64_t run_ns   = 0;
+    uint64_t hold_ns  = 0;
+    uint64_t ready_ns = 0;
+    uint64_t switches = 0;
+    uint64_t overruns = 0;
+    uint64_t fibers   = 0;
+};
+
+class Scheduler;
+class Arena;
+
+// 存活协程的快照，用于导出协程清单和排查卡住的协程
+struct FiberInfo
+{
+    uint32_t id          = 0;
+    int state            = 0;
+    std::string tag;
+    std::string scheduler;   // 最近一次调度该协程的调度器名称
+    uint32_t last_thread = 0; // 最近一次执行该协程的线程
+    uint64_t state_ms    = 0; // 处于当前状态的时长
+    std::string wait_on;      // 阻塞在哪个 hook 调用上（HOLD 时有效）
+    uint32_t overruns    = 0; // 连续执行超过时间片的次数
+    std::string backtrace;    // 进入 HOLD 时的调用栈（需打开 fiber.hold.backtrace）
+};
+
 // 协程类
 class Fiber : public std::enable_shared_from_this<Fiber>
 {
+    friend class Scheduler;
+    friend class FiberRegistry;
 
 public:
     enum State
@@ -39,11 +88,34 @@ public:
     void back();
 
     bool isFinish() { return m_state == TERM || m_state == EXCEPT; }
+    // 上下文还在某个线程上，swapcontext 保存完之前都算，调度器不能在其它线程上切入
+    bool isRunning() const { return m_running.load(std::memory_order_acquire); }
 
     uint32_t get_id() { return m_id; }
     State get_state() { return m_state; }
     void set_state(State state) { m_state = state; }
 
+    // 设置协程的 name/tag，耗时统计按 tag 聚合
+    void setTag(const std::string& tag);
+    const std::string& getTag() const;
+
+    uint64_t getRunNs() const { return m_run_ns; }
+    uint64_t getHoldNs() const { return m_hold_ns; }
+    uint64_t getReadyNs() const { return m_ready_ns; }
+    uint64_t getSwitches() const { return m_switches; }
+    uint32_t getOverruns() const { return m_overruns; }
+
+    // 调度优先级（Scheduler::Priority），被 schedule 显式指定后保持，reset 时恢复为 NORMAL
+    int getPriority() const { return m_priority; }
+    void setPriority(int priority) { m_priority = priority; }
+
+    // 是否接受时间片检查，调度器内部的 root/idle 协程会长期处于 EXEC，需要排除
+    void setSliceWatched(bool val) { m_slice_watched.store(val, std::memory_order_relaxed); }
+
+    // 协程的 arena，第一次调用时创建；协程执行结束、reset 时释放其中的内存，arena 对象保留复用
+    // 线程主协程和调度器的 root/idle 协程不会释放 arena，在其中调用会触发 ASSERT
+    Arena* getArena();
+
 public:
     // 获取当前协程
     static Fiber::ptr GetThis();
@@ -61,19 +133,81 @@ public:
     static void MainFunc();
     // 获取协程id
     static uint32_t GetFiberId();
+    // 获取所有 tag 的耗时统计快照，不会阻塞正在运行的协程
+    static void GetTagStats(std::vector<FiberStatsSnapshot>& result);
+    // 记录当前协程即将阻塞在哪个调用上（如 hook 的 read、connect），切回时自动清除
+    static void SetWaitReason(const char* reason);
+    /**
+     * @brief 协作式抢占点，长时间计算的循环里调用
+     * 监控线程发现当前协程执行超过时间片后会设置标记，这里只读一次原子变量；
+     * 标记被设置且处于调度器中时，让出执行权（READY）重新排队
+     * @return {*} 是否发生了让出
+     */
+    static bool maybeYield();
+    /**
+     * @brief 检查所有 EXEC 协程，连续执行超过 slice_ms 的设置让出标记并计一次超时
+     * @param {uint64_t} slice_ms 时间片
+     * @param {vector<FiberInfo>*} overruns 本次新发现的超时协程，可为 nullptr
+     * @return {*} 本次新发现的超时协程数
+     */
+    static size_t CheckSlices(uint64_t slice_ms, std::vector<FiberInfo>* overruns = nullptr);
+    // 获取所有存活协程的快照，with_backtrace 为 true 时附带 HOLD 协程的调用栈
+    static void ListFibers(std::vector<FiberInfo>& result, bool with_backtrace = false);
+    // 导出所有存活协程（id、状态、调度器、线程、状态时长、阻塞调用、调用栈）
+    static std::string DumpFibers(bool with_backtrace = true);
+    static const char* StateToString(State state);
 
 private:
     Fiber();
 
+    // 切入时累计等待时间，切出时累计运行时间
+    void onSwapIn();
+    void onSwapOut();
+    // 由 Scheduler 在入队时调用，HOLD 状态下被唤醒的协程从这时起算 READY 时间
+    void onScheduled(uint64_t now_ns);
+    void resetStats();
+    void captureBacktrace();
+    void fillInfo(FiberInfo& info, uint64_t now_ns, bool with_backtrace);
+
 private:
     uint32_t m_id       = 0;
     size_t m_stack_size = 0;
-    State m_state       = INIT;
+    // 状态会被协程清单、看门狗等其它线程读取
+    std::atomic<State> m_state{INIT};
+    std::atomic<bool> m_running{false};
 
     ucontext_t m_ctx;
     void* m_stack = nullptr;
 
     FiberCb m_cb;
+
+    std::atomic<FiberTagStats*> m_tag_stats{nullptr};
+    std::atomic<uint64_t> m_state_ns{0};  // 进入当前状态的时间点（单调时钟）
+    std::atomic<uint64_t> m_queued_ns{0}; // HOLD 状态下被唤醒入队的时间点，0 表示未入队
+    bool m_tag_counted  = false;          // 本次执行是否已计入 tag 的协程数
+    uint64_t m_run_ns   = 0;
+    uint64_t m_hold_ns  = 0;
+    uint64_t m_ready_ns = 0;
+    uint64_t m_switches = 0;
+
+    std::atomic<Scheduler*> m_scheduler{nullptr};
+    std::atomic<uint32_t> m_last_thread{0};
+    std::atomic<const char*> m_wait_reason{nullptr};
+
+    static const int MAX_HOLD_BACKTRACE = 16;
+    void* m_hold_bt[MAX_HOLD_BACKTRACE];
+    std::atomic<int> m_hold_bt_size{0};
+
+    std::atomic<bool> m_yield_requested{false};
+    std::atomic<uint32_t> m_overruns{0};
+    std::atomic<bool> m_slice_watched{true};
+    int m_priority = 1; // Scheduler::NORMAL
+    std::unique_ptr<Arena> m_arena;
+
+    // 存活协程登记表的侵入式链表，由 FiberRegistry 持分片锁访问
+    Fiber* m_reg_prev    = nullptr;
+    Fiber* m_reg_next    = nullptr;
+    uint32_t m_reg_shard = 0;
 };
 
 } // namespace trycle
@@ -0,0 +1,66 @@
+#ifndef TRY_FIBER_WATCHDOG_H
+#define TRY_FIBER_WATCHDOG_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+
+#include "fiber.h"
+#include "thread.h"
+
+namespace trycle
+{
+
+/**
+ * 协程看门狗
+ * 独立线程周期性扫描存活协程，处于 HOLD/READY 超过阈值的协程输出告警日志（附带调用栈），
+ * 同一个协程在同一次停留中只告警一次。
+ * 同时监控 EXEC 协程的时间片，连续执行超过 slice_ms 的协程会被设置让出标记
+ * （由 Fiber::maybeYield 响应），并记录一次超时。
+ */
+class FiberWatchdog
+{
+public:
+    typedef std::shared_ptr<FiberWatchdog> ptr;
+
+    /**
+     * @param {uint64_t} stuck_ms 卡住阈值，0 表示使用配置 fiber.watchdog.stuck_ms
+     * @param {uint64_t} interval_ms 扫描间隔，0 表示使用配置 fiber.watchdog.interval_ms
+     * @param {uint64_t} slice_ms 时间片，0 表示使用配置 fiber.watchdog.slice_ms
+     */
+    FiberWatchdog(uint64_t stuck_ms = 0, uint64_t interval_ms = 0, uint64_t slice_ms = 0);
+    ~FiberWatchdog();
+
+    void start();
+    void stop();
+
+    // 立即扫描一次，返回新发现的卡住协程数
+    size_t check();
+    // 立即检查一次时间片，返回新发现的超时协程数
+    size_t checkSlices();
+
+    uint64_t getStuckMs() const { return m_stuck_ms; }
+    uint64_t getIntervalMs() const { return m_interval_ms; }
+    uint64_t getSliceMs() const { return m_slice_ms; }
+    // 启动以来告警过的卡住协程、时间片超时次数
+    uint64_t getStuckReports() const { return m_stuck_reports; }
+    uint64_t getOverrunReports() const { return m_overrun_reports; }
+
+private:
+    void run();
+
+private:
+    uint64_t m_stuck_ms;
+    uint64_t m_interval_ms;
+    uint64_t m_slice_ms;
+    std::atomic<bool> m_running{false};
+    std::atomic<uint64_t> m_stuck_reports{0};
+    std::atomic<uint64_t> m_overrun_reports{0};
+    Thread::ptr m_thread;
+    // 已告警的协程 id -> 告警时的状态时长，用于去重
+    std::map<uint32_t, uint64_t> m_reported;
+};
+
+} // namespace trycle
+
+#endif // TRY_FIBER_WATCHDOG_H
@@ -0,0 +1,231 @@
+#ifndef TRY_HTTP_H
+#define TRY_HTTP_H
+
+#include <memory>
+#include <ostream>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace trycle
+{
+namespace http
+{
+
+/* Request Methods */
+#define HTTP_METHOD_MAP(XX)     \
+    XX(0, DELETE, DELETE)       \
+    XX(1, GET, GET)             \
+    XX(2, HEAD, HEAD)           \
+    XX(3, POST, POST)           \
+    XX(4, PUT, PUT)             \
+    XX(5, CONNECT, CONNECT)     \
+    XX(6, OPTIONS, OPTIONS)     \
+    XX(7, TRACE, TRACE)         \
+    XX(8, PATCH, PATCH)
+
+/* Status Codes */
+#define HTTP_STATUS_MAP(XX)                                                 \
+    XX(100, CONTINUE, Continue)                                             \
+    XX(101, SWITCHING_PROTOCOLS, Switching Protocols)                       \
+    XX(200, OK, OK)                                                         \
+    XX(201, CREATED, Created)                                               \
+    XX(202, ACCEPTED, Accepted)                                             \
+    XX(204, NO_CONTENT, No Content)                                         \
+    XX(206, PARTIAL_CONTENT, Partial Content)                               \
+    XX(301, MOVED_PERMANENTLY, Moved Permanently)                           \
+    XX(302, FOUND, Found)                                                   \
+    XX(304, NOT_MODIFIED, Not Modified)                                     \
+    XX(400, BAD_REQUEST, Bad Request)                                       \
+    XX(401, UNAUTHORIZED, Unauthorized)                                     \
+    XX(403, FORBIDDEN, Forbidden)                                           \
+    XX(404, NOT_FOUND, Not Found)                                           \
+    XX(405, METHOD_NOT_ALLOWED, Method Not Allowed)                         \
+    XX(408, REQUEST_TIMEOUT, Request Timeout)                               \
+    XX(411, LENGTH_REQUIRED, Length Required)                               \
+    XX(413, PAYLOAD_TOO_LARGE, Payload Too Large)                           \
+    XX(414, URI_TOO_LONG, URI Too Long)                                     \
+    XX(431, REQUEST_HEADER_FIELDS_TOO_LARGE, Request Header Fields Too Large) \
+    XX(500, INTERNAL_SERVER_ERROR, Internal Server Error)                   \
+    XX(501, NOT_IMPLEMENTED, Not Implemented)                               \
+    XX(502, BAD_GATEWAY, Bad Gateway)                                       \
+    XX(503, SERVICE_UNAVAILABLE, Service Unavailable)                       \
+    XX(504, GATEWAY_TIMEOUT, Gateway Timeout)                               \
+    XX(505, HTTP_VERSION_NOT_SUPPORTED, HTTP Version Not Supported)
+
+enum class HttpMethod
+{
+#define XX(num, name, string) name = num,
+    HTTP_METHOD_MAP(XX)
+#undef XX
+        INVALID_METHOD
+};
+
+enum class HttpStatus
+{
+#define XX(code, name, desc) name = code,
+    HTTP_STATUS_MAP(XX)
+#undef XX
+};
+
+HttpMethod StringToHttpMethod(const char* m, size_t len);
+const char* HttpMethodToString(HttpMethod m);
+const char* HttpStatusToString(HttpStatus s);
+
+/**
+ * 不持有数据的字符串片段，指向连接的读缓冲区
+ */
+struct StringView
+{
+    const char* data = nullptr;
+    size_t size      = 0;
+
+    StringView() {}
+    StringView(const char* d, size_t n)
+        : data(d),
+          size(n) {}
+    StringView(const char* s)
+        : data(s),
+          size(strlen(s)) {}
+    StringView(const std::string& s)
+        : data(s.data()),
+          size(s.size()) {}
+
+    bool empty() const { return size == 0; }
+    std::string toString() const { return std::string(data, size); }
+
+    bool operator==(const StringView& rhs) const { return size == rhs.size && memcmp(data, rhs.data, size) == 0; }
+    bool operator!=(const StringView& rhs) const { return !(*this == rhs); }
+    // 忽略大小写比较，用于头部名称和 token 值
+    bool equalsIgnoreCase(const StringView& rhs) const { return size == rhs.size && strncasecmp(data, rhs.data, size) == 0; }
+};
+
+std::ostream& operator<<(std::ostream& os, const StringView& sv);
+
+/**
+ * HTTP 请求
+ *
+ * 由 HttpRequestParser 在连接的读缓冲区上解析得到，请求行、头部、body 都只记录偏移，
+ * 访问时才换算成指向缓冲区的 StringView，不会拷贝。
+ * 因此请求只在本次处理期间有效：读取下一个请求时缓冲区会被移动或覆盖。
+ */
+class HttpRequest
+{
+    friend class HttpRequestParser;
+
+public:
+    // 缓冲区中的一段，相对请求起始位置
+    struct Range
+    {
+        uint32_t offset = 0;
+        uint32_t length = 0;
+    };
+
+    struct Header
+    {
+        Range name;
+        Range value;
+    };
+
+    HttpRequest();
+
+    HttpMethod getMethod() const { return m_method; }
+    // 0x11 表示 HTTP/1.1，0x10 表示 HTTP/1.0
+    uint8_t getVersion() const { return m_version; }
+    // 完整的 request-target，如 /index.html?a=1
+    StringView getTarget() const { return view(m_target); }
+    StringView getPath() const { return view(m_path); }
+    StringView getQuery() const { return view(m_query); }
+    StringView getBody() const { return view(m_body); }
+
+    size_t getHeaderCount() const { return m_headers.size(); }
+    StringView getHeaderName(size_t i) const { return view(m_headers[i].name); }
+    StringView getHeaderValue(size_t i) const { return view(m_headers[i].value); }
+
+    /**
+     * @brief 按名称（忽略大小写）查找第一个头部
+     * @param {StringView} def 不存在时返回的值
+     */
+    StringView getHeader(const StringView& name, const StringView& def = StringView()) const;
+    bool hasHeader(const StringView& name) const;
+
+    bool isKeepAlive() const { return m_keep_alive; }
+    bool isChunked() const { return m_chunked; }
+
+    std::ostream& dump(std::ostream& os) const;
+    std::string toString() const;
+
+private:
+    StringView view(const Range& r) const { return StringView(m_base + r.offset, r.length); }
+    void reset();
+
+private:
+    // 请求在缓冲区中的起始地址，解析完成时设置
+    const char* m_base = nullptr;
+    HttpMethod m_method;
+    uint8_t m_version;
+    bool m_keep_alive;
+    bool m_chunked;
+    Range m_target;
+    Range m_path;
+    Range m_query;
+    Range m_body;
+    std::vector<Header> m_headers;
+};
+
+/**
+ * HTTP 响应
+ *
+ * 头部和 body 都由响应持有，serializeHead 只生成状态行和头部，body 作为单独的一段，
+ * 由 HttpSession 与其它响应一起通过一次 writev 发出。
+ */
+class HttpResponse
+{
+public:
+    typedef std::shared_ptr<HttpResponse> ptr;
+
+    HttpResponse(uint8_t version = 0x11, bool keep_alive = true);
+
+    HttpStatus getStatus() const { return m_status; }
+    void setStatus(HttpStatus status) { m_status = status; }
+    uint8_t getVersion() const { return m_version; }
+    void setVersion(uint8_t version) { m_version = version; }
+    bool isKeepAlive() const { return m_keep_alive; }
+    void setKeepAlive(bool keep_alive) { m_keep_alive = keep_alive; }
+
+    const std::string& getBody() const { return m_body; }
+    std::string& getBody() { return m_body; }
+    void setBody(const std::string& body) { m_body = body; }
+    void setBody(std::string&& body) { m_body = std::move(body); }
+
+    /**
+     * @brief 设置头部，已存在时（忽略大小写）覆盖；content-length 和 connection 由 serializeHead 生成，不需要设置
+     */
+    void setHeader(const std::string& key, const std::string& val);
+    std::string getHeader(const std::string& key, const std::string& def = "") const;
+    void delHeader(const std::string& key);
+
+    /**
+     * @brief 把状态行和头部追加到 out，以空行结尾
+     */
+    void serializeHead(std::string& out) const;
+
+    std::ostream& dump(std::ostream& os) const;
+    std::string toString() const;
+
+private:
+    HttpStatus m_status = HttpStatus::OK;
+    uint8_t m_version;
+    bool m_keep_alive;
+    std::string m_body;
+    std::vector<std::pair<std::string, std::string>> m_headers;
+};
+
+std::ostream& operator<<(std::ostream& os, const HttpRequest& req);
+std::ostream& operator<<(std::ostream& os, const HttpResponse& rsp);
+
+} // namespace http
+} // namespace trycle
+
+#endif // TRY_HTTP_H
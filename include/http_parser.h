@@ -0,0 +1,108 @@
+#ifndef TRY_HTTP_PARSER_H
+#define TRY_HTTP_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "http.h"
+
+namespace trycle
+{
+namespace http
+{
+
+/**
+ * 增量式 HTTP/1.1 请求解析器
+ *
+ * 每次 execute 传入从请求起始位置开始、到目前为止收到的全部数据（可以在两次调用之间被移动或扩容），
+ * 解析器只保存相对请求起始位置的偏移，从上次停下的地方继续扫描，已经扫描过的字节不会再看第二遍。
+ * 行结束符用 memchr 查找（glibc 中按 SIMD 实现），头部只记录偏移，不拷贝。
+ *
+ * chunked 编码的 body 在缓冲区中原地解码：每个 chunk 的数据向前移动到上一个 chunk 之后，
+ * 解析完成时 body 是缓冲区中连续的一段。
+ *
+ * 一个请求解析完成后 getConsumed 返回它占用的字节数，后面的字节属于下一个（流水线）请求，
+ * 调用 reset 之后从那里继续解析。
+ */
+class HttpRequestParser
+{
+public:
+    enum Status
+    {
+        INCOMPLETE = 0, // 需要更多数据
+        DONE       = 1, // 一个请求解析完成
+        ERROR      = 2, // 请求格式错误或超过限制，getError 返回应答的状态码
+    };
+
+    HttpRequestParser();
+
+    /**
+     * @brief 解析请求
+     * @param {char*} data 请求的起始位置，chunked 编码时会被原地修改
+     * @param {size_t} len 目前已有的字节数，必须不少于上一次调用时的长度
+     * @return {*} 解析状态
+     */
+    Status execute(char* data, size_t len);
+
+    /**
+     * @brief 开始解析下一个请求，保留已分配的内存
+     */
+    void reset();
+
+    // 完成时请求占用的字节数
+    size_t getConsumed() const { return m_consumed; }
+    HttpStatus getError() const { return m_error; }
+    // execute 返回 DONE 之后有效，指向传入的缓冲区
+    HttpRequest& getRequest() { return m_request; }
+
+    /**
+     * @brief 头部（请求行加所有头部）最大长度，http.request.max_header_size
+     */
+    static uint64_t GetMaxHeaderSize();
+    /**
+     * @brief body 最大长度，http.request.max_body_size
+     */
+    static uint64_t GetMaxBodySize();
+
+private:
+    enum State
+    {
+        REQUEST_LINE,
+        HEADERS,
+        BODY,
+        CHUNK_SIZE,
+        CHUNK_DATA,
+        CHUNK_DATA_END,
+        TRAILERS,
+        FINISHED,
+    };
+
+    // 从 m_pos 开始找下一行，找到时返回 true，[line, line + line_len) 为不含 CRLF 的行
+    bool nextLine(const char* data, size_t len, size_t& line, size_t& line_len);
+    bool parseRequestLine(const char* data, size_t line, size_t line_len);
+    bool parseHeader(const char* data, size_t line, size_t line_len);
+    // 头部结束，根据 Transfer-Encoding、Content-Length 决定 body 的解析方式
+    bool headersDone(const char* data);
+    Status fail(HttpStatus status);
+
+private:
+    State m_state;
+    // 下一个要解析的位置
+    size_t m_pos;
+    // memchr 查找换行的起点，不小于 m_pos，避免重复扫描
+    size_t m_scan;
+    size_t m_consumed;
+    uint64_t m_content_length;
+    bool m_has_content_length;
+    // 当前 chunk 剩余的字节数
+    uint64_t m_chunk_left;
+    // 解码后 body 的结束位置
+    size_t m_body_end;
+    HttpStatus m_error;
+    HttpRequest m_request;
+};
+
+} // namespace http
+} // namespace trycle
+
+#endif // TRY_HTTP_PARSER_H
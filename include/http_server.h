@@ -0,0 +1,112 @@
+#ifndef TRY_HTTP_SERVER_H
+#define TRY_HTTP_SERVER_H
+
+#include <memory>
+#include <string>
+#include <sys/uio.h>
+#include <vector>
+
+#include "http.h"
+#include "http_parser.h"
+#include "servlet.h"
+#include "socket.h"
+#include "tcp_server.h"
+
+namespace trycle
+{
+namespace http
+{
+
+/**
+ * 服务端的一个 HTTP 连接
+ *
+ * 请求直接在读缓冲区上解析，缓冲区只在放不下时才整理（把未处理的数据移到开头）或扩容。
+ * 响应先排队，直到需要等待新数据（或排队的数据足够多）时才通过一次 writev 全部发出，
+ * 因此流水线上已经到达的多个请求的响应会合并在同一次系统调用中。
+ */
+class HttpSession
+{
+public:
+    typedef std::shared_ptr<HttpSession> ptr;
+
+    HttpSession(Socket::ptr sock);
+    ~HttpSession();
+
+    /**
+     * @brief 读取下一个请求，需要等待数据之前先发出排队的响应
+     * @return {*} 请求，在下一次调用之前有效；连接关闭、出错或请求格式错误时返回 nullptr
+     */
+    HttpRequest* recvRequest();
+
+    /**
+     * @brief recvRequest 返回 nullptr 时应答给客户端的状态码，OK 表示不需要应答（连接关闭或超时）
+     */
+    HttpStatus getError() const { return m_error; }
+
+    /**
+     * @brief 响应加入发送队列，body 被移走
+     * @param {bool} head_only 为 true 时只发送状态行和头部（HEAD 请求）
+     * @return {*} 队列满了触发发送且发送失败时返回 false
+     */
+    bool queueResponse(HttpResponse& response, bool head_only = false);
+
+    /**
+     * @brief 通过 writev 发出排队的响应
+     */
+    bool flush();
+
+    Socket::ptr getSocket() const { return m_sock; }
+
+private:
+    // 读缓冲区没有空间时整理或扩容
+    void reserve();
+    std::string& nextSegment();
+
+private:
+    Socket::ptr m_sock;
+    HttpRequestParser m_parser;
+    bool m_has_request = false;
+    HttpStatus m_error = HttpStatus::OK;
+
+    // 读缓冲区，[m_begin, m_end) 为未处理的数据
+    std::vector<char> m_buffer;
+    size_t m_begin = 0;
+    size_t m_end   = 0;
+
+    // 发送队列，字符串对象循环复用
+    std::vector<std::string> m_segments;
+    size_t m_segment_count = 0;
+    size_t m_pending_bytes = 0;
+    std::vector<iovec> m_iovs;
+};
+
+/**
+ * HTTP/1.1 服务器，支持长连接和流水线，请求交给 ServletDispatch 分发
+ */
+class HttpServer : public TcpServer
+{
+public:
+    typedef std::shared_ptr<HttpServer> ptr;
+
+    /**
+     * @brief 构造函数
+     * @param {bool} keepalive 是否允许长连接
+     */
+    HttpServer(bool keepalive = true, IOManager* worker = IOManager::GetThis(), IOManager* acceptor = IOManager::GetThis());
+    HttpServer(bool keepalive, const std::vector<IOManager*>& workers, const std::vector<IOManager*>& acceptors);
+
+    ServletDispatch::ptr getServletDispatch() const { return m_dispatch; }
+    void setServletDispatch(ServletDispatch::ptr v) { m_dispatch = v; }
+
+protected:
+    void handleClient(Socket::ptr client) override;
+
+private:
+    bool m_is_keepalive;
+    ServletDispatch::ptr m_dispatch;
+};
+
+} // namespace http
+} // namespace trycle
+
+#endif // TRY_HTTP_SERVER_H
@@ -0,0 +1,141 @@
+#ifndef TRY_IOBUFFER_H
+#define TRY_IOBUFFER_H
+
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+namespace trycle
+{
+
+/**
+ * 由固定大小的块组成的缓冲区
+ *
+ * 数据分散在一串块中，追加时只在最后一个块写满后再挂一个新块，已有数据从不搬移或 realloc；
+ * 块从 SlabPool 分配，释放时还给分配它的线程，稳定运行后基本不再向系统申请内存。
+ *
+ *  - prepend：第一个块前面有空闲时直接向前写，否则在前面挂一个新块，数据放在块尾，后续的 prepend 可以继续向前写
+ *  - splice：把另一个缓冲区的块整块摘下挂到末尾，只改指针不拷贝数据，代理转发大消息时数据不会被复制
+ *  - getReadBuffers / writeFd：以 iovec 的形式直接交给 hook 过的 writev
+ *  - getWriteBuffers / commit / readFd：预留块后直接 readv 到块中
+ *
+ * 非线程安全。
+ */
+class IOBuffer
+{
+public:
+    typedef std::shared_ptr<IOBuffer> ptr;
+
+    // 每个块的数据容量
+    static const size_t BLOCK_SIZE = 4096;
+
+    IOBuffer();
+    ~IOBuffer();
+
+    IOBuffer(const IOBuffer&)            = delete;
+    IOBuffer& operator=(const IOBuffer&) = delete;
+    IOBuffer(IOBuffer&& other);
+    IOBuffer& operator=(IOBuffer&& other);
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    size_t getBlockCount() const { return m_block_count; }
+
+    void append(const void* data, size_t len);
+    void append(const std::string& data) { append(data.data(), data.size()); }
+    void prepend(const void* data, size_t len);
+    void prepend(const std::string& data) { prepend(data.data(), data.size()); }
+
+    /**
+     * @brief 把 other 的全部数据移到末尾，整块转移，other 被清空
+     */
+    void splice(IOBuffer& other);
+
+    /**
+     * @brief 把 other 开头的 len 字节移到末尾：完整的块直接转移，只有跨块的最后一部分需要拷贝
+     * @return {*} 实际移动的字节数
+     */
+    size_t splice(IOBuffer& other, size_t len);
+
+    /**
+     * @brief 从 offset 开始拷贝最多 len 字节到 dst，不移除数据
+     * @return {*} 拷贝的字节数
+     */
+    size_t copyOut(void* dst, size_t len, size_t offset = 0) const;
+
+    /**
+     * @brief 丢弃开头的 len 字节，用完的块放回池中
+     */
+    void consume(size_t len);
+
+    /**
+     * @brief 拷贝并移除开头最多 len 字节
+     */
+    size_t read(void* dst, size_t len);
+
+    /**
+     * @brief 查找字节 c
+     * @return {*} 相对开头的位置，没有找到返回 -1
+     */
+    ssize_t find(char c, size_t offset = 0) const;
+
+    std::string toString() const;
+    void clear();
+
+    /**
+     * @brief 读侧视图：从 offset 开始最多 len 字节对应的 iovec，不移除数据
+     * @param {iovec*} iov 输出
+     * @param {size_t} max_iov iov 的容量
+     * @return {*} 填充的 iovec 个数
+     */
+    size_t getReadBuffers(iovec* iov, size_t max_iov, size_t len = (size_t)-1, size_t offset = 0) const;
+
+    /**
+     * @brief 写侧视图：在末尾预留至少 len 字节的空间，返回对应的 iovec；
+     *        写入后调用 commit 提交实际写入的字节数，两者之间不能有其它修改操作
+     * @return {*} 填充的 iovec 个数
+     */
+    size_t getWriteBuffers(iovec* iov, size_t max_iov, size_t len);
+    void commit(size_t len);
+
+    /**
+     * @brief 从 fd 读取最多 len 字节，通过 readv 直接写入块中
+     * @return {*} readv 的返回值
+     */
+    ssize_t readFd(int fd, size_t len = 64 * 1024);
+
+    /**
+     * @brief 把开头最多 len 字节通过 writev 写入 fd，写出的部分被移除
+     * @return {*} writev 的返回值
+     */
+    ssize_t writeFd(int fd, size_t len = (size_t)-1);
+
+private:
+    struct Block;
+
+    // 从 SlabPool 分配块
+    static Block* AllocBlock();
+    // 可以在任意线程归还
+    static void ReleaseBlock(Block* block);
+
+    Block* popFront();
+    void pushBack(Block* block);
+    void pushFront(Block* block);
+    // 释放末尾没有数据的块（getWriteBuffers 预留后未用到的部分）
+    void trimTail();
+
+private:
+    Block* m_head        = nullptr;
+    Block* m_tail        = nullptr;
+    size_t m_size        = 0;
+    size_t m_block_count = 0;
+    // getWriteBuffers 中第一个可写的块，commit 从这里开始提交
+    Block* m_write_block = nullptr;
+};
+
+} // namespace trycle
+
+#endif // TRY_IOBUFFER_H
@@ -3,6 +3,7 @@
 
 #include <functional>
 
+#include "fd_table.h"
 #include "scheduler.h"
 #include "timer.h"
 
@@ -17,7 +18,8 @@ public:
     {
         NONE  = 0x0,
         READ  = 0x1, // EPOLLIN
-        WRITE = 0x4  // EPOLLOUT
+        WRITE = 0x4, // EPOLLOUT
+        ERROR = 0x8  // EPOLLERR，epoll 总会上报，注册它只是为了在错误队列有消息时得到回调（如 MSG_ZEROCOPY 完成通知）
     };
 
     struct FdContext
@@ -27,9 +29,10 @@ public:
 
         struct EventContext
         {
-            Scheduler* m_scheduler;           // 指定处理该事件的调度器
+            Scheduler* m_scheduler = nullptr; // 指定处理该事件的调度器
             Fiber::ptr m_fiber;               // 要执行的协程
             std::function<void()> m_callback; // 要执行的函数，fiber与callback，只需要其一
+            const void* m_token = nullptr;    // 注册方的标识，按标识注销时只移除自己的注册
         };
 
         EventContext& getEventContext(EventType event);
@@ -39,21 +42,33 @@ public:
         MutexType m_mutex;
         EventContext m_read;  // 处理读事件
         EventContext m_write; // 处理写事件
+        EventContext m_error; // 处理错误事件
         int m_fd{};           // 要监听的文件描述符
         EventType m_events = EventType::NONE;
+        // 每次向 epoll 注册（EPOLL_CTL_ADD）加一，epoll 事件带有注册时的代数，
+        // 槽位在 fd 关闭复用后重新注册时，旧注册已返回、尚未处理的事件不会触发新 fd 的等待者
+        uint32_t m_generation = 0;
     };
 
 public:
     typedef std::shared_ptr<IOManager> ptr;
-    typedef RWMutex MutexType;
 
     IOManager(size_t thread_size = 1, bool use_caller = false, const std::string& name = "");
     ~IOManager();
 
     bool addEvent(int fd, EventType event, std::function<void()> callback = nullptr);
+    /**
+     * @brief 检查和注册在同一把锁内完成，事件已被注册时返回 false 而不是断言失败
+     * @param {const void*} token 注册方的标识，配合 removeEvent(fd, event, token) 使用
+     * @return {*} 是否注册成功
+     */
+    bool tryAddEvent(int fd, EventType event, std::function<void()> callback, const void* token = nullptr);
     bool removeEvent(int fd, EventType event);
+    // 只移除 token 注册的事件；自己的注册已经触发、同一事件又被其它协程注册时不会误删
+    bool removeEvent(int fd, EventType event, const void* token);
     bool cancelEvent(int fd, EventType event);
     bool cancelAllEvent(int fd);
+    bool hasEvent(int fd, EventType event);
 
 public:
     static IOManager* GetThis();
@@ -64,16 +79,21 @@ protected:
     bool isStop(uint64_t& next_timeout);
     void idle() override;
 
-    void contextListResize(int size);
-
     void onTimerInsertedAtFirst();
 
+    FdContext* getFdContext(int fd, bool auto_create);
+
+private:
+    // 调用方持有 fd_ctx->m_mutex，且事件尚未注册
+    int addEventLocked(FdContext* fd_ctx, int fd, EventType event, std::function<void()>& callback, const void* token);
+    // 调用方持有 fd_ctx->m_mutex，且事件已注册
+    void removeEventLocked(FdContext* fd_ctx, int fd, EventType event);
+
 private:
-    MutexType m_mutex;
-    int m_epoll_fd = 0;                            // epoll文件标识符
-    int m_tickle_fds[2]{};                         // 主线程给子线程发送消息的管道
-    std::atomic_size_t m_pending_event_count{};    // 等待执行的事件数量
-    std::vector<FdContext::ptr> m_fd_context_list; // FdContext的对象池，下标对应fd id
+    int m_epoll_fd = 0;                         // epoll文件标识符
+    int m_tickle_fds[2]{};                      // 主线程给子线程发送消息的管道
+    std::atomic_size_t m_pending_event_count{}; // 等待执行的事件数量
+    FdTable<FdContext> m_fd_contexts;           // FdContext的分段表，下标对应fd id，查找无锁
 };
 
 } // namespace trycle
@@ -0,0 +1,202 @@
+#ifndef TRY_IP_TRIE_H
+#define TRY_IP_TRIE_H
+
+#include <memory>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "singleton.h"
+#include "sock_addr.h"
+
+namespace trycle
+{
+
+/**
+ * 128 位的 IP 键，IPv4 映射为 ::ffff:a.b.c.d，前缀长度相应加 96
+ * 这样 IPv4 和 IPv6 的前缀可以放在同一棵树里
+ */
+struct IpKey
+{
+    uint8_t bytes[16];
+
+    IpKey() { memset(bytes, 0, sizeof(bytes)); }
+
+    // 非 IP 地址返回 false
+    static bool FromSockAddr(const SockAddr& addr, IpKey& key);
+
+    /**
+     * @brief 解析 CIDR：10.0.0.0/8、2001:db8::/32，不带前缀长度时表示单个地址
+     * @param {uint8_t&} prefix_len 映射后的前缀长度（IPv4 加 96）
+     */
+    static bool ParseCidr(const std::string& cidr, IpKey& key, uint8_t& prefix_len);
+
+    // 第 i 位（从最高位开始）
+    int bit(uint32_t i) const { return (bytes[i >> 3] >> (7 - (i & 7))) & 1; }
+
+    // 清零前缀之后的位
+    void mask(uint32_t prefix_len);
+
+    // 与 other 的前 prefix_len 位是否相同
+    bool matches(const IpKey& other, uint32_t prefix_len) const;
+
+    // 与 other 相同的前缀位数，最多比较 limit 位
+    uint32_t commonPrefix(const IpKey& other, uint32_t limit) const;
+};
+
+/**
+ * 路径压缩的二叉前缀树（Patricia），最长前缀匹配
+ * 只有分叉和带值的前缀才有节点，查找最多访问前缀长度个节点，每个节点比较一段前缀
+ * 不是线程安全的，构建完成后只读；需要更新时构建新树整体替换（见 IpAcl）
+ */
+template <typename T>
+class IpPrefixTrie
+{
+public:
+    IpPrefixTrie() = default;
+    IpPrefixTrie(const IpPrefixTrie&)            = delete;
+    IpPrefixTrie& operator=(const IpPrefixTrie&) = delete;
+
+    /**
+     * @brief 插入前缀，已存在时覆盖
+     * @param {uint8_t} prefix_len 0 ~ 128
+     */
+    void insert(IpKey key, uint8_t prefix_len, const T& value)
+    {
+        key.mask(prefix_len);
+        std::unique_ptr<Node>* slot = &m_root;
+        while (true)
+        {
+            Node* node = slot->get();
+            if (!node)
+            {
+                slot->reset(new Node(key, prefix_len, value));
+                ++m_size;
+                return;
+            }
+            uint32_t common = node->key.commonPrefix(key, std::min(node->prefix_len, prefix_len));
+            if (common < node->prefix_len)
+            {
+                // 新前缀在 node 的中间分叉，插入一个分叉节点
+                std::unique_ptr<Node> split(new Node(key, common));
+                split->key.mask(common);
+                int old_bit = node->key.bit(common);
+                split->child[old_bit].swap(*slot);
+                if (common == prefix_len)
+                {
+                    split->has_value = true;
+                    split->value     = value;
+                }
+                else
+                {
+                    split->child[!old_bit].reset(new Node(key, prefix_len, value));
+                }
+                slot->swap(split);
+                ++m_size;
+                return;
+            }
+            if (prefix_len == node->prefix_len)
+            {
+                m_size += !node->has_value;
+                node->has_value = true;
+                node->value     = value;
+                return;
+            }
+            slot = &node->child[key.bit(node->prefix_len)];
+        }
+    }
+
+    /**
+     * @brief 最长前缀匹配
+     * @return {*} 没有匹配的前缀时返回 nullptr
+     */
+    const T* lookup(const IpKey& key) const
+    {
+        const T* best = nullptr;
+        const Node* node = m_root.get();
+        while (node && key.matches(node->key, node->prefix_len))
+        {
+            if (node->has_value)
+            {
+                best = &node->value;
+            }
+            if (node->prefix_len == 128)
+            {
+                break;
+            }
+            node = node->child[key.bit(node->prefix_len)].get();
+        }
+        return best;
+    }
+
+    // 前缀（带值的节点）数量
+    size_t size() const { return m_size; }
+
+private:
+    struct Node
+    {
+        Node(const IpKey& k, uint8_t len)
+            : key(k), prefix_len(len) {}
+        Node(const IpKey& k, uint8_t len, const T& v)
+            : key(k), prefix_len(len), has_value(true), value(v) {}
+
+        IpKey key;
+        uint8_t prefix_len;
+        bool has_value = false;
+        T value{};
+        std::unique_ptr<Node> child[2];
+    };
+
+    std::unique_ptr<Node> m_root;
+    size_t m_size = 0;
+};
+
+/**
+ * 基于 IpPrefixTrie 的 IP 访问控制列表
+ *
+ * 按最长前缀匹配决定允许或拒绝，同一前缀同时出现在 allow 和 deny 中时拒绝，都不匹配时使用默认策略。
+ * load 构建一张新表后用 std::atomic_store 整体替换，查询通过 std::atomic_load 拿到当前表，
+ * 重新加载期间的查询不会加锁，也不会看到构建了一半的表。
+ *
+ * IpAclMgr 绑定配置 acl.allow、acl.deny、acl.default_allow，配置变更时自动重新加载。
+ */
+class IpAcl
+{
+public:
+    typedef std::shared_ptr<IpAcl> ptr;
+
+    IpAcl();
+
+    /**
+     * @brief 用新的规则替换整张表，有任何一条规则格式错误时不替换
+     * @param {vector<std::string>&} allow 允许的 CIDR 列表
+     * @param {vector<std::string>&} deny 拒绝的 CIDR 列表
+     * @param {bool} default_allow 没有匹配时是否允许
+     * @param {string*} error 不为空时返回第一条错误的规则
+     * @return {*} 是否替换成功
+     */
+    bool load(const std::vector<std::string>& allow, const std::vector<std::string>& deny,
+              bool default_allow = true, std::string* error = nullptr);
+
+    bool isAllowed(const SockAddr& addr) const;
+    bool isAllowed(const Address& addr) const { return isAllowed(SockAddr(addr)); }
+
+    // 当前表中的前缀数量
+    size_t size() const;
+
+private:
+    struct Table
+    {
+        IpPrefixTrie<bool> trie;
+        bool default_allow = true;
+    };
+
+    std::shared_ptr<const Table> m_table;
+};
+
+typedef SingletonPtr<IpAcl> IpAclMgr;
+
+} // namespace trycle
+
+#endif // TRY_IP_TRIE_H
@@ -17,12 +17,13 @@
 #include <yaml-cpp/yaml.h>
 
 #include "singleton.h"
+#include "slab.h"
 #include "thread.h"
 #include "util.h"
 // #include "config.h"
 
 #define MAKE_LOG_EVENT(level, message) \
-    std::make_shared<trycle::LogEvent>(__FILE__, __LINE__, trycle::GetThreadId(), trycle::GetFiberId(), time(0), message, level)
+    trycle::MakeSlabShared<trycle::LogEvent>(__FILE__, __LINE__, trycle::GetThreadId(), trycle::GetFiberId(), time(0), message, level)
 
 #define LOG_LEVEL(logger, level, message) \
     logger->log(MAKE_LOG_EVENT(level, message))
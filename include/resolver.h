@@ -0,0 +1,120 @@
+#ifndef TRY_RESOLVER_H
+#define TRY_RESOLVER_H
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "address.h"
+#include "fiber.h"
+#include "singleton.h"
+#include "thread.h"
+
+namespace trycle
+{
+
+class Scheduler;
+
+/**
+ * 协程友好的域名解析器
+ *
+ * getaddrinfo 是阻塞调用，直接在协程里调用会卡住整个调度线程。
+ * 在协程中解析时，把 getaddrinfo 交给专用的解析线程执行，当前协程挂起，解析完成后被唤醒；
+ * 不在协程中时直接在当前线程解析。
+ *
+ * 结果按 (node, service, family, type, protocol) 缓存在分片的表中：
+ * 成功的结果缓存 dns.cache.ttl_ms，不存在的域名缓存 dns.cache.negative_ttl_ms（负缓存），
+ * EAI_AGAIN 等临时错误不缓存。getaddrinfo 不返回 TTL，所以过期时间由配置决定。
+ * 同一个 key 同时有多个协程解析时只发起一次查询，其余协程等待同一个结果（请求合并）。
+ */
+class Resolver
+{
+public:
+    typedef std::shared_ptr<Resolver> ptr;
+    typedef Mutex MutexType;
+
+    Resolver();
+    ~Resolver();
+
+    /**
+     * @brief 解析 node，结果追加到 result，每次返回新的 Address 对象，修改它们不影响缓存
+     * @param {string&} node 域名或 ip
+     * @param {string&} service 端口或服务名，可以为空
+     * @return {*} getaddrinfo 的错误码，0 表示成功
+     */
+    int resolve(std::vector<Address::ptr>& result, const std::string& node, const std::string& service,
+                int family = AF_INET, int type = 0, int protocol = 0);
+
+    // 清空缓存，不影响正在进行的查询
+    void clear();
+
+    uint64_t getHitCount() const { return m_hit_count; }
+    uint64_t getMissCount() const { return m_miss_count; }
+    uint64_t getCoalescedCount() const { return m_coalesced_count; }
+
+private:
+    struct Result
+    {
+        typedef std::shared_ptr<Result> ptr;
+        int error = 0;
+        std::vector<Address::ptr> addrs;
+    };
+
+    // 一次正在进行的查询，等待同一个 key 的协程都挂在 waiters 上
+    struct Query
+    {
+        typedef std::shared_ptr<Query> ptr;
+        std::string key;
+        std::string node;
+        std::string service;
+        int family   = 0;
+        int type     = 0;
+        int protocol = 0;
+        Result::ptr result;
+        std::vector<std::pair<Scheduler*, Fiber::ptr>> waiters;
+    };
+
+    struct Entry
+    {
+        Result::ptr result;
+        uint64_t expire_ms = 0;
+        Query::ptr query; // 正在进行的查询
+    };
+
+    struct Shard
+    {
+        MutexType mutex;
+        std::unordered_map<std::string, Entry> entries;
+    };
+
+    static const size_t SHARD_COUNT = 16;
+
+    Shard& getShard(const std::string& key);
+    // 执行 getaddrinfo
+    static Result::ptr DoLookup(const Query& query);
+    // 按结果写入缓存（临时错误不缓存），调用方持有分片的锁
+    void store(Shard& shard, const Query& query, const Result::ptr& result);
+    // 解析线程的主函数
+    void run();
+
+private:
+    Shard m_shards[SHARD_COUNT];
+
+    MutexType m_queue_mutex;
+    Semaphore m_queue_sem;
+    std::deque<Query::ptr> m_queue; // 等待解析线程处理的查询
+    std::vector<Thread::ptr> m_threads;
+    bool m_stopping = false;
+
+    std::atomic<uint64_t> m_hit_count{0};
+    std::atomic<uint64_t> m_miss_count{0};
+    std::atomic<uint64_t> m_coalesced_count{0};
+};
+
+typedef SingletonPtr<Resolver> ResolverMgr;
+
+} // namespace trycle
+
+#endif // TRY_RESOLVER_H
@@ -0,0 +1,150 @@
+#ifndef TRY_RPC_H
+#define TRY_RPC_H
+
+#include <memory>
+#include <stdint.h>
+#include <string>
+
+#include "bytearray.h"
+#include "fiber.h"
+#include "iobuffer.h"
+#include "socket.h"
+#include "thread.h"
+
+namespace trycle
+{
+
+class IOManager;
+
+namespace rpc
+{
+
+/* Status Codes */
+#define RPC_STATUS_MAP(XX)                     \
+    XX(0, OK, ok)                              \
+    XX(1, NOT_FOUND, method not found)         \
+    XX(2, TIMEOUT, timeout)                    \
+    XX(3, CLOSED, connection closed)           \
+    XX(4, BAD_REQUEST, bad request)            \
+    XX(5, INTERNAL_ERROR, internal error)
+
+enum class RpcStatus
+{
+#define XX(code, name, desc) name = code,
+    RPC_STATUS_MAP(XX)
+#undef XX
+};
+
+const char* RpcStatusToString(RpcStatus s);
+
+/**
+ * 一帧 RPC 消息
+ *
+ * 线上格式（定长整数为网络字节序）：
+ *
+ *   uint32 length            之后的字节数
+ *   uint8  type              REQUEST / RESPONSE
+ *   uint32 seq               请求的序号，响应原样带回，用来在一个连接上匹配并发的请求
+ *   REQUEST：  varint 长度 + method，之后直到帧尾都是 body
+ *   RESPONSE： zigzag varint status，之后直到帧尾都是 body
+ */
+struct RpcFrame
+{
+    enum Type
+    {
+        REQUEST  = 1,
+        RESPONSE = 2,
+    };
+
+    enum DecodeResult
+    {
+        INCOMPLETE = 0, // 需要更多数据
+        DONE       = 1, // 解出一帧
+        ERROR      = 2, // 格式错误或超过 rpc.max_frame_size，连接应关闭
+    };
+
+    uint8_t type      = REQUEST;
+    uint32_t seq      = 0;
+    RpcStatus status  = RpcStatus::OK;
+    std::string method;
+    std::string body;
+
+    /**
+     * @brief 编码后追加到 out，长度在编码完成后 prepend 到帧头
+     */
+    void encode(IOBuffer& out) const;
+
+    /**
+     * @brief 从 in 的开头解出一帧，成功时取出这一帧的数据，INCOMPLETE 时不改变 in
+     */
+    DecodeResult decode(ByteArray& in);
+
+    /**
+     * @brief 帧的最大长度，rpc.max_frame_size
+     */
+    static uint32_t GetMaxFrameSize();
+};
+
+/**
+ * 收发 RpcFrame 的连接，客户端和服务端共用
+ *
+ * 读：readv 直接读进 ByteArray 的块中，一次读到的多个帧依次解出。
+ * 写：send 只把帧编码进发送队列；队列从空变为非空时在创建连接的 IOManager 线程上调度一个 flush 协程，
+ * 它运行之前其它协程排进来的帧会随同一次 writev 发出（整块 splice 出队列，不拷贝）。
+ * 必须在 IOManager 中创建，send 可以在任意线程调用。
+ */
+class RpcConnection : public std::enable_shared_from_this<RpcConnection>
+{
+public:
+    typedef std::shared_ptr<RpcConnection> ptr;
+    typedef Mutex MutexType;
+
+    RpcConnection(Socket::ptr sock);
+
+    /**
+     * @brief 读取下一帧，数据不足时挂起当前协程
+     * @return {*} 连接关闭、超时或帧格式错误时返回 false
+     */
+    bool recv(RpcFrame& frame);
+
+    /**
+     * @brief 帧加入发送队列，由 flush 协程批量发出
+     * @return {*} 连接已关闭时返回 false
+     */
+    bool send(const RpcFrame& frame);
+
+    /**
+     * @brief 挂起当前协程直到 flush 协程退出，即发送队列已经写完或连接已关闭
+     */
+    void waitFlushed();
+
+    void close();
+    bool isClosed();
+    Socket::ptr getSocket() const { return m_sock; }
+
+    // 发出的 writev 次数和帧数，两者之比就是平均每次系统调用合并的帧数
+    uint64_t getWritevCount() const { return m_writev_count; }
+    uint64_t getSentFrames() const { return m_sent_frames; }
+
+private:
+    void flush();
+
+private:
+    Socket::ptr m_sock;
+    IOManager* m_iom;
+    uint32_t m_thread;
+    ByteArray m_in;
+
+    MutexType m_mutex;
+    IOBuffer m_out;
+    bool m_flushing = false;
+    bool m_closed   = false;
+    Fiber::ptr m_flush_waiter;
+    uint64_t m_writev_count = 0;
+    uint64_t m_sent_frames  = 0;
+};
+
+} // namespace rpc
+} // namespace trycle
+
+#endif // TRY_RPC_H
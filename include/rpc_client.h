@@ -0,0 +1,94 @@
+#ifndef TRY_RPC_CLIENT_H
+#define TRY_RPC_CLIENT_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "address.h"
+#include "fiber.h"
+#include "rpc.h"
+#include "scheduler.h"
+#include "thread.h"
+
+namespace trycle
+{
+namespace rpc
+{
+
+/**
+ * RPC 客户端，多个协程的调用复用同一个连接
+ *
+ * call 为请求分配 seq，登记到等待表后把当前协程挂起；接收协程读到响应后按 seq 从表中取出调用，
+ * 写入结果并唤醒对应的协程。每个调用的超时由 IOManager 上的定时器实现，
+ * 定时器和响应谁先从表中取出调用谁生效，超时后才到的响应被丢弃。
+ * 连接断开时所有等待中的调用返回 CLOSED。
+ */
+class RpcClient : public std::enable_shared_from_this<RpcClient>
+{
+public:
+    typedef std::shared_ptr<RpcClient> ptr;
+    typedef Mutex MutexType;
+
+    /**
+     * @brief 在已连接的 socket 上创建客户端，接收协程运行在当前 IOManager 上
+     */
+    static RpcClient::ptr Create(Socket::ptr sock);
+
+    /**
+     * @brief 连接 addr 并创建客户端
+     * @return {*} 连接失败返回 nullptr
+     */
+    static RpcClient::ptr Connect(Address::ptr addr, uint64_t timeout_ms = (uint64_t)-1);
+
+    ~RpcClient();
+
+    /**
+     * @brief 调用方法，挂起当前协程直到响应到达、超时或连接断开
+     * @param {uint64_t} timeout_ms 超时时间，-1 表示使用 rpc.client.timeout_ms
+     * @return {*} 服务端返回的状态，或 TIMEOUT、CLOSED
+     */
+    RpcStatus call(const std::string& method, const std::string& request, std::string& response,
+                   uint64_t timeout_ms = (uint64_t)-1);
+
+    void close();
+    bool isClosed();
+    RpcConnection::ptr getConnection() const { return m_conn; }
+    // 等待响应的调用数
+    size_t getPendingCount();
+
+private:
+    struct Call
+    {
+        typedef std::shared_ptr<Call> ptr;
+        Scheduler* scheduler = nullptr;
+        Fiber::ptr fiber;
+        RpcStatus status = RpcStatus::OK;
+        std::string body;
+    };
+
+    RpcClient(Socket::ptr sock);
+
+    // 接收协程，只持有 weak_ptr，客户端销毁时连接被关闭，接收协程随之退出
+    static void RecvLoop(std::weak_ptr<RpcClient> weak, RpcConnection::ptr conn);
+
+    /**
+     * @brief 从等待表中取出 seq 对应的调用，写入结果并唤醒
+     * @return {*} 调用已经被取出（已超时或已响应）时返回 false
+     */
+    bool complete(uint32_t seq, RpcStatus status, std::string* body);
+    // 连接断开，所有等待中的调用返回 status
+    void failAll(RpcStatus status);
+
+private:
+    RpcConnection::ptr m_conn;
+    MutexType m_mutex;
+    uint32_t m_seq = 0;
+    bool m_closed  = false;
+    std::unordered_map<uint32_t, Call::ptr> m_calls;
+};
+
+} // namespace rpc
+} // namespace trycle
+
+#endif // TRY_RPC_CLIENT_H
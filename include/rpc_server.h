@@ -0,0 +1,53 @@
+#ifndef TRY_RPC_SERVER_H
+#define TRY_RPC_SERVER_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rpc.h"
+#include "tcp_server.h"
+
+namespace trycle
+{
+namespace rpc
+{
+
+/**
+ * RPC 服务器
+ *
+ * 连接上的请求依次解出，每个请求在连接所在线程上的一个新协程中处理，
+ * 慢请求不会挡住同一连接上后面的请求，响应按完成的先后顺序发出，由客户端按 seq 匹配。
+ */
+class RpcServer : public TcpServer
+{
+public:
+    typedef std::shared_ptr<RpcServer> ptr;
+    /**
+     * @brief 方法的处理函数，返回值作为响应的状态
+     * @param {string&} request 请求的 body
+     * @param {string&} response 响应的 body
+     */
+    typedef std::function<RpcStatus(const std::string& request, std::string& response)> Method;
+
+    RpcServer(IOManager* worker = IOManager::GetThis(), IOManager* acceptor = IOManager::GetThis());
+    RpcServer(const std::vector<IOManager*>& workers, const std::vector<IOManager*>& acceptors);
+
+    /**
+     * @brief 注册方法，必须在 start 之前调用，运行期间只读不加锁
+     */
+    void registerMethod(const std::string& name, Method method);
+
+protected:
+    void handleClient(Socket::ptr client) override;
+
+private:
+    std::unordered_map<std::string, Method> m_methods;
+};
+
+} // namespace rpc
+} // namespace trycle
+
+#endif // TRY_RPC_SERVER_H
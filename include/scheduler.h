@@ -10,6 +10,7 @@
 #include "fiber.h"
 #include "hook.h"
 #include "thread.h"
+#include "util.h"
 
 namespace trycle
 {
@@ -17,6 +18,28 @@ namespace trycle
 // static thread_local Fiber* t_fiber = nullptr;
 static thread_local Fiber::ptr t_fiber_ptr;
 
+// 排队延迟直方图，按 2 的幂划分微秒区间，只做原子累加
+struct QueueDelayHistogram
+{
+    static const int BUCKETS = 32;
+
+    void record(uint64_t delay_us);
+
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum_us{0};
+    std::atomic<uint64_t> max_us{0};
+    std::atomic<uint64_t> buckets[BUCKETS] = {};
+};
+
+struct QueueDelaySnapshot
+{
+    uint64_t count  = 0;
+    uint64_t avg_us = 0;
+    uint64_t max_us = 0;
+    uint64_t p50_us = 0; // 直方图估算值（区间上界）
+    uint64_t p99_us = 0;
+};
+
 class Scheduler
 {
     friend class Fiber;
@@ -25,6 +48,15 @@ public:
     typedef std::shared_ptr<Scheduler> ptr;
     typedef Mutex MutexType;
 
+    // 优先级，数值越小越优先；每个优先级一个队列，低优先级通过老化避免饿死
+    enum Priority
+    {
+        HIGH   = 0,
+        NORMAL = 1,
+        LOW    = 2,
+    };
+    static const int PRIORITY_COUNT = 3;
+
     Scheduler() = delete;
     Scheduler(int thread_size, bool use_caller, const std::string& name);
     virtual ~Scheduler();
@@ -34,14 +66,20 @@ public:
     void start();
     void stop();
 
+    /**
+     * @brief 添加协程或函数到调度队列
+     * @param {FiberOrCb} fc 协程或函数
+     * @param {int} thread 指定执行的线程 id，-1 表示任意线程
+     * @param {int} priority 优先级（HIGH/NORMAL/LOW），-1 表示沿用协程自身的优先级，函数默认为 NORMAL
+     */
     template <typename FiberOrCb>
-    void schedule(FiberOrCb fc, int thread = -1)
+    void schedule(FiberOrCb fc, int thread = -1, int priority = -1)
     {
 
         bool need_tickle = false;
         {
             MutexType::Lock lock(&m_mutex);
-            need_tickle = schedule_without_lock(fc, thread);
+            need_tickle = schedule_without_lock(fc, thread, priority);
         }
         if (need_tickle)
         {
@@ -50,7 +88,7 @@ public:
     }
 
     template <typename InputIterator>
-    void schedule(InputIterator begin, InputIterator end, int thread)
+    void schedule(InputIterator begin, InputIterator end, int thread, int priority = -1)
     {
         bool need_tickle = false;
         {
@@ -58,7 +96,7 @@ public:
             while (begin != end)
             {
                 auto ft     = &*begin;
-                need_tickle = schedule_without_lock(ft, thread) || need_tickle;
+                need_tickle = schedule_without_lock(ft, thread, priority) || need_tickle;
                 ++begin;
             }
         }
@@ -68,10 +106,35 @@ public:
         }
     }
 
+    /**
+     * @brief 协程挂起后由调度器之外的线程唤醒（如解析线程）时，挂起前调用 addExternalWait，
+     *        唤醒（schedule）之后调用 removeExternalWait；计数不为 0 时调度器不会停止
+     */
+    void addExternalWait() { ++m_external_waits; }
+    void removeExternalWait() { --m_external_waits; }
+
+    /**
+     * @brief 常驻运行调度循环的线程 id，可作为 schedule 的 thread 参数把任务固定到某个线程；
+     *        use_caller 的线程只在 stop 时才运行调度循环，只有没有其它线程时才返回它
+     */
+    std::vector<int> getThreadIds();
+
+    // 获取指定优先级队列的排队延迟统计
+    QueueDelaySnapshot getQueueDelay(int priority) const;
+    // 导出所有优先级队列的排队延迟统计（次数、平均、最大、p50、p99）
+    std::string dumpQueueDelay() const;
+
 public:
     static Scheduler* GetThis();
     // static void SetThis(Scheduler* s);
     static Fiber* GetMainFiber();
+    /**
+     * @brief 按协程 tag 导出运行时间最多的 top_n 项（运行、HOLD、READY 耗时及切换次数）
+     * @param {size_t} top_n 导出的条数
+     * @param {bool} by_wait 为 true 时按等待时间（HOLD + READY）排序
+     * @return {*} 格式化后的文本，只读取原子计数，不会暂停任何调度线程
+     */
+    static std::string DumpTopConsumers(size_t top_n = 10, bool by_wait = false);
 
 protected:
     void set_to_this();
@@ -83,24 +146,53 @@ protected:
 
 private:
     template <typename FiberOrCb>
-    bool schedule_without_lock(FiberOrCb fc, int thread = -1)
+    bool schedule_without_lock(FiberOrCb fc, int thread = -1, int priority = -1)
     {
-        bool need_tickle = m_fibers.empty();
+        bool need_tickle = !hasPendingFibers();
 
         FiberAndThread ft(fc, thread);
         if (ft.fiber || ft.cb)
         {
-            m_fibers.push_back(ft);
+            if (priority < 0 || priority >= PRIORITY_COUNT)
+            {
+                // 协程沿用自身的优先级，IO 事件、定时器唤醒时不会丢失
+                priority = ft.fiber ? ft.fiber->getPriority() : NORMAL;
+            }
+            else if (ft.fiber)
+            {
+                ft.fiber->setPriority(priority);
+            }
+            ft.priority   = priority;
+            ft.enqueue_ns = GetMonotonicNs();
+            if (ft.fiber)
+            {
+                ft.fiber->onScheduled(ft.enqueue_ns);
+            }
+            m_fibers[priority].push_back(ft);
         }
 
         return need_tickle;
     }
 
+    bool hasPendingFibers() const
+    {
+        for (int i = 0; i < PRIORITY_COUNT; i++)
+        {
+            if (!m_fibers[i].empty())
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
     struct FiberAndThread
     {
         Fiber::ptr fiber;
         std::function<void()> cb;
-        int thread = -1;
+        int thread          = -1;
+        int priority        = NORMAL;
+        uint64_t enqueue_ns = 0; // 入队时间，用于老化和排队延迟统计
 
         FiberAndThread(Fiber::ptr ptr, const int t)
             : fiber(ptr),
@@ -127,9 +219,11 @@ private:
 
         void reset()
         {
-            fiber  = nullptr;
-            cb     = nullptr;
-            thread = -1;
+            fiber      = nullptr;
+            cb         = nullptr;
+            thread     = -1;
+            priority   = NORMAL;
+            enqueue_ns = 0;
         }
     };
 
@@ -138,16 +232,21 @@ protected:
     int m_thread_count{};
     int m_active_thread_count{};
     int m_idle_thread_count{};
+    // 等待外部线程唤醒的协程数
+    std::atomic<int> m_external_waits{0};
     // 执行停止状态
     bool m_stopping = true;
     // 是否自动停止
     bool m_auto_stop = false;
     int m_root_thread_id{};
+    // 低优先级任务每排队 m_aging_ns 提升一级
+    uint64_t m_aging_ns = 0;
 
 protected:
     MutexType m_mutex;
     std::vector<Thread::ptr> m_threads;
-    std::list<FiberAndThread> m_fibers;
+    std::list<FiberAndThread> m_fibers[PRIORITY_COUNT];
+    QueueDelayHistogram m_queue_delay[PRIORITY_COUNT];
     Fiber::ptr m_root_fiber;
     std::string m_name{};
 };
@@ -0,0 +1,114 @@
+#ifndef TRY_SERVLET_H
+#define TRY_SERVLET_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "http.h"
+#include "thread.h"
+
+namespace trycle
+{
+namespace http
+{
+
+class HttpSession;
+
+/**
+ * 请求处理器，handle 在连接所在的协程中执行，返回 0 表示成功
+ */
+class Servlet
+{
+public:
+    typedef std::shared_ptr<Servlet> ptr;
+
+    Servlet(const std::string& name)
+        : m_name(name) {}
+    virtual ~Servlet() {}
+
+    virtual int32_t handle(HttpRequest& request, HttpResponse& response, HttpSession& session) = 0;
+
+    const std::string& getName() const { return m_name; }
+
+protected:
+    std::string m_name;
+};
+
+/**
+ * 由函数实现的 Servlet
+ */
+class FunctionServlet : public Servlet
+{
+public:
+    typedef std::shared_ptr<FunctionServlet> ptr;
+    typedef std::function<int32_t(HttpRequest& request, HttpResponse& response, HttpSession& session)> callback;
+
+    FunctionServlet(callback cb);
+    int32_t handle(HttpRequest& request, HttpResponse& response, HttpSession& session) override;
+
+private:
+    callback m_cb;
+};
+
+/**
+ * 路由表：先按路径精确匹配（哈希表），再按注册顺序做通配符（fnmatch）匹配，都不匹配时交给默认 Servlet（404）
+ */
+class ServletDispatch : public Servlet
+{
+public:
+    typedef std::shared_ptr<ServletDispatch> ptr;
+    typedef RWMutex RWMutexType;
+
+    ServletDispatch();
+    int32_t handle(HttpRequest& request, HttpResponse& response, HttpSession& session) override;
+
+    void addServlet(const std::string& uri, Servlet::ptr slt);
+    void addServlet(const std::string& uri, FunctionServlet::callback cb);
+    /**
+     * @brief 通配符路由，按 fnmatch 规则匹配，如匹配 /static/ 下的所有路径
+     */
+    void addGlobServlet(const std::string& uri, Servlet::ptr slt);
+    void addGlobServlet(const std::string& uri, FunctionServlet::callback cb);
+
+    void delServlet(const std::string& uri);
+    void delGlobServlet(const std::string& uri);
+
+    Servlet::ptr getDefault() const { return m_default; }
+    void setDefault(Servlet::ptr v) { m_default = v; }
+
+    Servlet::ptr getServlet(const std::string& uri);
+    Servlet::ptr getGlobServlet(const std::string& uri);
+    /**
+     * @brief 按精确、通配符、默认的顺序找到处理 path 的 Servlet
+     */
+    Servlet::ptr getMatchedServlet(const StringView& path);
+
+private:
+    RWMutexType m_mutex;
+    std::unordered_map<std::string, Servlet::ptr> m_datas;
+    std::vector<std::pair<std::string, Servlet::ptr>> m_globs;
+    Servlet::ptr m_default;
+};
+
+/**
+ * 默认 Servlet，返回 404
+ */
+class NotFoundServlet : public Servlet
+{
+public:
+    typedef std::shared_ptr<NotFoundServlet> ptr;
+
+    NotFoundServlet(const std::string& name);
+    int32_t handle(HttpRequest& request, HttpResponse& response, HttpSession& session) override;
+
+private:
+    std::string m_content;
+};
+
+} // namespace http
+} // namespace trycle
+
+#endif // TRY_SERVLET_H
@@ -0,0 +1,122 @@
+#ifndef TRY_SLAB_H
+#define TRY_SLAB_H
+
+#include <cstddef>
+#include <memory>
+#include <stdint.h>
+#include <utility>
+
+namespace trycle
+{
+
+struct SlabStats
+{
+    uint64_t allocs       = 0; // 从 slab 分配的次数
+    uint64_t frees        = 0; // 归还的次数（含跨线程）
+    uint64_t remote_frees = 0; // 由其他线程归还、挂到所属线程 remote 链表的次数
+    uint64_t slabs        = 0; // 向系统申请的 slab 数
+    uint64_t large        = 0; // 超过 MAX_SIZE、直接 malloc 的次数
+    uint64_t caches       = 0; // 创建过的线程缓存数，线程退出后缓存留给新线程接管
+};
+
+/**
+ * 定长对象的 slab 分配器
+ *
+ * SMALL_SIZE 以内按 GRANULE 分级，从 SLAB_SIZE 的 slab 中切分；到 MAX_SIZE 为止按 LARGE_GRANULE 分级，
+ * 从 LARGE_SLAB_SIZE 的 slab 中切分。每个线程有自己的缓存，每级一条空闲链表，分配和本线程归还都不加锁；
+ * 空闲链表为空时，先整串取走其他线程归还的对象（每级一条无锁的 remote 链表），再从最近的 slab 中切出新对象，
+ * slab 用完时向系统申请。slab 按自身大小对齐，开头记录所属的线程缓存，归还时由地址找到所属缓存，不需要对象头。
+ *
+ * slab 不还给系统，稳定运行后的内存占用等于峰值时的对象数；线程退出时缓存（连同其中的空闲对象）
+ * 交给之后创建的线程接管，不会随线程的创建销毁而增长。
+ *
+ * 小对象用于 Timer、LogEvent、Fiber 等热路径上频繁创建的对象，配合 SlabAllocator / MakeSlabShared，
+ * 对象和 shared_ptr 的控制块在一次分配中完成；大对象用于 IOBuffer、Arena 的块等定长缓冲区。
+ */
+class SlabPool
+{
+public:
+    // 小对象大小分级的粒度，也是分配结果的对齐
+    static const size_t GRANULE = 16;
+    // 小对象的上限
+    static const size_t SMALL_SIZE = 2048;
+    // 大对象大小分级的粒度
+    static const size_t LARGE_GRANULE = 128;
+    // 超过该大小直接 malloc
+    static const size_t MAX_SIZE = 32 * 1024;
+    static const size_t SMALL_CLASS_COUNT = SMALL_SIZE / GRANULE;
+    static const size_t CLASS_COUNT = SMALL_CLASS_COUNT + (MAX_SIZE - SMALL_SIZE) / LARGE_GRANULE;
+    // 小对象、大对象 slab 的大小和对齐
+    static const size_t SLAB_SIZE = 64 * 1024;
+    static const size_t LARGE_SLAB_SIZE = 512 * 1024;
+
+    /**
+     * @brief 分配 size 字节，失败时抛出 std::bad_alloc
+     */
+    static void* Allocate(size_t size);
+
+    /**
+     * @brief 归还 Allocate 得到的内存，size 必须和分配时相同，可以在任意线程调用
+     */
+    static void Deallocate(void* ptr, size_t size);
+
+    /**
+     * @brief 所有线程的累计统计
+     */
+    static SlabStats GetStats();
+};
+
+/**
+ * 使用 SlabPool 的 std 分配器，无状态，所有实例相等
+ * 如 std::allocate_shared<T>(SlabAllocator<T>(), args...)
+ */
+template <typename T>
+class SlabAllocator
+{
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <typename U>
+    struct rebind
+    {
+        typedef SlabAllocator<U> other;
+    };
+
+    SlabAllocator() {}
+    template <typename U>
+    SlabAllocator(const SlabAllocator<U>& other) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(SlabPool::Allocate(n * sizeof(T))); }
+    void deallocate(T* p, size_t n) { SlabPool::Deallocate(p, n * sizeof(T)); }
+};
+
+template <typename T, typename U>
+bool operator==(const SlabAllocator<T>& lhs, const SlabAllocator<U>& rhs)
+{
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const SlabAllocator<T>& lhs, const SlabAllocator<U>& rhs)
+{
+    return false;
+}
+
+/**
+ * @brief 相当于 std::make_shared，对象和控制块从 SlabPool 分配
+ */
+template <typename T, typename... Args>
+std::shared_ptr<T> MakeSlabShared(Args&&... args)
+{
+    return std::allocate_shared<T>(SlabAllocator<T>(), std::forward<Args>(args)...);
+}
+
+} // namespace trycle
+
+#endif // TRY_SLAB_H
@@ -0,0 +1,97 @@
+#ifndef TRY_SOCK_ADDR_H
+#define TRY_SOCK_ADDR_H
+
+#include <functional>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+
+#include "address.h"
+
+namespace trycle
+{
+
+/**
+ * 值类型的 socket 地址
+ *
+ * 内部就是一个 sockaddr_storage 联合体，可以直接拷贝、放进容器，
+ * 不分配内存，也没有虚函数调用，适合每个连接都要处理对端地址的热路径。
+ * 需要多态的 Address 时通过 toAddress / 构造函数互相转换。
+ */
+class SockAddr
+{
+public:
+    // 空地址，getFamily() 为 AF_UNSPEC
+    SockAddr();
+    SockAddr(const sockaddr* addr, socklen_t len);
+    SockAddr(const sockaddr_in& addr);
+    SockAddr(const sockaddr_in6& addr);
+    explicit SockAddr(const Address& addr);
+
+    /**
+     * @brief 解析数字形式的地址，不查询 DNS：1.2.3.4、1.2.3.4:80、::1、[::1]、[::1]:80
+     * @param {string&} str 地址字符串
+     * @param {SockAddr&} out 解析结果
+     * @param {uint16_t} port 字符串中没有端口时使用的端口
+     * @return {*} 不是数字形式的地址（如域名）或格式错误时返回 false
+     */
+    static bool Parse(const std::string& str, SockAddr& out, uint16_t port = 0);
+
+    int getFamily() const { return m_addr.sa.sa_family; }
+    bool isV4() const { return getFamily() == AF_INET; }
+    bool isV6() const { return getFamily() == AF_INET6; }
+    bool isIp() const { return isV4() || isV6(); }
+
+    sockaddr* getAddr() { return &m_addr.sa; }
+    const sockaddr* getAddr() const { return &m_addr.sa; }
+    socklen_t getAddrLen() const { return m_len; }
+    // accept/recvfrom 等写入地址后设置实际长度
+    void setAddrLen(socklen_t len) { m_len = len; }
+    // accept/recvfrom 可写入的最大长度
+    static socklen_t Capacity() { return sizeof(sockaddr_storage); }
+
+    const sockaddr_in& v4() const { return m_addr.v4; }
+    const sockaddr_in6& v6() const { return m_addr.v6; }
+
+    // 端口（主机字节序），非 IP 地址返回 0
+    uint16_t getPort() const;
+    void setPort(uint16_t port);
+
+    // 1.2.3.4:80、[::1]:80，可以被 Parse 解析回来
+    std::string toString() const;
+
+    // 转换为多态的 Address，空地址返回 nullptr
+    Address::ptr toAddress() const;
+
+    size_t hash() const;
+
+    bool operator==(const SockAddr& rhs) const;
+    bool operator!=(const SockAddr& rhs) const { return !(*this == rhs); }
+    // 先按地址族，再按地址、端口排序
+    bool operator<(const SockAddr& rhs) const;
+
+private:
+    union
+    {
+        sockaddr sa;
+        sockaddr_in v4;
+        sockaddr_in6 v6;
+        sockaddr_storage storage;
+    } m_addr;
+    socklen_t m_len;
+};
+
+} // namespace trycle
+
+namespace std
+{
+
+template <>
+struct hash<trycle::SockAddr>
+{
+    size_t operator()(const trycle::SockAddr& addr) const { return addr.hash(); }
+};
+
+} // namespace std
+
+#endif // TRY_SOCK_ADDR_H
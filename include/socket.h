@@ -0,0 +1,193 @@
+#ifndef TRY_SOCKET_H
+#define TRY_SOCKET_H
+
+#include <memory>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <ostream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "address.h"
+
+namespace trycle
+{
+
+/**
+ * socket 封装，读写走 hook 过的系统调用，在协程中 EAGAIN 时挂起而不是阻塞线程
+ *
+ * 为了不做多余的系统调用：
+ *  - 对端地址来自 connect/accept 的参数，本地地址来自 bind，只有绑定通配地址时才在第一次访问时 getsockname 一次
+ *  - TCP_NODELAY、SO_REUSEADDR、SO_REUSEPORT、收发缓冲区大小缓存在对象中，设置成相同的值时不再调用 setsockopt
+ *  - 收发超时直接写入 FdCtx，由 hook 层实现；只有当前线程没有开启 hook 时才 setsockopt
+ */
+class Socket : public std::enable_shared_from_this<Socket>
+{
+public:
+    typedef std::shared_ptr<Socket> ptr;
+    typedef std::weak_ptr<Socket> weak_ptr;
+
+    enum Type
+    {
+        TCP = SOCK_STREAM,
+        UDP = SOCK_DGRAM,
+    };
+
+    enum Family
+    {
+        IPv4 = AF_INET,
+        IPv6 = AF_INET6,
+        UNIX = AF_UNIX,
+    };
+
+    /**
+     * @brief 创建与 address 地址族相同的 TCP/UDP socket
+     */
+    static Socket::ptr CreateTCP(Address::ptr address);
+    static Socket::ptr CreateUDP(Address::ptr address);
+
+    static Socket::ptr CreateTCPSocket();
+    static Socket::ptr CreateUDPSocket();
+    static Socket::ptr CreateTCPSocket6();
+    static Socket::ptr CreateUDPSocket6();
+
+    /**
+     * @brief 构造函数，真正的 socket 在第一次 bind/connect 时才创建
+     * @param {int} family 协议族
+     * @param {int} type 类型，SOCK_STREAM、SOCK_DGRAM
+     * @param {int} protocol 协议
+     */
+    Socket(int family, int type, int protocol = 0);
+    virtual ~Socket();
+
+    Socket(const Socket&)            = delete;
+    Socket& operator=(const Socket&) = delete;
+
+    /**
+     * @brief 收发超时，写入 FdCtx，由 hook 层在等待时使用；-1 表示不超时
+     */
+    uint64_t getSendTimeout() const { return m_send_timeout; }
+    void setSendTimeout(uint64_t ms);
+    uint64_t getRecvTimeout() const { return m_recv_timeout; }
+    void setRecvTimeout(uint64_t ms);
+
+    bool getOption(int level, int option, void* result, socklen_t* len);
+    bool setOption(int level, int option, const void* val, socklen_t len);
+
+    template <typename T>
+    bool getOption(int level, int option, T& result)
+    {
+        socklen_t len = sizeof(T);
+        return getOption(level, option, &result, &len);
+    }
+
+    template <typename T>
+    bool setOption(int level, int option, const T& val)
+    {
+        return setOption(level, option, &val, sizeof(T));
+    }
+
+    /**
+     * @brief 带缓存的常用选项，与缓存值相同时直接返回 true
+     */
+    bool setNoDelay(bool on);
+    bool setReuseAddr(bool on);
+    bool setReusePort(bool on);
+    bool setSendBufferSize(int bytes);
+    bool setRecvBufferSize(int bytes);
+    bool getNoDelay() const { return m_no_delay == 1; }
+    bool getReusePort() const { return m_reuse_port == 1; }
+    // 内核实际使用的缓冲区大小（通常是设置值的两倍），第一次访问时查询
+    int getSendBufferSize();
+    int getRecvBufferSize();
+
+    bool bind(const Address::ptr addr);
+    bool listen(int backlog = SOMAXCONN);
+
+    /**
+     * @brief 接受连接，对端地址取自 accept 本身，不再调用 getpeername
+     * @return {*} 新连接，失败返回 nullptr
+     */
+    Socket::ptr accept();
+
+    /**
+     * @brief 连接 addr
+     * @param {uint64_t} timeout_ms 超时时间，-1 表示使用 tcp.timeout.ms
+     */
+    bool connect(const Address::ptr addr, uint64_t timeout_ms = (uint64_t)-1);
+
+    bool close();
+
+    ssize_t send(const void* buffer, size_t length, int flags = 0);
+    ssize_t send(const iovec* buffers, size_t count, int flags = 0);
+    ssize_t sendTo(const void* buffer, size_t length, const Address::ptr to, int flags = 0);
+    ssize_t recv(void* buffer, size_t length, int flags = 0);
+    ssize_t recv(iovec* buffers, size_t count, int flags = 0);
+    ssize_t recvFrom(void* buffer, size_t length, Address::ptr& from, int flags = 0);
+
+    Address::ptr getRemoteAddress();
+    Address::ptr getLocalAddress();
+
+    int getSocket() const { return m_sock; }
+    int getFamily() const { return m_family; }
+    int getType() const { return m_type; }
+    int getProtocol() const { return m_protocol; }
+    bool isConnected() const { return m_is_connected; }
+    bool isValid() const { return m_sock != -1; }
+    // SO_ERROR，读取后内核会清除
+    int getError();
+
+    std::ostream& dump(std::ostream& os) const;
+    std::string toString() const;
+
+    /**
+     * @brief 唤醒等待读、写、accept 的协程，它们的调用返回 -1，errno 为 ECANCELED
+     *        读写分别取消，事件在协程挂起的 IOManager 上触发，可以在任意线程调用
+     */
+    bool cancelRead();
+    bool cancelWrite();
+    bool cancelAccept();
+    bool cancelAll();
+
+private:
+    // 创建 socket 并设置默认选项
+    bool newSock();
+    // 接管已有的 fd（accept 得到的连接）
+    bool init(int sock);
+    // 新 socket 的默认选项：SO_REUSEADDR，TCP 开启 TCP_NODELAY
+    void initSock();
+    // 把创建 socket 之前设置的超时写入 FdCtx
+    void applyTimeouts();
+    void applyTimeout(int type, uint64_t ms);
+    // 设置带缓存的 int 选项
+    bool setCachedOption(int level, int option, int val, int& cached);
+
+private:
+    int m_sock;
+    int m_family;
+    int m_type;
+    int m_protocol;
+    bool m_is_connected = false;
+
+    uint64_t m_send_timeout = (uint64_t)-1;
+    uint64_t m_recv_timeout = (uint64_t)-1;
+
+    // 选项缓存，-1 表示未知
+    int m_no_delay           = -1;
+    int m_reuse_addr         = -1;
+    int m_reuse_port         = -1;
+    int m_send_buffer        = -1; // 最近一次设置的值
+    int m_recv_buffer        = -1;
+    int m_send_buffer_actual = -1; // 内核实际使用的值
+    int m_recv_buffer_actual = -1;
+
+    Address::ptr m_local_address;
+    Address::ptr m_remote_address;
+};
+
+std::ostream& operator<<(std::ostream& os, const Socket& sock);
+
+} // namespace trycle
+
+#endif // TRY_SOCKET_H
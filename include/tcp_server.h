@@ -0,0 +1,173 @@
+#ifndef TRY_TCP_SERVER_H
+#define TRY_TCP_SERVER_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "address.h"
+#include "iomanager.h"
+#include "socket.h"
+#include "thread.h"
+
+namespace trycle
+{
+
+struct TcpServerStats
+{
+    uint64_t accepted      = 0; // 累计接受的连接
+    uint64_t rejected      = 0; // 超过连接数上限被关闭的连接
+    uint64_t closed        = 0; // 处理结束的连接
+    uint64_t accept_errors = 0; // accept 失败次数（不含停止时的取消）
+    uint64_t active        = 0; // 当前连接数
+    uint64_t peak          = 0; // 连接数峰值
+};
+
+/**
+ * 多 reactor 的 TCP 服务器
+ *
+ * acceptor IOManager 只负责 accept：每个监听地址在每个 acceptor 上各有一个开启 SO_REUSEPORT 的监听 socket，
+ * 由内核在它们之间分配新连接。accept 得到的连接按分发策略选出一个 worker IOManager 的线程，
+ * 通过 schedule(fc, thread) 固定在该线程上执行 handleClient，连接之后的读写事件也都注册在这个 worker 上。
+ *
+ * 子类重写 handleClient 实现具体协议；handleClient 返回后连接被关闭。
+ */
+class TcpServer : public std::enable_shared_from_this<TcpServer>
+{
+public:
+    typedef std::shared_ptr<TcpServer> ptr;
+
+    // 连接分发策略
+    enum Dispatch
+    {
+        ROUND_ROBIN       = 0, // 轮询
+        LEAST_CONNECTIONS = 1, // 当前连接数最少的线程
+        FD_HASH           = 2, // 按 fd 取模，同一个 fd 总是落在同一个线程
+    };
+
+    /**
+     * @brief 构造函数
+     * @param {IOManager*} worker 处理连接的 IOManager
+     * @param {IOManager*} acceptor 执行 accept 的 IOManager
+     */
+    TcpServer(IOManager* worker = IOManager::GetThis(), IOManager* acceptor = IOManager::GetThis());
+
+    /**
+     * @brief 构造函数
+     * @param {vector<IOManager*>&} workers 处理连接的 IOManager，连接在它们的所有线程之间分发
+     * @param {vector<IOManager*>&} acceptors 执行 accept 的 IOManager，每个都有自己的监听 socket
+     */
+    TcpServer(const std::vector<IOManager*>& workers, const std::vector<IOManager*>& acceptors);
+    virtual ~TcpServer();
+
+    /**
+     * @brief 在每个 acceptor 上创建一个 SO_REUSEPORT 的监听 socket 并绑定 addr；
+     *        端口为 0 时第一个监听 socket 得到的端口会用于其余的监听 socket
+     */
+    virtual bool bind(Address::ptr addr);
+
+    /**
+     * @brief 绑定多个地址
+     * @param {vector<Address::ptr>&} fails 绑定失败的地址
+     * @return {*} 全部成功返回 true，有失败时已经绑定的监听 socket 也会被关闭
+     */
+    virtual bool bind(const std::vector<Address::ptr>& addrs, std::vector<Address::ptr>& fails);
+
+    /**
+     * @brief 开始 accept，重复调用直接返回 true；stop 之后不能再次 start
+     */
+    virtual bool start();
+
+    /**
+     * @brief 优雅停止：关闭监听 socket，等待正在处理的连接结束；
+     *        超过 drain_timeout_ms 后 shutdown 剩余连接并唤醒阻塞在读写上的协程，等待它们返回
+     * @param {uint64_t} drain_timeout_ms -1 表示使用 tcp.server.drain_timeout_ms
+     */
+    virtual void stop(uint64_t drain_timeout_ms = (uint64_t)-1);
+
+    const std::string& getName() const { return m_name; }
+    void setName(const std::string& name) { m_name = name; }
+    uint64_t getRecvTimeout() const { return m_recv_timeout; }
+    void setRecvTimeout(uint64_t ms) { m_recv_timeout = ms; }
+    // 0 表示不限制
+    uint64_t getMaxConnections() const { return m_max_connections; }
+    void setMaxConnections(uint64_t max) { m_max_connections = max; }
+    Dispatch getDispatch() const { return m_dispatch; }
+    void setDispatch(Dispatch dispatch) { m_dispatch = dispatch; }
+
+    bool isStop() const { return m_is_stop; }
+    std::vector<Socket::ptr> getListeners() const { return m_listeners; }
+
+    TcpServerStats getStats() const;
+    /**
+     * @brief 导出计数以及每个 worker 线程当前的连接数
+     */
+    std::string dump() const;
+
+protected:
+    /**
+     * @brief 处理一个连接，在分发到的 worker 线程上执行
+     */
+    virtual void handleClient(Socket::ptr client);
+
+    /**
+     * @brief 监听 socket 的 accept 循环，在 acceptor 上执行
+     */
+    virtual void startAccept(Socket::ptr sock);
+
+private:
+    // 一个 worker 线程
+    struct Slot
+    {
+        IOManager* iom = nullptr;
+        int thread     = -1;
+        std::atomic<uint64_t> connections{0};
+    };
+
+    Slot* selectSlot(const Socket::ptr& client);
+    void dispatch(Socket::ptr client);
+    void runClient(Socket::ptr client, Slot* slot);
+    // 唤醒阻塞在 accept 上的协程
+    void cancelAccept();
+    // 强制结束剩余连接
+    void abortClients();
+    // 等待 cond 成立，最多 timeout_ms
+    template <typename Cond>
+    bool waitFor(Cond cond, uint64_t timeout_ms);
+
+private:
+    typedef Mutex MutexType;
+
+    std::string m_name = "trycle/1.0.0";
+    std::vector<IOManager*> m_workers;
+    std::vector<IOManager*> m_acceptors;
+    std::vector<Socket::ptr> m_listeners;
+    // 监听 socket 对应的 acceptor
+    std::map<Socket*, IOManager*> m_listener_owners;
+    std::vector<std::unique_ptr<Slot>> m_slots;
+
+    uint64_t m_recv_timeout;
+    uint64_t m_max_connections;
+    Dispatch m_dispatch = ROUND_ROBIN;
+    std::atomic<bool> m_is_stop{true};
+    std::atomic<bool> m_started{false};
+
+    std::atomic<uint64_t> m_round_robin{0};
+    std::atomic<int> m_accepting{0};
+    std::atomic<uint64_t> m_accepted{0};
+    std::atomic<uint64_t> m_rejected{0};
+    std::atomic<uint64_t> m_closed{0};
+    std::atomic<uint64_t> m_accept_errors{0};
+    std::atomic<uint64_t> m_active{0};
+    std::atomic<uint64_t> m_peak{0};
+
+    // 正在处理的连接，用于停止时强制结束
+    MutexType m_mutex;
+    std::map<Socket*, std::pair<Socket::ptr, IOManager*>> m_clients;
+};
+
+} // namespace trycle
+
+#endif // TRY_TCP_SERVER_H
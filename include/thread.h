@@ -182,7 +182,7 @@ class RWMutex
 {
 public:
     typedef ReadScopedLockImpl<RWMutex> ReadLock;
-    typedef ReadScopedLockImpl<RWMutex> WriteLock;
+    typedef WriteScopedLockImpl<RWMutex> WriteLock;
 
     RWMutex()
     {
@@ -20,6 +20,8 @@ std::vector<std::string> Split(const std::string& str, const std::string& delimi
 
 uint64_t GetCurrentMs();
 uint64_t GetCurrentUs();
+// 单调时钟（CLOCK_MONOTONIC），不受系统时间回拨影响，用于统计耗时
+uint64_t GetMonotonicNs();
 
 } // namespace trycle
 
@@ -0,0 +1,132 @@
+#ifndef TRY_ZERO_COPY_H
+#define TRY_ZERO_COPY_H
+
+#include <map>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "fiber.h"
+#include "thread.h"
+
+namespace trycle
+{
+
+/**
+ * @brief 把文件 [offset, offset + len) 发送到 fd_out，数据由内核直接从页缓存拷贝，不经过用户态
+ *        走 hook 过的 sendfile，fd_out 写满时挂起当前协程；sendfile 不支持该组合时退化为经由管道的 splice
+ * @param {int} fd_out 输出端，通常是 socket
+ * @param {int} file_fd 输入文件
+ * @param {off_t} offset 文件偏移，不修改 file_fd 自身的读写位置
+ * @param {size_t} len 要发送的字节数，文件提前结束时按实际长度返回
+ * @return {*} 发送的字节数，一个字节都没有发出且出错时返回 -1
+ */
+ssize_t transferFile(int fd_out, int file_fd, off_t offset, size_t len);
+
+/**
+ * @brief 单向中继：fd_in -> 管道 -> fd_out，数据只在内核的管道缓冲区之间移动
+ *        直到 fd_in 读到 EOF 或任一端出错才返回，返回前不关闭也不 shutdown 两端
+ * @param {size_t} chunk 每次 splice 的最大字节数
+ * @return {*} 中继的字节数，一个字节都没有中继且出错时返回 -1
+ */
+ssize_t spliceRelay(int fd_in, int fd_out, size_t chunk = 64 * 1024);
+
+/**
+ * @brief 双向中继（TCP 代理）：在当前 IOManager 上为两个方向各起一个协程做 spliceRelay，
+ *        一个方向结束后 shutdown 对端的写方向，两个方向都结束后关闭 a、b
+ * @return {*} 不在 IOManager 中时返回 false，此时不接管 a、b
+ */
+bool spliceProxy(int a, int b, size_t chunk = 64 * 1024);
+
+class IOManager;
+
+/**
+ * MSG_ZEROCOPY 发送（Linux 4.14+）
+ *
+ * 不小于阈值（tcp.zerocopy.threshold）的数据带 MSG_ZEROCOPY 发送，内核直接引用用户页，
+ * 发送完成后在 socket 的错误队列上给出 SO_EE_ORIGIN_ZEROCOPY 通知。在那之前缓冲区不能被修改或释放，
+ * 所以 send 接收一个 owner，持有到对应的通知到达为止；小于阈值时普通拷贝发送，立即返回，不持有 owner。
+ *
+ * 有未完成的发送时在 IOManager 上注册 ERROR 事件，回调里读取错误队列、释放 owner，
+ * 全部完成后唤醒在 flush 中等待的协程。内核或 socket 不支持 SO_ZEROCOPY 时全部退化为普通发送。
+ * 必须通过 Create 创建，回调持有对象的 shared_ptr。
+ */
+class ZeroCopySender : public std::enable_shared_from_this<ZeroCopySender>
+{
+public:
+    typedef std::shared_ptr<ZeroCopySender> ptr;
+    typedef Mutex MutexType;
+
+    /**
+     * @brief 创建 fd 的发送器并尝试开启 SO_ZEROCOPY，必须在 IOManager 中调用才会启用零拷贝
+     * @param {int} fd 已连接的 TCP socket
+     */
+    static ptr Create(int fd);
+
+    /**
+     * @brief 发送 [data, data + len)，直到全部发出或出错
+     * @param {shared_ptr<const void>} owner 缓冲区的持有者，零拷贝发送时保留到内核完成通知到达
+     * @param {int} flags send 的 flags
+     * @return {*} 发出的字节数，一个字节都没有发出且出错时返回 -1
+     */
+    ssize_t send(const std::shared_ptr<const void>& owner, const void* data, size_t len, int flags = 0);
+
+    /**
+     * @brief 挂起当前协程，直到所有零拷贝发送都已完成（缓冲区全部释放）
+     * @param {uint64_t} timeout_ms 超时时间，-1 表示一直等待
+     * @return {*} 超时返回 false
+     */
+    bool flush(uint64_t timeout_ms = (uint64_t)-1);
+
+    bool isEnabled() const { return m_enabled; }
+    int getFd() const { return m_fd; }
+    size_t getThreshold() const { return m_threshold; }
+    void setThreshold(size_t v) { m_threshold = v; }
+
+    // 尚未收到完成通知的零拷贝发送数
+    size_t getPendingCount();
+    // 带 MSG_ZEROCOPY 的发送次数
+    uint64_t getZeroCopyCount() const { return m_zerocopy_count; }
+    // 小于阈值、普通拷贝的发送次数
+    uint64_t getCopyCount() const { return m_copy_count; }
+    // 内核实际做了拷贝的完成通知数（如回环或网卡不支持 scatter-gather），数量多时说明零拷贝没有收益
+    uint64_t getKernelCopiedCount() const { return m_kernel_copied_count; }
+
+private:
+    ZeroCopySender(int fd);
+
+    /**
+     * @brief 非阻塞地读取错误队列中的完成通知并释放对应的 owner，调用方持有 m_mutex
+     * @return {*} 读到的通知数，socket 已出错时返回 -1
+     */
+    int reap();
+
+    // ERROR 事件回调
+    void onError();
+    // 有未完成的发送且没有注册 ERROR 事件时注册，调用方持有 m_mutex
+    void watch();
+    // 放弃所有未完成的发送（socket 已出错或关闭），调用方持有 m_mutex
+    void dropPending();
+    // 没有未完成的发送时唤醒 flush 中的协程，调用方持有 m_mutex
+    void wakeWaiter();
+
+private:
+    int m_fd;
+    uint32_t m_generation  = 0;                                // 创建时 FdCtx 的代数，fd 被关闭复用后不再读它的错误队列
+    bool m_enabled         = false;
+    bool m_watching        = false;                            // 是否注册了 ERROR 事件
+    size_t m_threshold     = 0;
+    uint32_t m_next_id     = 0;                                // 下一次零拷贝发送的通知序号，与内核的计数一致
+    IOManager* m_iom       = nullptr;
+    std::map<uint32_t, std::shared_ptr<const void>> m_pending; // 通知序号 -> 缓冲区持有者
+    Fiber::ptr m_waiter;                                       // 在 flush 中等待的协程
+    uint64_t m_zerocopy_count      = 0;
+    uint64_t m_copy_count          = 0;
+    uint64_t m_kernel_copied_count = 0;
+    MutexType m_mutex;
+};
+
+} // namespace trycle
+
+#endif // TRY_ZERO_COPY_H
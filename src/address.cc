@@ -1,6 +1,8 @@
 #include "address.h"
 #include "endianx.h"
 #include "log.h"
+#include "resolver.h"
+#include "sock_addr.h"
 
 #include <ifaddrs.h>
 #include <netdb.h>
@@ -59,16 +61,13 @@ Address::ptr Address::Create(const sockaddr* addr, socklen_t sock_len)
 
 bool Address::Lookup(std::vector<Address::ptr>& result, const std::string& host, int family, int type, int protoccol)
 {
-    addrinfo hints, *results, *next;
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_flags     = 0;
-    hints.ai_family    = family;
-    hints.ai_socktype  = type,
-    hints.ai_protocol  = protoccol;
-    hints.ai_addrlen   = 0;
-    hints.ai_canonname = NULL;
-    hints.ai_addr      = NULL;
-    hints.ai_next      = NULL;
+    // 数字形式的地址直接用 inet_pton 解析，不经过 getaddrinfo
+    SockAddr numeric;
+    if (SockAddr::Parse(host, numeric) && (family == AF_UNSPEC || family == numeric.getFamily()))
+    {
+        result.push_back(numeric.toAddress());
+        return true;
+    }
 
     std::string node;
     const char* service = NULL;
@@ -106,7 +105,8 @@ bool Address::Lookup(std::vector<Address::ptr>& result, const std::string& host,
         node = host;
     }
 
-    int error = getaddrinfo(node.c_str(), service, &hints, &results);
+    // 由 Resolver 解析并缓存，在协程中调用时不会阻塞调度线程
+    int error = ResolverMgr::GetSingleton()->resolve(result, node, service ? service : "", family, type, protoccol);
     if (error)
     {
         LOG_FMT_ERROR(g_logger, "Address::Lookup error | host=%s, family=%d, type=%d | error=%d, errstr=%s",
@@ -114,15 +114,6 @@ bool Address::Lookup(std::vector<Address::ptr>& result, const std::string& host,
         return false;
     }
 
-    next = results;
-    while (next)
-    {
-        result.push_back(Create(next->ai_addr, next->ai_addrlen));
-        next = next->ai_next;
-    }
-
-    freeaddrinfo(results);
-
     return !result.empty();
 }
 
@@ -276,7 +267,7 @@ bool Address::operator<(const Address& rhs) const
 bool Address::operator==(const Address& rhs) const
 {
     return getAddrLen() == rhs.getAddrLen() &&
-           memcmp(getAddr(), rhs.getAddr(), getAddrLen());
+           memcmp(getAddr(), rhs.getAddr(), getAddrLen()) == 0;
 }
 
 bool Address::operator!=(const Address& rhs) const
@@ -292,36 +283,15 @@ bool Address::operator!=(const Address& rhs) const
 
 IpAddress::ptr IpAddress::Create(const char* addr, uint16_t port)
 {
-    addrinfo hints, *results;
-    memset(&hints, 0, sizeof(addrinfo));
-
-    hints.ai_flags  = AI_NUMERICHOST;
-    hints.ai_family = AF_UNSPEC;
-
-    int error       = getaddrinfo(addr, NULL, &hints, &results);
-    if (error)
-    {
-        LOG_FMT_ERROR(g_logger, "Ipv4Address::Create error | addr=%s, port%d | error=%d, errstr=%s",
-                      addr, port, errno, strerror(errno));
-        return nullptr;
-    }
-
-    try
+    SockAddr numeric;
+    if (!SockAddr::Parse(addr, numeric, port) || !numeric.isIp())
     {
-        IpAddress::ptr result = std::dynamic_pointer_cast<IpAddress>(Address::Create(results->ai_addr, results->ai_addrlen));
-        if (result)
-        {
-            result->setPort(port);
-        }
-        freeaddrinfo(results);
-        return result;
-    }
-    catch (...)
-    {
-        LOG_ERROR(g_logger, "IpAddress::Create error.");
-        freeaddrinfo(results);
+        LOG_FMT_ERROR(g_logger, "IpAddress::Create error | addr=%s, port=%d | not a numeric address", addr, port);
         return nullptr;
     }
+    IpAddress::ptr result = std::dynamic_pointer_cast<IpAddress>(numeric.toAddress());
+    result->setPort(port);
+    return result;
 }
 
 // IpAddress::ptr IpAddress::broadcastAddress(uint32_t prefix_len)
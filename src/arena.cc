@@ -0,0 +1,99 @@
+#include "arena.h"
+
+#include "fiber.h"
+#include "slab.h"
+
+namespace trycle
+{
+
+const size_t Arena::CHUNK_SIZE;
+const size_t Arena::LARGE_THRESHOLD;
+
+/**
+ * ============================================================================
+ * Arena 类的实现
+ * ============================================================================
+ */
+Arena::Arena()
+{
+}
+
+Arena::~Arena()
+{
+    reset();
+}
+
+void* Arena::allocateSlow(size_t size, size_t align)
+{
+    if (size + align > LARGE_THRESHOLD)
+    {
+        Chunk* chunk = (Chunk*)SlabPool::Allocate(sizeof(Chunk) + size + align);
+        chunk->size  = size + align;
+        chunk->next  = m_large;
+        m_large      = chunk;
+        m_used += size;
+        uintptr_t p = ((uintptr_t)(chunk + 1) + align - 1) & ~(uintptr_t)(align - 1);
+        return (void*)p;
+    }
+
+    Chunk* chunk = (Chunk*)SlabPool::Allocate(sizeof(Chunk) + CHUNK_SIZE);
+    chunk->size  = CHUNK_SIZE;
+    chunk->next  = m_head;
+    m_head       = chunk;
+    ++m_chunk_count;
+
+    // 当前块剩下的空间直接放弃
+    m_ptr = (char*)(chunk + 1);
+    m_end = m_ptr + CHUNK_SIZE;
+    return allocate(size, align);
+}
+
+void Arena::addCleanup(void (*fn)(void*), void* obj)
+{
+    Cleanup* cleanup = (Cleanup*)allocate(sizeof(Cleanup), alignof(Cleanup));
+    cleanup->fn      = fn;
+    cleanup->obj     = obj;
+    cleanup->next    = m_cleanups;
+    m_cleanups       = cleanup;
+}
+
+void Arena::FreeChunks(Chunk* chunk)
+{
+    while (chunk)
+    {
+        Chunk* next = chunk->next;
+        SlabPool::Deallocate(chunk, sizeof(Chunk) + chunk->size);
+        chunk = next;
+    }
+}
+
+void Arena::reset()
+{
+    // 析构函数中还可能从 arena 分配，先取下链表
+    while (m_cleanups)
+    {
+        Cleanup* cleanup = m_cleanups;
+        m_cleanups       = nullptr;
+        for (; cleanup; cleanup = cleanup->next)
+        {
+            cleanup->fn(cleanup->obj);
+        }
+    }
+
+    FreeChunks(m_large);
+    FreeChunks(m_head);
+
+    m_ptr         = nullptr;
+    m_end         = nullptr;
+    m_head        = nullptr;
+    m_large       = nullptr;
+    m_chunk_count = 0;
+    m_used        = 0;
+}
+
+Arena* Arena::GetThis()
+{
+    return Fiber::GetThis()->getArena();
+}
+
+} // namespace trycle
@@ -0,0 +1,281 @@
+#include "bytearray.h"
+
+#include <fcntl.h>
+#include <stdexcept>
+#include <string.h>
+#include <unistd.h>
+
+#include "endianx.h"
+#include "hook.h"
+#include "log.h"
+
+namespace trycle
+{
+
+static auto g_logger = GET_LOGGER("system");
+
+// uint64 的 varint 最多 10 字节
+static const size_t MAX_VARINT_SIZE = 10;
+
+/**
+ * ============================================================================
+ * ByteArray 类的实现
+ * ============================================================================
+ */
+ByteArray::ByteArray(bool little_endian)
+    : m_little_endian(little_endian)
+{
+}
+
+template <typename T>
+void ByteArray::writeFixed(T val)
+{
+    val = m_little_endian ? byteswapOnBigEndian(val) : byteswapOnLittleEndian(val);
+    m_buffer.append(&val, sizeof(val));
+}
+
+template <typename T>
+T ByteArray::readFixed()
+{
+    T val;
+    read(&val, sizeof(val));
+    return m_little_endian ? byteswapOnBigEndian(val) : byteswapOnLittleEndian(val);
+}
+
+void ByteArray::writeFint8(int8_t val) { writeFixed(val); }
+void ByteArray::writeFuint8(uint8_t val) { writeFixed(val); }
+void ByteArray::writeFint16(int16_t val) { writeFixed(val); }
+void ByteArray::writeFuint16(uint16_t val) { writeFixed(val); }
+void ByteArray::writeFint32(int32_t val) { writeFixed(val); }
+void ByteArray::writeFuint32(uint32_t val) { writeFixed(val); }
+void ByteArray::writeFint64(int64_t val) { writeFixed(val); }
+void ByteArray::writeFuint64(uint64_t val) { writeFixed(val); }
+
+int8_t ByteArray::readFint8() { return readFixed<int8_t>(); }
+uint8_t ByteArray::readFuint8() { return readFixed<uint8_t>(); }
+int16_t ByteArray::readFint16() { return readFixed<int16_t>(); }
+uint16_t ByteArray::readFuint16() { return readFixed<uint16_t>(); }
+int32_t ByteArray::readFint32() { return readFixed<int32_t>(); }
+uint32_t ByteArray::readFuint32() { return readFixed<uint32_t>(); }
+int64_t ByteArray::readFint64() { return readFixed<int64_t>(); }
+uint64_t ByteArray::readFuint64() { return readFixed<uint64_t>(); }
+
+void ByteArray::writeVarint(uint64_t val)
+{
+    uint8_t tmp[MAX_VARINT_SIZE];
+    size_t n = 0;
+    while (val >= 0x80)
+    {
+        tmp[n++] = (uint8_t)(val | 0x80);
+        val >>= 7;
+    }
+    tmp[n++] = (uint8_t)val;
+    m_buffer.append(tmp, n);
+}
+
+uint64_t ByteArray::readVarint()
+{
+    // 多数情况下 varint 整个落在第一个块中，直接在块上解码；跨块时先拷出来
+    uint8_t tmp[MAX_VARINT_SIZE];
+    const uint8_t* p;
+    size_t avail;
+    iovec iov;
+    if (m_buffer.getReadBuffers(&iov, 1, MAX_VARINT_SIZE) && (iov.iov_len == MAX_VARINT_SIZE || iov.iov_len == m_buffer.size()))
+    {
+        p     = (const uint8_t*)iov.iov_base;
+        avail = iov.iov_len;
+    }
+    else
+    {
+        p     = tmp;
+        avail = m_buffer.copyOut(tmp, MAX_VARINT_SIZE);
+    }
+
+    uint64_t val = 0;
+    for (size_t i = 0; i < avail; ++i)
+    {
+        val |= (uint64_t)(p[i] & 0x7F) << (7 * i);
+        if (!(p[i] & 0x80))
+        {
+            m_buffer.consume(i + 1);
+            return val;
+        }
+    }
+    if (avail < MAX_VARINT_SIZE)
+    {
+        throw std::out_of_range("ByteArray::readVarint not enough data");
+    }
+    throw std::invalid_argument("ByteArray::readVarint varint too long");
+}
+
+void ByteArray::writeInt32(int32_t val) { writeVarint(EncodeZigzag32(val)); }
+void ByteArray::writeUint32(uint32_t val) { writeVarint(val); }
+void ByteArray::writeInt64(int64_t val) { writeVarint(EncodeZigzag64(val)); }
+void ByteArray::writeUint64(uint64_t val) { writeVarint(val); }
+
+int32_t ByteArray::readInt32() { return DecodeZigzag32((uint32_t)readVarint()); }
+uint32_t ByteArray::readUint32() { return (uint32_t)readVarint(); }
+int64_t ByteArray::readInt64() { return DecodeZigzag64(readVarint()); }
+uint64_t ByteArray::readUint64() { return readVarint(); }
+
+void ByteArray::writeFloat(float val)
+{
+    uint32_t v;
+    memcpy(&v, &val, sizeof(val));
+    writeFuint32(v);
+}
+
+void ByteArray::writeDouble(double val)
+{
+    uint64_t v;
+    memcpy(&v, &val, sizeof(val));
+    writeFuint64(v);
+}
+
+float ByteArray::readFloat()
+{
+    uint32_t v = readFuint32();
+    float val;
+    memcpy(&val, &v, sizeof(v));
+    return val;
+}
+
+double ByteArray::readDouble()
+{
+    uint64_t v = readFuint64();
+    double val;
+    memcpy(&val, &v, sizeof(v));
+    return val;
+}
+
+void ByteArray::writeStringF16(const std::string& val)
+{
+    // 长度写不进前缀时不截断，否则读端会按错误的长度解析后面的数据
+    if (val.size() > UINT16_MAX)
+    {
+        throw std::length_error("ByteArray::writeStringF16 string too long");
+    }
+    writeFuint16(val.size());
+    m_buffer.append(val);
+}
+
+void ByteArray::writeStringF32(const std::string& val)
+{
+    if (val.size() > UINT32_MAX)
+    {
+        throw std::length_error("ByteArray::writeStringF32 string too long");
+    }
+    writeFuint32(val.size());
+    m_buffer.append(val);
+}
+
+void ByteArray::writeStringF64(const std::string& val)
+{
+    writeFuint64(val.size());
+    m_buffer.append(val);
+}
+
+void ByteArray::writeStringVint(const std::string& val)
+{
+    writeUint64(val.size());
+    m_buffer.append(val);
+}
+
+void ByteArray::writeStringWithoutLength(const std::string& val)
+{
+    m_buffer.append(val);
+}
+
+std::string ByteArray::readString(uint64_t len)
+{
+    if (len > m_buffer.size())
+    {
+        throw std::out_of_range("ByteArray::readString not enough data");
+    }
+    std::string val(len, '\0');
+    m_buffer.read(&val[0], len);
+    return val;
+}
+
+std::string ByteArray::readStringF16() { return readString(readFuint16()); }
+std::string ByteArray::readStringF32() { return readString(readFuint32()); }
+std::string ByteArray::readStringF64() { return readString(readFuint64()); }
+std::string ByteArray::readStringVint() { return readString(readUint64()); }
+
+void ByteArray::read(void* data, size_t len)
+{
+    if (len > m_buffer.size())
+    {
+        throw std::out_of_range("ByteArray::read not enough data");
+    }
+    m_buffer.read(data, len);
+}
+
+bool ByteArray::writeToFile(const std::string& name) const
+{
+    int fd = ::open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        LOG_FMT_ERROR(g_logger, "ByteArray::writeToFile open fail | %s, %d, %s", name.c_str(), errno, strerror(errno));
+        return false;
+    }
+    iovec iov[64];
+    size_t offset = 0;
+    while (offset < m_buffer.size())
+    {
+        size_t cnt = m_buffer.getReadBuffers(iov, 64, (size_t)-1, offset);
+        ssize_t n  = ::writev(fd, iov, cnt);
+        if (n <= 0)
+        {
+            LOG_FMT_ERROR(g_logger, "ByteArray::writeToFile writev fail | %s, %d, %s", name.c_str(), errno, strerror(errno));
+            ::close(fd);
+            return false;
+        }
+        offset += n;
+    }
+    ::close(fd);
+    return true;
+}
+
+bool ByteArray::readFromFile(const std::string& name)
+{
+    int fd = ::open(name.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        LOG_FMT_ERROR(g_logger, "ByteArray::readFromFile open fail | %s, %d, %s", name.c_str(), errno, strerror(errno));
+        return false;
+    }
+    ssize_t n;
+    while ((n = m_buffer.readFd(fd)) > 0)
+    {
+    }
+    ::close(fd);
+    if (n < 0)
+    {
+        LOG_FMT_ERROR(g_logger, "ByteArray::readFromFile readv fail | %s, %d, %s", name.c_str(), errno, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+std::string ByteArray::toHexString() const
+{
+    static const char* s_hex = "0123456789abcdef";
+    std::string data         = toString();
+    std::string str;
+    str.reserve(data.size() * 3);
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        if (i > 0 && i % 32 == 0)
+        {
+            str.push_back('\n');
+        }
+        uint8_t c = data[i];
+        str.push_back(s_hex[c >> 4]);
+        str.push_back(s_hex[c & 0x0F]);
+        str.push_back(' ');
+    }
+    return str;
+}
+
+} // namespace trycle
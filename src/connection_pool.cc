@@ -0,0 +1,438 @@
+#include "connection_pool.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "config.h"
+#include "hook.h"
+#include "log.h"
+#include "macro.h"
+#include "util.h"
+
+namespace trycle
+{
+
+static auto g_logger = GET_LOGGER("system");
+
+static auto g_tcp_pool_max_idle        = Config::lookUp<uint32_t>("tcp.pool.max_idle", 8, "tcp connection pool max idle connections per upstream");
+static auto g_tcp_pool_max_total       = Config::lookUp<uint32_t>("tcp.pool.max_total", 0, "tcp connection pool max connections per upstream, 0 means unlimited");
+static auto g_tcp_pool_idle_timeout    = Config::lookUp<uint64_t>("tcp.pool.idle_timeout_ms", 60 * 1000, "tcp connection pool idle timeout ms");
+static auto g_tcp_pool_connect_timeout = Config::lookUp<uint64_t>("tcp.pool.connect_timeout_ms", 3000, "tcp connection pool default get timeout ms");
+
+// 清理定时器的最大间隔，空闲连接最多比 idle_timeout 晚这么久关闭
+static const uint64_t MAX_SWEEP_INTERVAL_MS = 1000;
+
+void ConnectionPool::Upstream::wakeOne()
+{
+    while (!waiters.empty())
+    {
+        Waiter::ptr waiter = waiters.front();
+        waiters.pop_front();
+        if (waiter->fiber)
+        {
+            waiter->scheduler->schedule(std::move(waiter->fiber));
+            waiter->fiber.reset();
+            return;
+        }
+    }
+}
+
+/**
+ * ============================================================================
+ * ConnectionPool 类的实现
+ * ============================================================================
+ */
+ConnectionPool::ptr ConnectionPool::Create(IOManager* iom)
+{
+    ASSERT_M(iom, "ConnectionPool needs an IOManager");
+    ConnectionPool::ptr pool(new ConnectionPool(iom));
+    std::weak_ptr<ConnectionPool> weak(pool);
+    uint64_t interval = std::min(std::max(pool->m_idle_timeout / 2, (uint64_t)1), MAX_SWEEP_INTERVAL_MS);
+    pool->m_timer     = iom->addConditionTimer(interval, [weak]()
+                                               {
+                                                   auto pool = weak.lock();
+                                                   if (pool)
+                                                   {
+                                                       pool->sweep();
+                                                   } },
+                                               weak, true);
+    return pool;
+}
+
+ConnectionPool::ConnectionPool(IOManager* iom)
+    : m_iom(iom),
+      m_max_idle(g_tcp_pool_max_idle->getVal()),
+      m_max_total(g_tcp_pool_max_total->getVal()),
+      m_idle_timeout(g_tcp_pool_idle_timeout->getVal()),
+      m_connect_timeout(g_tcp_pool_connect_timeout->getVal())
+{
+}
+
+ConnectionPool::~ConnectionPool()
+{
+    if (m_timer)
+    {
+        m_timer->cancel();
+    }
+    clear();
+}
+
+ConnectionPool::Upstream::ptr ConnectionPool::getUpstream(const std::string& key, Address::ptr addr)
+{
+    {
+        RWMutex::ReadLock lock(&m_mutex);
+        auto it = m_upstreams.find(key);
+        if (it != m_upstreams.end())
+        {
+            return it->second;
+        }
+    }
+    RWMutex::WriteLock lock(&m_mutex);
+    auto& up = m_upstreams[key];
+    if (!up)
+    {
+        up = std::make_shared<Upstream>();
+        if (addr)
+        {
+            up->addr = addr;
+        }
+        else
+        {
+            up->host = key;
+        }
+    }
+    return up;
+}
+
+Socket::ptr ConnectionPool::get(const std::string& host, uint64_t timeout_ms)
+{
+    return checkout(getUpstream(host, nullptr), timeout_ms);
+}
+
+Socket::ptr ConnectionPool::get(Address::ptr addr, uint64_t timeout_ms)
+{
+    return checkout(getUpstream(addr->toString(), addr), timeout_ms);
+}
+
+bool ConnectionPool::IsAlive(Socket* sock)
+{
+    // 不经过 hook，不会挂起：EAGAIN 说明连接正常且没有数据，
+    // 返回 0 是对端已关闭，读到数据说明上一次使用留下了未读的响应，连接状态不可信
+    char c;
+    ssize_t n = recv_f(sock->getSocket(), &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+Socket::ptr ConnectionPool::checkout(Upstream::ptr up, uint64_t timeout_ms)
+{
+    if (timeout_ms == (uint64_t)-1)
+    {
+        timeout_ms = m_connect_timeout;
+    }
+    uint64_t deadline = GetCurrentMs() + timeout_ms;
+
+    while (true)
+    {
+        std::vector<Socket*> dead;
+        Socket* sock  = nullptr;
+        bool create   = false;
+        uint64_t now  = GetCurrentMs();
+        Waiter::ptr waiter;
+        {
+            MutexType::Lock lock(&up->mutex);
+            while (!up->idle.empty())
+            {
+                Idle idle = up->idle.back();
+                up->idle.pop_back();
+                if (now - idle.since < m_idle_timeout && IsAlive(idle.sock))
+                {
+                    sock = idle.sock;
+                    break;
+                }
+                dead.push_back(idle.sock);
+                --up->total;
+            }
+            if (!sock)
+            {
+                if (!m_max_total || up->total < m_max_total)
+                {
+                    ++up->total;
+                    create = true;
+                }
+                else if (now < deadline && Scheduler::GetThis())
+                {
+                    waiter            = std::make_shared<Waiter>();
+                    waiter->scheduler = Scheduler::GetThis();
+                    waiter->fiber     = Fiber::GetThis();
+                    up->waiters.push_back(waiter);
+                }
+            }
+            // 丢弃的连接腾出了名额
+            for (size_t i = 0; i < dead.size() && !up->waiters.empty(); ++i)
+            {
+                up->wakeOne();
+            }
+        }
+        m_dead += dead.size();
+        for (Socket* s : dead)
+        {
+            delete s;
+        }
+
+        if (sock)
+        {
+            ++m_reused;
+            return wrap(up, sock);
+        }
+        if (create)
+        {
+            sock = connect(up, deadline);
+            if (sock)
+            {
+                ++m_created;
+                return wrap(up, sock);
+            }
+            int err = errno;
+            ++m_connect_failed;
+            {
+                MutexType::Lock lock(&up->mutex);
+                --up->total;
+                up->wakeOne();
+            }
+            errno = err;
+            return nullptr;
+        }
+        if (!waiter)
+        {
+            ++m_wait_timeouts;
+            errno = ETIMEDOUT;
+            return nullptr;
+        }
+
+        // 达到连接数上限，等待归还或超时后重新检查
+        Timer::ptr timer = m_iom->addTimer(deadline - now, [up, waiter]()
+                                           {
+                                               MutexType::Lock lock(&up->mutex);
+                                               if (waiter->fiber)
+                                               {
+                                                   up->waiters.remove(waiter);
+                                                   waiter->scheduler->schedule(std::move(waiter->fiber));
+                                                   waiter->fiber.reset();
+                                               } },
+                                           false);
+        Fiber::YieldToHold();
+        timer->cancel();
+    }
+}
+
+Socket* ConnectionPool::connect(Upstream::ptr up, uint64_t deadline)
+{
+    std::vector<Address::ptr> addrs;
+    if (up->addr)
+    {
+        addrs.push_back(up->addr);
+    }
+    else if (!Address::Lookup(addrs, up->host, AF_UNSPEC, SOCK_STREAM))
+    {
+        errno = EHOSTUNREACH;
+        return nullptr;
+    }
+
+    int err = ETIMEDOUT;
+    for (auto& addr : addrs)
+    {
+        uint64_t now = GetCurrentMs();
+        if (now >= deadline)
+        {
+            err = ETIMEDOUT;
+            break;
+        }
+        Socket* sock = new Socket(addr->getFamily(), SOCK_STREAM, 0);
+        if (sock->connect(addr, deadline - now))
+        {
+            return sock;
+        }
+        err = errno;
+        LOG_FMT_DEBUG(g_logger, "ConnectionPool connect fail | %s, errno=%d, errstr=%s",
+                      addr->toString().c_str(), err, strerror(err));
+        delete sock;
+    }
+    errno = err;
+    return nullptr;
+}
+
+Socket::ptr ConnectionPool::wrap(Upstream::ptr up, Socket* sock)
+{
+    std::weak_ptr<ConnectionPool> weak(shared_from_this());
+    return Socket::ptr(sock, [weak, up](Socket* sock)
+                       {
+                           auto pool = weak.lock();
+                           if (pool)
+                           {
+                               pool->release(up, sock);
+                           }
+                           else
+                           {
+                               delete sock;
+                           } });
+}
+
+void ConnectionPool::release(Upstream::ptr up, Socket* sock)
+{
+    bool reusable = sock->isValid() && sock->isConnected();
+    {
+        MutexType::Lock lock(&up->mutex);
+        if (reusable && up->idle.size() < m_max_idle)
+        {
+            up->idle.push_back(Idle{sock, GetCurrentMs()});
+            up->wakeOne();
+            return;
+        }
+        --up->total;
+        up->wakeOne();
+    }
+    delete sock;
+}
+
+size_t ConnectionPool::prewarm(const std::string& host, size_t count)
+{
+    return prewarm(getUpstream(host, nullptr), count);
+}
+
+size_t ConnectionPool::prewarm(Address::ptr addr, size_t count)
+{
+    return prewarm(getUpstream(addr->toString(), addr), count);
+}
+
+size_t ConnectionPool::prewarm(Upstream::ptr up, size_t count)
+{
+    count             = std::min<size_t>(count, m_max_idle);
+    uint64_t deadline = GetCurrentMs() + m_connect_timeout;
+    size_t created    = 0;
+    while (true)
+    {
+        {
+            MutexType::Lock lock(&up->mutex);
+            if (up->idle.size() >= count || (m_max_total && up->total >= m_max_total))
+            {
+                break;
+            }
+            ++up->total;
+        }
+        Socket* sock = connect(up, deadline);
+        MutexType::Lock lock(&up->mutex);
+        if (!sock)
+        {
+            ++m_connect_failed;
+            --up->total;
+            up->wakeOne();
+            break;
+        }
+        ++m_created;
+        ++created;
+        up->idle.push_back(Idle{sock, GetCurrentMs()});
+        up->wakeOne();
+    }
+    return created;
+}
+
+void ConnectionPool::sweep()
+{
+    std::vector<Upstream::ptr> ups;
+    {
+        RWMutex::ReadLock lock(&m_mutex);
+        for (auto& it : m_upstreams)
+        {
+            ups.push_back(it.second);
+        }
+    }
+
+    uint64_t now = GetCurrentMs();
+    std::vector<Socket*> expired;
+    for (auto& up : ups)
+    {
+        MutexType::Lock lock(&up->mutex);
+        // 头部是最早归还的，遇到没有超时的就可以停止
+        while (!up->idle.empty() && now - up->idle.front().since >= m_idle_timeout)
+        {
+            expired.push_back(up->idle.front().sock);
+            up->idle.pop_front();
+            --up->total;
+            up->wakeOne();
+        }
+    }
+    m_expired += expired.size();
+    for (Socket* sock : expired)
+    {
+        delete sock;
+    }
+}
+
+void ConnectionPool::clear()
+{
+    std::vector<Socket*> socks;
+    {
+        RWMutex::ReadLock lock(&m_mutex);
+        for (auto& it : m_upstreams)
+        {
+            Upstream::ptr up = it.second;
+            MutexType::Lock up_lock(&up->mutex);
+            for (auto& idle : up->idle)
+            {
+                socks.push_back(idle.sock);
+                --up->total;
+                up->wakeOne();
+            }
+            up->idle.clear();
+        }
+    }
+    for (Socket* sock : socks)
+    {
+        delete sock;
+    }
+}
+
+ConnectionPoolStats ConnectionPool::getStats()
+{
+    ConnectionPoolStats stats;
+    stats.created        = m_created;
+    stats.reused         = m_reused;
+    stats.expired        = m_expired;
+    stats.dead           = m_dead;
+    stats.connect_failed = m_connect_failed;
+    stats.wait_timeouts  = m_wait_timeouts;
+
+    RWMutex::ReadLock lock(&m_mutex);
+    for (auto& it : m_upstreams)
+    {
+        MutexType::Lock up_lock(&it.second->mutex);
+        stats.idle += it.second->idle.size();
+        stats.total += it.second->total;
+    }
+    return stats;
+}
+
+std::ostream& ConnectionPool::dump(std::ostream& os)
+{
+    ConnectionPoolStats stats = getStats();
+    size_t upstreams;
+    {
+        RWMutex::ReadLock lock(&m_mutex);
+        upstreams = m_upstreams.size();
+    }
+    os << "[ConnectionPool upstreams=" << upstreams
+       << " idle=" << stats.idle
+       << " total=" << stats.total
+       << " created=" << stats.created
+       << " reused=" << stats.reused
+       << " expired=" << stats.expired
+       << " dead=" << stats.dead
+       << " connect_failed=" << stats.connect_failed
+       << " wait_timeouts=" << stats.wait_timeouts
+       << "]";
+    return os;
+}
+
+} // namespace trycle
@@ -0,0 +1,260 @@
+#include "connector.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "hook.h"
+#include "iomanager.h"
+#include "log.h"
+#include "util.h"
+
+namespace trycle
+{
+
+static auto g_logger = GET_LOGGER("system");
+
+static auto g_tcp_timeout_ms           = Config::lookUp<int>("tcp.timeout.ms", 5000, "tcp timeout ms");
+static auto g_connect_attempt_delay_ms = Config::lookUp<uint64_t>("tcp.connect.attempt_delay_ms", 250, "happy eyeballs connection attempt delay ms");
+
+/**
+ * 一次 connectAny 中所有连接尝试共享的状态
+ * 发起连接的协程（driver）挂起等待，每个尝试结束时唤醒它重新检查
+ */
+struct ConnectRace
+{
+    typedef std::shared_ptr<ConnectRace> ptr;
+    typedef Mutex MutexType;
+
+    MutexType mutex;
+    IOManager* iom = nullptr;
+    int winner_fd  = -1;        // 最先连上的 socket
+    Address::ptr winner;        // 最先连上的地址
+    size_t running = 0;         // 正在进行的尝试数
+    int last_error = ECONNREFUSED;
+    bool done      = false;     // driver 已经返回，之后完成的连接直接关闭
+    std::vector<int> fds;       // 正在连接的 socket，用于取消
+    Fiber::ptr waiter;          // 挂起的 driver
+
+    // 唤醒 driver，调用方持有 mutex
+    void wake()
+    {
+        if (waiter)
+        {
+            iom->schedule(std::move(waiter));
+            waiter.reset();
+        }
+    }
+};
+
+// 按 RFC 8305 交替排列地址族，以第一个地址的地址族开头
+static std::vector<Address::ptr> interleave(const std::vector<Address::ptr>& addrs)
+{
+    if (addrs.empty())
+    {
+        return addrs;
+    }
+    int first_family = addrs[0]->getFamily();
+    std::vector<Address::ptr> primary, secondary, result;
+    for (auto& addr : addrs)
+    {
+        (addr->getFamily() == first_family ? primary : secondary).push_back(addr);
+    }
+    for (size_t i = 0; i < std::max(primary.size(), secondary.size()); ++i)
+    {
+        if (i < primary.size())
+        {
+            result.push_back(primary[i]);
+        }
+        if (i < secondary.size())
+        {
+            result.push_back(secondary[i]);
+        }
+    }
+    return result;
+}
+
+// 一次连接尝试，在单独的协程中运行
+static void attempt(ConnectRace::ptr race, Address::ptr addr, uint64_t deadline)
+{
+    int fd = -1;
+    {
+        ConnectRace::MutexType::Lock lock(&race->mutex);
+        if (race->winner_fd == -1 && !race->done)
+        {
+            fd = ::socket(addr->getFamily(), SOCK_STREAM, 0);
+            if (fd < 0)
+            {
+                race->last_error = errno;
+            }
+            else
+            {
+                race->fds.push_back(fd);
+            }
+        }
+        if (fd < 0)
+        {
+            --race->running;
+            race->wake();
+            return;
+        }
+    }
+
+    uint64_t now = GetCurrentMs();
+    int rt       = connect_with_timeout(fd, addr->getAddr(), addr->getAddrLen(), deadline > now ? deadline - now : 0);
+    int err      = errno;
+    LOG_FMT_DEBUG(g_logger, "connectAny attempt | addr=%s, rt=%d, errno=%d", addr->toString().c_str(), rt, rt ? err : 0);
+
+    bool keep = false;
+    {
+        ConnectRace::MutexType::Lock lock(&race->mutex);
+        race->fds.erase(std::find(race->fds.begin(), race->fds.end(), fd));
+        --race->running;
+        // 被取消的连接也可能返回 0，只有第一个完成且 driver 还在等待的才算赢
+        if (rt == 0 && race->winner_fd == -1 && !race->done)
+        {
+            race->winner_fd = fd;
+            race->winner    = addr;
+            keep            = true;
+        }
+        else if (rt != 0 && race->winner_fd == -1)
+        {
+            race->last_error = err;
+        }
+        race->wake();
+    }
+    if (!keep)
+    {
+        ::close(fd);
+    }
+}
+
+// 不在 IOManager 中时逐个连接
+static int connect_sequential(const std::vector<Address::ptr>& addrs, uint64_t deadline, Address::ptr* peer)
+{
+    int err = ECONNREFUSED;
+    for (auto& addr : addrs)
+    {
+        uint64_t now = GetCurrentMs();
+        if (now >= deadline)
+        {
+            err = ETIMEDOUT;
+            break;
+        }
+        int fd = ::socket(addr->getFamily(), SOCK_STREAM, 0);
+        if (fd < 0)
+        {
+            err = errno;
+            continue;
+        }
+        if (connect_with_timeout(fd, addr->getAddr(), addr->getAddrLen(), deadline - now) == 0)
+        {
+            if (peer)
+            {
+                *peer = addr;
+            }
+            return fd;
+        }
+        err = errno;
+        ::close(fd);
+    }
+    errno = err;
+    return -1;
+}
+
+int connectAny(const std::string& host, uint64_t timeout_ms, Address::ptr* peer)
+{
+    std::vector<Address::ptr> addrs;
+    if (!Address::Lookup(addrs, host, AF_UNSPEC, SOCK_STREAM))
+    {
+        errno = EHOSTUNREACH;
+        return -1;
+    }
+    return connectAny(interleave(addrs), timeout_ms, peer);
+}
+
+int connectAny(const std::vector<Address::ptr>& addrs, uint64_t timeout_ms, Address::ptr* peer)
+{
+    if (addrs.empty())
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    if (timeout_ms == (uint64_t)-1)
+    {
+        timeout_ms = g_tcp_timeout_ms->getVal();
+    }
+    uint64_t deadline = GetCurrentMs() + timeout_ms;
+
+    IOManager* iom = IOManager::GetThis();
+    if (!iom || !is_enable_hook())
+    {
+        return connect_sequential(addrs, deadline, peer);
+    }
+
+    auto race        = std::make_shared<ConnectRace>();
+    race->iom        = iom;
+    uint64_t delay   = g_connect_attempt_delay_ms->getVal();
+    uint64_t next_ms = 0; // 下一次尝试最早的发起时间
+    size_t next      = 0;
+    bool timed_out   = false;
+    while (true)
+    {
+        uint64_t now        = GetCurrentMs();
+        uint64_t wait_until = deadline;
+        {
+            ConnectRace::MutexType::Lock lock(&race->mutex);
+            if (race->winner_fd != -1 || (next == addrs.size() && race->running == 0))
+            {
+                break;
+            }
+            if (now >= deadline)
+            {
+                timed_out = true;
+                break;
+            }
+            // 到了间隔时间，或者前面的尝试都已失败，立即发起下一个
+            if (next < addrs.size() && (race->running == 0 || now >= next_ms))
+            {
+                ++race->running;
+                iom->schedule(std::bind(&attempt, race, addrs[next++], deadline));
+                next_ms = now + delay;
+                continue;
+            }
+            if (next < addrs.size())
+            {
+                wait_until = std::min(deadline, next_ms);
+            }
+            race->waiter = Fiber::GetThis();
+        }
+
+        Timer::ptr timer = iom->addTimer(wait_until - now, [race]()
+                                         {
+                                             ConnectRace::MutexType::Lock lock(&race->mutex);
+                                             race->wake(); },
+                                         false);
+        Fiber::YieldToHold();
+        timer->cancel();
+    }
+
+    ConnectRace::MutexType::Lock lock(&race->mutex);
+    race->done = true;
+    // 取消还在连接中的 socket，它们的协程被唤醒后自行关闭
+    for (int fd : race->fds)
+    {
+        iom->cancelEvent(fd, IOManager::EventType::WRITE);
+    }
+    if (race->winner_fd == -1)
+    {
+        errno = timed_out ? ETIMEDOUT : race->last_error;
+        return -1;
+    }
+    if (peer)
+    {
+        *peer = race->winner;
+    }
+    return race->winner_fd;
+}
+
+} // namespace trycle
@@ -0,0 +1,182 @@
+#include "datagram.h"
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <string.h>
+
+#include "hook.h"
+#include "log.h"
+
+namespace trycle
+{
+
+static auto g_logger = GET_LOGGER("system");
+
+// 每个槽位的控制消息缓冲区，放得下 UDP_GRO(int) 或 UDP_SEGMENT(uint16_t)
+static const size_t CONTROL_SIZE = CMSG_SPACE(sizeof(int));
+
+/**
+ * ============================================================================
+ * DatagramBatch 类的实现
+ * ============================================================================
+ */
+DatagramBatch::DatagramBatch(size_t capacity, size_t buffer_size)
+    : m_capacity(capacity),
+      m_buffer_size(buffer_size),
+      m_msgs(capacity),
+      m_iovs(capacity),
+      m_addrs(capacity),
+      m_lengths(capacity),
+      m_segments(capacity),
+      m_controls(capacity * CONTROL_SIZE + sizeof(cmsghdr)),
+      m_buffer(capacity * buffer_size)
+{
+    memset(&m_msgs[0], 0, sizeof(mmsghdr) * capacity);
+    for (size_t i = 0; i < capacity; ++i)
+    {
+        m_iovs[i].iov_base           = data(i);
+        m_msgs[i].msg_hdr.msg_iov    = &m_iovs[i];
+        m_msgs[i].msg_hdr.msg_iovlen = 1;
+        m_msgs[i].msg_hdr.msg_name   = &m_addrs[i];
+    }
+}
+
+// 控制消息缓冲区要按 cmsghdr 对齐
+static char* control_at(std::vector<char>& controls, size_t i)
+{
+    uintptr_t base = (uintptr_t)&controls[0];
+    uintptr_t mask = alignof(cmsghdr) - 1;
+    return (char*)((base + mask) & ~mask) + i * CONTROL_SIZE;
+}
+
+int DatagramBatch::recv(int fd, int flags)
+{
+    m_count = 0;
+    for (size_t i = 0; i < m_capacity; ++i)
+    {
+        msghdr& hdr        = m_msgs[i].msg_hdr;
+        m_iovs[i].iov_len  = m_buffer_size;
+        hdr.msg_namelen    = sizeof(sockaddr_storage);
+        hdr.msg_control    = control_at(m_controls, i);
+        hdr.msg_controllen = CONTROL_SIZE;
+        hdr.msg_flags      = 0;
+        m_msgs[i].msg_len  = 0;
+    }
+
+    // MSG_WAITFORONE：第一个报文到达之后，后续只收能立即读到的
+    int n = ::recvmmsg(fd, &m_msgs[0], m_capacity, flags | MSG_WAITFORONE, nullptr);
+    if (n <= 0)
+    {
+        return n;
+    }
+
+    for (int i = 0; i < n; ++i)
+    {
+        msghdr& hdr   = m_msgs[i].msg_hdr;
+        m_lengths[i]  = m_msgs[i].msg_len;
+        m_segments[i] = 0;
+        if (hdr.msg_flags & MSG_TRUNC)
+        {
+            LOG_FMT_WARN(g_logger, "DatagramBatch::recv truncated | fd=%d, buffer_size=%d", fd, (int)m_buffer_size);
+        }
+#ifdef UDP_GRO
+        for (cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr); cmsg; cmsg = CMSG_NXTHDR(&hdr, cmsg))
+        {
+            if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+            {
+                int segment = 0;
+                memcpy(&segment, CMSG_DATA(cmsg), sizeof(segment));
+                m_segments[i] = segment;
+            }
+        }
+#endif
+    }
+    m_count = n;
+    return n;
+}
+
+bool DatagramBatch::push(const void* data, size_t len, const sockaddr* addr, socklen_t addr_len, uint16_t gso_size)
+{
+    if (m_count == m_capacity || len > m_buffer_size || addr_len > sizeof(sockaddr_storage))
+    {
+        return false;
+    }
+#ifndef UDP_SEGMENT
+    if (gso_size)
+    {
+        return false;
+    }
+#endif
+    size_t i = m_count++;
+    memcpy(this->data(i), data, len);
+    memcpy(&m_addrs[i], addr, addr_len);
+    m_lengths[i]                  = len;
+    m_segments[i]                 = gso_size;
+    m_msgs[i].msg_hdr.msg_namelen = addr_len;
+    return true;
+}
+
+int DatagramBatch::send(int fd, int flags)
+{
+    for (size_t i = 0; i < m_count; ++i)
+    {
+        msghdr& hdr        = m_msgs[i].msg_hdr;
+        m_iovs[i].iov_len  = m_lengths[i];
+        hdr.msg_control    = nullptr;
+        hdr.msg_controllen = 0;
+        hdr.msg_flags      = 0;
+#ifdef UDP_SEGMENT
+        // 超过一段的数据交给内核按 gso_size 切成多个报文
+        if (m_segments[i] && m_lengths[i] > m_segments[i])
+        {
+            hdr.msg_control    = control_at(m_controls, i);
+            hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+            cmsghdr* cmsg      = CMSG_FIRSTHDR(&hdr);
+            cmsg->cmsg_level   = SOL_UDP;
+            cmsg->cmsg_type    = UDP_SEGMENT;
+            cmsg->cmsg_len     = CMSG_LEN(sizeof(uint16_t));
+            memcpy(CMSG_DATA(cmsg), &m_segments[i], sizeof(uint16_t));
+        }
+#endif
+    }
+
+    size_t sent = 0;
+    while (sent < m_count)
+    {
+        int n = ::sendmmsg(fd, &m_msgs[sent], m_count - sent, flags);
+        if (n < 0)
+        {
+            if (sent == 0)
+            {
+                m_count = 0;
+                return -1;
+            }
+            break;
+        }
+        sent += n;
+    }
+    m_count = 0;
+    return sent;
+}
+
+bool DatagramBatch::EnableGro(int fd)
+{
+#ifdef UDP_GRO
+    int val = 1;
+    return setsockopt(fd, SOL_UDP, UDP_GRO, &val, sizeof(val)) == 0;
+#else
+    return false;
+#endif
+}
+
+bool DatagramBatch::SupportGso()
+{
+#ifdef UDP_SEGMENT
+    return true;
+#else
+    return false;
+#endif
+}
+
+} // namespace trycle
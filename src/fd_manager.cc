@@ -12,16 +12,13 @@ namespace trycle
  * FdCtx 类的实现
  * ============================================================================
  */
-FdCtx::FdCtx(int fd)
-    : m_fd(fd),
-      m_isInit(false),
-      m_isSocket(false),
-      m_isSysNoBlock(false),
-      m_isUserNoBlock(false),
-      m_recvTimeout(-1),
-      m_sendTimeout(-1)
+uint64_t FdCtx::Snapshot::getTimeout(int type) const
+{
+    return type == SO_RCVTIMEO ? recv_timeout : send_timeout;
+}
+
+FdCtx::FdCtx()
 {
-    init();
 }
 
 FdCtx::~FdCtx()
@@ -30,58 +27,146 @@ FdCtx::~FdCtx()
 
 bool FdCtx::init()
 {
-    if (m_isInit)
+    if (getIsInit())
     {
         return false;
     }
 
+    int fd = getFd();
     // linux 文件描述符状态变量
     struct stat fd_stat;
     // 文件是否已经关闭
-    if (fstat(m_fd, &fd_stat) == -1)
+    if (fstat(fd, &fd_stat) == -1)
     {
         // 全非，不达到条件
-        m_isInit   = false;
-        m_isSocket = false;
+        setIsInit(false);
+        setIsSocket(false);
     }
     else
     {
-        m_isInit = true;
+        setIsInit(true);
         // 判定是否为 socket 文件描述符
-        m_isSocket = S_ISSOCK(fd_stat.st_mode);
+        setIsSocket(S_ISSOCK(fd_stat.st_mode));
+        m_isFifo.store(S_ISFIFO(fd_stat.st_mode), std::memory_order_relaxed);
     }
 
-    if (m_isSocket)
+    if (isHookable())
     {
-        int flags = fcntl_f(m_fd, F_GETFL);
-        // 如果是 socket 并且是阻塞形式
+        int flags = fcntl_f(fd, F_GETFL);
+        // 如果是 socket（或管道）并且是阻塞形式
         if (!(flags & O_NONBLOCK))
         {
             // 将文件标识设置为 非阻塞形式，后续交由 hook 作异步处理
-            fcntl_f(m_fd, F_SETFL, flags | O_NONBLOCK);
+            fcntl_f(fd, F_SETFL, flags | O_NONBLOCK);
         }
-        m_isSysNoBlock = true;
+        setIsSysNoBlock(true);
     }
     else
     {
-        m_isSysNoBlock = false;
+        setIsSysNoBlock(false);
     }
 
-    m_isUserNoBlock = false;
-    m_recvTimeout   = -1;
-    m_sendTimeout   = -1;
-    return m_isInit;
+    setIsUserNoBlock(false);
+    m_recvTimeout.store(-1, std::memory_order_relaxed);
+    m_sendTimeout.store(-1, std::memory_order_relaxed);
+    return getIsInit();
+}
+
+void FdCtx::clear(int fd)
+{
+    // 代数此时为偶数，保证下面的写不会排到代数变化之前，读取方据此发现属性正在改写
+    std::atomic_thread_fence(std::memory_order_release);
+    setFd(fd);
+    setIsInit(false);
+    setIsSocket(false);
+    m_isFifo.store(false, std::memory_order_relaxed);
+    setIsSysNoBlock(false);
+    setIsUserNoBlock(false);
+    setClose(false);
+    m_recvTimeout.store(-1, std::memory_order_relaxed);
+    m_sendTimeout.store(-1, std::memory_order_relaxed);
+    m_read_waiter.store(nullptr, std::memory_order_relaxed);
+    m_write_waiter.store(nullptr, std::memory_order_relaxed);
+}
+
+void FdCtx::publish()
+{
+    // 属性写完之后再发布新的代数（奇数），无锁读取方看到存活时属性一定完整
+    m_generation.fetch_add(1, std::memory_order_release);
+}
+
+void FdCtx::reset(int fd)
+{
+    clear(fd);
+    init();
+    publish();
+}
+
+void FdCtx::resetNonBlock(int fd, bool is_socket, bool user_nonblock)
+{
+    clear(fd);
+    setIsInit(true);
+    setIsSocket(is_socket);
+    m_isFifo.store(!is_socket, std::memory_order_relaxed);
+    setIsSysNoBlock(true);
+    setIsUserNoBlock(user_nonblock);
+    publish();
+}
+
+void FdCtx::resetFrom(int fd, const FdCtx& other)
+{
+    clear(fd);
+    setIsInit(other.m_isInit.load(std::memory_order_relaxed));
+    setIsSocket(other.m_isSocket.load(std::memory_order_relaxed));
+    m_isFifo.store(other.m_isFifo.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    setIsSysNoBlock(other.m_isSysNoBlock.load(std::memory_order_relaxed));
+    setIsUserNoBlock(other.m_isUserNoBlock.load(std::memory_order_relaxed));
+    m_recvTimeout.store(other.m_recvTimeout.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    m_sendTimeout.store(other.m_sendTimeout.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    publish();
+}
+
+void FdCtx::retire()
+{
+    setClose(true);
+    m_generation.fetch_add(1, std::memory_order_release);
+}
+
+bool FdCtx::snapshot(Snapshot& snap) const
+{
+    while (true)
+    {
+        uint32_t gen = m_generation.load(std::memory_order_acquire);
+        if (!(gen & 1))
+        {
+            return false;
+        }
+        snap.generation       = gen;
+        snap.is_socket        = m_isSocket.load(std::memory_order_relaxed);
+        snap.is_hookable      = snap.is_socket || m_isFifo.load(std::memory_order_relaxed);
+        snap.is_sys_nonblock  = m_isSysNoBlock.load(std::memory_order_relaxed);
+        snap.is_user_nonblock = m_isUserNoBlock.load(std::memory_order_relaxed);
+        snap.is_closed        = m_isClosed.load(std::memory_order_relaxed);
+        snap.recv_timeout     = m_recvTimeout.load(std::memory_order_relaxed);
+        snap.send_timeout     = m_sendTimeout.load(std::memory_order_relaxed);
+        // 属性的读不能排到第二次读代数之后
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (m_generation.load(std::memory_order_relaxed) == gen)
+        {
+            return true;
+        }
+    }
 }
 
 void FdCtx::setTimeout(int type, uint64_t val)
 {
     if (type == SO_RCVTIMEO)
     {
-        m_recvTimeout = val;
+        m_recvTimeout.store(val, std::memory_order_relaxed);
     }
     else
     {
-        m_sendTimeout = val;
+        m_sendTimeout.store(val, std::memory_order_relaxed);
     }
 }
 
@@ -89,11 +174,11 @@ uint64_t FdCtx::getTimeout(int type)
 {
     if (type == SO_RCVTIMEO)
     {
-        return m_recvTimeout;
+        return m_recvTimeout.load(std::memory_order_relaxed);
     }
     else
     {
-        return m_sendTimeout;
+        return m_sendTimeout.load(std::memory_order_relaxed);
     }
 }
 
@@ -104,55 +189,87 @@ uint64_t FdCtx::getTimeout(int type)
  */
 FdManager::FdManager()
 {
-    m_fd_ctx_list.resize(64);
 }
 
 FdManager::~FdManager()
 {
 }
 
-FdCtx::ptr FdManager::get(int fd, bool auto_create)
+FdCtx* FdManager::get(int fd, bool auto_create)
 {
-    if (fd == -1)
+    FdCtx* fd_ctx = m_fd_ctx_table.get(fd);
+    if (fd_ctx && fd_ctx->isAlive())
+    {
+        return fd_ctx;
+    }
+    if (!auto_create)
     {
         return nullptr;
     }
-    MutexType::ReadLock lock(&m_mutex);
-    if (m_fd_ctx_list.size() <= fd)
+
+    fd_ctx = m_fd_ctx_table.getOrCreate(fd);
+    if (!fd_ctx)
     {
-        if (!auto_create)
-        {
-            return nullptr;
-        }
+        return nullptr;
     }
-    else
+    MutexType::Lock lock(&m_mutex);
+    if (!fd_ctx->isAlive())
     {
-        if (m_fd_ctx_list[fd] || !auto_create)
-        {
-            return m_fd_ctx_list[fd];
-        }
+        fd_ctx->reset(fd);
     }
-    lock.unlock();
+    return fd_ctx;
+}
 
-    MutexType::WriteLock lock2(&m_mutex);
-    FdCtx::ptr fd_ctx(new FdCtx(fd));
-    if (fd >= m_fd_ctx_list.size())
+FdCtx* FdManager::addNonBlock(int fd, bool is_socket, bool user_nonblock)
+{
+    FdCtx* fd_ctx = m_fd_ctx_table.getOrCreate(fd);
+    if (!fd_ctx)
+    {
+        return nullptr;
+    }
+    MutexType::Lock lock(&m_mutex);
+    // fd 可能被未 hook 的 close 关闭过，残留的旧记录直接作废
+    if (fd_ctx->isAlive())
     {
-        m_fd_ctx_list.resize(m_fd_ctx_list.size() * 1.5);
+        fd_ctx->retire();
     }
-    m_fd_ctx_list[fd] = fd_ctx;
+    fd_ctx->resetNonBlock(fd, is_socket, user_nonblock);
     return fd_ctx;
 }
 
+FdCtx* FdManager::dup(int oldfd, int newfd)
+{
+    FdCtx* old_ctx = m_fd_ctx_table.get(oldfd);
+    FdCtx* new_ctx = m_fd_ctx_table.getOrCreate(newfd);
+    if (!old_ctx || !new_ctx || old_ctx == new_ctx)
+    {
+        return nullptr;
+    }
+    MutexType::Lock lock(&m_mutex);
+    if (!old_ctx->isAlive())
+    {
+        return nullptr;
+    }
+    if (new_ctx->isAlive())
+    {
+        new_ctx->retire();
+    }
+    new_ctx->resetFrom(newfd, *old_ctx);
+    return new_ctx;
+}
+
 void FdManager::del(int fd)
 {
-    MutexType::WriteLock lock(&m_mutex);
-    if (m_fd_ctx_list.size() <= fd)
+    FdCtx* fd_ctx = m_fd_ctx_table.get(fd);
+    if (!fd_ctx)
     {
         return;
     }
-
-    m_fd_ctx_list[fd].reset();
+    MutexType::Lock lock(&m_mutex);
+    if (fd_ctx->isAlive())
+    {
+        fd_ctx->retire();
+    }
 }
 
-} // namespace trycle
\ No newline at end of file
+} // namespace trycle
@@ -1,8 +1,13 @@
 #include "fiber.h"
 
+#include <algorithm>
 #include <atomic>
+#include <execinfo.h>
+#include <map>
+#include <sstream>
 #include <stdint.h>
 
+#include "arena.h"
 #include "config.h"
 #include "macro.h"
 #include "scheduler.h"
@@ -18,7 +23,165 @@ static std::atomic<uint64_t> t_fiber_count{0};
 static thread_local Fiber* t_fiber = nullptr;
 static thread_local Fiber::ptr t_thread_fiber{};
 
-auto g_fiber_stack_size = Config::lookUp<size_t>("fiber.stack.size", 1024 * 1024, "fiber stack size");
+auto g_fiber_stack_size   = Config::lookUp<size_t>("fiber.stack.size", 1024 * 1024, "fiber stack size");
+auto g_fiber_stats_enable = Config::lookUp<bool>("fiber.stats.enable", true, "fiber cpu/wait time accounting");
+
+// 切换协程时读取，不能每次都走 ConfigVar 的锁
+static std::atomic<bool> s_fiber_stats_enable{true};
+
+struct FiberStatsIniter
+{
+    FiberStatsIniter()
+    {
+        s_fiber_stats_enable = g_fiber_stats_enable->getVal();
+        g_fiber_stats_enable->add_listener(
+            [](const bool& old_val, const bool& new_val)
+            {
+                s_fiber_stats_enable = new_val;
+            });
+    }
+};
+
+static FiberStatsIniter s_fiber_stats_initer;
+
+auto g_fiber_hold_backtrace = Config::lookUp<bool>("fiber.hold.backtrace", false, "record backtrace when fiber yields to HOLD");
+
+static std::atomic<bool> s_fiber_hold_backtrace{false};
+
+struct FiberBacktraceIniter
+{
+    FiberBacktraceIniter()
+    {
+        s_fiber_hold_backtrace = g_fiber_hold_backtrace->getVal();
+        g_fiber_hold_backtrace->add_listener(
+            [](const bool& old_val, const bool& new_val)
+            {
+                s_fiber_hold_backtrace = new_val;
+            });
+    }
+};
+
+static FiberBacktraceIniter s_fiber_backtrace_initer;
+
+/**
+ * 存活协程登记表，协程通过自身的 m_reg_prev/m_reg_next 挂在链表上，登记和注销不分配内存
+ * 按创建线程分片加锁，各线程创建、销毁协程互不争用；只有导出清单时依次遍历所有分片
+ */
+class FiberRegistry
+{
+public:
+    void add(Fiber* fiber)
+    {
+        fiber->m_reg_shard = GetThreadId() % SHARD_COUNT;
+        Shard& shard       = m_shards[fiber->m_reg_shard];
+        Mutex::Lock lock(&shard.mutex);
+        fiber->m_reg_prev = nullptr;
+        fiber->m_reg_next = shard.head;
+        if (shard.head)
+        {
+            shard.head->m_reg_prev = fiber;
+        }
+        shard.head = fiber;
+    }
+
+    // 协程可能在其它线程上析构，按登记时记下的分片注销
+    void del(Fiber* fiber)
+    {
+        Shard& shard = m_shards[fiber->m_reg_shard];
+        Mutex::Lock lock(&shard.mutex);
+        if (fiber->m_reg_prev)
+        {
+            fiber->m_reg_prev->m_reg_next = fiber->m_reg_next;
+        }
+        else
+        {
+            shard.head = fiber->m_reg_next;
+        }
+        if (fiber->m_reg_next)
+        {
+            fiber->m_reg_next->m_reg_prev = fiber->m_reg_prev;
+        }
+        fiber->m_reg_prev = fiber->m_reg_next = nullptr;
+    }
+
+    // 持有分片锁期间其中的协程无法析构，可以安全读取
+    template <typename Func>
+    void visit(Func func)
+    {
+        for (auto& shard : m_shards)
+        {
+            Mutex::Lock lock(&shard.mutex);
+            for (Fiber* fiber = shard.head; fiber; fiber = fiber->m_reg_next)
+            {
+                func(fiber);
+            }
+        }
+    }
+
+private:
+    static const size_t SHARD_COUNT = 16;
+
+    struct Shard
+    {
+        Mutex mutex;
+        Fiber* head = nullptr;
+    };
+
+    Shard m_shards[SHARD_COUNT];
+};
+
+typedef Singleton<FiberRegistry> FiberReg;
+
+static const char* UNTAGGED_FIBER = "<untagged>";
+
+// tag -> 统计对象，只在 setTag 和导出快照时加锁
+class FiberTagRegistry
+{
+public:
+    FiberTagStats* get(const std::string& tag)
+    {
+        Mutex::Lock lock(&m_mutex);
+        auto it = m_stats.find(tag);
+        if (it != m_stats.end())
+        {
+            return it->second;
+        }
+        // 统计对象常驻，协程持有的裸指针始终有效
+        FiberTagStats* stats = new FiberTagStats(tag);
+        m_stats[tag]         = stats;
+        return stats;
+    }
+
+    void list(std::vector<FiberStatsSnapshot>& result)
+    {
+        Mutex::Lock lock(&m_mutex);
+        result.reserve(result.size() + m_stats.size());
+        for (const auto& pair : m_stats)
+        {
+            FiberStatsSnapshot item;
+            item.tag      = pair.first;
+            item.run_ns   = pair.second->run_ns.load(std::memory_order_relaxed);
+            item.hold_ns  = pair.second->hold_ns.load(std::memory_order_relaxed);
+            item.ready_ns = pair.second->ready_ns.load(std::memory_order_relaxed);
+            item.switches = pair.second->switches.load(std::memory_order_relaxed);
+            item.overruns = pair.second->overruns.load(std::memory_order_relaxed);
+            item.fibers   = pair.second->fibers.load(std::memory_order_relaxed);
+            result.push_back(item);
+        }
+    }
+
+    FiberTagStats* untagged()
+    {
+        static FiberTagStats* stats = get(UNTAGGED_FIBER);
+        return stats;
+    }
+
+private:
+    Mutex m_mutex;
+    std::map<std::string, FiberTagStats*> m_stats;
+};
+
+typedef Singleton<FiberTagRegistry> FiberTagReg;
 
 class StackAllocator
 {
@@ -46,6 +209,10 @@ Fiber::Fiber()
         ASSERT_M(false, "getcontext error.");
     }
     ++t_fiber_count;
+
+    m_last_thread = GetThreadId();
+    m_state_ns    = GetMonotonicNs();
+    FiberReg::GetInstance()->add(this);
 }
 
 Fiber::Fiber(FiberCb cb, size_t stack_size)
@@ -67,10 +234,14 @@ Fiber::Fiber(FiberCb cb, size_t stack_size)
 
     makecontext(&m_ctx, &Fiber::MainFunc, 0);
     ++t_fiber_count;
+
+    resetStats();
+    FiberReg::GetInstance()->add(this);
 }
 
 Fiber::~Fiber()
 {
+    FiberReg::GetInstance()->del(this);
     --t_fiber_count;
     if (m_stack)
     {
@@ -103,6 +274,10 @@ void Fiber::reset(FiberCb cb)
                  m_state == EXCEPT,
              "invalid state to reset.");
     // SetThis(this);
+    if (m_arena)
+    {
+        m_arena->reset();
+    }
     m_cb = cb;
 
     if (getcontext(&m_ctx))
@@ -115,25 +290,219 @@ void Fiber::reset(FiberCb cb)
     m_ctx.uc_stack.ss_size = m_stack_size;
 
     makecontext(&m_ctx, &Fiber::MainFunc, 0);
-    m_state = INIT;
+    m_state    = INIT;
+    m_priority = Scheduler::NORMAL;
+
+    resetStats();
+}
+
+void Fiber::setTag(const std::string& tag)
+{
+    FiberTagStats* stats = tag.empty() ? FiberTagReg::GetInstance()->untagged()
+                                       : FiberTagReg::GetInstance()->get(tag);
+    FiberTagStats* old   = m_tag_stats.load(std::memory_order_relaxed);
+    if (stats == old)
+    {
+        return;
+    }
+    m_tag_stats.store(stats, std::memory_order_relaxed);
+    // 已经计入旧 tag（执行中设置 tag）时转到新 tag，每次执行只计一次
+    if (m_tag_counted)
+    {
+        old->fibers.fetch_sub(1, std::memory_order_relaxed);
+        stats->fibers.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+const std::string& Fiber::getTag() const
+{
+    static const std::string main_tag = "<main>";
+    FiberTagStats* stats              = m_tag_stats.load(std::memory_order_relaxed);
+    return stats ? stats->tag : main_tag;
+}
+
+Arena* Fiber::getArena()
+{
+    // 线程主协程、调度器的 root/idle 协程不会结束也不会 reset，arena 只增不减
+    ASSERT_M(m_stack && m_slice_watched.load(std::memory_order_relaxed),
+             "arena is only available in fibers that terminate or reset");
+    if (!m_arena)
+    {
+        m_arena.reset(new Arena());
+    }
+    return m_arena.get();
+}
+
+void Fiber::resetStats()
+{
+    m_run_ns   = 0;
+    m_hold_ns  = 0;
+    m_ready_ns = 0;
+    m_switches = 0;
+    m_state_ns.store(GetMonotonicNs(), std::memory_order_relaxed);
+    m_queued_ns.store(0, std::memory_order_relaxed);
+    m_wait_reason.store(nullptr, std::memory_order_relaxed);
+    m_hold_bt_size.store(0, std::memory_order_relaxed);
+    m_yield_requested.store(false, std::memory_order_relaxed);
+    m_overruns.store(0, std::memory_order_relaxed);
+
+    // 协程数在第一次切入时计入，那时 tag 一般已经设置好
+    m_tag_stats.store(FiberTagReg::GetInstance()->untagged(), std::memory_order_relaxed);
+    m_tag_counted = false;
+}
+
+void Fiber::onSwapIn()
+{
+    // 时间点总是记录，协程清单和看门狗依赖它；统计开关只控制累加
+    uint64_t now_ns    = GetMonotonicNs();
+    uint64_t since_ns  = m_state_ns.load(std::memory_order_relaxed);
+    uint64_t queued_ns = m_queued_ns.exchange(0, std::memory_order_relaxed);
+    m_state_ns.store(now_ns, std::memory_order_relaxed);
+    m_scheduler.store(Scheduler::GetThis(), std::memory_order_relaxed);
+    m_last_thread.store(GetThreadId(), std::memory_order_relaxed);
+    m_wait_reason.store(nullptr, std::memory_order_relaxed);
+
+    FiberTagStats* stats = m_tag_stats.load(std::memory_order_relaxed);
+    if (!stats)
+    {
+        return;
+    }
+    if (!m_tag_counted)
+    {
+        m_tag_counted = true;
+        stats->fibers.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (!s_fiber_stats_enable)
+    {
+        return;
+    }
+    if (since_ns)
+    {
+        uint64_t hold_ns  = 0;
+        uint64_t ready_ns = 0;
+        if (m_state != HOLD)
+        {
+            ready_ns = now_ns - since_ns;
+        }
+        else if (queued_ns > since_ns)
+        {
+            // IO 事件、定时器唤醒：入队前是 HOLD，入队后在队列中等待
+            hold_ns  = queued_ns - since_ns;
+            ready_ns = now_ns - queued_ns;
+        }
+        else
+        {
+            hold_ns = now_ns - since_ns;
+        }
+        m_hold_ns += hold_ns;
+        m_ready_ns += ready_ns;
+        stats->hold_ns.fetch_add(hold_ns, std::memory_order_relaxed);
+        stats->ready_ns.fetch_add(ready_ns, std::memory_order_relaxed);
+    }
+    ++m_switches;
+    stats->switches.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Fiber::onScheduled(uint64_t now_ns)
+{
+    if (m_state == HOLD)
+    {
+        m_queued_ns.store(now_ns, std::memory_order_relaxed);
+    }
+}
+
+void Fiber::onSwapOut()
+{
+    // 已经让出，抢占请求不再需要
+    m_yield_requested.store(false, std::memory_order_relaxed);
+    uint64_t now_ns   = GetMonotonicNs();
+    uint64_t since_ns = m_state_ns.load(std::memory_order_relaxed);
+    m_state_ns.store(now_ns, std::memory_order_relaxed);
+
+    FiberTagStats* stats = m_tag_stats.load(std::memory_order_relaxed);
+    if (!stats || !s_fiber_stats_enable || !since_ns)
+    {
+        return;
+    }
+    uint64_t run_ns = now_ns - since_ns;
+    m_run_ns += run_ns;
+    stats->run_ns.fetch_add(run_ns, std::memory_order_relaxed);
+}
+
+void Fiber::captureBacktrace()
+{
+    if (!s_fiber_hold_backtrace)
+    {
+        return;
+    }
+    // 协程切出后栈不再变化，但 ucontext 无法从其它线程回溯，只能在挂起前记录
+    int size = ::backtrace(m_hold_bt, MAX_HOLD_BACKTRACE);
+    m_hold_bt_size.store(size, std::memory_order_release);
+}
+
+void Fiber::fillInfo(FiberInfo& info, uint64_t now_ns, bool with_backtrace)
+{
+    info.id          = m_id;
+    info.state       = m_state.load(std::memory_order_relaxed);
+    info.last_thread = m_last_thread.load(std::memory_order_relaxed);
+    info.overruns    = m_overruns.load(std::memory_order_relaxed);
+
+    FiberTagStats* stats = m_tag_stats.load(std::memory_order_relaxed);
+    info.tag             = stats ? stats->tag : "<main>";
+
+    Scheduler* scheduler = m_scheduler.load(std::memory_order_relaxed);
+    info.scheduler       = scheduler ? scheduler->get_name() : "";
+
+    uint64_t since_ns    = m_state_ns.load(std::memory_order_relaxed);
+    info.state_ms        = since_ns && now_ns > since_ns ? (now_ns - since_ns) / 1000000 : 0;
+
+    const char* reason   = m_wait_reason.load(std::memory_order_relaxed);
+    info.wait_on         = reason ? reason : "";
+
+    int bt_size          = m_hold_bt_size.load(std::memory_order_acquire);
+    if (with_backtrace && info.state == HOLD && bt_size > 0)
+    {
+        char** strings = ::backtrace_symbols(m_hold_bt, bt_size);
+        if (strings)
+        {
+            std::stringstream ss;
+            // 跳过 captureBacktrace 自身
+            for (int i = 1; i < bt_size; i++)
+            {
+                ss << "    " << strings[i] << "\n";
+            }
+            info.backtrace = ss.str();
+            free(strings);
+        }
+    }
 }
 
 // 切换到协程执行
 void Fiber::swap_in()
 {
-    ASSERT(m_state != EXEC);
+    ASSERT(m_state != EXEC && !isRunning());
     SetThis(this);
 
+    m_running.store(true, std::memory_order_relaxed);
+    onSwapIn();
     m_state = EXEC;
     // if (swapcontext(&t_thread_fiber->m_ctx, &m_ctx))
     if (swapcontext(&Scheduler::GetMainFiber()->m_ctx, &m_ctx))
     {
         ASSERT_M(false, "swapcontext error");
     }
+    // 协程在 YieldToHold 中先置 HOLD 再切出，回到这里时上下文才保存完整，之后其它线程才能切入
+    // 没有声明状态就切出的（如 idle）按 HOLD 处理，必须在放开之前设置，否则会覆盖其它线程切入后的 EXEC
+    if (m_state == EXEC)
+    {
+        m_state = HOLD;
+    }
+    m_running.store(false, std::memory_order_release);
 }
 // 将协程切换到后台
 void Fiber::swap_out()
 {
+    onSwapOut();
     SetThis(Scheduler::GetMainFiber());
     // if (swapcontext(&m_ctx, &t_thread_fiber->m_ctx))
     if (swapcontext(&m_ctx, &Scheduler::GetMainFiber()->m_ctx))
@@ -148,6 +517,7 @@ void Fiber::call()
     ASSERT_M(t_thread_fiber, "Has not master fiber!");
     ASSERT(m_state == INIT || m_state == READY || m_state == HOLD)
     SetThis(this);
+    onSwapIn();
     m_state = EXEC;
     if (swapcontext(&t_thread_fiber->m_ctx, &m_ctx))
     {
@@ -157,6 +527,7 @@ void Fiber::call()
 
 void Fiber::back()
 {
+    onSwapOut();
     SetThis(t_thread_fiber.get());
     if (swapcontext(&m_ctx, &t_thread_fiber->m_ctx))
     {
@@ -188,6 +559,7 @@ void Fiber::Yield()
 {
     Fiber::ptr cur = GetThis();
     cur->m_state   = HOLD;
+    cur->captureBacktrace();
     cur->back();
 }
 
@@ -196,6 +568,7 @@ void Fiber::YieldToHold()
 {
     Fiber::ptr cur = GetThis();
     cur->m_state   = HOLD;
+    cur->captureBacktrace();
     cur->swap_out();
 }
 // 将协程切换到后台，并设置READY状态
@@ -213,6 +586,131 @@ uint64_t Fiber::TotalFibers()
     return t_fiber_count;
 }
 
+void Fiber::GetTagStats(std::vector<FiberStatsSnapshot>& result)
+{
+    FiberTagReg::GetInstance()->list(result);
+}
+
+void Fiber::SetWaitReason(const char* reason)
+{
+    if (t_fiber)
+    {
+        t_fiber->m_wait_reason.store(reason, std::memory_order_relaxed);
+    }
+}
+
+bool Fiber::maybeYield()
+{
+    Fiber* cur = t_fiber;
+    if (!cur || !cur->m_yield_requested.load(std::memory_order_relaxed))
+    {
+        return false;
+    }
+    cur->m_yield_requested.store(false, std::memory_order_relaxed);
+    // 只有调度器中的协程才能安全地重新排队
+    if (!cur->m_stack || !Scheduler::GetThis() || cur == Scheduler::GetMainFiber())
+    {
+        return false;
+    }
+    YieldToReady();
+    return true;
+}
+
+size_t Fiber::CheckSlices(uint64_t slice_ms, std::vector<FiberInfo>* overruns)
+{
+    uint64_t now_ns   = GetMonotonicNs();
+    uint64_t slice_ns = slice_ms * 1000000;
+    size_t count      = 0;
+    FiberReg::GetInstance()->visit([&](Fiber* fiber)
+                                   {
+                                       if (!fiber->m_stack || !fiber->m_slice_watched.load(std::memory_order_relaxed) || fiber->m_state != EXEC)
+                                       {
+                                           return;
+                                       }
+                                       uint64_t since_ns = fiber->m_state_ns.load(std::memory_order_relaxed);
+                                       if (!since_ns || now_ns < since_ns + slice_ns)
+                                       {
+                                           return;
+                                       }
+                                       // 同一次连续执行只计一次，协程切出后标记被清除
+                                       if (fiber->m_yield_requested.exchange(true, std::memory_order_relaxed))
+                                       {
+                                           return;
+                                       }
+                                       ++count;
+                                       fiber->m_overruns.fetch_add(1, std::memory_order_relaxed);
+                                       FiberTagStats* stats = fiber->m_tag_stats.load(std::memory_order_relaxed);
+                                       if (stats)
+                                       {
+                                           stats->overruns.fetch_add(1, std::memory_order_relaxed);
+                                       }
+                                       if (overruns)
+                                       {
+                                           overruns->push_back(FiberInfo());
+                                           fiber->fillInfo(overruns->back(), now_ns, false);
+                                       } });
+    return count;
+}
+
+void Fiber::ListFibers(std::vector<FiberInfo>& result, bool with_backtrace)
+{
+    uint64_t now_ns = GetMonotonicNs();
+    FiberReg::GetInstance()->visit([&result, now_ns, with_backtrace](Fiber* fiber)
+                                   {
+                                       result.push_back(FiberInfo());
+                                       fiber->fillInfo(result.back(), now_ns, with_backtrace); });
+    std::sort(result.begin(), result.end(), [](const FiberInfo& lhs, const FiberInfo& rhs)
+              { return lhs.id < rhs.id; });
+}
+
+std::string Fiber::DumpFibers(bool with_backtrace)
+{
+    std::vector<FiberInfo> fibers;
+    ListFibers(fibers, with_backtrace);
+
+    std::stringstream ss;
+    ss << "fibers: " << fibers.size() << "\n";
+    for (const auto& info : fibers)
+    {
+        ss << "fiber id=" << info.id
+           << " state=" << StateToString((State)info.state)
+           << " tag=" << info.tag
+           << " scheduler=" << (info.scheduler.empty() ? "-" : info.scheduler)
+           << " thread=" << info.last_thread
+           << " state_ms=" << info.state_ms
+           << " overruns=" << info.overruns;
+        if (!info.wait_on.empty())
+        {
+            ss << " wait_on=" << info.wait_on;
+        }
+        ss << "\n";
+        if (!info.backtrace.empty())
+        {
+            ss << info.backtrace;
+        }
+    }
+    return ss.str();
+}
+
+const char* Fiber::StateToString(State state)
+{
+    switch (state)
+    {
+#define XX(name)    \
+    case name:      \
+        return #name;
+        XX(INIT)
+        XX(EXEC)
+        XX(HOLD)
+        XX(TERM)
+        XX(READY)
+        XX(EXCEPT)
+#undef XX
+        default:
+            return "UNKNOWN";
+    }
+}
+
 // 协程主方法
 void Fiber::MainFunc()
 {
@@ -223,7 +721,12 @@ void Fiber::MainFunc()
     try
     {
         cur->m_cb();
-        cur->m_cb    = nullptr;
+        cur->m_cb = nullptr;
+        // 回调（及其捕获的对象）析构之后再释放 arena
+        if (cur->m_arena)
+        {
+            cur->m_arena->reset();
+        }
         cur->m_state = TERM;
         // LOG_FMT_DEBUG(g_logger, "Fiber TERM | id=%d", cur->m_id);
     }
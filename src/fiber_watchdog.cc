@@ -0,0 +1,138 @@
+#include "fiber_watchdog.h"
+
+#include <algorithm>
+#include <unistd.h>
+#include <vector>
+
+#include "config.h"
+#include "hook.h"
+#include "log.h"
+
+namespace trycle
+{
+
+static auto g_logger = GET_LOGGER("system");
+
+static auto g_watchdog_stuck_ms    = Config::lookUp<uint64_t>("fiber.watchdog.stuck_ms", 10000, "fiber stuck threshold ms");
+static auto g_watchdog_interval_ms = Config::lookUp<uint64_t>("fiber.watchdog.interval_ms", 1000, "fiber watchdog scan interval ms");
+static auto g_watchdog_slice_ms    = Config::lookUp<uint64_t>("fiber.watchdog.slice_ms", 100, "fiber exec time slice ms");
+
+// 监控线程的最小检查粒度
+static const uint64_t WATCHDOG_TICK_MS = 10;
+
+FiberWatchdog::FiberWatchdog(uint64_t stuck_ms, uint64_t interval_ms, uint64_t slice_ms)
+    : m_stuck_ms(stuck_ms ? stuck_ms : g_watchdog_stuck_ms->getVal()),
+      m_interval_ms(interval_ms ? interval_ms : g_watchdog_interval_ms->getVal()),
+      m_slice_ms(slice_ms ? slice_ms : g_watchdog_slice_ms->getVal())
+{
+}
+
+FiberWatchdog::~FiberWatchdog()
+{
+    stop();
+}
+
+void FiberWatchdog::start()
+{
+    if (m_running.exchange(true))
+    {
+        return;
+    }
+    m_thread.reset(new Thread("fiber_watchdog", std::bind(&FiberWatchdog::run, this)));
+}
+
+void FiberWatchdog::stop()
+{
+    if (!m_running.exchange(false))
+    {
+        return;
+    }
+    if (m_thread)
+    {
+        m_thread->join();
+        m_thread.reset();
+    }
+}
+
+size_t FiberWatchdog::check()
+{
+    std::vector<FiberInfo> fibers;
+    Fiber::ListFibers(fibers, true);
+
+    size_t stuck_count = 0;
+    std::map<uint32_t, uint64_t> reported;
+    for (const auto& info : fibers)
+    {
+        if (info.state != Fiber::HOLD && info.state != Fiber::READY)
+        {
+            continue;
+        }
+        if (info.state_ms < m_stuck_ms)
+        {
+            continue;
+        }
+
+        auto it = m_reported.find(info.id);
+        // 状态时长变小说明协程中间被调度过，这是一次新的停留
+        bool is_new = it == m_reported.end() || info.state_ms < it->second;
+        reported[info.id] = info.state_ms;
+        if (!is_new)
+        {
+            continue;
+        }
+
+        ++stuck_count;
+        LOG_FMT_WARN(g_logger, "fiber stuck | id=%u, state=%s, tag=%s, scheduler=%s, thread=%u, state_ms=%lu, wait_on=%s\n%s",
+                     info.id, Fiber::StateToString((Fiber::State)info.state),
+                     info.tag.c_str(), info.scheduler.c_str(), info.last_thread,
+                     info.state_ms, info.wait_on.empty() ? "-" : info.wait_on.c_str(),
+                     info.backtrace.c_str());
+    }
+    m_reported.swap(reported);
+    m_stuck_reports += stuck_count;
+    return stuck_count;
+}
+
+size_t FiberWatchdog::checkSlices()
+{
+    std::vector<FiberInfo> overruns;
+    size_t count = Fiber::CheckSlices(m_slice_ms, &overruns);
+    for (const auto& info : overruns)
+    {
+        LOG_FMT_WARN(g_logger, "fiber slice overrun | id=%u, tag=%s, scheduler=%s, thread=%u, exec_ms=%lu, overruns=%u",
+                     info.id, info.tag.c_str(), info.scheduler.c_str(), info.last_thread,
+                     info.state_ms, info.overruns);
+    }
+    m_overrun_reports += count;
+    return count;
+}
+
+void FiberWatchdog::run()
+{
+    // 看门狗线程不参与调度，确保 sleep 不走 hook
+    set_enable_hook(false);
+    // 时间片检查的间隔取时间片的一半，保证超时能被及时发现
+    uint64_t slice_tick_ms = std::max(m_slice_ms / 2, WATCHDOG_TICK_MS);
+    uint64_t elapsed_ms    = 0;
+    uint64_t slice_elapsed = 0;
+    while (m_running)
+    {
+        // 分段休眠，保证 stop 能及时返回
+        usleep_f(WATCHDOG_TICK_MS * 1000);
+        elapsed_ms += WATCHDOG_TICK_MS;
+        slice_elapsed += WATCHDOG_TICK_MS;
+
+        if (slice_elapsed >= slice_tick_ms)
+        {
+            slice_elapsed = 0;
+            checkSlices();
+        }
+        if (elapsed_ms >= m_interval_ms)
+        {
+            elapsed_ms = 0;
+            check();
+        }
+    }
+}
+
+} // namespace trycle
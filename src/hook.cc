@@ -3,10 +3,12 @@
 #include "fd_manager.h"
 #include "iomanager.h"
 #include "log.h"
+#include "util.h"
 
 #include <arpa/inet.h>
 #include <dlfcn.h>
 #include <sys/ioctl.h>
+#include <vector>
 
 static auto g_logger                             = GET_LOGGER("system");
 
@@ -27,16 +29,33 @@ static thread_local bool t_is_enable_hook;
     DO(socket)       \
     DO(connect)      \
     DO(accept)       \
+    DO(accept4)      \
+    DO(socketpair)   \
+    DO(shutdown)     \
+    DO(pipe)         \
+    DO(pipe2)        \
+    DO(dup)          \
+    DO(dup2)         \
+    DO(dup3)         \
     DO(read)         \
     DO(readv)        \
     DO(recv)         \
     DO(recvfrom)     \
     DO(recvmsg)      \
+    DO(recvmmsg)     \
     DO(write)        \
     DO(writev)       \
     DO(send)         \
     DO(sendto)       \
     DO(sendmsg)      \
+    DO(sendmmsg)     \
+    DO(sendfile)     \
+    DO(splice)       \
+    DO(tee)          \
+    DO(poll)         \
+    DO(ppoll)        \
+    DO(select)       \
+    DO(epoll_wait)   \
     DO(close)        \
     DO(fcntl)        \
     DO(ioctl)        \
@@ -89,71 +108,147 @@ static HookIniter hook_initer;
 
 struct TimeInfo
 {
-    bool cancelled = false;
+    int cancelled = 0;
 };
 
+// FdMgr::GetSingleton 每次都返回 shared_ptr 的拷贝（一次原子引用计数），热路径上缓存裸指针
+static trycle::FdManager* fd_mgr()
+{
+    static trycle::FdManager* s_fd_mgr = trycle::FdMgr::GetSingleton().get();
+    return s_fd_mgr;
+}
+
+// 取 fd 当前代属性的一致快照；fd 未登记或读取时已被关闭返回 nullptr，按未托管的 fd 处理
+static trycle::FdCtx* get_fd_snapshot(int fd, trycle::FdCtx::Snapshot& snap)
+{
+    trycle::FdCtx* ctx = fd_mgr()->get(fd);
+    return ctx && ctx->snapshot(snap) ? ctx : nullptr;
+}
+
+// 内核已经按非阻塞创建了 fd，登记到 FdManager；超出 FdTable 容量无法托管时还原成用户要求的阻塞模式
+static void add_nonblock_fd(int fd, bool is_socket, bool user_nonblock)
+{
+    if (!fd_mgr()->addNonBlock(fd, is_socket, user_nonblock) && !user_nonblock)
+    {
+        int flags = fcntl_f(fd, F_GETFL);
+        fcntl_f(fd, F_SETFL, flags & ~O_NONBLOCK);
+    }
+}
+
+// fd 即将被关闭（close 或 dup2 覆盖），唤醒挂在它上面的协程并作废 FdCtx
+static void release_fd(int fd)
+{
+    if (!fd_mgr()->get(fd))
+    {
+        return;
+    }
+    trycle::IOManager* iom = trycle::IOManager::GetThis();
+    if (iom)
+    {
+        iom->cancelAllEvent(fd);
+    }
+    fd_mgr()->del(fd);
+}
+
+/**
+ * 快路径：系统调用能立即完成时，只读一次 thread_local 和一次 FdTable，不加锁、不分配内存
+ * 慢路径：返回 EAGAIN 时才创建 TimeInfo 和超时定时器，注册事件后挂起当前协程
+ */
 template <typename OrignalFunc, typename... Args>
-static ssize_t do_io(int fd, OrignalFunc func, const char* func_name, int32_t event, uint64_t timeout_so, Args&&... args)
+static ssize_t do_io(int fd, OrignalFunc func, const char* func_name, int32_t event, int timeout_so, Args&&... args)
 {
-    if (!trycle::is_enable_hook)
+    if (!trycle::t_is_enable_hook)
     {
-        return func(fd, std::forward<Args>(args)...);
+        return func(fd, args...);
     }
-    trycle::FdCtx::ptr fd_ctx = trycle::FdMgr::GetSingleton()->get(fd);
+    trycle::FdCtx::Snapshot snap;
+    trycle::FdCtx* fd_ctx = get_fd_snapshot(fd, snap);
     if (!fd_ctx)
     {
-        return func(fd, std::forward<Args>(args)...);
+        return func(fd, args...);
     }
 
-    if (fd_ctx->isClosed())
+    if (snap.is_closed)
     {
         errno = EBADF;
         return -1;
     }
-    if (!fd_ctx->getIsSocket() || fd_ctx->getIsUserNoBlock())
+    if (!snap.is_hookable || snap.is_user_nonblock)
     {
-        return func(fd, std::forward<Args>(args)...);
+        return func(fd, args...);
     }
 
-    uint64_t to = fd_ctx->getTimeout(fd);
-    std::shared_ptr<TimeInfo> time_info(new TimeInfo());
-
-RETRY:
-    ssize_t n = func(fd, std::forward<Args>(args)...);
+    ssize_t n = 0;
     // 出现 EINTR，是因为系统 API 阻塞等待状态下被其它系统信号中断
     // 此处的解决办法是重新调用这次系统的 API
-    while (n == -1 && errno == EINTR)
+    do
     {
-        n = func(fd, std::forward<Args>(args)...);
+        n = func(fd, args...);
+    } while (n == -1 && errno == EINTR);
+    if (n != -1 || errno != EAGAIN)
+    {
+        return n;
     }
 
     // 出现 EAGAIN 是因为长时间未读到数据或无法写入数据
     // 直接把这个 fd 丢到 IOManager 里监听对应事件，触发后返回本执行上下文
-    if (n == -1 && errno == EAGAIN)
+    trycle::IOManager* iom = trycle::IOManager::GetThis();
+    if (!iom)
+    {
+        return n;
+    }
+
+    uint64_t to = snap.getTimeout(timeout_so);
+    // 记下快照的代数，挂起期间 fd 被关闭并复用时不会把新 fd 的状态当成自己的
+    bool is_read    = event == trycle::IOManager::EventType::READ;
+    uint32_t gen    = snap.generation;
+    uint32_t cancel = fd_ctx->getCancelCount(is_read);
+    std::shared_ptr<TimeInfo> time_info;
+    uint64_t deadline = 0;
+    if (to != (uint64_t)-1)
+    {
+        time_info.reset(new TimeInfo());
+        deadline = trycle::GetCurrentMs() + to;
+    }
+
+    while (true)
     {
-        trycle::IOManager* iom = trycle::IOManager::GetThis();
         trycle::Timer::ptr timer;
-        if (to != (uint64_t)-1)
+        if (time_info)
         {
+            // 多次 EAGAIN 共用同一个截止时间，而不是每次重新计时
+            uint64_t now = trycle::GetCurrentMs();
+            if (now >= deadline)
+            {
+                errno = ETIMEDOUT;
+                return -1;
+            }
             std::weak_ptr<TimeInfo> wtime_info(time_info);
             timer = iom->addConditionTimer(
-                timeout_so,
-                [fd, event, iom, wtime_info]()
+                deadline - now,
+                [fd, gen, event, iom, wtime_info]()
                 {
                     auto tinfo = wtime_info.lock();
                     if (!tinfo || tinfo->cancelled)
                     {
                         return;
                     }
+                    trycle::FdCtx* ctx = fd_mgr()->get(fd);
+                    if (!ctx || ctx->getGeneration() != gen)
+                    {
+                        return;
+                    }
                     tinfo->cancelled = ETIMEDOUT;
                     iom->cancelEvent(fd, (trycle::IOManager::EventType)event);
                 },
                 wtime_info, false);
         }
 
+        fd_ctx->setWaiter(is_read, iom);
         int rt = iom->addEvent(fd, (trycle::IOManager::EventType)event);
         if (rt)
         {
+            fd_ctx->setWaiter(is_read, nullptr);
             LOG_FMT_ERROR(g_logger, "addEvent failed | func_name=%s, fd=%d", func_name, fd);
             if (timer)
             {
@@ -161,22 +256,278 @@ RETRY:
             }
             return -1;
         }
+        // 登记之前已经被其他线程取消、取消方没有找到本协程的事件时，由自己触发
+        if (fd_ctx->getCancelCount(is_read) != cancel)
+        {
+            iom->cancelEvent(fd, (trycle::IOManager::EventType)event);
+        }
 
+        trycle::Fiber::SetWaitReason(func_name);
         trycle::Fiber::YieldToHold();
+        if (fd_ctx->getGeneration() == gen)
+        {
+            fd_ctx->setWaiter(is_read, nullptr);
+        }
         if (timer)
         {
             timer->cancel();
         }
-        if (time_info->cancelled)
+        if (time_info && time_info->cancelled)
         {
             errno = time_info->cancelled;
             return -1;
         }
+        if (fd_ctx->getGeneration() != gen)
+        {
+            errno = EBADF;
+            return -1;
+        }
+        if (fd_ctx->getCancelCount(is_read) != cancel)
+        {
+            errno = ECANCELED;
+            return -1;
+        }
+
+        do
+        {
+            n = func(fd, args...);
+        } while (n == -1 && errno == EINTR);
+        if (n != -1 || errno != EAGAIN)
+        {
+            return n;
+        }
+    }
+}
+
+struct PollWaiter
+{
+    trycle::IOManager* iom = nullptr;
+    trycle::Fiber::ptr fiber;
+    std::atomic<bool> fired{false};
+
+    // fd 事件和定时器可能同时触发，只唤醒一次
+    void wake()
+    {
+        if (!fired.exchange(true))
+        {
+            iom->schedule(fiber);
+        }
+    }
+};
+
+// 无法交给 epoll 等待的 fd（普通文件，或者同一事件已被其它协程注册）按这个间隔轮询
+static const uint64_t POLL_FALLBACK_INTERVAL_MS = 10;
+
+/**
+ * poll 系列 hook 的公共实现
+ * 先用 0 超时探测一次，没有就绪的 fd 时，把每个 fd 的读写事件注册到 IOManager，
+ * 任意一个事件或超时定时器触发后唤醒当前协程，注销剩余事件，再用 0 超时的 poll 收集真实结果
+ */
+static int do_poll(struct pollfd* fds, nfds_t nfds, int timeout_ms, const char* func_name)
+{
+    int rt = poll_f(fds, nfds, 0);
+    if (rt != 0 || timeout_ms == 0)
+    {
+        return rt;
+    }
+
+    trycle::IOManager* iom = trycle::IOManager::GetThis();
+    if (!iom)
+    {
+        return poll_f(fds, nfds, timeout_ms);
+    }
+
+    uint64_t deadline = timeout_ms < 0 ? (uint64_t)-1 : trycle::GetCurrentMs() + timeout_ms;
+    std::vector<std::pair<int, trycle::IOManager::EventType>> registered;
+    while (true)
+    {
+        std::shared_ptr<PollWaiter> waiter(new PollWaiter());
+        waiter->iom   = iom;
+        waiter->fiber = trycle::Fiber::GetThis();
+
+        bool fallback = false;
+        registered.clear();
+        for (nfds_t i = 0; i < nfds; i++)
+        {
+            if (fds[i].fd < 0)
+            {
+                continue;
+            }
+            uint32_t events = trycle::IOManager::NONE;
+            if (fds[i].events & (POLLIN | POLLPRI | POLLRDNORM | POLLRDBAND | POLLRDHUP))
+            {
+                events |= trycle::IOManager::READ;
+            }
+            if (fds[i].events & (POLLOUT | POLLWRNORM | POLLWRBAND))
+            {
+                events |= trycle::IOManager::WRITE;
+            }
+            for (uint32_t type : {(uint32_t)trycle::IOManager::READ, (uint32_t)trycle::IOManager::WRITE})
+            {
+                if (!(events & type))
+                {
+                    continue;
+                }
+                auto event = (trycle::IOManager::EventType)type;
+                // 检查和注册在同一把锁内完成，其它协程（可能在别的线程上）已注册同一事件时退回轮询
+                if (!iom->tryAddEvent(fds[i].fd, event, [waiter]()
+                                      { waiter->wake(); },
+                                      waiter.get()))
+                {
+                    fallback = true;
+                    continue;
+                }
+                registered.push_back(std::make_pair(fds[i].fd, event));
+            }
+        }
 
-        goto RETRY;
+        uint64_t wait_ms = (uint64_t)-1;
+        if (deadline != (uint64_t)-1)
+        {
+            uint64_t now = trycle::GetCurrentMs();
+            wait_ms      = deadline > now ? deadline - now : 0;
+        }
+        if (fallback)
+        {
+            wait_ms = std::min(wait_ms, POLL_FALLBACK_INTERVAL_MS);
+        }
+        trycle::Timer::ptr timer;
+        if (wait_ms != (uint64_t)-1)
+        {
+            timer = iom->addTimer(
+                wait_ms, [waiter]()
+                { waiter->wake(); },
+                false);
+        }
+
+        trycle::Fiber::SetWaitReason(func_name);
+        trycle::Fiber::YieldToHold();
+
+        if (timer)
+        {
+            timer->cancel();
+        }
+        // 已经触发的事件由 IOManager 自动移除，这里只注销本轮自己还没触发的注册，
+        // 触发后又被其它协程注册的同一事件标识不同，不会被误删
+        for (auto& item : registered)
+        {
+            iom->removeEvent(item.first, item.second, waiter.get());
+        }
+
+        rt = poll_f(fds, nfds, 0);
+        if (rt != 0)
+        {
+            return rt;
+        }
+        if (deadline != (uint64_t)-1 && trycle::GetCurrentMs() >= deadline)
+        {
+            return 0;
+        }
+    }
+}
+
+/**
+ * splice/tee 的两端都可能返回 EAGAIN（输入端没有数据，或输出端没有空间），
+ * 探测两端，挂起等待没有就绪的一端，两端都已就绪时让出一次执行权后重试
+ * func(nonblock)：只有走 hook 的路径传入 true，其余情况保持调用方的阻塞语义
+ */
+template <typename Func>
+static ssize_t do_pair_io(int fd_in, int fd_out, const char* func_name, Func func)
+{
+    if (!trycle::t_is_enable_hook || !trycle::IOManager::GetThis())
+    {
+        return func(false);
+    }
+    trycle::FdCtx::Snapshot in_snap;
+    trycle::FdCtx::Snapshot out_snap;
+    trycle::FdCtx* in_ctx  = get_fd_snapshot(fd_in, in_snap);
+    trycle::FdCtx* out_ctx = get_fd_snapshot(fd_out, out_snap);
+    bool in_hook           = in_ctx && in_snap.is_hookable;
+    bool out_hook          = out_ctx && out_snap.is_hookable;
+    if ((in_ctx && in_snap.is_closed) || (out_ctx && out_snap.is_closed))
+    {
+        errno = EBADF;
+        return -1;
+    }
+    if ((!in_hook && !out_hook) ||
+        (in_hook && in_snap.is_user_nonblock) ||
+        (out_hook && out_snap.is_user_nonblock))
+    {
+        return func(false);
+    }
+
+    // 两端各自的超时取较小值
+    uint64_t to = (uint64_t)-1;
+    if (in_hook)
+    {
+        to = std::min(to, in_snap.recv_timeout);
     }
+    if (out_hook)
+    {
+        to = std::min(to, out_snap.send_timeout);
+    }
+    uint64_t deadline = to == (uint64_t)-1 ? (uint64_t)-1 : trycle::GetCurrentMs() + to;
+
+    while (true)
+    {
+        ssize_t n = 0;
+        do
+        {
+            n = func(true);
+        } while (n == -1 && errno == EINTR);
+        if (n != -1 || errno != EAGAIN)
+        {
+            return n;
+        }
 
-    return n;
+        struct pollfd pfds[2];
+        nfds_t count = 0;
+        if (in_hook)
+        {
+            pfds[count++] = {fd_in, POLLIN, 0};
+        }
+        if (out_hook)
+        {
+            pfds[count++] = {fd_out, POLLOUT, 0};
+        }
+        poll_f(pfds, count, 0);
+        struct pollfd waits[2];
+        nfds_t wait_count = 0;
+        for (nfds_t i = 0; i < count; i++)
+        {
+            if (!pfds[i].revents)
+            {
+                waits[wait_count++] = {pfds[i].fd, pfds[i].events, 0};
+            }
+        }
+        if (wait_count == 0)
+        {
+            trycle::Fiber::YieldToReady();
+            continue;
+        }
+
+        int wait_ms = -1;
+        if (deadline != (uint64_t)-1)
+        {
+            uint64_t now = trycle::GetCurrentMs();
+            if (now >= deadline)
+            {
+                errno = ETIMEDOUT;
+                return -1;
+            }
+            wait_ms = deadline - now;
+        }
+        int rt = do_poll(waits, wait_count, wait_ms, func_name);
+        if (rt < 0)
+        {
+            return rt;
+        }
+        if (rt == 0)
+        {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+    }
 }
 
 extern "C"
@@ -192,8 +543,12 @@ extern "C"
             return sleep_f(seconds);
         }
 
+        trycle::IOManager* iom = trycle::IOManager::GetThis();
+        if (!iom)
+        {
+            return sleep_f(seconds);
+        }
         trycle::Fiber::ptr fiber = trycle::Fiber::GetThis();
-        trycle::IOManager* iom   = trycle::IOManager::GetThis();
 
         // iom->addTimer(
         //     seconds * 1000,
@@ -204,9 +559,10 @@ extern "C"
         //     false);
         iom->addTimer(
             seconds * 1000,
-            std::bind((void(trycle::Scheduler::*)(trycle::Fiber::ptr, int)) & trycle::IOManager::schedule, iom, fiber, -1),
+            std::bind((void(trycle::Scheduler::*)(trycle::Fiber::ptr, int, int)) & trycle::IOManager::schedule, iom, fiber, -1, -1),
             false);
 
+        trycle::Fiber::SetWaitReason("sleep");
         trycle::Fiber::YieldToHold();
 
         return 0;
@@ -218,8 +574,12 @@ extern "C"
         {
             return usleep_f(usec);
         }
+        trycle::IOManager* iom = trycle::IOManager::GetThis();
+        if (!iom)
+        {
+            return usleep_f(usec);
+        }
         trycle::Fiber::ptr fiber = trycle::Fiber::GetThis();
-        trycle::IOManager* iom   = trycle::IOManager::GetThis();
         // iom->addTimer(
         //     usec / 1000,
         //     [fiber, iom]()
@@ -227,8 +587,9 @@ extern "C"
         //     false);
         iom->addTimer(
             usec / 1000,
-            std::bind((void(trycle::Scheduler::*)(trycle::Fiber::ptr, int)) & trycle::IOManager::schedule, iom, fiber, -1),
+            std::bind((void(trycle::Scheduler::*)(trycle::Fiber::ptr, int, int)) & trycle::IOManager::schedule, iom, fiber, -1, -1),
             false);
+        trycle::Fiber::SetWaitReason("usleep");
         trycle::Fiber::YieldToHold();
 
         return 0;
@@ -241,8 +602,12 @@ extern "C"
             return nanosleep_f(req, rem);
         }
 
+        trycle::IOManager* iom = trycle::IOManager::GetThis();
+        if (!iom)
+        {
+            return nanosleep_f(req, rem);
+        }
         trycle::Fiber::ptr fiber = trycle::Fiber::GetThis();
-        trycle::IOManager* iom   = trycle::IOManager::GetThis();
 
         uint64_t timeout_ms      = req->tv_sec * 1000 + req->tv_nsec / 1000 / 1000;
         // iom->addTimer(
@@ -252,8 +617,9 @@ extern "C"
         //     false);
         iom->addTimer(
             timeout_ms,
-            std::bind((void(trycle::Scheduler::*)(trycle::Fiber::ptr, int)) & trycle::IOManager::schedule, iom, fiber, -1),
+            std::bind((void(trycle::Scheduler::*)(trycle::Fiber::ptr, int, int)) & trycle::IOManager::schedule, iom, fiber, -1, -1),
             false);
+        trycle::Fiber::SetWaitReason("nanosleep");
         trycle::Fiber::YieldToHold();
         return 0;
     }
@@ -265,29 +631,47 @@ extern "C"
             return socket_f(domain, type, protocol);
         }
 
-        int fd = socket_f(domain, type, protocol);
+        // 直接创建非阻塞 socket，省掉 FdCtx::init 中的 fstat 和两次 fcntl
+        int fd = socket_f(domain, type | SOCK_NONBLOCK, protocol);
 
         if (fd == -1)
         {
             return fd;
         }
-        trycle::FdMgr::GetSingleton()->get(fd, true);
+        add_nonblock_fd(fd, true, type & SOCK_NONBLOCK);
         return fd;
     }
 
+    int socketpair(int domain, int type, int protocol, int sv[2])
+    {
+        if (!trycle::t_is_enable_hook)
+        {
+            return socketpair_f(domain, type, protocol, sv);
+        }
+        int rt = socketpair_f(domain, type | SOCK_NONBLOCK, protocol, sv);
+        if (rt)
+        {
+            return rt;
+        }
+        add_nonblock_fd(sv[0], true, type & SOCK_NONBLOCK);
+        add_nonblock_fd(sv[1], true, type & SOCK_NONBLOCK);
+        return rt;
+    }
+
     int connect_with_timeout(int sockfd, const struct sockaddr* addr, socklen_t addrlen, uint64_t timeout_ms)
     {
         if (!trycle::t_is_enable_hook)
         {
             return connect_f(sockfd, addr, addrlen);
         }
-        auto ctx = trycle::FdMgr::GetSingleton()->get(sockfd);
-        if (!ctx || ctx->isClosed())
+        trycle::FdCtx::Snapshot snap;
+        auto ctx = get_fd_snapshot(sockfd, snap);
+        if (!ctx || snap.is_closed)
         {
             errno = EBADF;
             return -1;
         }
-        if (!ctx->getIsSocket() || ctx->getIsUserNoBlock())
+        if (!snap.is_socket || snap.is_user_nonblock)
         {
             return connect_f(sockfd, addr, addrlen);
         }
@@ -304,20 +688,26 @@ extern "C"
 
         trycle::IOManager* iom = trycle::IOManager::GetThis();
         trycle::Timer::ptr timer;
+        uint32_t gen = snap.generation;
         std::shared_ptr<TimeInfo> tinfo(new TimeInfo());
         std::weak_ptr<TimeInfo> wtinfo(tinfo);
 
-        if (timeout_ms == (uint64_t)-1)
+        if (timeout_ms != (uint64_t)-1)
         {
             timer = iom->addConditionTimer(
                 timeout_ms,
-                [sockfd, iom, wtinfo]()
+                [sockfd, gen, iom, wtinfo]()
                 {
                     auto t = wtinfo.lock();
                     if (!t || t->cancelled)
                     {
                         return;
                     }
+                    trycle::FdCtx* c = fd_mgr()->get(sockfd);
+                    if (!c || c->getGeneration() != gen)
+                    {
+                        return;
+                    }
                     t->cancelled = ETIMEDOUT;
                     iom->cancelEvent(sockfd, trycle::IOManager::EventType::WRITE);
                 },
@@ -327,6 +717,7 @@ extern "C"
         int rt = iom->addEvent(sockfd, trycle::IOManager::EventType::WRITE);
         if (rt == 0)
         {
+            trycle::Fiber::SetWaitReason("connect");
             trycle::Fiber::YieldToHold();
             if (timer)
             {
@@ -382,11 +773,127 @@ extern "C"
         {
             return accept_f(sockfd, addr, addrlen);
         }
-        if (sockfd > 0)
+        // 用 accept4 直接拿到非阻塞的连接，省掉 fstat 和两次 fcntl
+        int fd = do_io(sockfd, accept4_f, "accept", trycle::IOManager::EventType::READ, SO_RCVTIMEO, addr, addrlen, SOCK_NONBLOCK);
+        if (fd >= 0)
+        {
+            add_nonblock_fd(fd, true, false);
+        }
+        return fd;
+    }
+
+    int accept4(int sockfd, struct sockaddr* addr, socklen_t* addrlen, int flags)
+    {
+        if (!trycle::t_is_enable_hook)
+        {
+            return accept4_f(sockfd, addr, addrlen, flags);
+        }
+        int fd = do_io(sockfd, accept4_f, "accept4", trycle::IOManager::EventType::READ, SO_RCVTIMEO, addr, addrlen, flags | SOCK_NONBLOCK);
+        if (fd >= 0)
+        {
+            add_nonblock_fd(fd, true, flags & SOCK_NONBLOCK);
+        }
+        return fd;
+    }
+
+    int shutdown(int sockfd, int how)
+    {
+        int rt = shutdown_f(sockfd, how);
+        if (rt || !trycle::t_is_enable_hook || !fd_mgr()->get(sockfd))
+        {
+            return rt;
+        }
+        // 唤醒挂在已关闭方向上的协程，让它们重试并拿到 EOF 或 EPIPE
+        trycle::IOManager* iom = trycle::IOManager::GetThis();
+        if (!iom)
+        {
+            return rt;
+        }
+        if ((how == SHUT_RD || how == SHUT_RDWR) && iom->hasEvent(sockfd, trycle::IOManager::READ))
+        {
+            iom->cancelEvent(sockfd, trycle::IOManager::READ);
+        }
+        if ((how == SHUT_WR || how == SHUT_RDWR) && iom->hasEvent(sockfd, trycle::IOManager::WRITE))
+        {
+            iom->cancelEvent(sockfd, trycle::IOManager::WRITE);
+        }
+        return rt;
+    }
+
+    int pipe(int pipefd[2])
+    {
+        if (!trycle::t_is_enable_hook)
+        {
+            return pipe_f(pipefd);
+        }
+        return pipe2(pipefd, 0);
+    }
+
+    int pipe2(int pipefd[2], int flags)
+    {
+        if (!trycle::t_is_enable_hook)
         {
-            trycle::FdMgr::GetSingleton()->get(sockfd, true);
+            return pipe2_f(pipefd, flags);
         }
-        return sockfd;
+        int rt = pipe2_f(pipefd, flags | O_NONBLOCK);
+        if (rt)
+        {
+            return rt;
+        }
+        add_nonblock_fd(pipefd[0], false, flags & O_NONBLOCK);
+        add_nonblock_fd(pipefd[1], false, flags & O_NONBLOCK);
+        return rt;
+    }
+
+    int dup(int oldfd)
+    {
+        int fd = dup_f(oldfd);
+        if (fd >= 0 && trycle::t_is_enable_hook)
+        {
+            // 新 fd 共享同一个打开的文件（包括 O_NONBLOCK），属性照搬
+            fd_mgr()->dup(oldfd, fd);
+        }
+        return fd;
+    }
+
+    int dup2(int oldfd, int newfd)
+    {
+        if (!trycle::t_is_enable_hook || oldfd == newfd)
+        {
+            return dup2_f(oldfd, newfd);
+        }
+        // oldfd 无效时 newfd 保持不变，不能提前作废
+        if (fcntl_f(oldfd, F_GETFD) == -1)
+        {
+            return -1;
+        }
+        // 在内核关闭 newfd 原来的文件之前，从 epoll 中注销并唤醒等待者
+        release_fd(newfd);
+        int fd = dup2_f(oldfd, newfd);
+        if (fd >= 0)
+        {
+            fd_mgr()->dup(oldfd, fd);
+        }
+        return fd;
+    }
+
+    int dup3(int oldfd, int newfd, int flags)
+    {
+        if (!trycle::t_is_enable_hook || oldfd == newfd)
+        {
+            return dup3_f(oldfd, newfd, flags);
+        }
+        if (fcntl_f(oldfd, F_GETFD) == -1)
+        {
+            return -1;
+        }
+        release_fd(newfd);
+        int fd = dup3_f(oldfd, newfd, flags);
+        if (fd >= 0)
+        {
+            fd_mgr()->dup(oldfd, fd);
+        }
+        return fd;
     }
 
     ssize_t read(int fd, void* buf, size_t count)
@@ -414,6 +921,11 @@ extern "C"
         return do_io(sockfd, recvmsg_f, "recvmsg", trycle::IOManager::EventType::READ, SO_RCVTIMEO, msg, flags);
     }
 
+    int recvmmsg(int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags, struct timespec* timeout)
+    {
+        return do_io(sockfd, recvmmsg_f, "recvmmsg", trycle::IOManager::EventType::READ, SO_RCVTIMEO, msgvec, vlen, flags, timeout);
+    }
+
     ssize_t write(int fd, const void* buf, size_t count)
     {
         return do_io(fd, write_f, "write", trycle::IOManager::EventType::WRITE, SO_SNDTIMEO, buf, count);
@@ -439,22 +951,189 @@ extern "C"
         return do_io(sockfd, sendmsg_f, "sendmsg", trycle::IOManager::EventType::WRITE, SO_SNDTIMEO, msg, flags);
     }
 
-    int close(int fd)
+    int sendmmsg(int sockfd, struct mmsghdr* msgvec, unsigned int vlen, int flags)
+    {
+        return do_io(sockfd, sendmmsg_f, "sendmmsg", trycle::IOManager::EventType::WRITE, SO_SNDTIMEO, msgvec, vlen, flags);
+    }
+
+    ssize_t sendfile(int out_fd, int in_fd, off_t* offset, size_t count)
+    {
+        // 输入端是普通文件，只有输出端会 EAGAIN
+        return do_io(out_fd, sendfile_f, "sendfile", trycle::IOManager::EventType::WRITE, SO_SNDTIMEO, in_fd, offset, count);
+    }
+
+    ssize_t splice(int fd_in, loff_t* off_in, int fd_out, loff_t* off_out, size_t len, unsigned int flags)
+    {
+        return do_pair_io(fd_in, fd_out, "splice", [=](bool nonblock)
+                          { return splice_f(fd_in, off_in, fd_out, off_out, len, nonblock ? flags | SPLICE_F_NONBLOCK : flags); });
+    }
+
+    ssize_t tee(int fd_in, int fd_out, size_t len, unsigned int flags)
+    {
+        return do_pair_io(fd_in, fd_out, "tee", [=](bool nonblock)
+                          { return tee_f(fd_in, fd_out, len, nonblock ? flags | SPLICE_F_NONBLOCK : flags); });
+    }
+
+    int poll(struct pollfd* fds, nfds_t nfds, int timeout)
     {
         if (!trycle::t_is_enable_hook)
         {
-            return close_f(fd);
+            return poll_f(fds, nfds, timeout);
         }
-        auto fd_ctx = trycle::FdMgr::GetSingleton()->get(fd);
-        if (fd_ctx)
+        return do_poll(fds, nfds, timeout, "poll");
+    }
+
+    int ppoll(struct pollfd* fds, nfds_t nfds, const struct timespec* tmo_p, const sigset_t* sigmask)
+    {
+        // 带信号掩码时无法原子地替换掩码并等待，交给系统调用
+        if (!trycle::t_is_enable_hook || sigmask)
+        {
+            return ppoll_f(fds, nfds, tmo_p, sigmask);
+        }
+        int timeout_ms = -1;
+        if (tmo_p)
         {
-            auto iom = trycle::IOManager::GetThis();
-            if (iom)
+            timeout_ms = tmo_p->tv_sec * 1000 + (tmo_p->tv_nsec + 999999) / 1000000;
+        }
+        return do_poll(fds, nfds, timeout_ms, "ppoll");
+    }
+
+    int select(int nfds, fd_set* readfds, fd_set* writefds, fd_set* exceptfds, struct timeval* timeout)
+    {
+        if (!trycle::t_is_enable_hook)
+        {
+            return select_f(nfds, readfds, writefds, exceptfds, timeout);
+        }
+        int timeout_ms = -1;
+        if (timeout)
+        {
+            timeout_ms = timeout->tv_sec * 1000 + (timeout->tv_usec + 999) / 1000;
+        }
+
+        // fd_set 转成 pollfd，统一走 do_poll
+        std::vector<struct pollfd> pfds;
+        for (int fd = 0; fd < nfds; fd++)
+        {
+            short events = 0;
+            if (readfds && FD_ISSET(fd, readfds))
+            {
+                events |= POLLIN;
+            }
+            if (writefds && FD_ISSET(fd, writefds))
+            {
+                events |= POLLOUT;
+            }
+            if (exceptfds && FD_ISSET(fd, exceptfds))
             {
-                iom->cancelAllEvent(fd);
+                events |= POLLPRI;
             }
-            trycle::FdMgr::GetSingleton()->del(fd);
+            if (events)
+            {
+                struct pollfd pfd;
+                pfd.fd      = fd;
+                pfd.events  = events;
+                pfd.revents = 0;
+                pfds.push_back(pfd);
+            }
+        }
+
+        int rt = do_poll(pfds.data(), pfds.size(), timeout_ms, "select");
+        if (rt < 0)
+        {
+            return rt;
+        }
+
+        int count = 0;
+        for (auto& pfd : pfds)
+        {
+            if (pfd.revents & POLLNVAL)
+            {
+                errno = EBADF;
+                return -1;
+            }
+        }
+        for (auto& pfd : pfds)
+        {
+            bool want_read   = readfds && FD_ISSET(pfd.fd, readfds);
+            bool want_write  = writefds && FD_ISSET(pfd.fd, writefds);
+            bool want_except = exceptfds && FD_ISSET(pfd.fd, exceptfds);
+            if (want_read)
+            {
+                FD_CLR(pfd.fd, readfds);
+                if (pfd.revents & (POLLIN | POLLHUP | POLLERR))
+                {
+                    FD_SET(pfd.fd, readfds);
+                    ++count;
+                }
+            }
+            if (want_write)
+            {
+                FD_CLR(pfd.fd, writefds);
+                if (pfd.revents & (POLLOUT | POLLERR))
+                {
+                    FD_SET(pfd.fd, writefds);
+                    ++count;
+                }
+            }
+            if (want_except)
+            {
+                FD_CLR(pfd.fd, exceptfds);
+                if (pfd.revents & POLLPRI)
+                {
+                    FD_SET(pfd.fd, exceptfds);
+                    ++count;
+                }
+            }
+        }
+        return count;
+    }
+
+    int epoll_wait(int epfd, struct epoll_event* events, int maxevents, int timeout)
+    {
+        if (!trycle::t_is_enable_hook || timeout == 0)
+        {
+            return epoll_wait_f(epfd, events, maxevents, timeout);
+        }
+
+        // epoll fd 本身可以被 epoll 监听，有事件就绪时 epfd 可读
+        uint64_t deadline = timeout < 0 ? (uint64_t)-1 : trycle::GetCurrentMs() + timeout;
+        while (true)
+        {
+            int rt = epoll_wait_f(epfd, events, maxevents, 0);
+            if (rt != 0)
+            {
+                return rt;
+            }
+
+            int wait_ms = -1;
+            if (deadline != (uint64_t)-1)
+            {
+                uint64_t now = trycle::GetCurrentMs();
+                if (now >= deadline)
+                {
+                    return 0;
+                }
+                wait_ms = deadline - now;
+            }
+            struct pollfd pfd;
+            pfd.fd      = epfd;
+            pfd.events  = POLLIN;
+            pfd.revents = 0;
+            rt          = do_poll(&pfd, 1, wait_ms, "epoll_wait");
+            if (rt <= 0)
+            {
+                return rt;
+            }
+        }
+    }
+
+    int close(int fd)
+    {
+        if (!trycle::t_is_enable_hook)
+        {
+            return close_f(fd);
         }
+        release_fd(fd);
         return close_f(fd);
     }
 
@@ -468,13 +1147,14 @@ extern "C"
             {
                 int arg = va_arg(va, int);
                 va_end(va);
-                auto ctx = trycle::FdMgr::GetSingleton()->get(fd);
-                if (!ctx || ctx->isClosed() || !ctx->getIsSocket())
+                trycle::FdCtx::Snapshot snap;
+                auto ctx = get_fd_snapshot(fd, snap);
+                if (!ctx || snap.is_closed || !snap.is_hookable)
                 {
                     return fcntl_f(fd, cmd, arg);
                 }
                 ctx->setIsUserNoBlock(arg & O_NONBLOCK);
-                if (ctx->getIsSysNoBlock())
+                if (snap.is_sys_nonblock)
                 {
                     arg |= O_NONBLOCK;
                 }
@@ -488,13 +1168,13 @@ extern "C"
             {
                 va_end(va);
                 // int arg  = va_arg(va, int);
-                int arg  = fcntl_f(fd, cmd);
-                auto ctx = trycle::FdMgr::GetSingleton()->get(fd);
-                if (!ctx || ctx->isClosed() || !ctx->getIsSocket())
+                int arg = fcntl_f(fd, cmd);
+                trycle::FdCtx::Snapshot snap;
+                if (!get_fd_snapshot(fd, snap) || snap.is_closed || !snap.is_hookable)
                 {
                     return arg;
                 }
-                if (ctx->getIsUserNoBlock())
+                if (snap.is_user_nonblock)
                 {
                     return arg | O_NONBLOCK;
                 }
@@ -572,9 +1252,10 @@ extern "C"
 
         if (FIONBIO == request)
         {
-            bool userNonblock         = !!*(int*)arg;
-            trycle::FdCtx::ptr fd_ctx = trycle::FdMgr::GetSingleton()->get(fd);
-            if (!fd_ctx || fd_ctx->isClosed() || !fd_ctx->getIsSocket())
+            bool userNonblock = !!*(int*)arg;
+            trycle::FdCtx::Snapshot snap;
+            trycle::FdCtx* fd_ctx = get_fd_snapshot(fd, snap);
+            if (!fd_ctx || snap.is_closed || !snap.is_hookable)
             {
                 return ioctl_f(fd, request, arg);
             }
@@ -599,7 +1280,7 @@ extern "C"
         {
             if (optname == SO_RCVTIMEO || optname == SO_SNDTIMEO)
             {
-                auto fd_ctx = trycle::FdMgr::GetSingleton()->get(sockfd);
+                auto fd_ctx = fd_mgr()->get(sockfd);
                 if (fd_ctx)
                 {
                     const timeval* tval = (const timeval*)optval;
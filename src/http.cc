@@ -0,0 +1,235 @@
+#include "http.h"
+
+#include <sstream>
+#include <strings.h>
+
+namespace trycle
+{
+namespace http
+{
+
+HttpMethod StringToHttpMethod(const char* m, size_t len)
+{
+#define XX(num, name, string)                               \
+    if (len == sizeof(#string) - 1 && memcmp(m, #string, len) == 0) \
+    {                                                       \
+        return HttpMethod::name;                            \
+    }
+    HTTP_METHOD_MAP(XX);
+#undef XX
+    return HttpMethod::INVALID_METHOD;
+}
+
+static const char* s_method_string[] = {
+#define XX(num, name, string) #string,
+    HTTP_METHOD_MAP(XX)
+#undef XX
+};
+
+const char* HttpMethodToString(HttpMethod m)
+{
+    uint32_t idx = (uint32_t)m;
+    if (idx >= (sizeof(s_method_string) / sizeof(s_method_string[0])))
+    {
+        return "<unknown>";
+    }
+    return s_method_string[idx];
+}
+
+const char* HttpStatusToString(HttpStatus s)
+{
+    switch (s)
+    {
+#define XX(code, name, msg) \
+    case HttpStatus::name:  \
+        return #msg;
+        HTTP_STATUS_MAP(XX);
+#undef XX
+        default:
+            return "<unknown>";
+    }
+}
+
+std::ostream& operator<<(std::ostream& os, const StringView& sv)
+{
+    return os.write(sv.data, sv.size);
+}
+
+/**
+ * ============================================================================
+ * HttpRequest 类的实现
+ * ============================================================================
+ */
+HttpRequest::HttpRequest()
+{
+    reset();
+}
+
+void HttpRequest::reset()
+{
+    m_base       = nullptr;
+    m_method     = HttpMethod::INVALID_METHOD;
+    m_version    = 0x11;
+    m_keep_alive = true;
+    m_chunked    = false;
+    m_target     = Range();
+    m_path       = Range();
+    m_query      = Range();
+    m_body       = Range();
+    // 保留容量，连接上的后续请求不再分配
+    m_headers.clear();
+}
+
+StringView HttpRequest::getHeader(const StringView& name, const StringView& def) const
+{
+    for (auto& header : m_headers)
+    {
+        if (view(header.name).equalsIgnoreCase(name))
+        {
+            return view(header.value);
+        }
+    }
+    return def;
+}
+
+bool HttpRequest::hasHeader(const StringView& name) const
+{
+    for (auto& header : m_headers)
+    {
+        if (view(header.name).equalsIgnoreCase(name))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::ostream& HttpRequest::dump(std::ostream& os) const
+{
+    os << HttpMethodToString(m_method) << " " << getTarget()
+       << " HTTP/" << (uint32_t)(m_version >> 4) << "." << (uint32_t)(m_version & 0x0F) << "\r\n";
+    for (size_t i = 0; i < m_headers.size(); ++i)
+    {
+        os << getHeaderName(i) << ": " << getHeaderValue(i) << "\r\n";
+    }
+    os << "\r\n"
+       << getBody();
+    return os;
+}
+
+std::string HttpRequest::toString() const
+{
+    std::stringstream ss;
+    dump(ss);
+    return ss.str();
+}
+
+/**
+ * ============================================================================
+ * HttpResponse 类的实现
+ * ============================================================================
+ */
+HttpResponse::HttpResponse(uint8_t version, bool keep_alive)
+    : m_version(version),
+      m_keep_alive(keep_alive)
+{
+}
+
+void HttpResponse::setHeader(const std::string& key, const std::string& val)
+{
+    for (auto& header : m_headers)
+    {
+        if (strcasecmp(header.first.c_str(), key.c_str()) == 0)
+        {
+            header.second = val;
+            return;
+        }
+    }
+    m_headers.emplace_back(key, val);
+}
+
+std::string HttpResponse::getHeader(const std::string& key, const std::string& def) const
+{
+    for (auto& header : m_headers)
+    {
+        if (strcasecmp(header.first.c_str(), key.c_str()) == 0)
+        {
+            return header.second;
+        }
+    }
+    return def;
+}
+
+void HttpResponse::delHeader(const std::string& key)
+{
+    for (auto it = m_headers.begin(); it != m_headers.end(); ++it)
+    {
+        if (strcasecmp(it->first.c_str(), key.c_str()) == 0)
+        {
+            m_headers.erase(it);
+            return;
+        }
+    }
+}
+
+void HttpResponse::serializeHead(std::string& out) const
+{
+    char line[64];
+    int n = snprintf(line, sizeof(line), "HTTP/%u.%u %u ",
+                     (uint32_t)(m_version >> 4), (uint32_t)(m_version & 0x0F), (uint32_t)m_status);
+    out.append(line, n);
+    out.append(HttpStatusToString(m_status));
+    out.append("\r\n");
+
+    for (auto& header : m_headers)
+    {
+        out.append(header.first);
+        out.append(": ");
+        out.append(header.second);
+        out.append("\r\n");
+    }
+    // HTTP/1.1 默认长连接，HTTP/1.0 默认短连接，只在与默认值不同时写 connection
+    if (m_version == 0x11 && !m_keep_alive)
+    {
+        out.append("connection: close\r\n");
+    }
+    else if (m_version == 0x10 && m_keep_alive)
+    {
+        out.append("connection: keep-alive\r\n");
+    }
+    // 1xx、204、304 不能带 body，也不写 content-length
+    uint32_t code = (uint32_t)m_status;
+    if (code >= 200 && m_status != HttpStatus::NO_CONTENT && m_status != HttpStatus::NOT_MODIFIED)
+    {
+        n = snprintf(line, sizeof(line), "content-length: %zu\r\n", m_body.size());
+        out.append(line, n);
+    }
+    out.append("\r\n");
+}
+
+std::ostream& HttpResponse::dump(std::ostream& os) const
+{
+    std::string head;
+    serializeHead(head);
+    return os << head << m_body;
+}
+
+std::string HttpResponse::toString() const
+{
+    std::stringstream ss;
+    dump(ss);
+    return ss.str();
+}
+
+std::ostream& operator<<(std::ostream& os, const HttpRequest& req)
+{
+    return req.dump(os);
+}
+
+std::ostream& operator<<(std::ostream& os, const HttpResponse& rsp)
+{
+    return rsp.dump(os);
+}
+
+} // namespace http
+} // namespace trycle
@@ -0,0 +1,483 @@
+#include "http_parser.h"
+
+#include <algorithm>
+#include <string.h>
+
+#include "config.h"
+
+namespace trycle
+{
+namespace http
+{
+
+static auto g_http_request_max_header_size = Config::lookUp<uint64_t>("http.request.max_header_size", 8 * 1024, "http request max header size");
+static auto g_http_request_max_body_size   = Config::lookUp<uint64_t>("http.request.max_body_size", 64 * 1024 * 1024, "http request max body size");
+
+static uint64_t s_http_request_max_header_size = 0;
+static uint64_t s_http_request_max_body_size   = 0;
+
+namespace
+{
+struct RequestSizeIniter
+{
+    RequestSizeIniter()
+    {
+        s_http_request_max_header_size = g_http_request_max_header_size->getVal();
+        s_http_request_max_body_size   = g_http_request_max_body_size->getVal();
+        g_http_request_max_header_size->add_listener([](const uint64_t& old_val, const uint64_t& new_val)
+                                                    { s_http_request_max_header_size = new_val; });
+        g_http_request_max_body_size->add_listener([](const uint64_t& old_val, const uint64_t& new_val)
+                                                  { s_http_request_max_body_size = new_val; });
+    }
+};
+static RequestSizeIniter _init;
+} // namespace
+
+uint64_t HttpRequestParser::GetMaxHeaderSize()
+{
+    return s_http_request_max_header_size;
+}
+
+uint64_t HttpRequestParser::GetMaxBodySize()
+{
+    return s_http_request_max_body_size;
+}
+
+// RFC 7230 tchar
+static bool is_token(char c)
+{
+    static const char* specials = "!#$%&'*+-.^_`|~";
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c && strchr(specials, c));
+}
+
+// 逗号分隔的列表中是否包含 token（忽略大小写），用于 Connection、Transfer-Encoding
+static bool has_token(const StringView& value, const StringView& token)
+{
+    size_t i = 0;
+    while (i < value.size)
+    {
+        while (i < value.size && (value.data[i] == ' ' || value.data[i] == '\t' || value.data[i] == ','))
+        {
+            ++i;
+        }
+        size_t start = i;
+        while (i < value.size && value.data[i] != ',' && value.data[i] != ' ' && value.data[i] != '\t')
+        {
+            ++i;
+        }
+        if (StringView(value.data + start, i - start).equalsIgnoreCase(token))
+        {
+            return true;
+        }
+        while (i < value.size && value.data[i] != ',')
+        {
+            ++i;
+        }
+    }
+    return false;
+}
+
+/**
+ * ============================================================================
+ * HttpRequestParser 类的实现
+ * ============================================================================
+ */
+HttpRequestParser::HttpRequestParser()
+{
+    reset();
+}
+
+void HttpRequestParser::reset()
+{
+    m_state              = REQUEST_LINE;
+    m_pos                = 0;
+    m_scan               = 0;
+    m_consumed           = 0;
+    m_content_length     = 0;
+    m_has_content_length = false;
+    m_chunk_left         = 0;
+    m_body_end           = 0;
+    m_error              = HttpStatus::OK;
+    m_request.reset();
+}
+
+HttpRequestParser::Status HttpRequestParser::fail(HttpStatus status)
+{
+    m_error = status;
+    m_state = FINISHED;
+    return ERROR;
+}
+
+bool HttpRequestParser::nextLine(const char* data, size_t len, size_t& line, size_t& line_len)
+{
+    const char* nl = m_scan < len ? (const char*)memchr(data + m_scan, '\n', len - m_scan) : nullptr;
+    if (!nl)
+    {
+        m_scan = len;
+        return false;
+    }
+    size_t end = nl - data;
+    line       = m_pos;
+    line_len   = end - m_pos;
+    // 兼容只用 LF 结尾的行
+    if (line_len && data[end - 1] == '\r')
+    {
+        --line_len;
+    }
+    m_pos = m_scan = end + 1;
+    return true;
+}
+
+bool HttpRequestParser::parseRequestLine(const char* data, size_t line, size_t line_len)
+{
+    const char* begin = data + line;
+    const char* end   = begin + line_len;
+
+    const char* sp1 = (const char*)memchr(begin, ' ', line_len);
+    if (!sp1)
+    {
+        return false;
+    }
+    m_request.m_method = StringToHttpMethod(begin, sp1 - begin);
+    if (m_request.m_method == HttpMethod::INVALID_METHOD)
+    {
+        m_error = HttpStatus::NOT_IMPLEMENTED;
+        return false;
+    }
+
+    const char* target = sp1 + 1;
+    const char* sp2    = (const char*)memchr(target, ' ', end - target);
+    if (!sp2 || sp2 == target)
+    {
+        return false;
+    }
+
+    const char* version = sp2 + 1;
+    if (end - version != 8 || memcmp(version, "HTTP/1.", 7) != 0)
+    {
+        m_error = HttpStatus::HTTP_VERSION_NOT_SUPPORTED;
+        return false;
+    }
+    if (version[7] == '1')
+    {
+        m_request.m_version    = 0x11;
+        m_request.m_keep_alive = true;
+    }
+    else if (version[7] == '0')
+    {
+        m_request.m_version    = 0x10;
+        m_request.m_keep_alive = false;
+    }
+    else
+    {
+        m_error = HttpStatus::HTTP_VERSION_NOT_SUPPORTED;
+        return false;
+    }
+
+    m_request.m_target.offset = target - data;
+    m_request.m_target.length = sp2 - target;
+    const char* question      = (const char*)memchr(target, '?', sp2 - target);
+    m_request.m_path.offset   = m_request.m_target.offset;
+    m_request.m_path.length   = (question ? question : sp2) - target;
+    if (question)
+    {
+        m_request.m_query.offset = question + 1 - data;
+        m_request.m_query.length = sp2 - question - 1;
+    }
+    return true;
+}
+
+bool HttpRequestParser::parseHeader(const char* data, size_t line, size_t line_len)
+{
+    const char* begin = data + line;
+    const char* end   = begin + line_len;
+    const char* colon = (const char*)memchr(begin, ':', line_len);
+    if (!colon || colon == begin)
+    {
+        return false;
+    }
+    // 名称中不允许空白（RFC 7230 3.2.4），否则可能被用来做请求走私
+    for (const char* p = begin; p < colon; ++p)
+    {
+        if (!is_token(*p))
+        {
+            return false;
+        }
+    }
+    const char* value = colon + 1;
+    while (value < end && (*value == ' ' || *value == '\t'))
+    {
+        ++value;
+    }
+    const char* value_end = end;
+    while (value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t'))
+    {
+        --value_end;
+    }
+
+    HttpRequest::Header header;
+    header.name.offset  = line;
+    header.name.length  = colon - begin;
+    header.value.offset = value - data;
+    header.value.length = value_end - value;
+    m_request.m_headers.push_back(header);
+
+    // 解析过程中就要用到的头部
+    StringView name(begin, colon - begin);
+    StringView val(value, value_end - value);
+    if (name.equalsIgnoreCase("content-length"))
+    {
+        uint64_t length = 0;
+        if (val.empty())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < val.size; ++i)
+        {
+            if (val.data[i] < '0' || val.data[i] > '9' || length > (UINT64_MAX - 9) / 10)
+            {
+                return false;
+            }
+            length = length * 10 + (val.data[i] - '0');
+        }
+        // 多个不一致的 Content-Length 是请求走私的典型手法
+        if (m_has_content_length && length != m_content_length)
+        {
+            return false;
+        }
+        m_has_content_length = true;
+        m_content_length     = length;
+    }
+    else if (name.equalsIgnoreCase("transfer-encoding"))
+    {
+        if (has_token(val, "chunked"))
+        {
+            m_request.m_chunked = true;
+        }
+        else
+        {
+            m_error = HttpStatus::NOT_IMPLEMENTED;
+            return false;
+        }
+    }
+    else if (name.equalsIgnoreCase("connection"))
+    {
+        if (has_token(val, "close"))
+        {
+            m_request.m_keep_alive = false;
+        }
+        else if (has_token(val, "keep-alive"))
+        {
+            m_request.m_keep_alive = true;
+        }
+    }
+    return true;
+}
+
+bool HttpRequestParser::headersDone(const char* data)
+{
+    if (m_request.m_chunked)
+    {
+        // 同时出现时以 Transfer-Encoding 为准（RFC 7230 3.3.3），但这种请求不可信，直接拒绝
+        if (m_has_content_length)
+        {
+            return false;
+        }
+        m_body_end              = m_pos;
+        m_request.m_body.offset = m_pos;
+        m_state                 = CHUNK_SIZE;
+        return true;
+    }
+    if (m_content_length > GetMaxBodySize())
+    {
+        m_error = HttpStatus::PAYLOAD_TOO_LARGE;
+        return false;
+    }
+    m_request.m_body.offset = m_pos;
+    m_request.m_body.length = m_content_length;
+    m_state                 = BODY;
+    return true;
+}
+
+HttpRequestParser::Status HttpRequestParser::execute(char* data, size_t len)
+{
+    size_t line     = 0;
+    size_t line_len = 0;
+    while (true)
+    {
+        switch (m_state)
+        {
+            case REQUEST_LINE:
+            {
+                if (!nextLine(data, len, line, line_len))
+                {
+                    if (len > GetMaxHeaderSize())
+                    {
+                        return fail(HttpStatus::URI_TOO_LONG);
+                    }
+                    return INCOMPLETE;
+                }
+                // 请求之前的空行忽略（RFC 7230 3.5）
+                if (line_len == 0)
+                {
+                    continue;
+                }
+                m_error = HttpStatus::BAD_REQUEST;
+                if (!parseRequestLine(data, line, line_len))
+                {
+                    return fail(m_error);
+                }
+                m_error = HttpStatus::OK;
+                m_state = HEADERS;
+                break;
+            }
+            case HEADERS:
+            {
+                if (!nextLine(data, len, line, line_len))
+                {
+                    if (len > GetMaxHeaderSize())
+                    {
+                        return fail(HttpStatus::REQUEST_HEADER_FIELDS_TOO_LARGE);
+                    }
+                    return INCOMPLETE;
+                }
+                if (m_pos > GetMaxHeaderSize())
+                {
+                    return fail(HttpStatus::REQUEST_HEADER_FIELDS_TOO_LARGE);
+                }
+                m_error = HttpStatus::BAD_REQUEST;
+                if (line_len == 0 ? !headersDone(data) : !parseHeader(data, line, line_len))
+                {
+                    return fail(m_error);
+                }
+                m_error = HttpStatus::OK;
+                break;
+            }
+            case BODY:
+            {
+                if (len - m_pos < m_content_length)
+                {
+                    return INCOMPLETE;
+                }
+                m_consumed = m_pos + m_content_length;
+                m_state    = FINISHED;
+                break;
+            }
+            case CHUNK_SIZE:
+            {
+                if (!nextLine(data, len, line, line_len))
+                {
+                    // chunk-size 行（含扩展）不应该很长
+                    if (len - m_pos > 1024)
+                    {
+                        return fail(HttpStatus::BAD_REQUEST);
+                    }
+                    return INCOMPLETE;
+                }
+                uint64_t size = 0;
+                size_t i      = 0;
+                for (; i < line_len; ++i)
+                {
+                    char c = data[line + i];
+                    int v  = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10
+                                                             : (c >= 'A' && c <= 'F')   ? c - 'A' + 10
+                                                                                        : -1;
+                    if (v < 0)
+                    {
+                        break;
+                    }
+                    if (size > (UINT64_MAX >> 4))
+                    {
+                        return fail(HttpStatus::BAD_REQUEST);
+                    }
+                    size = (size << 4) | v;
+                }
+                // 至少一位十六进制数字，之后只能是 chunk 扩展
+                if (i == 0 || (i < line_len && data[line + i] != ';' && data[line + i] != ' ' && data[line + i] != '\t'))
+                {
+                    return fail(HttpStatus::BAD_REQUEST);
+                }
+                if (size == 0)
+                {
+                    m_state = TRAILERS;
+                    break;
+                }
+                if (m_body_end - m_request.m_body.offset + size > GetMaxBodySize())
+                {
+                    return fail(HttpStatus::PAYLOAD_TOO_LARGE);
+                }
+                m_chunk_left = size;
+                m_state      = CHUNK_DATA;
+                break;
+            }
+            case CHUNK_DATA:
+            {
+                size_t n = std::min<uint64_t>(len - m_pos, m_chunk_left);
+                // 原地解码：把数据移到已解码部分之后
+                if (n && m_body_end != m_pos)
+                {
+                    memmove(data + m_body_end, data + m_pos, n);
+                }
+                m_body_end += n;
+                m_pos += n;
+                m_chunk_left -= n;
+                if (m_chunk_left)
+                {
+                    return INCOMPLETE;
+                }
+                m_scan  = m_pos;
+                m_state = CHUNK_DATA_END;
+                break;
+            }
+            case CHUNK_DATA_END:
+            {
+                if (!nextLine(data, len, line, line_len))
+                {
+                    if (len - m_pos >= 2)
+                    {
+                        return fail(HttpStatus::BAD_REQUEST);
+                    }
+                    return INCOMPLETE;
+                }
+                // chunk 数据之后必须紧跟 CRLF
+                if (line_len != 0)
+                {
+                    return fail(HttpStatus::BAD_REQUEST);
+                }
+                m_state = CHUNK_SIZE;
+                break;
+            }
+            case TRAILERS:
+            {
+                if (!nextLine(data, len, line, line_len))
+                {
+                    if (len - m_pos > GetMaxHeaderSize())
+                    {
+                        return fail(HttpStatus::REQUEST_HEADER_FIELDS_TOO_LARGE);
+                    }
+                    return INCOMPLETE;
+                }
+                // trailer 字段忽略
+                if (line_len == 0)
+                {
+                    m_request.m_body.length = m_body_end - m_request.m_body.offset;
+                    m_consumed              = m_pos;
+                    m_state                 = FINISHED;
+                }
+                break;
+            }
+            case FINISHED:
+            {
+                if (m_error != HttpStatus::OK)
+                {
+                    return ERROR;
+                }
+                m_request.m_base = data;
+                return DONE;
+            }
+        }
+    }
+}
+
+} // namespace http
+} // namespace trycle
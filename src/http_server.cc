@@ -0,0 +1,236 @@
+#include "http_server.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+
+#include "config.h"
+#include "hook.h"
+#include "log.h"
+
+namespace trycle
+{
+namespace http
+{
+
+static auto g_logger = GET_LOGGER("system");
+
+static auto g_http_session_buffer_size = Config::lookUp<uint64_t>("http.session.buffer_size", 16 * 1024, "http session initial read buffer size");
+static auto g_http_session_flush_size  = Config::lookUp<uint64_t>("http.session.flush_size", 64 * 1024, "http session flushes queued responses beyond this size");
+
+// body 小于该长度时直接拼在头部后面，少一个 iovec
+static const size_t INLINE_BODY_SIZE = 1024;
+
+/**
+ * ============================================================================
+ * HttpSession 类的实现
+ * ============================================================================
+ */
+HttpSession::HttpSession(Socket::ptr sock)
+    : m_sock(sock),
+      m_buffer(g_http_session_buffer_size->getVal())
+{
+}
+
+HttpSession::~HttpSession()
+{
+}
+
+void HttpSession::reserve()
+{
+    if (m_end < m_buffer.size())
+    {
+        return;
+    }
+    if (m_begin > 0)
+    {
+        // 前面的请求都处理完了，把剩下的半个请求移到开头；解析器只记录偏移，不受影响
+        memmove(&m_buffer[0], &m_buffer[m_begin], m_end - m_begin);
+        m_end -= m_begin;
+        m_begin = 0;
+        return;
+    }
+    // 一个请求就占满了缓冲区，扩容；上限由解析器的头部、body 长度限制保证
+    m_buffer.resize(m_buffer.size() * 2);
+}
+
+HttpRequest* HttpSession::recvRequest()
+{
+    if (m_has_request)
+    {
+        m_begin += m_parser.getConsumed();
+        if (m_begin == m_end)
+        {
+            m_begin = m_end = 0;
+        }
+        m_parser.reset();
+        m_has_request = false;
+    }
+
+    while (true)
+    {
+        switch (m_parser.execute(m_buffer.data() + m_begin, m_end - m_begin))
+        {
+            case HttpRequestParser::DONE:
+                m_has_request = true;
+                return &m_parser.getRequest();
+            case HttpRequestParser::ERROR:
+                m_error = m_parser.getError();
+                LOG_FMT_DEBUG(g_logger, "HttpSession bad request | sock=%d, status=%d",
+                              m_sock->getSocket(), (int)m_error);
+                return nullptr;
+            case HttpRequestParser::INCOMPLETE:
+                break;
+        }
+
+        // 要等待新数据了，先把已经处理完的请求的响应发出去
+        if (!flush())
+        {
+            return nullptr;
+        }
+        reserve();
+        ssize_t n = m_sock->recv(m_buffer.data() + m_end, m_buffer.size() - m_end);
+        if (n <= 0)
+        {
+            // 请求收到一半时超时，应答 408；空闲的长连接超时或对端关闭直接断开
+            if (n < 0 && errno == ETIMEDOUT && m_end > m_begin)
+            {
+                m_error = HttpStatus::REQUEST_TIMEOUT;
+            }
+            return nullptr;
+        }
+        m_end += n;
+    }
+}
+
+std::string& HttpSession::nextSegment()
+{
+    if (m_segment_count == m_segments.size())
+    {
+        m_segments.emplace_back();
+    }
+    std::string& segment = m_segments[m_segment_count++];
+    segment.clear();
+    return segment;
+}
+
+bool HttpSession::queueResponse(HttpResponse& response, bool head_only)
+{
+    std::string& head = nextSegment();
+    response.serializeHead(head);
+    m_pending_bytes += head.size();
+
+    std::string& body = response.getBody();
+    if (!head_only && !body.empty())
+    {
+        m_pending_bytes += body.size();
+        if (body.size() < INLINE_BODY_SIZE)
+        {
+            head.append(body);
+        }
+        else
+        {
+            // nextSegment 可能使 head 失效，之后不再使用 head
+            nextSegment().swap(body);
+        }
+    }
+
+    if (m_pending_bytes >= g_http_session_flush_size->getVal() || m_segment_count >= IOV_MAX)
+    {
+        return flush();
+    }
+    return true;
+}
+
+bool HttpSession::flush()
+{
+    if (!m_segment_count)
+    {
+        return true;
+    }
+    m_iovs.resize(m_segment_count);
+    for (size_t i = 0; i < m_segment_count; ++i)
+    {
+        m_iovs[i].iov_base = &m_segments[i][0];
+        m_iovs[i].iov_len  = m_segments[i].size();
+    }
+    m_segment_count = 0;
+    m_pending_bytes = 0;
+
+    // 通常一次 writev 就能写完；发送缓冲区满时 hook 挂起协程，之后从写到的位置继续
+    iovec* iov = m_iovs.data();
+    size_t cnt = m_iovs.size();
+    while (cnt)
+    {
+        ssize_t n = ::writev(m_sock->getSocket(), iov, cnt);
+        if (n <= 0)
+        {
+            LOG_FMT_DEBUG(g_logger, "HttpSession::flush writev failed | sock=%d, errno=%d, errstr=%s",
+                          m_sock->getSocket(), errno, strerror(errno));
+            return false;
+        }
+        while (cnt && (size_t)n >= iov->iov_len)
+        {
+            n -= iov->iov_len;
+            ++iov;
+            --cnt;
+        }
+        if (cnt)
+        {
+            iov->iov_base = (char*)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return true;
+}
+
+/**
+ * ============================================================================
+ * HttpServer 类的实现
+ * ============================================================================
+ */
+HttpServer::HttpServer(bool keepalive, IOManager* worker, IOManager* acceptor)
+    : HttpServer(keepalive, std::vector<IOManager*>{worker}, std::vector<IOManager*>{acceptor})
+{
+}
+
+HttpServer::HttpServer(bool keepalive, const std::vector<IOManager*>& workers, const std::vector<IOManager*>& acceptors)
+    : TcpServer(workers, acceptors),
+      m_is_keepalive(keepalive),
+      m_dispatch(new ServletDispatch())
+{
+}
+
+void HttpServer::handleClient(Socket::ptr client)
+{
+    HttpSession session(client);
+    while (true)
+    {
+        HttpRequest* request = session.recvRequest();
+        if (!request)
+        {
+            if (session.getError() != HttpStatus::OK)
+            {
+                HttpResponse response(0x11, false);
+                response.setStatus(session.getError());
+                response.setHeader("server", getName());
+                session.queueResponse(response);
+            }
+            break;
+        }
+
+        HttpResponse response(request->getVersion(), m_is_keepalive && request->isKeepAlive() && !isStop());
+        response.setHeader("server", getName());
+        m_dispatch->handle(*request, response, session);
+
+        bool keep_alive = response.isKeepAlive();
+        if (!session.queueResponse(response, request->getMethod() == HttpMethod::HEAD) || !keep_alive)
+        {
+            break;
+        }
+    }
+    session.flush();
+}
+
+} // namespace http
+} // namespace trycle
@@ -0,0 +1,433 @@
+#include "iobuffer.h"
+
+#include <algorithm>
+#include <string.h>
+
+#include "hook.h"
+#include "macro.h"
+#include "slab.h"
+
+namespace trycle
+{
+
+// 一次 readv/writev 最多使用的 iovec 数
+static const size_t MAX_IOV = 64;
+
+struct IOBuffer::Block
+{
+    Block* prev;
+    Block* next;
+    // [begin, end) 为有效数据
+    uint32_t begin;
+    uint32_t end;
+    char data[BLOCK_SIZE];
+
+    size_t readable() const { return end - begin; }
+    size_t writable() const { return BLOCK_SIZE - end; }
+};
+
+IOBuffer::Block* IOBuffer::AllocBlock()
+{
+    Block* block = (Block*)SlabPool::Allocate(sizeof(Block));
+    block->prev  = nullptr;
+    block->next  = nullptr;
+    block->begin = 0;
+    block->end   = 0;
+    return block;
+}
+
+// 块可能在另一个线程释放（跨线程转发），SlabPool 把它还给分配它的线程
+void IOBuffer::ReleaseBlock(Block* block)
+{
+    SlabPool::Deallocate(block, sizeof(Block));
+}
+
+/**
+ * ============================================================================
+ * IOBuffer 类的实现
+ * ============================================================================
+ */
+const size_t IOBuffer::BLOCK_SIZE;
+
+IOBuffer::IOBuffer()
+{
+}
+
+IOBuffer::~IOBuffer()
+{
+    clear();
+}
+
+IOBuffer::IOBuffer(IOBuffer&& other)
+{
+    *this = std::move(other);
+}
+
+IOBuffer& IOBuffer::operator=(IOBuffer&& other)
+{
+    if (this != &other)
+    {
+        clear();
+        std::swap(m_head, other.m_head);
+        std::swap(m_tail, other.m_tail);
+        std::swap(m_size, other.m_size);
+        std::swap(m_block_count, other.m_block_count);
+        other.m_write_block = nullptr;
+    }
+    return *this;
+}
+
+IOBuffer::Block* IOBuffer::popFront()
+{
+    Block* block = m_head;
+    m_head       = block->next;
+    if (m_head)
+    {
+        m_head->prev = nullptr;
+    }
+    else
+    {
+        m_tail = nullptr;
+    }
+    --m_block_count;
+    return block;
+}
+
+void IOBuffer::pushBack(Block* block)
+{
+    block->prev = m_tail;
+    block->next = nullptr;
+    if (m_tail)
+    {
+        m_tail->next = block;
+    }
+    else
+    {
+        m_head = block;
+    }
+    m_tail = block;
+    ++m_block_count;
+}
+
+void IOBuffer::pushFront(Block* block)
+{
+    block->prev = nullptr;
+    block->next = m_head;
+    if (m_head)
+    {
+        m_head->prev = block;
+    }
+    else
+    {
+        m_tail = block;
+    }
+    m_head = block;
+    ++m_block_count;
+}
+
+void IOBuffer::trimTail()
+{
+    while (m_tail && m_tail->readable() == 0)
+    {
+        Block* block = m_tail;
+        m_tail       = block->prev;
+        if (m_tail)
+        {
+            m_tail->next = nullptr;
+        }
+        else
+        {
+            m_head = nullptr;
+        }
+        --m_block_count;
+        ReleaseBlock(block);
+    }
+}
+
+void IOBuffer::append(const void* data, size_t len)
+{
+    const char* p = (const char*)data;
+    while (len)
+    {
+        Block* block = m_tail;
+        if (!block || !block->writable())
+        {
+            block = AllocBlock();
+            pushBack(block);
+        }
+        size_t n = std::min(len, block->writable());
+        memcpy(block->data + block->end, p, n);
+        block->end += n;
+        m_size += n;
+        p += n;
+        len -= n;
+    }
+}
+
+void IOBuffer::prepend(const void* data, size_t len)
+{
+    // 从后往前写，每个新块的数据都放在块尾，给之后的 prepend 留出空间
+    const char* end = (const char*)data + len;
+    while (len)
+    {
+        Block* block = m_head;
+        if (!block || block->begin == 0)
+        {
+            block        = AllocBlock();
+            block->begin = block->end = BLOCK_SIZE;
+            pushFront(block);
+        }
+        size_t n = std::min<size_t>(len, block->begin);
+        block->begin -= n;
+        memcpy(block->data + block->begin, end - n, n);
+        m_size += n;
+        end -= n;
+        len -= n;
+    }
+}
+
+void IOBuffer::splice(IOBuffer& other)
+{
+    if (&other == this || !other.m_head)
+    {
+        return;
+    }
+    trimTail();
+    other.trimTail();
+    if (!other.m_head)
+    {
+        return;
+    }
+    other.m_head->prev = m_tail;
+    if (m_tail)
+    {
+        m_tail->next = other.m_head;
+    }
+    else
+    {
+        m_head = other.m_head;
+    }
+    m_tail = other.m_tail;
+    m_size += other.m_size;
+    m_block_count += other.m_block_count;
+
+    other.m_head        = nullptr;
+    other.m_tail        = nullptr;
+    other.m_size        = 0;
+    other.m_block_count = 0;
+}
+
+size_t IOBuffer::splice(IOBuffer& other, size_t len)
+{
+    if (&other == this)
+    {
+        return 0;
+    }
+    if (len >= other.m_size)
+    {
+        len = other.m_size;
+        splice(other);
+        return len;
+    }
+    trimTail();
+    size_t moved = 0;
+    while (other.m_head && other.m_head->readable() <= len - moved)
+    {
+        Block* block = other.popFront();
+        other.m_size -= block->readable();
+        moved += block->readable();
+        if (block->readable())
+        {
+            m_size += block->readable();
+            pushBack(block);
+        }
+        else
+        {
+            ReleaseBlock(block);
+        }
+    }
+    // 剩下不足一块的部分拷贝
+    if (moved < len)
+    {
+        size_t n = len - moved;
+        append(other.m_head->data + other.m_head->begin, n);
+        other.consume(n);
+        moved += n;
+    }
+    return moved;
+}
+
+size_t IOBuffer::copyOut(void* dst, size_t len, size_t offset) const
+{
+    char* out     = (char*)dst;
+    size_t copied = 0;
+    for (Block* block = m_head; block && copied < len; block = block->next)
+    {
+        size_t readable = block->readable();
+        if (offset >= readable)
+        {
+            offset -= readable;
+            continue;
+        }
+        size_t n = std::min(readable - offset, len - copied);
+        memcpy(out + copied, block->data + block->begin + offset, n);
+        copied += n;
+        offset = 0;
+    }
+    return copied;
+}
+
+void IOBuffer::consume(size_t len)
+{
+    len = std::min(len, m_size);
+    m_size -= len;
+    while (len)
+    {
+        Block* block = m_head;
+        if (block->readable() > len)
+        {
+            block->begin += len;
+            return;
+        }
+        len -= block->readable();
+        ReleaseBlock(popFront());
+    }
+}
+
+size_t IOBuffer::read(void* dst, size_t len)
+{
+    size_t n = copyOut(dst, len);
+    consume(n);
+    return n;
+}
+
+ssize_t IOBuffer::find(char c, size_t offset) const
+{
+    size_t pos = 0;
+    for (Block* block = m_head; block; block = block->next)
+    {
+        size_t readable = block->readable();
+        if (offset >= readable)
+        {
+            offset -= readable;
+            pos += readable;
+            continue;
+        }
+        const char* begin = block->data + block->begin;
+        const char* hit   = (const char*)memchr(begin + offset, c, readable - offset);
+        if (hit)
+        {
+            return pos + (hit - begin);
+        }
+        pos += readable;
+        offset = 0;
+    }
+    return -1;
+}
+
+std::string IOBuffer::toString() const
+{
+    std::string str(m_size, '\0');
+    copyOut(&str[0], m_size);
+    return str;
+}
+
+void IOBuffer::clear()
+{
+    while (m_head)
+    {
+        ReleaseBlock(popFront());
+    }
+    m_size        = 0;
+    m_write_block = nullptr;
+}
+
+size_t IOBuffer::getReadBuffers(iovec* iov, size_t max_iov, size_t len, size_t offset) const
+{
+    size_t n = 0;
+    for (Block* block = m_head; block && len && n < max_iov; block = block->next)
+    {
+        if (offset >= block->readable())
+        {
+            offset -= block->readable();
+            continue;
+        }
+        size_t readable = std::min(block->readable() - offset, len);
+        iov[n].iov_base = block->data + block->begin + offset;
+        iov[n].iov_len  = readable;
+        offset          = 0;
+        len -= readable;
+        ++n;
+    }
+    return n;
+}
+
+size_t IOBuffer::getWriteBuffers(iovec* iov, size_t max_iov, size_t len)
+{
+    size_t n       = 0;
+    size_t reserve = 0;
+    m_write_block  = nullptr;
+    if (m_tail && m_tail->writable() && max_iov)
+    {
+        m_write_block   = m_tail;
+        iov[n].iov_base = m_tail->data + m_tail->end;
+        iov[n].iov_len  = std::min(m_tail->writable(), len);
+        reserve += iov[n].iov_len;
+        ++n;
+    }
+    while (reserve < len && n < max_iov)
+    {
+        Block* block = AllocBlock();
+        pushBack(block);
+        if (!m_write_block)
+        {
+            m_write_block = block;
+        }
+        iov[n].iov_base = block->data;
+        iov[n].iov_len  = std::min(BLOCK_SIZE, len - reserve);
+        reserve += iov[n].iov_len;
+        ++n;
+    }
+    return n;
+}
+
+void IOBuffer::commit(size_t len)
+{
+    for (Block* block = m_write_block; block && len; block = block->next)
+    {
+        size_t n = std::min(block->writable(), len);
+        block->end += n;
+        m_size += n;
+        len -= n;
+    }
+    ASSERT_M(len == 0, "IOBuffer::commit more than reserved");
+    m_write_block = nullptr;
+    trimTail();
+}
+
+ssize_t IOBuffer::readFd(int fd, size_t len)
+{
+    iovec iov[MAX_IOV];
+    size_t cnt = getWriteBuffers(iov, MAX_IOV, len);
+    ssize_t n  = ::readv(fd, iov, cnt);
+    commit(n > 0 ? n : 0);
+    return n;
+}
+
+ssize_t IOBuffer::writeFd(int fd, size_t len)
+{
+    iovec iov[MAX_IOV];
+    size_t cnt = getReadBuffers(iov, MAX_IOV, len);
+    if (!cnt)
+    {
+        return 0;
+    }
+    ssize_t n = ::writev(fd, iov, cnt);
+    if (n > 0)
+    {
+        consume(n);
+    }
+    return n;
+}
+
+} // namespace trycle
@@ -4,6 +4,7 @@
 #include <fcntl.h>
 #include <sys/epoll.h>
 
+#include "hook.h"
 #include "log.h"
 #include "macro.h"
 
@@ -12,6 +13,12 @@ namespace trycle
 
 static auto g_logger = GET_LOGGER("system");
 
+// epoll 事件的 data：低 32 位是 fd（与 data.fd 一致），高 32 位是注册时 FdContext 的代数
+static uint64_t MakeEventData(int fd, uint32_t generation)
+{
+    return (uint64_t)generation << 32 | (uint32_t)fd;
+}
+
 /**
  * ============================================================================
  * IOManager 类的实现
@@ -23,8 +30,8 @@ IOManager::IOManager(size_t thread_size, bool use_caller, const std::string& nam
     // 创建epoll
     m_epoll_fd = ::epoll_create(0xffff);
     ASSERT(m_epoll_fd > 0);
-    // 创建管道，并加入epoll监听
-    int pip_res = ::pipe(m_tickle_fds);
+    // 创建管道，并加入epoll监听（管道相关函数已被 hook，内部一律使用原始函数）
+    int pip_res = pipe_f(m_tickle_fds);
     ASSERT(!pip_res);
     // 创建管理可读事件监听
     epoll_event event{};
@@ -32,14 +39,12 @@ IOManager::IOManager(size_t thread_size, bool use_caller, const std::string& nam
     // 开启可读事件，并开启边缘触发
     event.events = EPOLLIN | EPOLLET;
     // 将管道读取端设置为非阻塞模式
-    int fcntl_res = ::fcntl(m_tickle_fds[0], F_SETFL, O_NONBLOCK);
+    int fcntl_res = fcntl_f(m_tickle_fds[0], F_SETFL, O_NONBLOCK);
     ASSERT(!fcntl_res);
 
     int ep_ctl_res = ::epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_tickle_fds[0], &event);
     ASSERT(!ep_ctl_res);
 
-    contextListResize(32);
-
     start();
 }
 
@@ -48,22 +53,19 @@ IOManager::~IOManager()
     // 触用 stop
     stop();
     // 关闭打开的文件标识符
-    close(m_epoll_fd);
-    close(m_tickle_fds[0]);
-    close(m_tickle_fds[1]);
+    close_f(m_epoll_fd);
+    close_f(m_tickle_fds[0]);
+    close_f(m_tickle_fds[1]);
 }
 
-void IOManager::contextListResize(int size)
+IOManager::FdContext* IOManager::getFdContext(int fd, bool auto_create)
 {
-    m_fd_context_list.resize(size);
-    for (int i = 0; i < m_fd_context_list.size(); i++)
+    if (!auto_create)
     {
-        if (!m_fd_context_list[i])
-        {
-            m_fd_context_list[i]       = std::make_shared<FdContext>();
-            m_fd_context_list[i]->m_fd = i;
-        }
+        return m_fd_contexts.get(fd);
     }
+    return m_fd_contexts.getOrCreate(fd, [](FdContext& fd_ctx, int i)
+                                     { fd_ctx.m_fd = i; });
 }
 
 void IOManager::onTimerInsertedAtFirst()
@@ -79,24 +81,16 @@ bool IOManager::addEvent(int fd, EventType event, std::function<void()> callback
     /**
      * NOTE:
      *  主要工作流程：
-     *  首先，从fd对象池中取出对应的对象指针，如果不存在，就扩容对象池
+     *  首先，从fd分段表中取出对应的对象指针，所在段不存在时分配
      *  然后，检查fd对象是否存在相同的事件
      *  接着，创建epoll事件对象，并注册事件
      *  最后，更新fd对象的事件处理器
      */
-    FdContext* fd_ctx;
-    MutexType::ReadLock lock(&m_mutex);
-    if (m_fd_context_list.size() > fd)
+    FdContext* fd_ctx = getFdContext(fd, true);
+    if (!fd_ctx)
     {
-        fd_ctx = m_fd_context_list[fd].get();
-        lock.unlock();
-    }
-    else
-    {
-        lock.unlock();
-        MutexType::WriteLock lock2(&m_mutex);
-        contextListResize(m_fd_context_list.size() * 1.5);
-        fd_ctx = m_fd_context_list[fd].get();
+        LOG_FMT_ERROR(g_logger, "IOManager::addEvent | fd out of range | fd=%d", fd);
+        return -1;
     }
 
     FdContext::MutexType::Lock lock3(&fd_ctx->m_mutex);
@@ -107,16 +101,41 @@ bool IOManager::addEvent(int fd, EventType event, std::function<void()> callback
         LOG_FMT_ERROR(g_logger, "IOManager::addEvent | exist same event | fd=%d, event=%d, fd_ctx.event=%d", (int)fd, event, fd_ctx->m_events);
         ASSERT(false);
     }
+    return addEventLocked(fd_ctx, fd, event, callback, nullptr);
+}
+
+bool IOManager::tryAddEvent(int fd, EventType event, std::function<void()> callback, const void* token)
+{
+    FdContext* fd_ctx = getFdContext(fd, true);
+    if (!fd_ctx)
+    {
+        return false;
+    }
+
+    FdContext::MutexType::Lock lock(&fd_ctx->m_mutex);
+    if (fd_ctx->m_events & event)
+    {
+        return false;
+    }
+    return addEventLocked(fd_ctx, fd, event, callback, token) == 0;
+}
 
+int IOManager::addEventLocked(FdContext* fd_ctx, int fd, EventType event, std::function<void()>& callback, const void* token)
+{
     /**
      * 如果这个fd context的 m_events 是空的，说明这个fd还没在epoll上注册
      * 使用 EPOLL_CTL_ADD 注册新事件
      * 否则，使用 EPOLL_CTL_MOD 更改fd监听的事件
      */
     int op = fd_ctx->m_events == EventType::NONE ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+    if (op == EPOLL_CTL_ADD)
+    {
+        // 新的注册，之前注册（fd 可能已被关闭复用）时已返回、尚未处理的事件作废
+        ++fd_ctx->m_generation;
+    }
     epoll_event ep_event{};
     ep_event.events   = EPOLLET | fd_ctx->m_events | event;
-    ep_event.data.ptr = fd_ctx;
+    ep_event.data.u64 = MakeEventData(fd, fd_ctx->m_generation);
     // 给fd注册事件监听
     int ep_ctl_res = ::epoll_ctl(m_epoll_fd, op, fd, &ep_event);
     if (ep_ctl_res)
@@ -139,6 +158,7 @@ bool IOManager::addEvent(int fd, EventType event, std::function<void()> callback
            !event_ctx.m_fiber &&
            !event_ctx.m_callback);
     event_ctx.m_scheduler = Scheduler::GetThis();
+    event_ctx.m_token     = token;
     if (callback)
     {
         event_ctx.m_callback.swap(callback);
@@ -154,14 +174,10 @@ bool IOManager::addEvent(int fd, EventType event, std::function<void()> callback
 
 bool IOManager::removeEvent(int fd, EventType event)
 {
-    FdContext* fd_ctx = nullptr;
+    FdContext* fd_ctx = getFdContext(fd, false);
+    if (!fd_ctx)
     {
-        MutexType::ReadLock lock(&m_mutex);
-        if (m_fd_context_list.size() <= fd)
-        {
-            return false;
-        }
-        fd_ctx = m_fd_context_list[fd].get();
+        return false;
     }
 
     FdContext::MutexType::Lock lock2(&fd_ctx->m_mutex);
@@ -170,11 +186,33 @@ bool IOManager::removeEvent(int fd, EventType event)
         LOG_FMT_INFO(g_logger, "event context not exist | eventType=%d", event);
         return false;
     }
+    removeEventLocked(fd_ctx, fd, event);
+    return true;
+}
 
+bool IOManager::removeEvent(int fd, EventType event, const void* token)
+{
+    FdContext* fd_ctx = getFdContext(fd, false);
+    if (!fd_ctx)
+    {
+        return false;
+    }
+
+    FdContext::MutexType::Lock lock(&fd_ctx->m_mutex);
+    if (!(fd_ctx->m_events & event) || fd_ctx->getEventContext(event).m_token != token)
+    {
+        return false;
+    }
+    removeEventLocked(fd_ctx, fd, event);
+    return true;
+}
+
+void IOManager::removeEventLocked(FdContext* fd_ctx, int fd, EventType event)
+{
     auto new_events = static_cast<EventType>(fd_ctx->m_events & ~event);
     int op          = new_events == EventType::NONE ? EPOLL_CTL_DEL : EPOLL_CTL_MOD;
     epoll_event ep_event{};
-    ep_event.data.ptr = fd_ctx;
+    ep_event.data.u64 = MakeEventData(fd, fd_ctx->m_generation);
     ep_event.events   = EPOLLET | new_events;
     int ep_ctl_res    = ::epoll_ctl(m_epoll_fd, op, fd, &ep_event);
     ASSERT_M(ep_ctl_res == 0, "IOManager::removeEvent | epoll ctl failed | epfd=" + std::to_string(m_epoll_fd));
@@ -183,20 +221,14 @@ bool IOManager::removeEvent(int fd, EventType event)
     auto& event_ctx  = fd_ctx->getEventContext(event);
     fd_ctx->resetEventContext(event_ctx);
     --m_pending_event_count;
-
-    return true;
 }
 
 bool IOManager::cancelEvent(int fd, EventType event)
 {
-    FdContext* fd_ctx = nullptr;
+    FdContext* fd_ctx = getFdContext(fd, false);
+    if (!fd_ctx)
     {
-        MutexType::ReadLock lock(&m_mutex);
-        if (m_fd_context_list.size() <= fd)
-        {
-            false;
-        }
-        fd_ctx = m_fd_context_list[fd].get();
+        return false;
     }
 
     FdContext::MutexType::Lock lock(&fd_ctx->m_mutex);
@@ -210,14 +242,12 @@ bool IOManager::cancelEvent(int fd, EventType event)
     int op         = new_event == EventType::NONE ? EPOLL_CTL_DEL : EPOLL_CTL_MOD;
 
     epoll_event ep_event{};
-    ep_event.data.ptr = fd_ctx;
+    ep_event.data.u64 = MakeEventData(fd, fd_ctx->m_generation);
     ep_event.events   = EPOLLET | new_event;
     int ep_ctl_res    = epoll_ctl(m_epoll_fd, op, fd, &ep_event);
     ASSERT_M(ep_ctl_res == 0, "IOManager::cancelEvent | epoll_ctl failed | epfd=" + std::to_string(m_epoll_fd));
 
-    fd_ctx->m_events = new_event;
-
-    auto& event_ctx  = fd_ctx->getEventContext(event);
+    // triggerEventContext 会从 m_events 中移除该事件
     fd_ctx->triggerEventContext(event);
     --m_pending_event_count;
 
@@ -226,14 +256,10 @@ bool IOManager::cancelEvent(int fd, EventType event)
 
 bool IOManager::cancelAllEvent(int fd)
 {
-    FdContext* fd_ctx = nullptr;
+    FdContext* fd_ctx = getFdContext(fd, false);
+    if (!fd_ctx)
     {
-        MutexType::ReadLock lock(&m_mutex);
-        if (m_fd_context_list.size() <= fd)
-        {
-            return false;
-        }
-        fd_ctx = m_fd_context_list[fd].get();
+        return false;
     }
     FdContext::MutexType::Lock lock(&fd_ctx->m_mutex);
 
@@ -258,11 +284,28 @@ bool IOManager::cancelAllEvent(int fd)
         --m_pending_event_count;
     }
 
+    if (fd_ctx->m_events & EventType::ERROR)
+    {
+        fd_ctx->triggerEventContext(EventType::ERROR);
+        --m_pending_event_count;
+    }
+
     fd_ctx->m_events = EventType::NONE;
 
     return true;
 }
 
+bool IOManager::hasEvent(int fd, EventType event)
+{
+    FdContext* fd_ctx = getFdContext(fd, false);
+    if (!fd_ctx)
+    {
+        return false;
+    }
+    FdContext::MutexType::Lock lock(&fd_ctx->m_mutex);
+    return fd_ctx->m_events & event;
+}
+
 IOManager* IOManager::GetThis()
 {
     return dynamic_cast<IOManager*>(Scheduler::GetThis());
@@ -270,11 +313,12 @@ IOManager* IOManager::GetThis()
 
 void IOManager::tickle()
 {
-    if (hasIdleThreads())
+    // 只有阻塞在 epoll_wait 中的线程需要唤醒
+    if (!hasIdleThreads())
     {
         return;
     }
-    int rt = ::write(m_tickle_fds[1], "T", 1);
+    int rt = write_f(m_tickle_fds[1], "T", 1);
     ASSERT(rt == 1);
 }
 
@@ -316,7 +360,8 @@ void IOManager::idle()
         do
         {
             // 阻塞等待 epoll_wait 返回结果，若超时中断，下镒继续重试
-            rt = ::epoll_wait(m_epoll_fd, ep_events, 64, next_timeout);
+            // epoll_wait 已被 hook，这里必须调用原始函数
+            rt = epoll_wait_f(m_epoll_fd, ep_events, 64, next_timeout);
             if (rt < 0 && errno == EINTR)
             {
                 // continue
@@ -347,7 +392,7 @@ void IOManager::idle()
                 // 将来自主线程的消息读取干净
                 while (true)
                 {
-                    int status = ::read(event.data.fd, &dummy, 1);
+                    int status = read_f(event.data.fd, &dummy, 1);
                     if (status == 0 || status == -1)
                     {
                         break;
@@ -357,8 +402,17 @@ void IOManager::idle()
             }
 
             // 处理非主线程的消息
-            auto fd_ctx = static_cast<FdContext*>(event.data.ptr);
+            FdContext* fd_ctx = getFdContext(event.data.fd, false);
+            if (!fd_ctx)
+            {
+                continue;
+            }
             FdContext::MutexType::Lock lock(&fd_ctx->m_mutex);
+            // 注册之后 fd 的事件被全部移除（如 close）又重新注册，这是旧注册的事件
+            if ((uint32_t)(event.data.u64 >> 32) != fd_ctx->m_generation)
+            {
+                continue;
+            }
             // 如果该事件 fd 出现错误或已经失效（中断）
             if (event.events & (EPOLLERR | EPOLLHUP))
             {
@@ -375,9 +429,15 @@ void IOManager::idle()
             {
                 real_events |= EventType::WRITE;
             }
+            if (event.events & EPOLLERR)
+            {
+                real_events |= EventType::ERROR;
+            }
 
+            // 只处理 fd 上注册过的事件，EPOLLERR/EPOLLHUP 会把读写都置上
+            real_events &= fd_ctx->m_events;
             // fd 中指定的事件已经被触发并处理，不做操作了
-            if ((fd_ctx->m_events & real_events) == EventType::NONE)
+            if (real_events == EventType::NONE)
             {
                 continue;
             }
@@ -387,7 +447,7 @@ void IOManager::idle()
             int op          = left_events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
             int new_events  = EPOLLET | left_events;
             epoll_event ep_event{};
-            ep_event.data.ptr = fd_ctx;
+            ep_event.data.u64 = MakeEventData(fd_ctx->m_fd, fd_ctx->m_generation);
             ep_event.events   = EPOLLET | new_events;
             int rt2           = ::epoll_ctl(m_epoll_fd, op, fd_ctx->m_fd, &ep_event);
             // epoll_ctl 执行失败，打印日志，不做操作了
@@ -409,6 +469,11 @@ void IOManager::idle()
                 fd_ctx->triggerEventContext(EventType::WRITE);
                 --m_pending_event_count;
             }
+            if (real_events & EventType::ERROR)
+            {
+                fd_ctx->triggerEventContext(EventType::ERROR);
+                --m_pending_event_count;
+            }
         }
 
         // 让出当前线程的执行权，给调度器执行排队等待的协程
@@ -433,6 +498,8 @@ IOManager::FdContext::EventContext& IOManager::FdContext::getEventContext(EventT
             return m_read;
         case EventType::WRITE:
             return m_write;
+        case EventType::ERROR:
+            return m_error;
 
         default:
             ASSERT_M(false, "event type not found | " + event);
@@ -443,6 +510,7 @@ bool IOManager::FdContext::resetEventContext(EventContext& event_ctx)
 {
     event_ctx.m_scheduler = nullptr;
     event_ctx.m_callback  = nullptr;
+    event_ctx.m_token     = nullptr;
     event_ctx.m_fiber.reset();
     return true;
 }
@@ -465,6 +533,7 @@ bool IOManager::FdContext::triggerEventContext(EventType event)
         event_ctx.m_scheduler->schedule(std::move(event_ctx.m_fiber));
     }
     event_ctx.m_scheduler = nullptr;
+    event_ctx.m_token     = nullptr;
     return true;
 }
 
@@ -0,0 +1,198 @@
+#include "ip_trie.h"
+
+#include <arpa/inet.h>
+
+#include "config.h"
+#include "log.h"
+
+namespace trycle
+{
+
+static auto g_logger = GET_LOGGER("system");
+
+static auto g_acl_allow         = Config::lookUp<std::vector<std::string>>("acl.allow", {}, "allowed cidr list");
+static auto g_acl_deny          = Config::lookUp<std::vector<std::string>>("acl.deny", {}, "denied cidr list");
+static auto g_acl_default_allow = Config::lookUp<bool>("acl.default_allow", true, "allow addresses matching no acl rule");
+
+/**
+ * ============================================================================
+ * IpKey 类的实现
+ * ============================================================================
+ */
+bool IpKey::FromSockAddr(const SockAddr& addr, IpKey& key)
+{
+    if (addr.isV4())
+    {
+        memset(key.bytes, 0, 10);
+        key.bytes[10] = 0xff;
+        key.bytes[11] = 0xff;
+        memcpy(key.bytes + 12, &addr.v4().sin_addr, 4);
+        return true;
+    }
+    if (addr.isV6())
+    {
+        memcpy(key.bytes, &addr.v6().sin6_addr, 16);
+        return true;
+    }
+    return false;
+}
+
+bool IpKey::ParseCidr(const std::string& cidr, IpKey& key, uint8_t& prefix_len)
+{
+    size_t slash     = cidr.find('/');
+    std::string host = cidr.substr(0, slash);
+    int len          = -1;
+    if (slash != std::string::npos)
+    {
+        std::string bits = cidr.substr(slash + 1);
+        if (bits.empty() || bits.size() > 3 || bits.find_first_not_of("0123456789") != std::string::npos)
+        {
+            return false;
+        }
+        len = atoi(bits.c_str());
+    }
+
+    SockAddr addr;
+    if (!SockAddr::Parse(host.find(':') != std::string::npos ? "[" + host + "]" : host, addr))
+    {
+        return false;
+    }
+    int max_len = addr.isV4() ? 32 : 128;
+    if (len > max_len)
+    {
+        return false;
+    }
+    FromSockAddr(addr, key);
+    prefix_len = (len < 0 ? max_len : len) + (addr.isV4() ? 96 : 0);
+    key.mask(prefix_len);
+    return true;
+}
+
+void IpKey::mask(uint32_t prefix_len)
+{
+    if (prefix_len >= 128)
+    {
+        return;
+    }
+    uint32_t i = prefix_len >> 3;
+    bytes[i] &= (uint8_t)(0xff00 >> (prefix_len & 7));
+    memset(bytes + i + 1, 0, 15 - i);
+}
+
+bool IpKey::matches(const IpKey& other, uint32_t prefix_len) const
+{
+    uint32_t full = prefix_len >> 3;
+    if (memcmp(bytes, other.bytes, full) != 0)
+    {
+        return false;
+    }
+    uint32_t rest = prefix_len & 7;
+    if (rest == 0)
+    {
+        return true;
+    }
+    uint8_t m = (uint8_t)(0xff00 >> rest);
+    return (bytes[full] & m) == (other.bytes[full] & m);
+}
+
+uint32_t IpKey::commonPrefix(const IpKey& other, uint32_t limit) const
+{
+    uint32_t i = 0;
+    while (i < limit)
+    {
+        uint8_t diff = bytes[i >> 3] ^ other.bytes[i >> 3];
+        if (diff == 0)
+        {
+            i += 8;
+            continue;
+        }
+        i += __builtin_clz((uint32_t)diff) - 24;
+        break;
+    }
+    return std::min(i, limit);
+}
+
+/**
+ * ============================================================================
+ * IpAcl 类的实现
+ * ============================================================================
+ */
+IpAcl::IpAcl()
+    : m_table(std::make_shared<Table>())
+{
+}
+
+bool IpAcl::load(const std::vector<std::string>& allow, const std::vector<std::string>& deny,
+                 bool default_allow, std::string* error)
+{
+    auto table           = std::make_shared<Table>();
+    table->default_allow = default_allow;
+    // 先插入 allow 再插入 deny，同一前缀以 deny 为准
+    const std::vector<std::string>* lists[] = {&allow, &deny};
+    for (int i = 0; i < 2; ++i)
+    {
+        for (auto& cidr : *lists[i])
+        {
+            IpKey key;
+            uint8_t prefix_len = 0;
+            if (!IpKey::ParseCidr(cidr, key, prefix_len))
+            {
+                LOG_FMT_ERROR(g_logger, "IpAcl::load invalid cidr | %s", cidr.c_str());
+                if (error)
+                {
+                    *error = cidr;
+                }
+                return false;
+            }
+            table->trie.insert(key, prefix_len, i == 0);
+        }
+    }
+    std::atomic_store(&m_table, std::shared_ptr<const Table>(table));
+    return true;
+}
+
+bool IpAcl::isAllowed(const SockAddr& addr) const
+{
+    auto table = std::atomic_load(&m_table);
+    IpKey key;
+    if (!IpKey::FromSockAddr(addr, key))
+    {
+        return table->default_allow;
+    }
+    const bool* allow = table->trie.lookup(key);
+    return allow ? *allow : table->default_allow;
+}
+
+size_t IpAcl::size() const
+{
+    return std::atomic_load(&m_table)->trie.size();
+}
+
+// 启动时从配置加载 IpAclMgr，配置变更时整表替换
+// 监听回调在新值写入之前调用，变更的那一项要用回调参数里的新值
+struct IpAclIniter
+{
+    IpAclIniter()
+    {
+        IpAclMgr::GetSingleton()->load(g_acl_allow->getVal(), g_acl_deny->getVal(), g_acl_default_allow->getVal());
+        g_acl_allow->add_listener(
+            [](const std::vector<std::string>& old_val, const std::vector<std::string>& new_val)
+            {
+                IpAclMgr::GetSingleton()->load(new_val, g_acl_deny->getVal(), g_acl_default_allow->getVal());
+            });
+        g_acl_deny->add_listener(
+            [](const std::vector<std::string>& old_val, const std::vector<std::string>& new_val)
+            {
+                IpAclMgr::GetSingleton()->load(g_acl_allow->getVal(), new_val, g_acl_default_allow->getVal());
+            });
+        g_acl_default_allow->add_listener(
+            [](const bool& old_val, const bool& new_val)
+            {
+                IpAclMgr::GetSingleton()->load(g_acl_allow->getVal(), g_acl_deny->getVal(), new_val);
+            });
+    }
+};
+
+static IpAclIniter s_ip_acl_initer;
+
+} // namespace trycle
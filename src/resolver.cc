@@ -0,0 +1,256 @@
+#include "resolver.h"
+
+#include <netdb.h>
+#include <string.h>
+
+#include "config.h"
+#include "log.h"
+#include "scheduler.h"
+#include "util.h"
+
+namespace trycle
+{
+
+static auto g_logger = GET_LOGGER("system");
+
+static auto g_dns_cache_ttl_ms          = Config::lookUp<uint64_t>("dns.cache.ttl_ms", 60000, "dns cache ttl ms");
+static auto g_dns_cache_negative_ttl_ms = Config::lookUp<uint64_t>("dns.cache.negative_ttl_ms", 5000, "dns negative cache ttl ms");
+static auto g_dns_resolver_threads      = Config::lookUp<size_t>("dns.resolver.threads", 2, "dns resolver thread count");
+
+// 单个分片超过这个数量时，写入前清理过期的条目
+static const size_t SHARD_SWEEP_SIZE = 1024;
+
+/**
+ * ============================================================================
+ * Resolver 类的实现
+ * ============================================================================
+ */
+Resolver::Resolver()
+{
+    size_t count = std::max<size_t>(1, g_dns_resolver_threads->getVal());
+    for (size_t i = 0; i < count; ++i)
+    {
+        m_threads.push_back(std::make_shared<Thread>("resolver_" + std::to_string(i),
+                                                     std::bind(&Resolver::run, this)));
+    }
+}
+
+Resolver::~Resolver()
+{
+    {
+        MutexType::Lock lock(&m_queue_mutex);
+        m_stopping = true;
+    }
+    for (size_t i = 0; i < m_threads.size(); ++i)
+    {
+        m_queue_sem.notify();
+    }
+    for (auto& thread : m_threads)
+    {
+        thread->join();
+    }
+}
+
+Resolver::Shard& Resolver::getShard(const std::string& key)
+{
+    return m_shards[std::hash<std::string>()(key) % SHARD_COUNT];
+}
+
+int Resolver::resolve(std::vector<Address::ptr>& result, const std::string& node, const std::string& service,
+                      int family, int type, int protocol)
+{
+    auto query      = std::make_shared<Query>();
+    query->key      = node + "|" + service + "|" + std::to_string(family) + "|" + std::to_string(type) + "|" + std::to_string(protocol);
+    query->node     = node;
+    query->service  = service;
+    query->family   = family;
+    query->type     = type;
+    query->protocol = protocol;
+
+    Shard& shard         = getShard(query->key);
+    Scheduler* scheduler = Scheduler::GetThis();
+    Result::ptr cached;
+    Query::ptr inflight;
+    {
+        MutexType::Lock lock(&shard.mutex);
+        auto it = shard.entries.find(query->key);
+        if (it != shard.entries.end() && it->second.result && GetCurrentMs() < it->second.expire_ms)
+        {
+            cached = it->second.result;
+        }
+        else if (scheduler)
+        {
+            Entry& entry = shard.entries[query->key];
+            if (entry.query)
+            {
+                // 已经有协程在查同一个 key，挂到它上面等结果
+                inflight = entry.query;
+                ++m_coalesced_count;
+            }
+            else
+            {
+                entry.query = query;
+                inflight    = query;
+                ++m_miss_count;
+            }
+            inflight->waiters.push_back(std::make_pair(scheduler, Fiber::GetThis()));
+            // 由解析线程唤醒，等待期间调度器不能停止
+            scheduler->addExternalWait();
+        }
+    }
+
+    if (cached)
+    {
+        ++m_hit_count;
+    }
+    else if (inflight)
+    {
+        if (inflight == query)
+        {
+            {
+                MutexType::Lock lock(&m_queue_mutex);
+                m_queue.push_back(query);
+            }
+            m_queue_sem.notify();
+        }
+        // 解析线程写入结果后唤醒
+        Fiber::YieldToHold();
+        cached = inflight->result;
+    }
+    else
+    {
+        // 不在协程中，直接在当前线程解析
+        ++m_miss_count;
+        cached = DoLookup(*query);
+        MutexType::Lock lock(&shard.mutex);
+        store(shard, *query, cached);
+    }
+
+    for (auto& addr : cached->addrs)
+    {
+        result.push_back(Address::Create(addr->getAddr(), addr->getAddrLen()));
+    }
+    return cached->error;
+}
+
+void Resolver::clear()
+{
+    for (auto& shard : m_shards)
+    {
+        MutexType::Lock lock(&shard.mutex);
+        for (auto it = shard.entries.begin(); it != shard.entries.end();)
+        {
+            if (it->second.query)
+            {
+                it->second.result.reset();
+                ++it;
+            }
+            else
+            {
+                it = shard.entries.erase(it);
+            }
+        }
+    }
+}
+
+Resolver::Result::ptr Resolver::DoLookup(const Query& query)
+{
+    addrinfo hints, *results = nullptr;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = query.family;
+    hints.ai_socktype = query.type;
+    hints.ai_protocol = query.protocol;
+
+    auto result   = std::make_shared<Result>();
+    result->error = getaddrinfo(query.node.c_str(), query.service.empty() ? nullptr : query.service.c_str(),
+                                &hints, &results);
+    if (result->error)
+    {
+        return result;
+    }
+    for (addrinfo* next = results; next; next = next->ai_next)
+    {
+        result->addrs.push_back(Address::Create(next->ai_addr, next->ai_addrlen));
+    }
+    freeaddrinfo(results);
+    return result;
+}
+
+void Resolver::store(Shard& shard, const Query& query, const Result::ptr& result)
+{
+    uint64_t now = GetCurrentMs();
+    if (shard.entries.size() > SHARD_SWEEP_SIZE)
+    {
+        for (auto it = shard.entries.begin(); it != shard.entries.end();)
+        {
+            if (!it->second.query && it->second.expire_ms <= now)
+            {
+                it = shard.entries.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    // 临时错误不缓存，下次重新查询
+    int error = result->error;
+    if (error == EAI_AGAIN || error == EAI_SYSTEM || error == EAI_MEMORY)
+    {
+        return;
+    }
+    Entry& entry    = shard.entries[query.key];
+    entry.result    = result;
+    entry.expire_ms = now + (error ? g_dns_cache_negative_ttl_ms->getVal() : g_dns_cache_ttl_ms->getVal());
+}
+
+void Resolver::run()
+{
+    while (true)
+    {
+        m_queue_sem.wait();
+        Query::ptr query;
+        {
+            MutexType::Lock lock(&m_queue_mutex);
+            if (m_stopping)
+            {
+                return;
+            }
+            if (m_queue.empty())
+            {
+                continue;
+            }
+            query = m_queue.front();
+            m_queue.pop_front();
+        }
+
+        Result::ptr result = DoLookup(*query);
+        if (result->error)
+        {
+            LOG_FMT_DEBUG(g_logger, "Resolver lookup failed | node=%s, service=%s, error=%d, errstr=%s",
+                          query->node.c_str(), query->service.c_str(), result->error, gai_strerror(result->error));
+        }
+
+        std::vector<std::pair<Scheduler*, Fiber::ptr>> waiters;
+        {
+            Shard& shard = getShard(query->key);
+            MutexType::Lock lock(&shard.mutex);
+            store(shard, *query, result);
+            Entry& entry = shard.entries[query->key];
+            if (entry.query == query)
+            {
+                entry.query.reset();
+            }
+            query->result = result;
+            waiters.swap(query->waiters);
+        }
+        for (auto& waiter : waiters)
+        {
+            waiter.first->schedule(waiter.second);
+            waiter.first->removeExternalWait();
+        }
+    }
+}
+
+} // namespace trycle
@@ -0,0 +1,276 @@
+#include "rpc.h"
+
+#include <stdexcept>
+
+#include "config.h"
+#include "endianx.h"
+#include "iomanager.h"
+#include "log.h"
+#include "macro.h"
+#include "util.h"
+
+namespace trycle
+{
+namespace rpc
+{
+
+static auto g_logger = GET_LOGGER("system");
+
+static auto g_rpc_max_frame_size = Config::lookUp<uint32_t>("rpc.max_frame_size", 16 * 1024 * 1024, "rpc max frame size");
+
+static uint32_t s_rpc_max_frame_size = 16 * 1024 * 1024;
+
+namespace
+{
+struct RpcIniter
+{
+    RpcIniter()
+    {
+        s_rpc_max_frame_size = g_rpc_max_frame_size->getVal();
+        g_rpc_max_frame_size->add_listener([](const uint32_t& old_val, const uint32_t& new_val)
+                                           { s_rpc_max_frame_size = new_val; });
+    }
+};
+static RpcIniter _init;
+} // namespace
+
+// length 之后至少有 type 和 seq
+static const uint32_t MIN_FRAME_SIZE = 1 + 4;
+
+const char* RpcStatusToString(RpcStatus s)
+{
+    switch (s)
+    {
+#define XX(code, name, msg) \
+    case RpcStatus::name:   \
+        return #msg;
+        RPC_STATUS_MAP(XX);
+#undef XX
+        default:
+            return "<unknown>";
+    }
+}
+
+/**
+ * ============================================================================
+ * RpcFrame 类的实现
+ * ============================================================================
+ */
+uint32_t RpcFrame::GetMaxFrameSize()
+{
+    return s_rpc_max_frame_size;
+}
+
+void RpcFrame::encode(IOBuffer& out) const
+{
+    ByteArray ba;
+    ba.writeFuint8(type);
+    ba.writeFuint32(seq);
+    if (type == REQUEST)
+    {
+        ba.writeStringVint(method);
+    }
+    else
+    {
+        ba.writeInt32((int32_t)status);
+    }
+    ba.writeStringWithoutLength(body);
+
+    uint32_t length = byteswapOnLittleEndian((uint32_t)ba.getSize());
+    ba.getBuffer().prepend(&length, sizeof(length));
+    out.splice(ba.getBuffer());
+}
+
+RpcFrame::DecodeResult RpcFrame::decode(ByteArray& in)
+{
+    if (in.getSize() < sizeof(uint32_t))
+    {
+        return INCOMPLETE;
+    }
+    uint32_t length;
+    in.getBuffer().copyOut(&length, sizeof(length));
+    length = byteswapOnLittleEndian(length);
+    if (length < MIN_FRAME_SIZE || length > s_rpc_max_frame_size)
+    {
+        LOG_FMT_ERROR(g_logger, "RpcFrame::decode invalid length | %u", length);
+        return ERROR;
+    }
+    if (in.getSize() < sizeof(uint32_t) + length)
+    {
+        return INCOMPLETE;
+    }
+    in.getBuffer().consume(sizeof(uint32_t));
+
+    // 帧结束时 in 中剩下的字节数
+    size_t rest = in.getSize() - length;
+    try
+    {
+        type = in.readFuint8();
+        seq  = in.readFuint32();
+        if (type == REQUEST)
+        {
+            method = in.readStringVint();
+            status = RpcStatus::OK;
+        }
+        else if (type == RESPONSE)
+        {
+            method.clear();
+            status = (RpcStatus)in.readInt32();
+        }
+        else
+        {
+            LOG_FMT_ERROR(g_logger, "RpcFrame::decode invalid type | %u", (uint32_t)type);
+            return ERROR;
+        }
+    }
+    catch (std::exception& e)
+    {
+        LOG_FMT_ERROR(g_logger, "RpcFrame::decode malformed frame | %s", e.what());
+        return ERROR;
+    }
+    // 头部字段越过了帧尾
+    if (in.getSize() < rest)
+    {
+        return ERROR;
+    }
+    body.resize(in.getSize() - rest);
+    if (!body.empty())
+    {
+        in.read(&body[0], body.size());
+    }
+    return DONE;
+}
+
+/**
+ * ============================================================================
+ * RpcConnection 类的实现
+ * ============================================================================
+ */
+RpcConnection::RpcConnection(Socket::ptr sock)
+    : m_sock(sock), m_iom(IOManager::GetThis()), m_thread(GetThreadId())
+{
+    ASSERT_M(m_iom, "RpcConnection must be created in an IOManager");
+}
+
+bool RpcConnection::recv(RpcFrame& frame)
+{
+    while (true)
+    {
+        switch (frame.decode(m_in))
+        {
+            case RpcFrame::DONE:
+                return true;
+            case RpcFrame::ERROR:
+                return false;
+            default:
+                break;
+        }
+        if (m_in.readFd(m_sock->getSocket()) <= 0)
+        {
+            return false;
+        }
+    }
+}
+
+bool RpcConnection::send(const RpcFrame& frame)
+{
+    IOBuffer buf;
+    frame.encode(buf);
+
+    bool schedule = false;
+    {
+        MutexType::Lock lock(&m_mutex);
+        if (m_closed)
+        {
+            return false;
+        }
+        m_out.splice(buf);
+        ++m_sent_frames;
+        if (!m_flushing)
+        {
+            m_flushing = true;
+            schedule   = true;
+        }
+    }
+    if (schedule)
+    {
+        // 排在当前已就绪的协程之后，它们发送的帧一起写出
+        m_iom->schedule(std::bind(&RpcConnection::flush, shared_from_this()), m_thread);
+    }
+    return true;
+}
+
+void RpcConnection::flush()
+{
+    IOBuffer batch;
+    Fiber::ptr waiter;
+    while (true)
+    {
+        {
+            MutexType::Lock lock(&m_mutex);
+            batch.splice(m_out);
+            if (batch.empty() || m_closed)
+            {
+                m_flushing = false;
+                waiter.swap(m_flush_waiter);
+                break;
+            }
+        }
+        while (!batch.empty())
+        {
+            ssize_t n = batch.writeFd(m_sock->getSocket());
+            if (n <= 0)
+            {
+                LOG_FMT_DEBUG(g_logger, "RpcConnection::flush writev fail | %s, errno=%d",
+                              m_sock->toString().c_str(), errno);
+                // 关闭后下一轮看到 m_closed 退出
+                close();
+                break;
+            }
+            MutexType::Lock lock(&m_mutex);
+            ++m_writev_count;
+        }
+    }
+    if (waiter)
+    {
+        m_iom->schedule(waiter);
+    }
+}
+
+void RpcConnection::waitFlushed()
+{
+    {
+        MutexType::Lock lock(&m_mutex);
+        if (!m_flushing)
+        {
+            return;
+        }
+        m_flush_waiter = Fiber::GetThis();
+    }
+    Fiber::YieldToHold();
+}
+
+void RpcConnection::close()
+{
+    {
+        MutexType::Lock lock(&m_mutex);
+        if (m_closed)
+        {
+            return;
+        }
+        m_closed = true;
+        m_out.clear();
+    }
+    // 唤醒阻塞在 readv / writev 上的协程
+    m_sock->cancelAll();
+    m_sock->close();
+}
+
+bool RpcConnection::isClosed()
+{
+    MutexType::Lock lock(&m_mutex);
+    return m_closed;
+}
+
+} // namespace rpc
+} // namespace trycle
@@ -0,0 +1,186 @@
+#include "rpc_client.h"
+
+#include <vector>
+
+#include "config.h"
+#include "iomanager.h"
+#include "log.h"
+#include "macro.h"
+#include "util.h"
+
+namespace trycle
+{
+namespace rpc
+{
+
+static auto g_logger = GET_LOGGER("system");
+
+static auto g_rpc_client_timeout = Config::lookUp<uint64_t>("rpc.client.timeout_ms", 3000, "rpc client default call timeout ms");
+
+/**
+ * ============================================================================
+ * RpcClient 类的实现
+ * ============================================================================
+ */
+RpcClient::ptr RpcClient::Create(Socket::ptr sock)
+{
+    IOManager* iom = IOManager::GetThis();
+    ASSERT_M(iom, "RpcClient must be created in an IOManager");
+    RpcClient::ptr client(new RpcClient(sock));
+    iom->schedule(std::bind(&RpcClient::RecvLoop, std::weak_ptr<RpcClient>(client), client->m_conn));
+    return client;
+}
+
+RpcClient::ptr RpcClient::Connect(Address::ptr addr, uint64_t timeout_ms)
+{
+    auto sock = Socket::CreateTCP(addr);
+    if (!sock->connect(addr, timeout_ms))
+    {
+        return nullptr;
+    }
+    return Create(sock);
+}
+
+RpcClient::RpcClient(Socket::ptr sock)
+    : m_conn(std::make_shared<RpcConnection>(sock))
+{
+}
+
+RpcClient::~RpcClient()
+{
+    close();
+}
+
+void RpcClient::RecvLoop(std::weak_ptr<RpcClient> weak, RpcConnection::ptr conn)
+{
+    RpcFrame frame;
+    while (conn->recv(frame))
+    {
+        auto client = weak.lock();
+        if (!client)
+        {
+            break;
+        }
+        if (frame.type != RpcFrame::RESPONSE)
+        {
+            LOG_FMT_ERROR(g_logger, "RpcClient unexpected frame | type=%u", (uint32_t)frame.type);
+            break;
+        }
+        client->complete(frame.seq, frame.status, &frame.body);
+    }
+    conn->close();
+    auto client = weak.lock();
+    if (client)
+    {
+        client->failAll(RpcStatus::CLOSED);
+    }
+}
+
+RpcStatus RpcClient::call(const std::string& method, const std::string& request, std::string& response, uint64_t timeout_ms)
+{
+    IOManager* iom = IOManager::GetThis();
+    ASSERT_M(iom, "RpcClient::call must be called in an IOManager");
+    if (timeout_ms == (uint64_t)-1)
+    {
+        timeout_ms = g_rpc_client_timeout->getVal();
+    }
+
+    auto call       = std::make_shared<Call>();
+    call->scheduler = iom;
+    call->fiber     = Fiber::GetThis();
+
+    RpcFrame frame;
+    frame.type   = RpcFrame::REQUEST;
+    frame.method = method;
+    frame.body   = request;
+    {
+        MutexType::Lock lock(&m_mutex);
+        if (m_closed)
+        {
+            return RpcStatus::CLOSED;
+        }
+        frame.seq = ++m_seq;
+        m_calls.emplace(frame.seq, call);
+    }
+    if (!m_conn->send(frame))
+    {
+        MutexType::Lock lock(&m_mutex);
+        m_calls.erase(frame.seq);
+        return RpcStatus::CLOSED;
+    }
+
+    std::weak_ptr<RpcClient> weak(shared_from_this());
+    uint32_t seq     = frame.seq;
+    Timer::ptr timer = iom->addTimer(timeout_ms, [weak, seq]()
+                                     {
+                                         auto client = weak.lock();
+                                         if (client)
+                                         {
+                                             client->complete(seq, RpcStatus::TIMEOUT, nullptr);
+                                         } },
+                                     false);
+    // 由接收协程、定时器或 failAll 唤醒
+    Fiber::YieldToHold();
+    timer->cancel();
+
+    response.swap(call->body);
+    return call->status;
+}
+
+bool RpcClient::complete(uint32_t seq, RpcStatus status, std::string* body)
+{
+    Call::ptr call;
+    {
+        MutexType::Lock lock(&m_mutex);
+        auto it = m_calls.find(seq);
+        if (it == m_calls.end())
+        {
+            return false;
+        }
+        call = it->second;
+        m_calls.erase(it);
+    }
+    call->status = status;
+    if (body)
+    {
+        call->body.swap(*body);
+    }
+    call->scheduler->schedule(std::move(call->fiber));
+    return true;
+}
+
+void RpcClient::failAll(RpcStatus status)
+{
+    std::unordered_map<uint32_t, Call::ptr> calls;
+    {
+        MutexType::Lock lock(&m_mutex);
+        m_closed = true;
+        calls.swap(m_calls);
+    }
+    for (auto& it : calls)
+    {
+        it.second->status = status;
+        it.second->scheduler->schedule(std::move(it.second->fiber));
+    }
+}
+
+void RpcClient::close()
+{
+    m_conn->close();
+    failAll(RpcStatus::CLOSED);
+}
+
+bool RpcClient::isClosed()
+{
+    MutexType::Lock lock(&m_mutex);
+    return m_closed;
+}
+
+size_t RpcClient::getPendingCount()
+{
+    MutexType::Lock lock(&m_mutex);
+    return m_calls.size();
+}
+
+} // namespace rpc
+} // namespace trycle
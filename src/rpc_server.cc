@@ -0,0 +1,141 @@
+#include "rpc_server.h"
+
+#include <atomic>
+#include <exception>
+
+#include "iomanager.h"
+#include "log.h"
+#include "util.h"
+
+namespace trycle
+{
+namespace rpc
+{
+
+static auto g_logger = GET_LOGGER("system");
+
+/**
+ * ============================================================================
+ * RpcServer 类的实现
+ * ============================================================================
+ */
+RpcServer::RpcServer(IOManager* worker, IOManager* acceptor)
+    : RpcServer(std::vector<IOManager*>{worker}, std::vector<IOManager*>{acceptor})
+{
+}
+
+RpcServer::RpcServer(const std::vector<IOManager*>& workers, const std::vector<IOManager*>& acceptors)
+    : TcpServer(workers, acceptors)
+{
+}
+
+void RpcServer::registerMethod(const std::string& name, Method method)
+{
+    m_methods[name] = method;
+}
+
+/**
+ * 一个连接上还没有发出响应的请求，连接在它们都处理完之后才关闭
+ * 协程被 IOManager 唤醒后可能在任意工作线程上继续执行，处理协程和 handleClient 会并发访问：
+ * 计数是原子变量，等待者在锁内登记；计数减到 0 的一方加锁取走等待者，不会漏掉唤醒
+ */
+struct PendingRequests
+{
+    typedef std::shared_ptr<PendingRequests> ptr;
+
+    void add() { ++count; }
+
+    void done()
+    {
+        if (--count != 0)
+        {
+            return;
+        }
+        Fiber::ptr fiber;
+        {
+            Mutex::Lock lock(&mutex);
+            fiber.swap(waiter);
+        }
+        if (fiber)
+        {
+            IOManager::GetThis()->schedule(std::move(fiber));
+        }
+    }
+
+    // 还有请求没有处理完时挂起，直到最后一个请求 done
+    void wait()
+    {
+        Mutex::Lock lock(&mutex);
+        if (count == 0)
+        {
+            return;
+        }
+        waiter = Fiber::GetThis();
+        lock.unlock();
+        Fiber::YieldToHold();
+    }
+
+    std::atomic<uint32_t> count{0};
+    Mutex mutex;
+    Fiber::ptr waiter;
+};
+
+// 在单独的协程中执行一个请求并发送响应
+static void process(RpcConnection::ptr conn, RpcServer::Method method, std::shared_ptr<RpcFrame> frame,
+                    PendingRequests::ptr pending)
+{
+    RpcFrame response;
+    response.type = RpcFrame::RESPONSE;
+    response.seq  = frame->seq;
+    try
+    {
+        response.status = method(frame->body, response.body);
+    }
+    catch (std::exception& e)
+    {
+        LOG_FMT_ERROR(g_logger, "RpcServer method exception | method=%s, what=%s", frame->method.c_str(), e.what());
+        response.status = RpcStatus::INTERNAL_ERROR;
+        response.body.clear();
+    }
+    conn->send(response);
+    pending->done();
+}
+
+void RpcServer::handleClient(Socket::ptr client)
+{
+    auto conn       = std::make_shared<RpcConnection>(client);
+    auto pending    = std::make_shared<PendingRequests>();
+    IOManager* iom  = IOManager::GetThis();
+    uint32_t thread = GetThreadId();
+    auto frame      = std::make_shared<RpcFrame>();
+    while (conn->recv(*frame))
+    {
+        if (frame->type != RpcFrame::REQUEST)
+        {
+            LOG_FMT_ERROR(g_logger, "RpcServer unexpected frame | type=%u, client=%s",
+                          (uint32_t)frame->type, client->toString().c_str());
+            break;
+        }
+        auto it = m_methods.find(frame->method);
+        if (it == m_methods.end())
+        {
+            RpcFrame response;
+            response.type   = RpcFrame::RESPONSE;
+            response.seq    = frame->seq;
+            response.status = RpcStatus::NOT_FOUND;
+            conn->send(response);
+            continue;
+        }
+        // 请求交给新协程后换一个帧对象接收下一个请求
+        pending->add();
+        iom->schedule(std::bind(&process, conn, it->second, frame, pending), thread);
+        frame = std::make_shared<RpcFrame>();
+    }
+    // 对端关闭写端后，已经收到的请求仍然要把响应写完
+    pending->wait();
+    conn->waitFlushed();
+    conn->close();
+}
+
+} // namespace rpc
+} // namespace trycle
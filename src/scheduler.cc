@@ -1,7 +1,14 @@
 #include "scheduler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "config.h"
 #include "fiber.h"
 #include "log.h"
 #include "macro.h"
+#include "slab.h"
 #include "thread.h"
 
 namespace trycle
@@ -12,10 +19,44 @@ static thread_local Fiber* t_fiber         = nullptr;
 
 static auto g_logger                       = GET_LOGGER("system");
 
+static auto g_scheduler_aging_ms           = Config::lookUp<uint64_t>("scheduler.aging_ms", 50, "queued task is promoted one priority level per aging_ms");
+
+/**
+ * ============================================================================
+ * QueueDelayHistogram 类的实现
+ * ============================================================================
+ */
+void QueueDelayHistogram::record(uint64_t delay_us)
+{
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum_us.fetch_add(delay_us, std::memory_order_relaxed);
+    uint64_t cur_max = max_us.load(std::memory_order_relaxed);
+    while (delay_us > cur_max &&
+           !max_us.compare_exchange_weak(cur_max, delay_us, std::memory_order_relaxed))
+    {
+    }
+    // 第 i 个区间为 [2^(i-1), 2^i) 微秒
+    int bucket = 0;
+    while (delay_us && bucket < BUCKETS - 1)
+    {
+        delay_us >>= 1;
+        ++bucket;
+    }
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * ============================================================================
+ * Scheduler 类的实现
+ * ============================================================================
+ */
+
 Scheduler::Scheduler(int thread_size, bool use_caller, const std::string& name)
     : m_name(name),
       m_thread_count(thread_size)
 {
+    m_aging_ns = g_scheduler_aging_ms->getVal() * 1000 * 1000;
+
     if (use_caller)
     {
         // 实例化此类的线程作为master fiber
@@ -26,7 +67,8 @@ Scheduler::Scheduler(int thread_size, bool use_caller, const std::string& name)
         ASSERT(GetThis() == nullptr);
         set_to_this();
         // 因为Scheduler::run()是实例化方法，需要用std::bind绑定调用者
-        m_root_fiber.reset(new Fiber(std::bind(&Scheduler::run, this)));
+        m_root_fiber = MakeSlabShared<Fiber>(std::bind(&Scheduler::run, this));
+        m_root_fiber->setSliceWatched(false);
 
         t_fiber          = m_root_fiber.get();
         m_root_thread_id = GetThreadId();
@@ -126,6 +168,122 @@ Fiber* Scheduler::GetMainFiber()
     return t_fiber;
 }
 
+std::vector<int> Scheduler::getThreadIds()
+{
+    MutexType::Lock lock(&m_mutex);
+    std::vector<int> ids;
+    for (auto& thread : m_threads)
+    {
+        ids.push_back(thread->get_id());
+    }
+    if (ids.empty() && m_root_thread_id != -1)
+    {
+        ids.push_back(m_root_thread_id);
+    }
+    return ids;
+}
+
+QueueDelaySnapshot Scheduler::getQueueDelay(int priority) const
+{
+    QueueDelaySnapshot snapshot;
+    if (priority < 0 || priority >= PRIORITY_COUNT)
+    {
+        return snapshot;
+    }
+    const QueueDelayHistogram& hist = m_queue_delay[priority];
+    snapshot.count                  = hist.count.load(std::memory_order_relaxed);
+    snapshot.max_us                 = hist.max_us.load(std::memory_order_relaxed);
+    if (!snapshot.count)
+    {
+        return snapshot;
+    }
+    snapshot.avg_us = hist.sum_us.load(std::memory_order_relaxed) / snapshot.count;
+
+    uint64_t p50_rank = (snapshot.count + 1) / 2;
+    uint64_t p99_rank = snapshot.count - snapshot.count / 100;
+    uint64_t seen     = 0;
+    for (int i = 0; i < QueueDelayHistogram::BUCKETS; i++)
+    {
+        seen += hist.buckets[i].load(std::memory_order_relaxed);
+        // 取区间上界，且不超过观测到的最大值
+        uint64_t upper = std::min<uint64_t>(i ? (1ull << i) - 1 : 0, snapshot.max_us);
+        if (!snapshot.p50_us && seen >= p50_rank)
+        {
+            snapshot.p50_us = upper;
+        }
+        if (seen >= p99_rank)
+        {
+            snapshot.p99_us = upper;
+            break;
+        }
+    }
+    return snapshot;
+}
+
+std::string Scheduler::dumpQueueDelay() const
+{
+    static const char* names[PRIORITY_COUNT] = {"HIGH", "NORMAL", "LOW"};
+
+    std::stringstream ss;
+    ss << std::left << std::setw(10) << "priority"
+       << std::right << std::setw(12) << "count"
+       << std::setw(12) << "avg_us"
+       << std::setw(12) << "p50_us"
+       << std::setw(12) << "p99_us"
+       << std::setw(12) << "max_us" << "\n";
+    for (int i = 0; i < PRIORITY_COUNT; i++)
+    {
+        QueueDelaySnapshot snapshot = getQueueDelay(i);
+        ss << std::left << std::setw(10) << names[i]
+           << std::right << std::setw(12) << snapshot.count
+           << std::setw(12) << snapshot.avg_us
+           << std::setw(12) << snapshot.p50_us
+           << std::setw(12) << snapshot.p99_us
+           << std::setw(12) << snapshot.max_us << "\n";
+    }
+    return ss.str();
+}
+
+std::string Scheduler::DumpTopConsumers(size_t top_n, bool by_wait)
+{
+    std::vector<FiberStatsSnapshot> stats;
+    Fiber::GetTagStats(stats);
+    std::sort(stats.begin(), stats.end(),
+              [by_wait](const FiberStatsSnapshot& lhs, const FiberStatsSnapshot& rhs)
+              {
+                  if (by_wait)
+                  {
+                      return lhs.hold_ns + lhs.ready_ns > rhs.hold_ns + rhs.ready_ns;
+                  }
+                  return lhs.run_ns > rhs.run_ns;
+              });
+    if (stats.size() > top_n)
+    {
+        stats.resize(top_n);
+    }
+
+    std::stringstream ss;
+    ss << std::left << std::setw(24) << "tag"
+       << std::right << std::setw(12) << "run_ms"
+       << std::setw(12) << "hold_ms"
+       << std::setw(12) << "ready_ms"
+       << std::setw(12) << "switches"
+       << std::setw(10) << "overruns"
+       << std::setw(10) << "fibers" << "\n";
+    ss << std::fixed << std::setprecision(3);
+    for (const auto& item : stats)
+    {
+        ss << std::left << std::setw(24) << item.tag
+           << std::right << std::setw(12) << item.run_ns / 1e6
+           << std::setw(12) << item.hold_ns / 1e6
+           << std::setw(12) << item.ready_ns / 1e6
+           << std::setw(12) << item.switches
+           << std::setw(10) << item.overruns
+           << std::setw(10) << item.fibers << "\n";
+    }
+    return ss.str();
+}
+
 void Scheduler::tickle()
 {
     LOG_DEBUG(g_logger, "Scheduler::tickle");
@@ -141,7 +299,9 @@ void Scheduler::run()
         t_fiber = Fiber::GetThis().get();
     }
 
-    Fiber::ptr idle_fiber(new Fiber(std::bind(&Scheduler::idle, this)));
+    Fiber::ptr idle_fiber = MakeSlabShared<Fiber>(std::bind(&Scheduler::idle, this));
+    idle_fiber->setTag(m_name + ".idle");
+    idle_fiber->setSliceWatched(false);
     Fiber::ptr cb_fiber;
     FiberAndThread ft;
 
@@ -153,25 +313,55 @@ void Scheduler::run()
         bool is_active = false;
         {
             MutexType::Lock lock(&m_mutex);
-            for (auto it = m_fibers.begin(); it != m_fibers.end(); ++it)
+            // 每个优先级队列取第一个可执行的任务，再按老化后的有效优先级选出一个
+            uint64_t now_ns = GetMonotonicNs();
+            int picked      = -1;
+            int64_t best    = 0;
+            std::list<FiberAndThread>::iterator picked_it;
+            for (int priority = 0; priority < PRIORITY_COUNT; priority++)
             {
-                if (it->thread != -1 && it->thread != m_root_thread_id)
+                auto& fibers = m_fibers[priority];
+                for (auto it = fibers.begin(); it != fibers.end(); ++it)
                 {
-                    tickle_me = true;
-                    continue;
-                }
-                ASSERT(it->cb || it->fiber);
+                    if (it->thread != -1 && it->thread != (int)GetThreadId())
+                    {
+                        tickle_me = true;
+                        continue;
+                    }
+                    ASSERT(it->cb || it->fiber);
 
-                if (it->fiber && it->fiber->get_state() == Fiber::EXEC)
-                {
-                    continue;
+                    // 已经 HOLD 但还没切出完的协程也要跳过，等它的上下文保存完
+                    if (it->fiber && it->fiber->isRunning())
+                    {
+                        continue;
+                    }
+
+                    // 排队每满 m_aging_ns，有效优先级提升一级
+                    int64_t effective = priority;
+                    if (m_aging_ns && now_ns > it->enqueue_ns)
+                    {
+                        effective -= (int64_t)((now_ns - it->enqueue_ns) / m_aging_ns);
+                    }
+                    if (picked == -1 || effective < best)
+                    {
+                        picked    = priority;
+                        best      = effective;
+                        picked_it = it;
+                    }
+                    break;
                 }
+            }
 
-                ft = *it;
-                m_fibers.erase(it);
+            if (picked != -1)
+            {
+                ft = *picked_it;
+                m_fibers[picked].erase(picked_it);
                 ++m_active_thread_count;
                 is_active = true;
-                break;
+                if (now_ns > ft.enqueue_ns)
+                {
+                    m_queue_delay[picked].record((now_ns - ft.enqueue_ns) / 1000);
+                }
             }
         }
 
@@ -185,14 +375,11 @@ void Scheduler::run()
             ft.fiber->swap_in();
             --m_active_thread_count;
 
+            // HOLD 的协程此时可能已经被唤醒并在其它线程上执行，不能再改它的状态
             if (ft.fiber->get_state() == Fiber::READY)
             {
                 schedule(ft.fiber);
             }
-            else if (!ft.fiber->isFinish())
-            {
-                ft.fiber->set_state(Fiber::HOLD);
-            }
             ft.reset();
         }
         else if (ft.cb)
@@ -203,8 +390,10 @@ void Scheduler::run()
             }
             else
             {
-                cb_fiber.reset(new Fiber(ft.cb));
+                cb_fiber = MakeSlabShared<Fiber>(ft.cb);
             }
+            // 函数任务的优先级交给执行它的协程，之后 IO、定时器唤醒时沿用
+            cb_fiber->setPriority(ft.priority);
 
             ft.reset();
             cb_fiber->swap_in();
@@ -215,13 +404,13 @@ void Scheduler::run()
                 schedule(cb_fiber);
                 cb_fiber.reset();
             }
-            else if (cb_fiber->isFinish())
+            // 切出时是 HOLD、随后在其它线程上执行完的协程，要等那边切出完才能复用，否则只放弃引用
+            else if (cb_fiber->isFinish() && !cb_fiber->isRunning())
             {
                 cb_fiber->reset(nullptr);
             }
             else
             {
-                cb_fiber->set_state(Fiber::HOLD);
                 cb_fiber.reset();
             }
         }
@@ -242,10 +431,6 @@ void Scheduler::run()
             ++m_idle_thread_count;
             idle_fiber->swap_in();
             --m_idle_thread_count;
-            if (!idle_fiber->isFinish())
-            {
-                idle_fiber->set_state(Fiber::HOLD);
-            }
         }
     }
 }
@@ -254,7 +439,7 @@ bool Scheduler::isStop()
 {
     // LOG_DEBUG(g_logger, "Scheduler::isStop()");
     MutexType::Lock lock(&m_mutex);
-    return m_auto_stop && m_stopping && m_active_thread_count == 0 && m_fibers.empty();
+    return m_auto_stop && m_stopping && m_active_thread_count == 0 && m_external_waits == 0 && !hasPendingFibers();
 }
 
 void Scheduler::idle()
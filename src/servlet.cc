@@ -0,0 +1,156 @@
+#include "servlet.h"
+
+#include <fnmatch.h>
+
+namespace trycle
+{
+namespace http
+{
+
+/**
+ * ============================================================================
+ * FunctionServlet 类的实现
+ * ============================================================================
+ */
+FunctionServlet::FunctionServlet(callback cb)
+    : Servlet("FunctionServlet"),
+      m_cb(cb)
+{
+}
+
+int32_t FunctionServlet::handle(HttpRequest& request, HttpResponse& response, HttpSession& session)
+{
+    return m_cb(request, response, session);
+}
+
+/**
+ * ============================================================================
+ * ServletDispatch 类的实现
+ * ============================================================================
+ */
+ServletDispatch::ServletDispatch()
+    : Servlet("ServletDispatch")
+{
+    m_default.reset(new NotFoundServlet("trycle/1.0"));
+}
+
+int32_t ServletDispatch::handle(HttpRequest& request, HttpResponse& response, HttpSession& session)
+{
+    auto slt = getMatchedServlet(request.getPath());
+    if (slt)
+    {
+        slt->handle(request, response, session);
+    }
+    return 0;
+}
+
+void ServletDispatch::addServlet(const std::string& uri, Servlet::ptr slt)
+{
+    RWMutexType::WriteLock lock(&m_mutex);
+    m_datas[uri] = slt;
+}
+
+void ServletDispatch::addServlet(const std::string& uri, FunctionServlet::callback cb)
+{
+    addServlet(uri, std::make_shared<FunctionServlet>(cb));
+}
+
+void ServletDispatch::addGlobServlet(const std::string& uri, Servlet::ptr slt)
+{
+    RWMutexType::WriteLock lock(&m_mutex);
+    for (auto it = m_globs.begin(); it != m_globs.end(); ++it)
+    {
+        if (it->first == uri)
+        {
+            it->second = slt;
+            return;
+        }
+    }
+    m_globs.push_back(std::make_pair(uri, slt));
+}
+
+void ServletDispatch::addGlobServlet(const std::string& uri, FunctionServlet::callback cb)
+{
+    addGlobServlet(uri, std::make_shared<FunctionServlet>(cb));
+}
+
+void ServletDispatch::delServlet(const std::string& uri)
+{
+    RWMutexType::WriteLock lock(&m_mutex);
+    m_datas.erase(uri);
+}
+
+void ServletDispatch::delGlobServlet(const std::string& uri)
+{
+    RWMutexType::WriteLock lock(&m_mutex);
+    for (auto it = m_globs.begin(); it != m_globs.end(); ++it)
+    {
+        if (it->first == uri)
+        {
+            m_globs.erase(it);
+            break;
+        }
+    }
+}
+
+Servlet::ptr ServletDispatch::getServlet(const std::string& uri)
+{
+    RWMutexType::ReadLock lock(&m_mutex);
+    auto it = m_datas.find(uri);
+    return it == m_datas.end() ? nullptr : it->second;
+}
+
+Servlet::ptr ServletDispatch::getGlobServlet(const std::string& uri)
+{
+    RWMutexType::ReadLock lock(&m_mutex);
+    for (auto& glob : m_globs)
+    {
+        if (glob.first == uri)
+        {
+            return glob.second;
+        }
+    }
+    return nullptr;
+}
+
+Servlet::ptr ServletDispatch::getMatchedServlet(const StringView& path)
+{
+    std::string uri = path.toString();
+    RWMutexType::ReadLock lock(&m_mutex);
+    auto it = m_datas.find(uri);
+    if (it != m_datas.end())
+    {
+        return it->second;
+    }
+    for (auto& glob : m_globs)
+    {
+        if (!fnmatch(glob.first.c_str(), uri.c_str(), 0))
+        {
+            return glob.second;
+        }
+    }
+    return m_default;
+}
+
+/**
+ * ============================================================================
+ * NotFoundServlet 类的实现
+ * ============================================================================
+ */
+NotFoundServlet::NotFoundServlet(const std::string& name)
+    : Servlet("NotFoundServlet")
+{
+    m_content = "<html><head><title>404 Not Found</title></head><body><center><h1>404 Not Found</h1></center><hr><center>" +
+                name + "</center></body></html>";
+}
+
+int32_t NotFoundServlet::handle(HttpRequest& request, HttpResponse& response, HttpSession& session)
+{
+    response.setStatus(HttpStatus::NOT_FOUND);
+    response.setHeader("content-type", "text/html");
+    response.setBody(m_content);
+    return 0;
+}
+
+} // namespace http
+} // namespace trycle
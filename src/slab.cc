@@ -0,0 +1,327 @@
+#include "slab.h"
+
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <vector>
+
+#include "thread.h"
+
+namespace trycle
+{
+
+const size_t SlabPool::GRANULE;
+const size_t SlabPool::SMALL_SIZE;
+const size_t SlabPool::LARGE_GRANULE;
+const size_t SlabPool::MAX_SIZE;
+const size_t SlabPool::SMALL_CLASS_COUNT;
+const size_t SlabPool::CLASS_COUNT;
+const size_t SlabPool::SLAB_SIZE;
+const size_t SlabPool::LARGE_SLAB_SIZE;
+
+static std::atomic<uint64_t> s_large_allocs{0};
+
+namespace
+{
+
+// slab 开头的管理信息，对象从 SLAB_HEADER_SIZE 处开始，保持 GRANULE 对齐
+static const size_t SLAB_HEADER_SIZE = 64;
+
+struct FreeNode
+{
+    FreeNode* next;
+};
+
+struct SlabCache;
+
+struct SlabHeader
+{
+    SlabCache* owner;
+};
+
+inline size_t SizeClass(size_t size)
+{
+    if (size <= SlabPool::SMALL_SIZE)
+    {
+        return size ? (size - 1) / SlabPool::GRANULE : 0;
+    }
+    return SlabPool::SMALL_CLASS_COUNT + (size - SlabPool::SMALL_SIZE - 1) / SlabPool::LARGE_GRANULE;
+}
+
+inline size_t ClassSize(size_t cls)
+{
+    if (cls < SlabPool::SMALL_CLASS_COUNT)
+    {
+        return (cls + 1) * SlabPool::GRANULE;
+    }
+    return SlabPool::SMALL_SIZE + (cls - SlabPool::SMALL_CLASS_COUNT + 1) * SlabPool::LARGE_GRANULE;
+}
+
+inline size_t ClassSlabSize(size_t cls)
+{
+    return cls < SlabPool::SMALL_CLASS_COUNT ? SlabPool::SLAB_SIZE : SlabPool::LARGE_SLAB_SIZE;
+}
+
+// 只由所属线程修改，其他线程读取统计时不需要精确
+inline void Increase(std::atomic<uint64_t>& counter)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+/**
+ * 线程缓存，local 只由持有它的线程访问，remote 由其他线程无锁地压入、持有线程整串取走
+ * 缓存不会销毁，slab 中记录的 owner 始终有效
+ */
+struct SlabCache
+{
+    FreeNode* local[SlabPool::CLASS_COUNT];
+    std::atomic<FreeNode*> remote[SlabPool::CLASS_COUNT];
+    // 最近申请的 slab 中还没有切出的部分，按需切分，不提前访问整个 slab
+    char* fresh[SlabPool::CLASS_COUNT];
+    char* fresh_end[SlabPool::CLASS_COUNT];
+
+    std::atomic<uint64_t> allocs{0};
+    std::atomic<uint64_t> frees{0};
+    std::atomic<uint64_t> remote_frees{0};
+    std::atomic<uint64_t> slabs{0};
+
+    SlabCache()
+    {
+        for (size_t i = 0; i < SlabPool::CLASS_COUNT; ++i)
+        {
+            local[i]     = nullptr;
+            fresh[i]     = nullptr;
+            fresh_end[i] = nullptr;
+            remote[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    void* allocate(size_t cls)
+    {
+        FreeNode* node = local[cls];
+        if (!node)
+        {
+            // 一次取走其他线程归还的全部对象，没有 ABA 问题
+            node = remote[cls].exchange(nullptr, std::memory_order_acquire);
+        }
+        Increase(allocs);
+        if (node)
+        {
+            local[cls] = node->next;
+            return node;
+        }
+
+        size_t size = ClassSize(cls);
+        if ((size_t)(fresh_end[cls] - fresh[cls]) < size)
+        {
+            newSlab(cls);
+        }
+        void* ptr = fresh[cls];
+        fresh[cls] += size;
+        return ptr;
+    }
+
+    void deallocate(void* ptr, size_t cls)
+    {
+        FreeNode* node = (FreeNode*)ptr;
+        node->next     = local[cls];
+        local[cls]     = node;
+        Increase(frees);
+    }
+
+    void deallocateRemote(void* ptr, size_t cls)
+    {
+        FreeNode* node = (FreeNode*)ptr;
+        node->next     = remote[cls].load(std::memory_order_relaxed);
+        while (!remote[cls].compare_exchange_weak(node->next, node,
+                                                  std::memory_order_release,
+                                                  std::memory_order_relaxed))
+        {
+        }
+        remote_frees.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 申请一个按自身大小对齐的 slab，上一个 slab 剩下不够一个对象的部分直接放弃
+    void newSlab(size_t cls)
+    {
+        size_t slab_size = ClassSlabSize(cls);
+        // 多申请一个 slab_size 再裁掉两头，得到对齐的地址；未访问的页不占用物理内存
+        char* raw = (char*)mmap(nullptr, slab_size * 2, PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (raw == MAP_FAILED)
+        {
+            throw std::bad_alloc();
+        }
+        char* base = (char*)(((uintptr_t)raw + slab_size - 1) & ~(uintptr_t)(slab_size - 1));
+        if (base != raw)
+        {
+            munmap(raw, base - raw);
+        }
+        munmap(base + slab_size, raw + slab_size - base);
+
+        ((SlabHeader*)base)->owner = this;
+        Increase(slabs);
+
+        fresh[cls]     = base + SLAB_HEADER_SIZE;
+        fresh_end[cls] = base + slab_size;
+    }
+};
+
+/**
+ * 所有线程缓存的登记表
+ * 线程退出时缓存放入 m_orphans 由新线程接管；线程退出后（如 thread_local、静态对象析构中）的分配走加锁的 m_shared
+ */
+class SlabCacheRegistry
+{
+public:
+    typedef Mutex MutexType;
+
+    SlabCache* acquire()
+    {
+        MutexType::Lock lock(&m_mutex);
+        if (!m_orphans.empty())
+        {
+            SlabCache* cache = m_orphans.back();
+            m_orphans.pop_back();
+            return cache;
+        }
+        SlabCache* cache = new SlabCache();
+        m_caches.push_back(cache);
+        return cache;
+    }
+
+    void release(SlabCache* cache)
+    {
+        MutexType::Lock lock(&m_mutex);
+        m_orphans.push_back(cache);
+    }
+
+    void* allocateShared(size_t cls)
+    {
+        MutexType::Lock lock(&m_mutex);
+        return m_shared.allocate(cls);
+    }
+
+    void getStats(SlabStats& stats)
+    {
+        MutexType::Lock lock(&m_mutex);
+        stats.caches = m_caches.size();
+        for (auto cache : m_caches)
+        {
+            AddStats(stats, cache);
+        }
+        AddStats(stats, &m_shared);
+    }
+
+private:
+    static void AddStats(SlabStats& stats, SlabCache* cache)
+    {
+        uint64_t remote_frees = cache->remote_frees.load(std::memory_order_relaxed);
+        stats.allocs += cache->allocs.load(std::memory_order_relaxed);
+        stats.frees += cache->frees.load(std::memory_order_relaxed) + remote_frees;
+        stats.remote_frees += remote_frees;
+        stats.slabs += cache->slabs.load(std::memory_order_relaxed);
+    }
+
+private:
+    MutexType m_mutex;
+    std::vector<SlabCache*> m_caches;
+    std::vector<SlabCache*> m_orphans;
+    SlabCache m_shared;
+};
+
+// 不析构：静态对象析构时仍可能分配、归还
+SlabCacheRegistry* GetRegistry()
+{
+    static SlabCacheRegistry* registry = new SlabCacheRegistry();
+    return registry;
+}
+
+static thread_local SlabCache* t_cache  = nullptr;
+static thread_local bool t_cache_exited = false;
+
+struct SlabCacheHolder
+{
+    SlabCache* cache = nullptr;
+
+    ~SlabCacheHolder()
+    {
+        t_cache        = nullptr;
+        t_cache_exited = true;
+        if (cache)
+        {
+            GetRegistry()->release(cache);
+        }
+    }
+};
+
+static thread_local SlabCacheHolder t_cache_holder;
+
+} // namespace
+
+/**
+ * ============================================================================
+ * SlabPool 类的实现
+ * ============================================================================
+ */
+void* SlabPool::Allocate(size_t size)
+{
+    if (size > MAX_SIZE)
+    {
+        void* ptr = malloc(size);
+        if (!ptr)
+        {
+            throw std::bad_alloc();
+        }
+        s_large_allocs.fetch_add(1, std::memory_order_relaxed);
+        return ptr;
+    }
+
+    size_t cls = SizeClass(size);
+    if (t_cache)
+    {
+        return t_cache->allocate(cls);
+    }
+    if (t_cache_exited)
+    {
+        return GetRegistry()->allocateShared(cls);
+    }
+    t_cache_holder.cache = GetRegistry()->acquire();
+    t_cache              = t_cache_holder.cache;
+    return t_cache->allocate(cls);
+}
+
+void SlabPool::Deallocate(void* ptr, size_t size)
+{
+    if (!ptr)
+    {
+        return;
+    }
+    if (size > MAX_SIZE)
+    {
+        free(ptr);
+        return;
+    }
+
+    size_t cls       = SizeClass(size);
+    SlabCache* owner = ((SlabHeader*)((uintptr_t)ptr & ~(uintptr_t)(ClassSlabSize(cls) - 1)))->owner;
+    if (owner == t_cache)
+    {
+        owner->deallocate(ptr, cls);
+    }
+    else
+    {
+        owner->deallocateRemote(ptr, cls);
+    }
+}
+
+SlabStats SlabPool::GetStats()
+{
+    SlabStats stats;
+    GetRegistry()->getStats(stats);
+    stats.large = s_large_allocs.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace trycle
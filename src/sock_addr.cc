@@ -0,0 +1,275 @@
+#include "sock_addr.h"
+
+#include <arpa/inet.h>
+#include <string.h>
+
+namespace trycle
+{
+
+// 比较和哈希只看有意义的字段，忽略 sin_zero 等填充
+static int compare_ip(const SockAddr& lhs, const SockAddr& rhs)
+{
+    if (lhs.isV4())
+    {
+        int rt = memcmp(&lhs.v4().sin_addr, &rhs.v4().sin_addr, sizeof(in_addr));
+        return rt ? rt : (int)lhs.getPort() - (int)rhs.getPort();
+    }
+    int rt = memcmp(&lhs.v6().sin6_addr, &rhs.v6().sin6_addr, sizeof(in6_addr));
+    if (rt)
+    {
+        return rt;
+    }
+    if (lhs.getPort() != rhs.getPort())
+    {
+        return (int)lhs.getPort() - (int)rhs.getPort();
+    }
+    return lhs.v6().sin6_scope_id < rhs.v6().sin6_scope_id ? -1 : lhs.v6().sin6_scope_id > rhs.v6().sin6_scope_id;
+}
+
+// FNV-1a
+static size_t hash_bytes(const void* data, size_t len, size_t seed)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    size_t h         = seed ^ 14695981039346656037ull;
+    for (size_t i = 0; i < len; ++i)
+    {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// 解析不带符号的十进制端口
+static bool parse_port(const char* str, size_t len, uint16_t& port)
+{
+    if (len == 0 || len > 5)
+    {
+        return false;
+    }
+    uint32_t val = 0;
+    for (size_t i = 0; i < len; ++i)
+    {
+        if (str[i] < '0' || str[i] > '9')
+        {
+            return false;
+        }
+        val = val * 10 + (str[i] - '0');
+    }
+    if (val > 0xffff)
+    {
+        return false;
+    }
+    port = val;
+    return true;
+}
+
+/**
+ * ============================================================================
+ * SockAddr 类的实现
+ * ============================================================================
+ */
+SockAddr::SockAddr()
+    : m_len(0)
+{
+    memset(&m_addr, 0, sizeof(m_addr));
+    m_addr.sa.sa_family = AF_UNSPEC;
+}
+
+SockAddr::SockAddr(const sockaddr* addr, socklen_t len)
+    : SockAddr()
+{
+    if (addr && len <= sizeof(m_addr))
+    {
+        memcpy(&m_addr, addr, len);
+        m_len = len;
+    }
+}
+
+SockAddr::SockAddr(const sockaddr_in& addr)
+    : SockAddr()
+{
+    m_addr.v4 = addr;
+    m_len     = sizeof(addr);
+}
+
+SockAddr::SockAddr(const sockaddr_in6& addr)
+    : SockAddr()
+{
+    m_addr.v6 = addr;
+    m_len     = sizeof(addr);
+}
+
+SockAddr::SockAddr(const Address& addr)
+    : SockAddr(addr.getAddr(), addr.getAddrLen())
+{
+}
+
+bool SockAddr::Parse(const std::string& str, SockAddr& out, uint16_t port)
+{
+    const char* host = str.c_str();
+    size_t host_len  = str.size();
+    int family       = AF_INET;
+
+    if (host_len && host[0] == '[')
+    {
+        // [v6] 或 [v6]:port
+        const char* end = (const char*)memchr(host, ']', host_len);
+        if (!end)
+        {
+            return false;
+        }
+        size_t rest = host_len - (end - host) - 1;
+        if (rest && (end[1] != ':' || !parse_port(end + 2, rest - 1, port)))
+        {
+            return false;
+        }
+        family   = AF_INET6;
+        host_len = end - host - 1;
+        host     = host + 1;
+    }
+    else
+    {
+        const char* colon = (const char*)memchr(host, ':', host_len);
+        if (colon && memchr(colon + 1, ':', host_len - (colon - host) - 1))
+        {
+            // 多个冒号，不带端口的 v6
+            family = AF_INET6;
+        }
+        else if (colon)
+        {
+            if (!parse_port(colon + 1, host_len - (colon - host) - 1, port))
+            {
+                return false;
+            }
+            host_len = colon - host;
+        }
+    }
+
+    char buf[INET6_ADDRSTRLEN];
+    if (host_len == 0 || host_len >= sizeof(buf))
+    {
+        return false;
+    }
+    memcpy(buf, host, host_len);
+    buf[host_len] = '\0';
+
+    SockAddr result;
+    if (family == AF_INET)
+    {
+        result.m_addr.v4.sin_family = AF_INET;
+        result.m_len                = sizeof(sockaddr_in);
+        if (inet_pton(AF_INET, buf, &result.m_addr.v4.sin_addr) != 1)
+        {
+            return false;
+        }
+    }
+    else
+    {
+        result.m_addr.v6.sin6_family = AF_INET6;
+        result.m_len                 = sizeof(sockaddr_in6);
+        if (inet_pton(AF_INET6, buf, &result.m_addr.v6.sin6_addr) != 1)
+        {
+            return false;
+        }
+    }
+    result.setPort(port);
+    out = result;
+    return true;
+}
+
+uint16_t SockAddr::getPort() const
+{
+    switch (getFamily())
+    {
+        case AF_INET:
+            return ntohs(m_addr.v4.sin_port);
+        case AF_INET6:
+            return ntohs(m_addr.v6.sin6_port);
+        default:
+            return 0;
+    }
+}
+
+void SockAddr::setPort(uint16_t port)
+{
+    switch (getFamily())
+    {
+        case AF_INET:
+            m_addr.v4.sin_port = htons(port);
+            break;
+        case AF_INET6:
+            m_addr.v6.sin6_port = htons(port);
+            break;
+        default:
+            break;
+    }
+}
+
+std::string SockAddr::toString() const
+{
+    char buf[INET6_ADDRSTRLEN + 8];
+    switch (getFamily())
+    {
+        case AF_INET:
+            inet_ntop(AF_INET, &m_addr.v4.sin_addr, buf, sizeof(buf));
+            return std::string(buf) + ":" + std::to_string(getPort());
+        case AF_INET6:
+            inet_ntop(AF_INET6, &m_addr.v6.sin6_addr, buf, sizeof(buf));
+            return "[" + std::string(buf) + "]:" + std::to_string(getPort());
+        case AF_UNSPEC:
+            return "";
+        default:
+            return toAddress()->toString();
+    }
+}
+
+Address::ptr SockAddr::toAddress() const
+{
+    if (getFamily() == AF_UNSPEC)
+    {
+        return nullptr;
+    }
+    return Address::Create(getAddr(), getAddrLen());
+}
+
+size_t SockAddr::hash() const
+{
+    switch (getFamily())
+    {
+        case AF_INET:
+            return hash_bytes(&m_addr.v4.sin_addr, sizeof(in_addr), m_addr.v4.sin_port);
+        case AF_INET6:
+            return hash_bytes(&m_addr.v6.sin6_addr, sizeof(in6_addr), m_addr.v6.sin6_port ^ ((size_t)m_addr.v6.sin6_scope_id << 16));
+        default:
+            return hash_bytes(&m_addr, m_len, 0);
+    }
+}
+
+bool SockAddr::operator==(const SockAddr& rhs) const
+{
+    if (getFamily() != rhs.getFamily())
+    {
+        return false;
+    }
+    if (isIp())
+    {
+        return compare_ip(*this, rhs) == 0;
+    }
+    return m_len == rhs.m_len && memcmp(&m_addr, &rhs.m_addr, m_len) == 0;
+}
+
+bool SockAddr::operator<(const SockAddr& rhs) const
+{
+    if (getFamily() != rhs.getFamily())
+    {
+        return getFamily() < rhs.getFamily();
+    }
+    if (isIp())
+    {
+        return compare_ip(*this, rhs) < 0;
+    }
+    int rt = memcmp(&m_addr, &rhs.m_addr, std::min(m_len, rhs.m_len));
+    return rt ? rt < 0 : m_len < rhs.m_len;
+}
+
+} // namespace trycle
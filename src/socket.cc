@@ -0,0 +1,593 @@
+#include "socket.h"
+
+#include <errno.h>
+#include <sstream>
+#include <string.h>
+
+#include "fd_manager.h"
+#include "hook.h"
+#include "iomanager.h"
+#include "log.h"
+#include "sock_addr.h"
+
+namespace trycle
+{
+
+static auto g_logger = GET_LOGGER("system");
+
+// 通配地址（0.0.0.0、::）或端口为 0 时，真正的本地地址要 bind/accept 之后才能确定
+static bool is_wildcard(const SockAddr& addr)
+{
+    if (addr.isV4())
+    {
+        return addr.v4().sin_addr.s_addr == htonl(INADDR_ANY) || addr.getPort() == 0;
+    }
+    if (addr.isV6())
+    {
+        return IN6_IS_ADDR_UNSPECIFIED(&addr.v6().sin6_addr) || addr.getPort() == 0;
+    }
+    return false;
+}
+
+/**
+ * ============================================================================
+ * Socket 类的实现
+ * ============================================================================
+ */
+Socket::ptr Socket::CreateTCP(Address::ptr address)
+{
+    return std::make_shared<Socket>(address->getFamily(), TCP, 0);
+}
+
+Socket::ptr Socket::CreateUDP(Address::ptr address)
+{
+    auto sock = std::make_shared<Socket>(address->getFamily(), UDP, 0);
+    sock->newSock();
+    sock->m_is_connected = true;
+    return sock;
+}
+
+Socket::ptr Socket::CreateTCPSocket()
+{
+    return std::make_shared<Socket>(IPv4, TCP, 0);
+}
+
+Socket::ptr Socket::CreateUDPSocket()
+{
+    auto sock = std::make_shared<Socket>(IPv4, UDP, 0);
+    sock->newSock();
+    sock->m_is_connected = true;
+    return sock;
+}
+
+Socket::ptr Socket::CreateTCPSocket6()
+{
+    return std::make_shared<Socket>(IPv6, TCP, 0);
+}
+
+Socket::ptr Socket::CreateUDPSocket6()
+{
+    auto sock = std::make_shared<Socket>(IPv6, UDP, 0);
+    sock->newSock();
+    sock->m_is_connected = true;
+    return sock;
+}
+
+Socket::Socket(int family, int type, int protocol)
+    : m_sock(-1),
+      m_family(family),
+      m_type(type),
+      m_protocol(protocol)
+{
+}
+
+Socket::~Socket()
+{
+    close();
+}
+
+// 超时写入 FdCtx 由 hook 层实现；当前线程没有开启 hook 时 IO 直接阻塞，只能交给内核
+void Socket::applyTimeout(int type, uint64_t ms)
+{
+    if (!isValid())
+    {
+        return;
+    }
+    FdCtx* ctx = FdMgr::GetSingleton()->get(m_sock);
+    if (ctx)
+    {
+        ctx->setTimeout(type, ms);
+    }
+    if (!ctx || !is_enable_hook())
+    {
+        timeval tv{0, 0};
+        if (ms != (uint64_t)-1)
+        {
+            tv.tv_sec  = ms / 1000;
+            tv.tv_usec = ms % 1000 * 1000;
+        }
+        setsockopt_f(m_sock, SOL_SOCKET, type, &tv, sizeof(tv));
+    }
+}
+
+void Socket::setSendTimeout(uint64_t ms)
+{
+    m_send_timeout = ms;
+    applyTimeout(SO_SNDTIMEO, ms);
+}
+
+void Socket::setRecvTimeout(uint64_t ms)
+{
+    m_recv_timeout = ms;
+    applyTimeout(SO_RCVTIMEO, ms);
+}
+
+bool Socket::getOption(int level, int option, void* result, socklen_t* len)
+{
+    if (getsockopt(m_sock, level, option, result, len))
+    {
+        LOG_FMT_DEBUG(g_logger, "Socket::getOption failed | sock=%d, level=%d, option=%d, errno=%d, errstr=%s",
+                      m_sock, level, option, errno, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool Socket::setOption(int level, int option, const void* val, socklen_t len)
+{
+    if (setsockopt(m_sock, level, option, val, len))
+    {
+        LOG_FMT_DEBUG(g_logger, "Socket::setOption failed | sock=%d, level=%d, option=%d, errno=%d, errstr=%s",
+                      m_sock, level, option, errno, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool Socket::setCachedOption(int level, int option, int val, int& cached)
+{
+    if (cached == val)
+    {
+        return true;
+    }
+    if (!isValid() && !newSock())
+    {
+        return false;
+    }
+    if (!setOption(level, option, val))
+    {
+        return false;
+    }
+    cached = val;
+    return true;
+}
+
+bool Socket::setNoDelay(bool on)
+{
+    if (m_type != TCP || m_family == UNIX)
+    {
+        return false;
+    }
+    return setCachedOption(IPPROTO_TCP, TCP_NODELAY, on, m_no_delay);
+}
+
+bool Socket::setReuseAddr(bool on)
+{
+    return setCachedOption(SOL_SOCKET, SO_REUSEADDR, on, m_reuse_addr);
+}
+
+bool Socket::setReusePort(bool on)
+{
+    return setCachedOption(SOL_SOCKET, SO_REUSEPORT, on, m_reuse_port);
+}
+
+bool Socket::setSendBufferSize(int bytes)
+{
+    int before = m_send_buffer;
+    bool rt    = setCachedOption(SOL_SOCKET, SO_SNDBUF, bytes, m_send_buffer);
+    if (before != m_send_buffer)
+    {
+        m_send_buffer_actual = -1;
+    }
+    return rt;
+}
+
+bool Socket::setRecvBufferSize(int bytes)
+{
+    int before = m_recv_buffer;
+    bool rt    = setCachedOption(SOL_SOCKET, SO_RCVBUF, bytes, m_recv_buffer);
+    if (before != m_recv_buffer)
+    {
+        m_recv_buffer_actual = -1;
+    }
+    return rt;
+}
+
+int Socket::getSendBufferSize()
+{
+    if (m_send_buffer_actual == -1 && isValid())
+    {
+        getOption(SOL_SOCKET, SO_SNDBUF, m_send_buffer_actual);
+    }
+    return m_send_buffer_actual;
+}
+
+int Socket::getRecvBufferSize()
+{
+    if (m_recv_buffer_actual == -1 && isValid())
+    {
+        getOption(SOL_SOCKET, SO_RCVBUF, m_recv_buffer_actual);
+    }
+    return m_recv_buffer_actual;
+}
+
+bool Socket::bind(const Address::ptr addr)
+{
+    if (!isValid() && !newSock())
+    {
+        return false;
+    }
+    if (addr->getFamily() != m_family)
+    {
+        LOG_FMT_ERROR(g_logger, "Socket::bind family mismatch | sock.family=%d, addr.family=%d, addr=%s",
+                      m_family, addr->getFamily(), addr->toString().c_str());
+        return false;
+    }
+    if (::bind(m_sock, addr->getAddr(), addr->getAddrLen()))
+    {
+        LOG_FMT_ERROR(g_logger, "Socket::bind failed | addr=%s, errno=%d, errstr=%s",
+                      addr->toString().c_str(), errno, strerror(errno));
+        return false;
+    }
+    // 绑定具体地址和端口时，本地地址就是 addr，不需要 getsockname
+    if (!is_wildcard(SockAddr(*addr)))
+    {
+        m_local_address = Address::Create(addr->getAddr(), addr->getAddrLen());
+    }
+    return true;
+}
+
+bool Socket::listen(int backlog)
+{
+    if (!isValid())
+    {
+        LOG_ERROR(g_logger, "Socket::listen sock is invalid");
+        return false;
+    }
+    if (::listen(m_sock, backlog))
+    {
+        LOG_FMT_ERROR(g_logger, "Socket::listen failed | errno=%d, errstr=%s", errno, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+Socket::ptr Socket::accept()
+{
+    SockAddr from;
+    socklen_t len = SockAddr::Capacity();
+    int newsock   = ::accept(m_sock, from.getAddr(), &len);
+    if (newsock == -1)
+    {
+        LOG_FMT_DEBUG(g_logger, "Socket::accept failed | sock=%d, errno=%d, errstr=%s", m_sock, errno, strerror(errno));
+        return nullptr;
+    }
+    from.setAddrLen(len);
+
+    auto sock = std::make_shared<Socket>(m_family, m_type, m_protocol);
+    if (!sock->init(newsock))
+    {
+        ::close(newsock);
+        return nullptr;
+    }
+    // 新连接从监听 socket 克隆而来，选项随之继承，缓存也一并继承
+    sock->m_no_delay    = m_no_delay;
+    sock->m_reuse_addr  = m_reuse_addr;
+    sock->m_reuse_port  = m_reuse_port;
+    sock->m_send_buffer = m_send_buffer;
+    sock->m_recv_buffer = m_recv_buffer;
+    sock->m_remote_address = from.toAddress();
+    // 监听的不是通配地址时，新连接的本地地址与监听地址相同
+    if (m_local_address && !is_wildcard(SockAddr(*m_local_address)))
+    {
+        sock->m_local_address = m_local_address;
+    }
+    return sock;
+}
+
+bool Socket::init(int sock)
+{
+    FdCtx* ctx = FdMgr::GetSingleton()->get(sock, true);
+    if (!ctx || !ctx->getIsSocket() || ctx->isClosed())
+    {
+        return false;
+    }
+    m_sock         = sock;
+    m_is_connected = true;
+    applyTimeouts();
+    return true;
+}
+
+bool Socket::connect(const Address::ptr addr, uint64_t timeout_ms)
+{
+    if (!isValid() && !newSock())
+    {
+        return false;
+    }
+    if (addr->getFamily() != m_family)
+    {
+        LOG_FMT_ERROR(g_logger, "Socket::connect family mismatch | sock.family=%d, addr.family=%d, addr=%s",
+                      m_family, addr->getFamily(), addr->toString().c_str());
+        return false;
+    }
+
+    int rt = timeout_ms == (uint64_t)-1 ? ::connect(m_sock, addr->getAddr(), addr->getAddrLen())
+                                        : connect_with_timeout(m_sock, addr->getAddr(), addr->getAddrLen(), timeout_ms);
+    if (rt)
+    {
+        LOG_FMT_DEBUG(g_logger, "Socket::connect failed | addr=%s, timeout=%lu, errno=%d, errstr=%s",
+                      addr->toString().c_str(), timeout_ms, errno, strerror(errno));
+        int err = errno;
+        close();
+        errno = err;
+        return false;
+    }
+    m_is_connected   = true;
+    m_remote_address = Address::Create(addr->getAddr(), addr->getAddrLen());
+    return true;
+}
+
+bool Socket::close()
+{
+    if (!m_is_connected && m_sock == -1)
+    {
+        return true;
+    }
+    m_is_connected = false;
+    // 选项缓存属于旧的 fd，重新创建 socket 时要重新设置
+    m_no_delay = m_reuse_addr = m_reuse_port = -1;
+    m_send_buffer = m_recv_buffer = m_send_buffer_actual = m_recv_buffer_actual = -1;
+    m_local_address.reset();
+    m_remote_address.reset();
+    if (m_sock != -1)
+    {
+        ::close(m_sock);
+        m_sock = -1;
+    }
+    return true;
+}
+
+ssize_t Socket::send(const void* buffer, size_t length, int flags)
+{
+    if (!isConnected())
+    {
+        return -1;
+    }
+    return ::send(m_sock, buffer, length, flags);
+}
+
+ssize_t Socket::send(const iovec* buffers, size_t count, int flags)
+{
+    if (!isConnected())
+    {
+        return -1;
+    }
+    msghdr msg{};
+    msg.msg_iov    = (iovec*)buffers;
+    msg.msg_iovlen = count;
+    return ::sendmsg(m_sock, &msg, flags);
+}
+
+ssize_t Socket::sendTo(const void* buffer, size_t length, const Address::ptr to, int flags)
+{
+    if (!isConnected())
+    {
+        return -1;
+    }
+    return ::sendto(m_sock, buffer, length, flags, to->getAddr(), to->getAddrLen());
+}
+
+ssize_t Socket::recv(void* buffer, size_t length, int flags)
+{
+    if (!isConnected())
+    {
+        return -1;
+    }
+    return ::recv(m_sock, buffer, length, flags);
+}
+
+ssize_t Socket::recv(iovec* buffers, size_t count, int flags)
+{
+    if (!isConnected())
+    {
+        return -1;
+    }
+    msghdr msg{};
+    msg.msg_iov    = buffers;
+    msg.msg_iovlen = count;
+    return ::recvmsg(m_sock, &msg, flags);
+}
+
+ssize_t Socket::recvFrom(void* buffer, size_t length, Address::ptr& from, int flags)
+{
+    if (!isConnected())
+    {
+        return -1;
+    }
+    SockAddr addr;
+    socklen_t len = SockAddr::Capacity();
+    ssize_t rt    = ::recvfrom(m_sock, buffer, length, flags, addr.getAddr(), &len);
+    if (rt >= 0)
+    {
+        addr.setAddrLen(len);
+        from = addr.toAddress();
+    }
+    return rt;
+}
+
+Address::ptr Socket::getRemoteAddress()
+{
+    if (m_remote_address || !isValid())
+    {
+        return m_remote_address;
+    }
+    SockAddr addr;
+    socklen_t len = SockAddr::Capacity();
+    if (getpeername(m_sock, addr.getAddr(), &len))
+    {
+        return nullptr;
+    }
+    addr.setAddrLen(len);
+    m_remote_address = addr.toAddress();
+    return m_remote_address;
+}
+
+Address::ptr Socket::getLocalAddress()
+{
+    if (m_local_address || !isValid())
+    {
+        return m_local_address;
+    }
+    SockAddr addr;
+    socklen_t len = SockAddr::Capacity();
+    if (getsockname(m_sock, addr.getAddr(), &len))
+    {
+        LOG_FMT_ERROR(g_logger, "Socket::getLocalAddress getsockname failed | sock=%d, errno=%d, errstr=%s",
+                      m_sock, errno, strerror(errno));
+        return nullptr;
+    }
+    addr.setAddrLen(len);
+    m_local_address = addr.toAddress();
+    return m_local_address;
+}
+
+int Socket::getError()
+{
+    int error = 0;
+    if (!getOption(SOL_SOCKET, SO_ERROR, error))
+    {
+        error = errno;
+    }
+    return error;
+}
+
+std::ostream& Socket::dump(std::ostream& os) const
+{
+    os << "[Socket sock=" << m_sock
+       << " is_connected=" << m_is_connected
+       << " family=" << m_family
+       << " type=" << m_type
+       << " protocol=" << m_protocol;
+    if (m_local_address)
+    {
+        os << " local_address=" << m_local_address->toString();
+    }
+    if (m_remote_address)
+    {
+        os << " remote_address=" << m_remote_address->toString();
+    }
+    os << "]";
+    return os;
+}
+
+std::string Socket::toString() const
+{
+    std::stringstream ss;
+    dump(ss);
+    return ss.str();
+}
+
+// 先递增本方向的取消计数，再到挂起该方向的 IOManager 上触发事件，被唤醒的协程据此返回 ECANCELED
+// 没有 hook 协程挂起时退回当前线程的 IOManager，取消直接用 addEvent 注册的回调
+static bool cancel_direction(int sock, FdCtx* ctx, IOManager::EventType event)
+{
+    bool read = event == IOManager::EventType::READ;
+    ctx->cancel(read);
+    IOManager* iom = ctx->getWaiter(read);
+    if (!iom)
+    {
+        iom = IOManager::GetThis();
+    }
+    return iom && iom->hasEvent(sock, event) && iom->cancelEvent(sock, event);
+}
+
+static bool cancel_event(int sock, int event)
+{
+    FdCtx* ctx = sock == -1 ? nullptr : FdMgr::GetSingleton()->get(sock);
+    if (!ctx)
+    {
+        return false;
+    }
+    if (event != IOManager::EventType::NONE)
+    {
+        return cancel_direction(sock, ctx, (IOManager::EventType)event);
+    }
+    bool read  = cancel_direction(sock, ctx, IOManager::EventType::READ);
+    bool write = cancel_direction(sock, ctx, IOManager::EventType::WRITE);
+    return read || write;
+}
+
+bool Socket::cancelRead()
+{
+    return cancel_event(m_sock, IOManager::EventType::READ);
+}
+
+bool Socket::cancelWrite()
+{
+    return cancel_event(m_sock, IOManager::EventType::WRITE);
+}
+
+bool Socket::cancelAccept()
+{
+    return cancelRead();
+}
+
+bool Socket::cancelAll()
+{
+    return cancel_event(m_sock, IOManager::EventType::NONE);
+}
+
+bool Socket::newSock()
+{
+    m_sock = ::socket(m_family, m_type, m_protocol);
+    if (m_sock == -1)
+    {
+        LOG_FMT_ERROR(g_logger, "Socket::newSock failed | family=%d, type=%d, protocol=%d, errno=%d, errstr=%s",
+                      m_family, m_type, m_protocol, errno, strerror(errno));
+        return false;
+    }
+    // 不在 hook 线程中创建时也要登记，超时才能写入 FdCtx
+    FdMgr::GetSingleton()->get(m_sock, true);
+    initSock();
+    return true;
+}
+
+void Socket::initSock()
+{
+    setReuseAddr(true);
+    if (m_type == TCP && m_family != UNIX)
+    {
+        setNoDelay(true);
+    }
+    applyTimeouts();
+}
+
+void Socket::applyTimeouts()
+{
+    // 构造之后、创建 socket 之前设置的超时
+    if (m_send_timeout != (uint64_t)-1)
+    {
+        applyTimeout(SO_SNDTIMEO, m_send_timeout);
+    }
+    if (m_recv_timeout != (uint64_t)-1)
+    {
+        applyTimeout(SO_RCVTIMEO, m_recv_timeout);
+    }
+}
+
+std::ostream& operator<<(std::ostream& os, const Socket& sock)
+{
+    return sock.dump(os);
+}
+
+} // namespace trycle
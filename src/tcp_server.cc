@@ -0,0 +1,350 @@
+#include "tcp_server.h"
+
+#include <errno.h>
+#include <sstream>
+#include <string.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "hook.h"
+#include "log.h"
+#include "macro.h"
+#include "util.h"
+
+namespace trycle
+{
+
+static auto g_logger = GET_LOGGER("system");
+
+static auto g_tcp_server_read_timeout    = Config::lookUp<uint64_t>("tcp.server.read_timeout_ms", 60 * 1000 * 2, "tcp server read timeout ms");
+static auto g_tcp_server_max_connections = Config::lookUp<uint64_t>("tcp.server.max_connections", 0, "tcp server connection limit, 0 means unlimited");
+static auto g_tcp_server_drain_timeout   = Config::lookUp<uint64_t>("tcp.server.drain_timeout_ms", 5000, "tcp server graceful stop drain timeout ms");
+
+// stop 中轮询等待的间隔
+static const uint64_t WAIT_INTERVAL_MS = 10;
+
+/**
+ * ============================================================================
+ * TcpServer 类的实现
+ * ============================================================================
+ */
+TcpServer::TcpServer(IOManager* worker, IOManager* acceptor)
+    : TcpServer(std::vector<IOManager*>{worker}, std::vector<IOManager*>{acceptor})
+{
+}
+
+TcpServer::TcpServer(const std::vector<IOManager*>& workers, const std::vector<IOManager*>& acceptors)
+    : m_workers(workers),
+      m_acceptors(acceptors),
+      m_recv_timeout(g_tcp_server_read_timeout->getVal()),
+      m_max_connections(g_tcp_server_max_connections->getVal())
+{
+    ASSERT_M(!m_workers.empty() && !m_acceptors.empty(), "TcpServer needs at least one worker and one acceptor");
+}
+
+TcpServer::~TcpServer()
+{
+    m_listeners.clear();
+}
+
+bool TcpServer::bind(Address::ptr addr)
+{
+    Address::ptr bind_addr = addr;
+    std::vector<Socket::ptr> listeners;
+    for (size_t i = 0; i < m_acceptors.size(); ++i)
+    {
+        auto sock = Socket::CreateTCP(bind_addr);
+        // 同一地址上的多个监听 socket 由内核按四元组哈希分配新连接
+        if (!sock->setReusePort(true) || !sock->bind(bind_addr) || !sock->listen())
+        {
+            LOG_FMT_ERROR(g_logger, "TcpServer::bind failed | name=%s, addr=%s, errno=%d, errstr=%s",
+                          m_name.c_str(), bind_addr->toString().c_str(), errno, strerror(errno));
+            return false;
+        }
+        if (i == 0)
+        {
+            // 端口为 0 时其余的监听 socket 要绑定到内核分配的端口上
+            bind_addr = sock->getLocalAddress();
+        }
+        listeners.push_back(sock);
+    }
+
+    for (size_t i = 0; i < listeners.size(); ++i)
+    {
+        m_listeners.push_back(listeners[i]);
+        m_listener_owners[listeners[i].get()] = m_acceptors[i];
+        LOG_FMT_INFO(g_logger, "TcpServer::bind success | name=%s, addr=%s, acceptor=%s",
+                     m_name.c_str(), bind_addr->toString().c_str(), m_acceptors[i]->get_name().c_str());
+    }
+    return true;
+}
+
+bool TcpServer::bind(const std::vector<Address::ptr>& addrs, std::vector<Address::ptr>& fails)
+{
+    for (auto& addr : addrs)
+    {
+        if (!bind(addr))
+        {
+            fails.push_back(addr);
+        }
+    }
+    if (!fails.empty())
+    {
+        m_listeners.clear();
+        m_listener_owners.clear();
+        return false;
+    }
+    return true;
+}
+
+bool TcpServer::start()
+{
+    if (m_started.exchange(true))
+    {
+        return true;
+    }
+
+    for (auto iom : m_workers)
+    {
+        for (int thread : iom->getThreadIds())
+        {
+            std::unique_ptr<Slot> slot(new Slot());
+            slot->iom    = iom;
+            slot->thread = thread;
+            m_slots.push_back(std::move(slot));
+        }
+    }
+    ASSERT_M(!m_slots.empty(), "TcpServer workers have no threads");
+
+    m_is_stop = false;
+    for (auto& sock : m_listeners)
+    {
+        ++m_accepting;
+        m_listener_owners[sock.get()]->schedule(std::bind(&TcpServer::startAccept, shared_from_this(), sock));
+    }
+    return true;
+}
+
+void TcpServer::startAccept(Socket::ptr sock)
+{
+    while (!m_is_stop)
+    {
+        Socket::ptr client = sock->accept();
+        if (!client)
+        {
+            if (m_is_stop)
+            {
+                break;
+            }
+            int err = errno;
+            ++m_accept_errors;
+            // fd 或内存用完时不要空转，等其它连接释放
+            if (err == EMFILE || err == ENFILE || err == ENOBUFS || err == ENOMEM)
+            {
+                usleep(WAIT_INTERVAL_MS * 1000);
+            }
+            // 监听 socket 本身已经失效，重试不会成功，退出 accept 循环
+            else if (err == EBADF || err == EINVAL || err == ENOTSOCK)
+            {
+                LOG_FMT_ERROR(g_logger, "TcpServer accept failed, stop accepting | name=%s, listener=%s, errno=%d, errstr=%s",
+                              m_name.c_str(), sock->toString().c_str(), err, strerror(err));
+                break;
+            }
+            continue;
+        }
+
+        ++m_accepted;
+        uint64_t active = ++m_active;
+        if (m_max_connections && active > m_max_connections)
+        {
+            --m_active;
+            ++m_rejected;
+            LOG_FMT_DEBUG(g_logger, "TcpServer reject | name=%s, active=%lu, max=%lu, client=%s",
+                          m_name.c_str(), active - 1, m_max_connections, client->toString().c_str());
+            client->close();
+            continue;
+        }
+        uint64_t peak = m_peak;
+        while (active > peak && !m_peak.compare_exchange_weak(peak, active))
+        {
+        }
+        dispatch(client);
+    }
+    // 监听 socket 在 acceptor 上关闭，hook 会同时清理它的 FdCtx 和事件
+    sock->close();
+    --m_accepting;
+}
+
+TcpServer::Slot* TcpServer::selectSlot(const Socket::ptr& client)
+{
+    size_t n = m_slots.size();
+    switch (m_dispatch)
+    {
+        case LEAST_CONNECTIONS:
+        {
+            Slot* best = m_slots[0].get();
+            for (size_t i = 1; i < n; ++i)
+            {
+                if (m_slots[i]->connections < best->connections)
+                {
+                    best = m_slots[i].get();
+                }
+            }
+            return best;
+        }
+        case FD_HASH:
+            return m_slots[client->getSocket() % n].get();
+        case ROUND_ROBIN:
+        default:
+            return m_slots[m_round_robin++ % n].get();
+    }
+}
+
+void TcpServer::dispatch(Socket::ptr client)
+{
+    Slot* slot = selectSlot(client);
+    ++slot->connections;
+    client->setRecvTimeout(m_recv_timeout);
+    {
+        MutexType::Lock lock(&m_mutex);
+        m_clients[client.get()] = std::make_pair(client, slot->iom);
+    }
+    slot->iom->schedule(std::bind(&TcpServer::runClient, shared_from_this(), client, slot), slot->thread);
+}
+
+void TcpServer::runClient(Socket::ptr client, Slot* slot)
+{
+    handleClient(client);
+    {
+        // 先移出再关闭，abortClients 持锁期间不会 shutdown 一个已经关闭（fd 可能被复用）的连接
+        MutexType::Lock lock(&m_mutex);
+        m_clients.erase(client.get());
+    }
+    client->close();
+    --slot->connections;
+    --m_active;
+    ++m_closed;
+}
+
+void TcpServer::handleClient(Socket::ptr client)
+{
+    LOG_FMT_INFO(g_logger, "TcpServer::handleClient | %s", client->toString().c_str());
+}
+
+void TcpServer::cancelAccept()
+{
+    for (auto& sock : m_listeners)
+    {
+        sock->cancelAccept();
+    }
+}
+
+void TcpServer::abortClients()
+{
+    auto self = shared_from_this();
+    MutexType::Lock lock(&m_mutex);
+    for (auto& it : m_clients)
+    {
+        Socket::ptr client = it.second.first;
+        // 在连接所在的 IOManager 上 shutdown，hook 会唤醒挂在该 fd 上的协程
+        it.second.second->schedule([self, client]()
+                                   {
+                                       MutexType::Lock lock(&self->m_mutex);
+                                       if (self->m_clients.count(client.get()))
+                                       {
+                                           ::shutdown(client->getSocket(), SHUT_RDWR);
+                                       } });
+    }
+}
+
+template <typename Cond>
+bool TcpServer::waitFor(Cond cond, uint64_t timeout_ms)
+{
+    uint64_t start = GetCurrentMs();
+    while (!cond())
+    {
+        if (timeout_ms != (uint64_t)-1 && GetCurrentMs() - start >= timeout_ms)
+        {
+            return false;
+        }
+        // 在协程中由 hook 挂起，不占用线程
+        usleep(WAIT_INTERVAL_MS * 1000);
+    }
+    return true;
+}
+
+void TcpServer::stop(uint64_t drain_timeout_ms)
+{
+    if (m_is_stop.exchange(true))
+    {
+        return;
+    }
+    if (drain_timeout_ms == (uint64_t)-1)
+    {
+        drain_timeout_ms = g_tcp_server_drain_timeout->getVal();
+    }
+
+    // accept 协程可能还没有挂起，这时的取消会丢失，所以反复取消直到所有 accept 循环退出
+    waitFor([this]()
+            {
+                if (m_accepting == 0)
+                {
+                    return true;
+                }
+                cancelAccept();
+                return false; },
+            (uint64_t)-1);
+    m_listeners.clear();
+    m_listener_owners.clear();
+
+    uint64_t start = GetCurrentMs();
+    if (!waitFor([this]()
+                 { return m_active == 0; },
+                 drain_timeout_ms))
+    {
+        LOG_FMT_WARN(g_logger, "TcpServer::stop drain timeout, aborting clients | name=%s, active=%lu, drain_timeout=%lu",
+                     m_name.c_str(), (uint64_t)m_active, drain_timeout_ms);
+        abortClients();
+        waitFor([this]()
+                { return m_active == 0; },
+                (uint64_t)-1);
+    }
+    LOG_FMT_INFO(g_logger, "TcpServer::stop | name=%s, elapsed=%lu ms, accepted=%lu, closed=%lu",
+                 m_name.c_str(), GetCurrentMs() - start, (uint64_t)m_accepted, (uint64_t)m_closed);
+}
+
+TcpServerStats TcpServer::getStats() const
+{
+    TcpServerStats stats;
+    stats.accepted      = m_accepted;
+    stats.rejected      = m_rejected;
+    stats.closed        = m_closed;
+    stats.accept_errors = m_accept_errors;
+    stats.active        = m_active;
+    stats.peak          = m_peak;
+    return stats;
+}
+
+std::string TcpServer::dump() const
+{
+    TcpServerStats stats = getStats();
+    std::stringstream ss;
+    ss << "[TcpServer name=" << m_name
+       << " stop=" << m_is_stop
+       << " dispatch=" << m_dispatch
+       << " accepted=" << stats.accepted
+       << " rejected=" << stats.rejected
+       << " closed=" << stats.closed
+       << " accept_errors=" << stats.accept_errors
+       << " active=" << stats.active
+       << " peak=" << stats.peak << "]";
+    for (auto& slot : m_slots)
+    {
+        ss << "\n    worker=" << slot->iom->get_name()
+           << " thread=" << slot->thread
+           << " connections=" << slot->connections;
+    }
+    return ss.str();
+}
+
+} // namespace trycle
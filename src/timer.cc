@@ -1,4 +1,5 @@
 #include "timer.h"
+#include "slab.h"
 #include "util.h"
 
 namespace trycle
@@ -138,7 +139,7 @@ TimerManager::~TimerManager()
 
 Timer::ptr TimerManager::addTimer(uint64_t ms, std::function<void()> fn, bool cyclic)
 {
-    Timer::ptr timer(new Timer(ms, cyclic, fn, this));
+    Timer::ptr timer = MakeSlabShared<Timer>(ms, cyclic, fn, this);
     MutexType::WriteLock lock(&m_mutex);
     m_timers.insert(timer);
     addTimer(timer, lock);
@@ -168,12 +169,8 @@ static void OnTimer(std::weak_ptr<void> weak_cond, std::function<void()> fn)
 Timer::ptr TimerManager::addConditionTimer(uint64_t ms, std::function<void()> fn,
                                            std::weak_ptr<void> weak_cond, bool cyclic)
 {
-    Timer::ptr timer(new Timer(ms, cyclic, fn, this));
-    {
-        MutexType::WriteLock lock(&m_mutex);
-        addTimer(ms, std::bind(&OnTimer, weak_cond, fn), cyclic);
-    }
-    return timer;
+    // 返回实际加入队列的定时器，调用方才能 cancel 掉它
+    return addTimer(ms, std::bind(&OnTimer, weak_cond, fn), cyclic);
 }
 
 void TimerManager::listExpiredTimers(std::vector<std::function<void()>>& fns)
@@ -190,6 +187,11 @@ void TimerManager::listExpiredTimers(std::vector<std::function<void()>>& fns)
     auto now_ms = GetCurrentMs();
 
     MutexType::WriteLock lock(&m_mutex);
+    // 换成写锁之前，其它线程可能已经取走了全部定时器
+    if (m_timers.empty())
+    {
+        return;
+    }
 
     // 检查调整系统时间是否被修改
     bool rolllover = detectTimeRollover(now_ms);
@@ -199,7 +201,7 @@ void TimerManager::listExpiredTimers(std::vector<std::function<void()>>& fns)
         return;
     }
 
-    Timer::ptr now_timer(new Timer(now_ms));
+    Timer::ptr now_timer = MakeSlabShared<Timer>(now_ms);
     // 如果系统时间被回拨，直接认为所有任务都已经超时，需要执行
     // 如果没有，则通过 lower_bound 找出第一个大于或等于 now_timer 定时器的迭代器
     auto it = rolllover ? m_timers.end() : m_timers.lower_bound(now_timer);
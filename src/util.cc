@@ -7,6 +7,7 @@
 #else
 #include <sys/syscall.h>
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 #endif
 
@@ -127,4 +128,11 @@ uint64_t GetCurrentUs()
     return tval.tv_sec * 1000ul * 1000ul + tval.tv_usec;
 }
 
+uint64_t GetMonotonicNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000ul * 1000ul * 1000ul + ts.tv_nsec;
+}
+
 } // namespace trycle
\ No newline at end of file
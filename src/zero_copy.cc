@@ -0,0 +1,408 @@
+#include "zero_copy.h"
+
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/errqueue.h>
+#include <memory>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "fd_manager.h"
+#include "hook.h"
+#include "iomanager.h"
+#include "log.h"
+#include "util.h"
+
+namespace trycle
+{
+
+static auto g_logger = GET_LOGGER("system");
+
+// 零拷贝要锁定用户页、处理完成通知，数据太小时不如直接拷贝
+static auto g_zerocopy_threshold = Config::lookUp<size_t>("tcp.zerocopy.threshold", 16 * 1024, "min bytes per send to use MSG_ZEROCOPY");
+
+static const unsigned int SPLICE_FLAGS = SPLICE_F_MOVE | SPLICE_F_MORE;
+
+// 把管道里的 len 个字节全部搬到 fd_out
+static bool drain_pipe(int pipe_in, int fd_out, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = ::splice(pipe_in, nullptr, fd_out, nullptr, len, SPLICE_FLAGS);
+        if (n <= 0)
+        {
+            return false;
+        }
+        len -= n;
+    }
+    return true;
+}
+
+// sendfile 不支持时的退路：文件 -> 管道 -> fd_out
+static ssize_t splice_file(int fd_out, int file_fd, off_t offset, size_t len)
+{
+    int fds[2];
+    if (::pipe2(fds, O_CLOEXEC) != 0)
+    {
+        return -1;
+    }
+    size_t sent = 0;
+    loff_t off  = offset;
+    while (sent < len)
+    {
+        ssize_t n = ::splice(file_fd, &off, fds[1], nullptr, len - sent, SPLICE_FLAGS);
+        if (n <= 0 || !drain_pipe(fds[0], fd_out, n))
+        {
+            break;
+        }
+        sent += n;
+    }
+    int err = errno;
+    ::close(fds[0]);
+    ::close(fds[1]);
+    errno = err;
+    return sent == 0 && len > 0 ? -1 : (ssize_t)sent;
+}
+
+ssize_t transferFile(int fd_out, int file_fd, off_t offset, size_t len)
+{
+    size_t sent = 0;
+    off_t off   = offset;
+    while (sent < len)
+    {
+        ssize_t n = ::sendfile(fd_out, file_fd, &off, len - sent);
+        if (n == 0)
+        {
+            break;
+        }
+        if (n < 0)
+        {
+            if (sent == 0 && (errno == EINVAL || errno == ENOSYS))
+            {
+                return splice_file(fd_out, file_fd, offset, len);
+            }
+            LOG_FMT_DEBUG(g_logger, "transferFile | fd_out=%d, file_fd=%d, sent=%lu, errno=%s",
+                          fd_out, file_fd, sent, strerror(errno));
+            return sent == 0 ? -1 : (ssize_t)sent;
+        }
+        sent += n;
+    }
+    return sent;
+}
+
+ssize_t spliceRelay(int fd_in, int fd_out, size_t chunk)
+{
+    int fds[2];
+    if (::pipe2(fds, O_CLOEXEC) != 0)
+    {
+        return -1;
+    }
+    size_t total = 0;
+    bool error   = false;
+    while (true)
+    {
+        ssize_t n = ::splice(fd_in, nullptr, fds[1], nullptr, chunk, SPLICE_FLAGS);
+        if (n == 0)
+        {
+            break;
+        }
+        if (n < 0 || !drain_pipe(fds[0], fd_out, n))
+        {
+            error = true;
+            break;
+        }
+        total += n;
+    }
+    int err = errno;
+    ::close(fds[0]);
+    ::close(fds[1]);
+    errno = err;
+    return error && total == 0 ? -1 : (ssize_t)total;
+}
+
+bool spliceProxy(int a, int b, size_t chunk)
+{
+    IOManager* iom = IOManager::GetThis();
+    if (!iom)
+    {
+        return false;
+    }
+    // 两个方向共享，最后结束的那个方向负责关闭
+    auto pending = std::make_shared<std::atomic<int>>(2);
+    auto relay   = [pending, a, b, chunk](int from, int to)
+    {
+        ssize_t n = spliceRelay(from, to, chunk);
+        LOG_FMT_DEBUG(g_logger, "spliceProxy | %d -> %d done, bytes=%d", from, to, (int)n);
+        if (n < 0)
+        {
+            // 出错时两端一起关掉，另一个方向挂起的读写随之被唤醒
+            ::shutdown(from, SHUT_RDWR);
+            ::shutdown(to, SHUT_RDWR);
+        }
+        else
+        {
+            ::shutdown(to, SHUT_WR);
+        }
+        if (--*pending == 0)
+        {
+            ::close(a);
+            ::close(b);
+        }
+    };
+    iom->schedule(std::bind(relay, a, b));
+    iom->schedule(std::bind(relay, b, a));
+    return true;
+}
+
+/**
+ * ============================================================================
+ * ZeroCopySender 类的实现
+ * ============================================================================
+ */
+ZeroCopySender::ptr ZeroCopySender::Create(int fd)
+{
+    return ptr(new ZeroCopySender(fd));
+}
+
+ZeroCopySender::ZeroCopySender(int fd)
+    : m_fd(fd),
+      m_threshold(g_zerocopy_threshold->getVal()),
+      m_iom(IOManager::GetThis())
+{
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY) && defined(SO_EE_ORIGIN_ZEROCOPY)
+    FdCtx* ctx = FdMgr::GetSingleton()->get(fd);
+    if (m_iom && ctx && ctx->getIsSocket())
+    {
+        int one      = 1;
+        m_enabled    = ::setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+        m_generation = ctx->getGeneration();
+    }
+#endif
+    if (!m_enabled)
+    {
+        LOG_FMT_DEBUG(g_logger, "ZeroCopySender | fd=%d, MSG_ZEROCOPY not available, fall back to copy", fd);
+    }
+}
+
+ssize_t ZeroCopySender::send(const std::shared_ptr<const void>& owner, const void* data, size_t len, int flags)
+{
+    bool zerocopy = m_enabled && len >= m_threshold;
+    const char* p = (const char*)data;
+    size_t sent   = 0;
+    while (sent < len)
+    {
+#ifdef MSG_ZEROCOPY
+        ssize_t n = ::send(m_fd, p + sent, len - sent, zerocopy ? flags | MSG_ZEROCOPY : flags);
+#else
+        ssize_t n = ::send(m_fd, p + sent, len - sent, flags);
+#endif
+        if (n < 0)
+        {
+            // 锁定的页超过 optmem 限制，这一次改为拷贝发送
+            if (zerocopy && errno == ENOBUFS)
+            {
+                zerocopy = false;
+                continue;
+            }
+            break;
+        }
+        sent += n;
+        if (!zerocopy)
+        {
+            ++m_copy_count;
+            continue;
+        }
+        // 每次成功的零拷贝 send 占用一个通知序号
+        MutexType::Lock lock(&m_mutex);
+        m_pending[m_next_id++] = owner;
+        ++m_zerocopy_count;
+        watch();
+    }
+    return sent == 0 && len > 0 ? -1 : (ssize_t)sent;
+}
+
+bool ZeroCopySender::flush(uint64_t timeout_ms)
+{
+    if (!m_enabled)
+    {
+        return true;
+    }
+    uint64_t deadline = timeout_ms == (uint64_t)-1 ? (uint64_t)-1 : GetCurrentMs() + timeout_ms;
+    Timer::ptr timer;
+    bool done = false;
+    while (true)
+    {
+        {
+            MutexType::Lock lock(&m_mutex);
+            if (reap() < 0)
+            {
+                dropPending();
+            }
+            if (m_pending.empty() || GetCurrentMs() >= deadline)
+            {
+                m_waiter.reset();
+                done = m_pending.empty();
+                break;
+            }
+            m_waiter = Fiber::GetThis();
+            watch();
+        }
+        if (!timer && deadline != (uint64_t)-1)
+        {
+            std::weak_ptr<ZeroCopySender> weak_self = shared_from_this();
+            timer = m_iom->addTimer(timeout_ms, [weak_self]()
+                                    {
+                                        auto self = weak_self.lock();
+                                        if (!self)
+                                        {
+                                            return;
+                                        }
+                                        MutexType::Lock lock(&self->m_mutex);
+                                        if (self->m_waiter)
+                                        {
+                                            self->m_iom->schedule(std::move(self->m_waiter));
+                                            self->m_waiter.reset();
+                                        } },
+                                    false);
+        }
+        Fiber::YieldToHold();
+    }
+    if (timer)
+    {
+        timer->cancel();
+    }
+    return done;
+}
+
+size_t ZeroCopySender::getPendingCount()
+{
+    MutexType::Lock lock(&m_mutex);
+    return m_pending.size();
+}
+
+int ZeroCopySender::reap()
+{
+#ifdef SO_EE_ORIGIN_ZEROCOPY
+    int count = 0;
+    while (true)
+    {
+        char control[128];
+        msghdr msg{};
+        msg.msg_control    = control;
+        msg.msg_controllen = sizeof(control);
+        // 直接调用原始函数，错误队列为空时返回 EAGAIN 而不是挂起
+        if (recvmsg_f(m_fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            if (errno == EAGAIN || errno == EINTR)
+            {
+                break;
+            }
+            return -1;
+        }
+        for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            if (!((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                  (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)))
+            {
+                continue;
+            }
+            sock_extended_err* serr = (sock_extended_err*)CMSG_DATA(cmsg);
+            if (serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY || serr->ee_errno != 0)
+            {
+                continue;
+            }
+            // 一条通知覆盖序号 [lo, hi]，序号是 32 位的，可能回绕
+            uint32_t lo = serr->ee_info;
+            uint32_t hi = serr->ee_data;
+#ifdef SO_EE_CODE_ZEROCOPY_COPIED
+            if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+            {
+                m_kernel_copied_count += hi - lo + 1;
+            }
+#endif
+            if (lo <= hi)
+            {
+                m_pending.erase(m_pending.lower_bound(lo), m_pending.upper_bound(hi));
+            }
+            else
+            {
+                m_pending.erase(m_pending.lower_bound(lo), m_pending.end());
+                m_pending.erase(m_pending.begin(), m_pending.upper_bound(hi));
+            }
+            ++count;
+        }
+    }
+    return count;
+#else
+    return 0;
+#endif
+}
+
+void ZeroCopySender::onError()
+{
+    MutexType::Lock lock(&m_mutex);
+    m_watching = false;
+
+    FdCtx* ctx = FdMgr::GetSingleton()->get(m_fd);
+    int count  = -1;
+    if (ctx && ctx->getGeneration() == m_generation)
+    {
+        count = reap();
+    }
+    if (count == 0)
+    {
+        // 没有完成通知却有 EPOLLERR，说明连接本身出错了，之后也不会再有通知
+        int err       = 0;
+        socklen_t len = sizeof(err);
+        if (getsockopt_f(m_fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err)
+        {
+            count = -1;
+        }
+    }
+    if (count < 0)
+    {
+        LOG_FMT_DEBUG(g_logger, "ZeroCopySender | fd=%d closed or failed, drop %d pending sends",
+                      m_fd, (int)m_pending.size());
+        dropPending();
+    }
+    watch();
+    wakeWaiter();
+}
+
+void ZeroCopySender::watch()
+{
+    if (m_watching || m_pending.empty() || !m_iom)
+    {
+        return;
+    }
+    ptr self = shared_from_this();
+    // addEvent 成功返回 0
+    if (m_iom->addEvent(m_fd, IOManager::EventType::ERROR, [self]()
+                        { self->onError(); }))
+    {
+        dropPending();
+        return;
+    }
+    m_watching = true;
+}
+
+void ZeroCopySender::dropPending()
+{
+    m_pending.clear();
+}
+
+void ZeroCopySender::wakeWaiter()
+{
+    if (m_waiter && m_pending.empty())
+    {
+        m_iom->schedule(std::move(m_waiter));
+        m_waiter.reset();
+    }
+}
+
+} // namespace trycle
@@ -0,0 +1,165 @@
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "arena.h"
+#include "fiber.h"
+#include "initialize.h"
+#include "iomanager.h"
+#include "log.h"
+#include "macro.h"
+#include "slab.h"
+#include "util.h"
+
+static auto g_logger = GET_LOGGER("system");
+
+typedef std::basic_string<char, std::char_traits<char>, trycle::ArenaAllocator<char>> ArenaString;
+
+static int s_destroyed = 0;
+
+struct Tracked
+{
+    int value;
+    Tracked(int v)
+        : value(v) {}
+    ~Tracked() { ++s_destroyed; }
+};
+
+// 对齐、大块分配、create 的析构、reset 后块回到空闲链表
+void test_basic()
+{
+    trycle::Arena arena;
+    char* c = (char*)arena.allocate(1, 1);
+    ASSERT(c);
+    double* d = (double*)arena.allocate(sizeof(double), alignof(double));
+    ASSERT((uintptr_t)d % alignof(double) == 0);
+    void* big = arena.allocate(trycle::Arena::CHUNK_SIZE * 2);
+    ASSERT(big && arena.getChunkCount() == 1);
+
+    for (int i = 0; i < 3; ++i)
+    {
+        ASSERT(arena.create<Tracked>(i)->value == i);
+    }
+    ASSERT(arena.create<int>(42) && s_destroyed == 0);
+
+    // 填满第一个块后申请新块
+    for (size_t i = 0; i < trycle::Arena::CHUNK_SIZE / 64; ++i)
+    {
+        arena.allocate(64);
+    }
+    ASSERT(arena.getChunkCount() == 2);
+
+    // 两个普通块还给 SlabPool，超过 SlabPool::MAX_SIZE 的大块直接 free
+    auto before = trycle::SlabPool::GetStats();
+    arena.reset();
+    ASSERT(s_destroyed == 3);
+    ASSERT(arena.getUsed() == 0 && arena.getChunkCount() == 0);
+    ASSERT(trycle::SlabPool::GetStats().frees - before.frees == 2);
+}
+
+// std 容器和 shared_ptr 使用协程的 arena，协程结束时一起释放
+void test_fiber()
+{
+    trycle::Arena* arena = nullptr;
+    size_t chunks        = 0;
+    trycle::Fiber::ptr fiber(new trycle::Fiber([&arena, &chunks]()
+                                               {
+                                                   arena = trycle::Arena::GetThis();
+                                                   ASSERT(arena == trycle::Fiber::GetThis()->getArena());
+
+                                                   std::vector<int, trycle::ArenaAllocator<int>> v;
+                                                   for (int i = 0; i < 1000; ++i)
+                                                   {
+                                                       v.push_back(i);
+                                                   }
+                                                   ArenaString s("a string long enough to skip the small buffer");
+                                                   s += s;
+                                                   std::map<int, int, std::less<int>, trycle::ArenaAllocator<std::pair<const int, int>>> m;
+                                                   m[1] = 2;
+                                                   auto sp = std::allocate_shared<Tracked>(trycle::ArenaAllocator<Tracked>(), 7);
+                                                   ASSERT(v[999] == 999 && m[1] == 2 && sp->value == 7);
+                                                   ASSERT(arena->getUsed() > 1000 * sizeof(int));
+                                                   chunks = arena->getChunkCount();
+                                                   trycle::Fiber::Yield();
+                                                   ASSERT(arena->getUsed() > 0); }));
+    fiber->call();
+    ASSERT(arena && arena->getUsed() > 0);
+    auto before = trycle::SlabPool::GetStats();
+    fiber->call();
+    ASSERT(fiber->get_state() == trycle::Fiber::TERM);
+    ASSERT(arena->getUsed() == 0 && arena->getChunkCount() == 0);
+    // 协程结束时块全部还给 SlabPool
+    ASSERT(trycle::SlabPool::GetStats().frees - before.frees >= chunks);
+
+    // reset 后复用同一个 arena 对象
+    fiber->reset([arena]()
+                 {
+                     ASSERT(trycle::Arena::GetThis() == arena && arena->getUsed() == 0);
+                     trycle::Arena::GetThis()->allocate(100); });
+    fiber->call();
+    ASSERT(arena->getUsed() == 0);
+}
+
+// 请求协程中大量短生命周期的小对象：默认分配器 vs 协程 arena
+// 两边都用模板实例化的容器，std::string 在 libstdc++ 中预先编译，不参与比较
+void test_bench()
+{
+    const int requests = 2000;
+    const int objects  = 200;
+
+    auto work = [](bool use_arena)
+    {
+        if (use_arena)
+        {
+            // 取一次当前协程的 arena，避免每个对象都查询 GetThis
+            trycle::ArenaAllocator<std::pair<const int, int>> alloc(trycle::Arena::GetThis());
+            std::map<int, int, std::less<int>, trycle::ArenaAllocator<std::pair<const int, int>>> m(std::less<int>(), alloc);
+            for (int i = 0; i < objects; ++i)
+            {
+                m[i] = i;
+            }
+        }
+        else
+        {
+            std::map<int, int> m;
+            for (int i = 0; i < objects; ++i)
+            {
+                m[i] = i;
+            }
+        }
+    };
+
+    uint64_t times[2];
+    for (int mode = 0; mode < 2; ++mode)
+    {
+        trycle::Fiber::ptr fiber(new trycle::Fiber(std::bind(work, mode == 1)));
+        uint64_t start = trycle::GetCurrentUs();
+        for (int i = 0; i < requests; ++i)
+        {
+            fiber->call();
+            fiber->reset(std::bind(work, mode == 1));
+        }
+        times[mode] = trycle::GetCurrentUs() - start;
+    }
+    LOG_FMT_INFO(g_logger, "bench | %d requests x %d map nodes, malloc %lu us, arena %lu us, slabs %lu",
+                 requests, objects, times[0], times[1], trycle::SlabPool::GetStats().slabs);
+}
+
+int main(int argc, char** argv)
+{
+    printf("======================================\n");
+
+    trycle::initialize();
+
+    printf("--------------------------------------\n");
+
+    trycle::Fiber::GetThis();
+    test_basic();
+    test_fiber();
+    test_bench();
+
+    printf("--------------------------------------\n");
+
+    return 0;
+}
@@ -0,0 +1,203 @@
+#include <arpa/inet.h>
+#include <limits>
+#include <stdexcept>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+#include "bytearray.h"
+#include "endianx.h"
+#include "initialize.h"
+#include "log.h"
+#include "macro.h"
+#include "util.h"
+
+static auto g_logger = GET_LOGGER("system");
+
+// 定长整数的字节序：默认大端，setLittleEndian 后小端
+void test_fixed()
+{
+    ASSERT(byteswapOnLittleEndian((uint16_t)0x1234) == htons(0x1234));
+    ASSERT(byteswapOnLittleEndian((uint32_t)0x12345678) == htonl(0x12345678));
+
+    trycle::ByteArray ba;
+    ba.writeFuint32(0x01020304);
+    ASSERT(ba.toHexString() == "01 02 03 04 ");
+    ba.setLittleEndian(true);
+    ba.writeFuint16(0x0102);
+    ASSERT(ba.toHexString() == "01 02 03 04 02 01 ");
+    ASSERT(ba.readFuint16() == 0x0201 && ba.readFuint16() == 0x0403);
+    ba.setLittleEndian(false);
+    ASSERT(ba.readFuint16() == 0x0201 && ba.getSize() == 0);
+
+    ba.writeFint8(-1);
+    ba.writeFint16(std::numeric_limits<int16_t>::min());
+    ba.writeFint32(-123456);
+    ba.writeFint64(std::numeric_limits<int64_t>::max());
+    ba.writeFloat(3.5f);
+    ba.writeDouble(-0.125);
+    ASSERT(ba.readFint8() == -1);
+    ASSERT(ba.readFint16() == std::numeric_limits<int16_t>::min());
+    ASSERT(ba.readFint32() == -123456);
+    ASSERT(ba.readFint64() == std::numeric_limits<int64_t>::max());
+    ASSERT(ba.readFloat() == 3.5f && ba.readDouble() == -0.125);
+    ASSERT(ba.getSize() == 0);
+}
+
+// varint / zigzag 的编码长度和边界值
+void test_varint()
+{
+    trycle::ByteArray ba;
+    ba.writeUint32(127);
+    ASSERT(ba.getSize() == 1);
+    ba.writeUint32(128);
+    ASSERT(ba.getSize() == 3);
+    ba.writeInt32(-1);
+    ASSERT(ba.getSize() == 4);
+    ba.writeUint64(std::numeric_limits<uint64_t>::max());
+    ASSERT(ba.getSize() == 14);
+    ASSERT(ba.readUint32() == 127 && ba.readUint32() == 128 && ba.readInt32() == -1);
+    ASSERT(ba.readUint64() == std::numeric_limits<uint64_t>::max());
+
+    int64_t values[] = {0, 1, -1, 63, -64, 64, std::numeric_limits<int32_t>::min(),
+                        std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max()};
+    for (int64_t v : values)
+    {
+        ASSERT(trycle::ByteArray::DecodeZigzag64(trycle::ByteArray::EncodeZigzag64(v)) == v);
+        ba.writeInt64(v);
+    }
+    for (int64_t v : values)
+    {
+        ASSERT(ba.readInt64() == v);
+    }
+
+    // 数据不足、varint 过长
+    ba.writeFuint8(0x80);
+    bool thrown = false;
+    try
+    {
+        ba.readUint64();
+    }
+    catch (std::out_of_range&)
+    {
+        thrown = true;
+    }
+    ASSERT(thrown && ba.getSize() == 1);
+    ba.clear();
+    for (int i = 0; i < 11; ++i)
+    {
+        ba.writeFuint8(0xFF);
+    }
+    thrown = false;
+    try
+    {
+        ba.readUint64();
+    }
+    catch (std::invalid_argument&)
+    {
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+
+// 跨越多个块的字符串和 varint，以及文件读写
+void test_blocks()
+{
+    trycle::ByteArray ba;
+    std::string big(trycle::IOBuffer::BLOCK_SIZE * 2 + 7, 'x');
+    ba.writeStringF16("hello");
+    ba.writeStringF32(big);
+    // 让 varint 跨越块边界
+    ba.writeStringWithoutLength(std::string(trycle::IOBuffer::BLOCK_SIZE - (ba.getSize() % trycle::IOBuffer::BLOCK_SIZE) - 2, 'p'));
+    ba.writeUint64(1ULL << 60);
+    ba.writeStringVint("tail");
+    ba.writeStringF64("");
+
+    const std::string file = "/tmp/test_bytearray.dat";
+    ASSERT(ba.writeToFile(file));
+    trycle::ByteArray copy;
+    ASSERT(copy.readFromFile(file));
+    ASSERT(copy.toString() == ba.toString());
+    unlink(file.c_str());
+
+    ASSERT(copy.readStringF16() == "hello");
+    ASSERT(copy.readStringF32() == big);
+    std::string pad(trycle::IOBuffer::BLOCK_SIZE - (5 + 2 + big.size() + 4) % trycle::IOBuffer::BLOCK_SIZE - 2, '\0');
+    copy.read(&pad[0], pad.size());
+    ASSERT(copy.readUint64() == (1ULL << 60));
+    ASSERT(copy.readStringVint() == "tail");
+    ASSERT(copy.readStringF64() == "" && copy.getSize() == 0);
+
+    // 长度超出 16 位前缀时抛出异常，不写入任何数据
+    bool thrown = false;
+    try
+    {
+        copy.writeStringF16(std::string(UINT16_MAX + 1, 'y'));
+    }
+    catch (std::length_error&)
+    {
+        thrown = true;
+    }
+    ASSERT(thrown && copy.getSize() == 0);
+    copy.writeStringF16(std::string(UINT16_MAX, 'y'));
+    ASSERT(copy.readStringF16().size() == UINT16_MAX);
+}
+
+// 编解码吞吐：一条消息包含 varint、定长整数、double 和字符串
+void test_bench()
+{
+    const int count = 200000;
+    std::vector<int64_t> values(count);
+    srand(1);
+    for (int i = 0; i < count; ++i)
+    {
+        values[i] = (int64_t)rand() - RAND_MAX / 2;
+    }
+    std::string name = "trycle.rpc.method";
+
+    trycle::ByteArray ba;
+    uint64_t start = trycle::GetCurrentUs();
+    for (int i = 0; i < count; ++i)
+    {
+        ba.writeUint32(i);
+        ba.writeInt64(values[i]);
+        ba.writeFuint32(i);
+        ba.writeDouble(i * 0.5);
+        ba.writeStringVint(name);
+    }
+    uint64_t encode_us = trycle::GetCurrentUs() - start;
+    size_t bytes       = ba.getSize();
+
+    start = trycle::GetCurrentUs();
+    for (int i = 0; i < count; ++i)
+    {
+        ASSERT(ba.readUint32() == (uint32_t)i);
+        ASSERT(ba.readInt64() == values[i]);
+        ASSERT(ba.readFuint32() == (uint32_t)i);
+        ASSERT(ba.readDouble() == i * 0.5);
+        ASSERT(ba.readStringVint() == name);
+    }
+    uint64_t decode_us = trycle::GetCurrentUs() - start;
+    ASSERT(ba.getSize() == 0);
+
+    LOG_FMT_INFO(g_logger, "bench | %d messages, %zu bytes, encode %lu us (%.1f MB/s), decode %lu us (%.1f MB/s)",
+                 count, bytes, encode_us, bytes / (double)encode_us, decode_us, bytes / (double)decode_us);
+}
+
+int main(int argc, char** argv)
+{
+    printf("======================================\n");
+
+    trycle::initialize();
+
+    printf("--------------------------------------\n");
+
+    test_fixed();
+    test_varint();
+    test_blocks();
+    test_bench();
+
+    printf("--------------------------------------\n");
+
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "address.h"
+#include "connector.h"
+#include "initialize.h"
+#include "iomanager.h"
+#include "log.h"
+#include "macro.h"
+#include "util.h"
+
+static auto g_logger = GET_LOGGER("system");
+
+static int listen_loopback(int backlog, uint16_t& port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, (sockaddr*)&addr, sizeof(addr));
+    socklen_t len = sizeof(addr);
+    getsockname(fd, (sockaddr*)&addr, &len);
+    listen(fd, backlog);
+    port = ntohs(addr.sin_port);
+    return fd;
+}
+
+static trycle::Address::ptr loopback(uint16_t port)
+{
+    return trycle::IpAddress::Create("127.0.0.1", port);
+}
+
+// 全连接队列占满又不 accept，之后的 SYN 被丢弃，相当于被黑洞的地址
+static int black_hole(uint16_t& port, std::vector<int>& fillers)
+{
+    int fd = listen_loopback(0, port);
+    for (int i = 0; i < 4; i++)
+    {
+        int c = socket(AF_INET, SOCK_STREAM, 0);
+        fcntl(c, F_SETFL, O_NONBLOCK);
+        auto addr = loopback(port);
+        connect(c, addr->getAddr(), addr->getAddrLen());
+        fillers.push_back(c);
+    }
+    return fd;
+}
+
+// 第一个地址被黑洞，间隔 250ms 后第二个地址连上，第一个被取消
+void test_black_hole()
+{
+    uint16_t bad_port, good_port;
+    std::vector<int> fillers;
+    int bad  = black_hole(bad_port, fillers);
+    int good = listen_loopback(16, good_port);
+
+    trycle::IOManager iom(1, false, "connect_any");
+    iom.schedule([bad_port, good_port]()
+                 {
+                     trycle::Address::ptr peer;
+                     uint64_t start = trycle::GetCurrentMs();
+                     int fd = trycle::connectAny({loopback(bad_port), loopback(good_port)}, 3000, &peer);
+                     uint64_t elapsed = trycle::GetCurrentMs() - start;
+                     LOG_FMT_INFO(g_logger, "connectAny black hole | fd=%d, peer=%s, elapsed=%lu ms",
+                                  fd, peer ? peer->toString().c_str() : "null", elapsed);
+                     ASSERT(fd >= 0 && std::dynamic_pointer_cast<trycle::IpAddress>(peer)->getPort() == good_port);
+                     ASSERT(elapsed < 1000);
+                     close(fd); });
+    iom.stop();
+
+    for (int fd : fillers)
+    {
+        close(fd);
+    }
+    close(bad);
+    close(good);
+}
+
+// 全部被拒绝时不等间隔，立即尝试下一个
+void test_all_refused()
+{
+    uint16_t port1, port2;
+    int fd1 = listen_loopback(1, port1);
+    int fd2 = listen_loopback(1, port2);
+    close(fd1);
+    close(fd2);
+
+    trycle::IOManager iom(1, false, "connect_any");
+    iom.schedule([port1, port2]()
+                 {
+                     uint64_t start = trycle::GetCurrentMs();
+                     int fd = trycle::connectAny({loopback(port1), loopback(port2)}, 3000);
+                     int err = errno;
+                     uint64_t elapsed = trycle::GetCurrentMs() - start;
+                     LOG_FMT_INFO(g_logger, "connectAny all refused | fd=%d, errno=%s, elapsed=%lu ms",
+                                  fd, strerror(err), elapsed);
+                     ASSERT(fd == -1 && err == ECONNREFUSED && elapsed < 200); });
+    iom.stop();
+}
+
+// 通过域名解析后连接
+void test_host()
+{
+    uint16_t port;
+    int listener = listen_loopback(16, port);
+
+    trycle::IOManager iom(1, false, "connect_any");
+    iom.schedule([port]()
+                 {
+                     trycle::Address::ptr peer;
+                     int fd = trycle::connectAny("localhost:" + std::to_string(port), -1, &peer);
+                     LOG_FMT_INFO(g_logger, "connectAny host | fd=%d, peer=%s", fd, peer ? peer->toString().c_str() : "null");
+                     ASSERT(fd >= 0);
+                     close(fd); });
+    iom.stop();
+    close(listener);
+}
+
+int main(int argc, char** argv)
+{
+    printf("======================================\n");
+
+    trycle::initialize();
+
+    printf("--------------------------------------\n");
+
+    test_black_hole();
+    test_all_refused();
+    test_host();
+
+    printf("--------------------------------------\n");
+
+    return 0;
+}
@@ -0,0 +1,212 @@
+#include <atomic>
+#include <errno.h>
+#include <sstream>
+#include <unistd.h>
+
+#include "config.h"
+#include "connection_pool.h"
+#include "initialize.h"
+#include "iomanager.h"
+#include "log.h"
+#include "macro.h"
+#include "socket.h"
+#include "util.h"
+
+static auto g_logger = GET_LOGGER("system");
+
+static std::atomic<int> s_accepted{0};
+// 为 true 时服务端处理完一个请求后主动关闭连接
+static std::atomic<bool> s_close_after_reply{false};
+
+// 回环 echo 服务，统计 accept 的连接数
+static trycle::Socket::ptr start_server()
+{
+    auto addr   = trycle::Address::LookupAnyIpAddress("127.0.0.1:0");
+    auto server = trycle::Socket::CreateTCP(addr);
+    ASSERT(server->bind(addr) && server->listen());
+    trycle::IOManager::GetThis()->schedule([server]()
+                                           {
+                                               while (true)
+                                               {
+                                                   auto conn = server->accept();
+                                                   if (!conn)
+                                                   {
+                                                       break;
+                                                   }
+                                                   ++s_accepted;
+                                                   trycle::IOManager::GetThis()->schedule([conn]()
+                                                                                          {
+                                                                                              char buf[256];
+                                                                                              ssize_t n;
+                                                                                              while ((n = conn->recv(buf, sizeof(buf))) > 0)
+                                                                                              {
+                                                                                                  conn->send(buf, n);
+                                                                                                  if (s_close_after_reply)
+                                                                                                  {
+                                                                                                      break;
+                                                                                                  }
+                                                                                              }
+                                                                                              conn->close(); });
+                                               } });
+    return server;
+}
+
+static void echo(trycle::Socket::ptr sock, const std::string& msg)
+{
+    ASSERT(sock->send(msg.data(), msg.size()) == (ssize_t)msg.size());
+    std::string got;
+    char buf[256];
+    while (got.size() < msg.size())
+    {
+        ssize_t n = sock->recv(buf, sizeof(buf));
+        ASSERT(n > 0);
+        got.append(buf, n);
+    }
+    ASSERT(got == msg);
+}
+
+static std::string dump(trycle::ConnectionPool::ptr pool)
+{
+    std::stringstream ss;
+    pool->dump(ss);
+    return ss.str();
+}
+
+// 归还后复用同一个连接，预热，对端关闭后的连接在取出时被丢弃
+void test_reuse(trycle::Address::ptr addr)
+{
+    auto pool = trycle::ConnectionPool::Create();
+    int fd;
+    {
+        auto sock = pool->get(addr);
+        ASSERT(sock);
+        fd = sock->getSocket();
+        echo(sock, "first");
+    }
+    {
+        auto sock = pool->get(addr->toString());
+        ASSERT(sock && sock->getSocket() == fd);
+        echo(sock, "second");
+    }
+    ASSERT(s_accepted == 1);
+    auto stats = pool->getStats();
+    ASSERT(stats.created == 1 && stats.reused == 1 && stats.idle == 1);
+
+    ASSERT(pool->prewarm(addr, 3) == 2);
+    usleep(10 * 1000);
+    ASSERT(s_accepted == 3 && pool->getStats().idle == 3);
+
+    // 服务端回复后关闭，连接归还时还是 connected，下一次取出时 MSG_PEEK 发现对端已关闭
+    pool->clear();
+    s_close_after_reply = true;
+    {
+        auto sock = pool->get(addr);
+        echo(sock, "closed by peer");
+    }
+    usleep(10 * 1000);
+    s_close_after_reply = false;
+    {
+        auto sock = pool->get(addr);
+        echo(sock, "fresh");
+    }
+    stats = pool->getStats();
+    ASSERT(stats.dead == 1 && stats.total == 1);
+
+    // 调用方 close 后释放的连接不会回到池中
+    {
+        auto sock = pool->get(addr);
+        sock->close();
+    }
+    ASSERT(pool->getStats().total == 0);
+    LOG_FMT_INFO(g_logger, "reuse | %s", dump(pool).c_str());
+}
+
+// 连接数上限：等待归还，等待超时
+void test_limits(trycle::Address::ptr addr)
+{
+    auto max_total    = trycle::Config::lookUp<uint32_t>("tcp.pool.max_total");
+    auto idle_timeout = trycle::Config::lookUp<uint64_t>("tcp.pool.idle_timeout_ms");
+    max_total->setVal(1);
+    idle_timeout->setVal(50);
+    auto pool = trycle::ConnectionPool::Create();
+    max_total->setVal(0);
+    idle_timeout->setVal(60 * 1000);
+
+    auto held = pool->get(addr);
+    int fd    = held->getSocket();
+    ASSERT(!pool->get(addr, 20) && errno == ETIMEDOUT);
+    ASSERT(pool->getStats().wait_timeouts == 1);
+
+    std::atomic<bool> got{false};
+    trycle::IOManager::GetThis()->schedule([pool, addr, fd, &got]()
+                                           {
+                                               uint64_t start = trycle::GetCurrentMs();
+                                               auto sock      = pool->get(addr, 1000);
+                                               ASSERT(sock && sock->getSocket() == fd);
+                                               ASSERT(trycle::GetCurrentMs() - start >= 40);
+                                               got = true; });
+    usleep(50 * 1000);
+    ASSERT(!got);
+    held.reset();
+    usleep(10 * 1000);
+    ASSERT(got);
+
+    // 空闲超时由定时器关闭
+    usleep(200 * 1000);
+    auto stats = pool->getStats();
+    ASSERT(stats.expired == 1 && stats.idle == 0 && stats.total == 0);
+    LOG_FMT_INFO(g_logger, "limits | %s", dump(pool).c_str());
+}
+
+// 每个请求新建连接 vs 从连接池取
+void test_bench(trycle::Address::ptr addr)
+{
+    const int rounds = 2000;
+    uint64_t start   = trycle::GetCurrentUs();
+    for (int i = 0; i < rounds; ++i)
+    {
+        auto sock = trycle::Socket::CreateTCP(addr);
+        ASSERT(sock->connect(addr));
+        echo(sock, "ping");
+    }
+    uint64_t connect_us = trycle::GetCurrentUs() - start;
+
+    auto pool = trycle::ConnectionPool::Create();
+    start     = trycle::GetCurrentUs();
+    for (int i = 0; i < rounds; ++i)
+    {
+        auto sock = pool->get(addr);
+        echo(sock, "ping");
+    }
+    uint64_t pool_us = trycle::GetCurrentUs() - start;
+    ASSERT(pool->getStats().created == 1);
+
+    LOG_FMT_INFO(g_logger, "bench | %d requests, connect each %.1f us/req, pooled %.1f us/req",
+                 rounds, connect_us / (double)rounds, pool_us / (double)rounds);
+}
+
+void run()
+{
+    auto server = start_server();
+    auto addr   = server->getLocalAddress();
+    test_reuse(addr);
+    test_limits(addr);
+    test_bench(addr);
+    server->close();
+}
+
+int main(int argc, char** argv)
+{
+    printf("======================================\n");
+
+    trycle::initialize();
+
+    printf("--------------------------------------\n");
+
+    trycle::IOManager iom(1, false, "pool");
+    iom.schedule(run);
+
+    printf("--------------------------------------\n");
+
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include <errno.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "coroutine.h"
+#include "initialize.h"
+#include "iomanager.h"
+#include "log.h"
+#include "macro.h"
+#include "util.h"
+
+static auto g_logger = GET_LOGGER("system");
+
+static int s_fds[2] = {-1, -1};
+
+static int s_sum           = 0;
+static uint64_t s_sleep_ms = 0;
+static bool s_readable     = false;
+static std::string s_received;
+
+trycle::Task<int> add_later(int a, int b)
+{
+    uint64_t start = trycle::GetCurrentMs();
+    co_await trycle::sleep_for(100);
+    s_sleep_ms = trycle::GetCurrentMs() - start;
+    co_return a + b;
+}
+
+trycle::Task<void> reader()
+{
+    LOG_DEBUG(g_logger, "reader wait readable...");
+    bool ok = co_await trycle::readable(s_fds[0]);
+    char buf[64]{};
+    ssize_t n = ::recv(s_fds[0], buf, sizeof(buf) - 1, MSG_DONTWAIT);
+    LOG_FMT_DEBUG(g_logger, "reader wake | ok=%d, n=%d, data=%s", (int)ok, (int)n, buf);
+    s_readable = ok;
+    if (n > 0)
+    {
+        s_received.assign(buf, n);
+    }
+}
+
+trycle::Task<void> writer()
+{
+    int sum = co_await add_later(40, 2);
+    LOG_FMT_DEBUG(g_logger, "add_later result=%d", sum);
+    s_sum = sum;
+
+    co_await trycle::yield();
+    std::string data = "hello coroutine " + std::to_string(sum);
+    ::send(s_fds[1], data.c_str(), data.size(), MSG_DONTWAIT);
+}
+
+void test_coroutine()
+{
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, s_fds);
+
+    {
+        trycle::IOManager iom(2, false, "coroutine");
+        trycle::CoSpawn(&iom, reader());
+        trycle::CoSpawn(&iom, writer());
+
+        // 有栈协程和无栈协程共用同一个 IOManager
+        iom.schedule([]()
+                     { LOG_DEBUG(g_logger, "fiber runs alongside coroutines"); });
+    }
+
+    // IOManager 析构时等待所有任务结束
+    ASSERT(s_sum == 42);
+    // 定时器精度为毫秒，留 5ms 余量
+    ASSERT(s_sleep_ms >= 95);
+    ASSERT(s_readable);
+    ASSERT(s_received == "hello coroutine 42");
+
+    // 已 detach 的任务再次 detach 返回空句柄
+    trycle::Task<int> task = add_later(1, 2);
+    auto handle            = task.detach();
+    ASSERT(handle && !task.detach());
+    handle.destroy();
+    trycle::Task<int> moved = std::move(task);
+    ASSERT(!moved.detach());
+    ::close(s_fds[0]);
+    ::close(s_fds[1]);
+}
+
+int main(int argc, char** argv)
+{
+    printf("======================================\n");
+
+    trycle::initialize();
+
+    printf("--------------------------------------\n");
+
+    test_coroutine();
+
+    printf("--------------------------------------\n");
+
+    return 0;
+}
@@ -0,0 +1,148 @@
+#include <atomic>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "fd_manager.h"
+#include "fd_table.h"
+#include "initialize.h"
+#include "log.h"
+#include "macro.h"
+#include "thread.h"
+
+static auto g_logger = GET_LOGGER("system");
+
+void test_fd_table()
+{
+    trycle::FdTable<int> table;
+    ASSERT(table.get(5) == nullptr);
+    ASSERT(table.get(-1) == nullptr);
+    ASSERT(table.getOrCreate((int)table.CAPACITY) == nullptr);
+
+    // 大 fd 只分配它所在的段，不需要把前面的段全部扩出来
+    int* slot = table.getOrCreate(900000, [](int& v, int fd)
+                                  { v = fd; });
+    ASSERT(slot && *slot == 900000);
+    ASSERT(table.get(900001) && *table.get(900001) == 900001);
+    ASSERT(table.get(0) == nullptr);
+    LOG_DEBUG(g_logger, "test_fd_table ok");
+}
+
+void test_generation()
+{
+    int fds[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    auto mgr = trycle::FdMgr::GetSingleton();
+
+    trycle::FdCtx* ctx = mgr->get(fds[0], true);
+    ASSERT(ctx && ctx->isAlive() && ctx->getIsSocket());
+    uint32_t gen = ctx->getGeneration();
+
+    // 关闭后同一个 fd 被复用，槽位地址不变，代数变化
+    mgr->del(fds[0]);
+    ASSERT(mgr->get(fds[0]) == nullptr);
+    ASSERT(ctx->isClosed());
+    ::close(fds[0]);
+    int fd = ::dup(fds[1]);
+    LOG_FMT_DEBUG(g_logger, "reuse fd | old=%d, new=%d", fds[0], fd);
+
+    trycle::FdCtx* ctx2 = mgr->get(fd, true);
+    ASSERT(ctx2 && ctx2->isAlive() && !ctx2->isClosed());
+    if (fd == fds[0])
+    {
+        ASSERT(ctx2 == ctx && ctx2->getGeneration() == gen + 2);
+    }
+    LOG_FMT_DEBUG(g_logger, "test_generation ok | gen %u -> %u", gen, ctx2->getGeneration());
+    mgr->del(fd);
+    ::close(fd);
+    ::close(fds[1]);
+}
+
+void test_concurrent_create()
+{
+    int fds[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    auto mgr = trycle::FdMgr::GetSingleton();
+
+    trycle::FdCtx* results[8] = {};
+    std::vector<trycle::Thread::ptr> threads;
+    for (int i = 0; i < 8; i++)
+    {
+        threads.push_back(std::make_shared<trycle::Thread>("fd_" + std::to_string(i),
+                                                           [&results, i, &fds, mgr]()
+                                                           { results[i] = mgr->get(fds[1], true); }));
+    }
+    for (auto& t : threads)
+    {
+        t->join();
+    }
+    for (int i = 1; i < 8; i++)
+    {
+        ASSERT(results[i] == results[0]);
+    }
+    ASSERT(results[0]->isAlive());
+    LOG_FMT_DEBUG(g_logger, "test_concurrent_create ok | gen=%u", results[0]->getGeneration());
+    mgr->del(fds[1]);
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+// 一个线程反复作废、重建 FdCtx，另一个线程无锁读取，快照中的属性必须来自同一代
+void test_snapshot()
+{
+    int fds[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    auto mgr = trycle::FdMgr::GetSingleton();
+
+    trycle::FdCtx* ctx = mgr->addNonBlock(fds[0], true, true);
+    ASSERT(ctx);
+    std::atomic<bool> stop{false};
+    uint64_t valid   = 0;
+    uint64_t retired = 0;
+    trycle::Thread reader("fd_reader", [&]()
+                          {
+                              while (!stop)
+                              {
+                                  trycle::FdCtx::Snapshot snap;
+                                  if (!ctx->snapshot(snap))
+                                  {
+                                      ++retired;
+                                      continue;
+                                  }
+                                  ++valid;
+                                  ASSERT(snap.generation & 1);
+                                  ASSERT(snap.is_hookable && snap.is_socket == snap.is_user_nonblock);
+                              } });
+    for (int i = 0; i < 200000; i++)
+    {
+        mgr->del(fds[0]);
+        mgr->addNonBlock(fds[0], i % 2, i % 2);
+    }
+    stop = true;
+    reader.join();
+    LOG_FMT_DEBUG(g_logger, "test_snapshot ok | valid=%lu, retired=%lu", valid, retired);
+    ASSERT(valid > 0);
+
+    mgr->del(fds[0]);
+    trycle::FdCtx::Snapshot snap;
+    ASSERT(!ctx->snapshot(snap));
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+int main(int argc, char** argv)
+{
+    printf("======================================\n");
+
+    trycle::initialize();
+
+    printf("--------------------------------------\n");
+
+    test_fd_table();
+    test_generation();
+    test_concurrent_create();
+    test_snapshot();
+
+    printf("--------------------------------------\n");
+
+    return 0;
+}
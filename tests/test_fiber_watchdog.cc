@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <atomic>
+#include <unistd.h>
+
+#include "config.h"
+#include "fiber.h"
+#include "fiber_watchdog.h"
+#include "initialize.h"
+#include "iomanager.h"
+#include "log.h"
+#include "macro.h"
+
+static auto g_logger = GET_LOGGER("system");
+
+static const uint64_t STUCK_MS = 1000;
+
+static std::atomic<uint64_t> s_yields{0};
+
+void stuck_fiber()
+{
+    trycle::Fiber::GetThis()->setTag("stuck_fiber");
+    LOG_DEBUG(g_logger, "stuck_fiber sleep 3s...");
+    sleep(3);
+    LOG_DEBUG(g_logger, "stuck_fiber wake");
+}
+
+void busy_fiber()
+{
+    trycle::Fiber::GetThis()->setTag("busy_fiber");
+    uint64_t start    = trycle::GetCurrentMs();
+    uint64_t yields   = 0;
+    volatile uint64_t sum = 0;
+    while (trycle::GetCurrentMs() - start < 500)
+    {
+        for (int i = 0; i < 10000; i++)
+        {
+            sum += i;
+        }
+        // 协作式抢占点
+        if (trycle::Fiber::maybeYield())
+        {
+            ++yields;
+        }
+    }
+    LOG_FMT_DEBUG(g_logger, "busy_fiber done | yields=%lu", yields);
+    s_yields = yields;
+}
+
+void test_watchdog()
+{
+    trycle::Config::lookUp<bool>("fiber.hold.backtrace")->setVal(true);
+
+    trycle::FiberWatchdog watchdog(STUCK_MS, 200, 50);
+    watchdog.start();
+
+    {
+        trycle::IOManager iom(2, false, "watchdog");
+        iom.schedule(&stuck_fiber);
+        iom.schedule(&busy_fiber);
+
+        usleep(1500 * 1000);
+        std::cout << trycle::Fiber::DumpFibers() << std::endl;
+        std::cout << trycle::Scheduler::DumpTopConsumers(5) << std::endl;
+
+        // 卡在 hook 的 sleep 上的协程出现在清单中，并且已被看门狗告警
+        std::vector<trycle::FiberInfo> fibers;
+        trycle::Fiber::ListFibers(fibers);
+        auto it = std::find_if(fibers.begin(), fibers.end(), [](const trycle::FiberInfo& info)
+                               { return info.tag == "stuck_fiber"; });
+        ASSERT(it != fibers.end());
+        ASSERT(it->state == trycle::Fiber::HOLD);
+        ASSERT(it->wait_on == "sleep");
+        ASSERT(it->state_ms >= STUCK_MS);
+        ASSERT(watchdog.getStuckReports() >= 1);
+    }
+
+    // 忙碌协程超过时间片后在抢占点让出过
+    ASSERT(s_yields > 0);
+    ASSERT(watchdog.getOverrunReports() >= 1);
+}
+
+int main(int argc, char** argv)
+{
+    printf("======================================\n");
+
+    trycle::initialize();
+
+    printf("--------------------------------------\n");
+
+    test_watchdog();
+
+    printf("--------------------------------------\n");
+
+    return 0;
+}
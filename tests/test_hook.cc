@@ -1,15 +1,20 @@
 #include <arpa/inet.h>
+#include <atomic>
 #include <stdint.h>
 #include <string>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <unistd.h>
 
+#include "fd_manager.h"
 #include "fiber.h"
 #include "hook.h"
 #include "initialize.h"
 #include "iomanager.h"
 #include "log.h"
+#include "macro.h"
 #include "scheduler.h"
+#include "util.h"
 
 // static auto g_logger = GET_ROOT_LOGGER;
 
@@ -68,6 +73,174 @@ void test_socket()
     LOG_FMT_DEBUG(GET_ROOT_LOGGER, "RECV result :\n%s", buff.c_str());
 }
 
+// 单线程 IOManager 里，poll/select/epoll_wait 挂起时其它协程仍能运行
+void test_poll()
+{
+    static int fds[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    trycle::IOManager* iom = trycle::IOManager::GetThis();
+
+    iom->schedule([]()
+                  {
+                      usleep(100 * 1000);
+                      LOG_DEBUG(GET_ROOT_LOGGER, "writer send 1 byte");
+                      send(fds[1], "p", 1, 0); });
+
+    struct pollfd pfd = {fds[0], POLLIN, 0};
+    uint64_t start    = trycle::GetCurrentMs();
+    int rt            = poll(&pfd, 1, 1000);
+    LOG_FMT_DEBUG(GET_ROOT_LOGGER, "poll finish | rt=%d, revents=%d, elapsed=%lu ms",
+                  rt, pfd.revents, trycle::GetCurrentMs() - start);
+    char c;
+    recv(fds[0], &c, 1, 0);
+
+    fd_set rset;
+    FD_ZERO(&rset);
+    FD_SET(fds[0], &rset);
+    timeval tv{0, 50 * 1000};
+    start = trycle::GetCurrentMs();
+    rt    = select(fds[0] + 1, &rset, nullptr, nullptr, &tv);
+    LOG_FMT_DEBUG(GET_ROOT_LOGGER, "select timeout | rt=%d, elapsed=%lu ms", rt, trycle::GetCurrentMs() - start);
+
+    int epfd = epoll_create1(0);
+    epoll_event ev{};
+    ev.events  = EPOLLIN;
+    ev.data.fd = fds[0];
+    epoll_ctl(epfd, EPOLL_CTL_ADD, fds[0], &ev);
+    iom->schedule([]()
+                  {
+                      usleep(100 * 1000);
+                      send(fds[1], "e", 1, 0); });
+    epoll_event out[4];
+    start = trycle::GetCurrentMs();
+    rt    = epoll_wait(epfd, out, 4, 1000);
+    LOG_FMT_DEBUG(GET_ROOT_LOGGER, "epoll_wait finish | rt=%d, fd=%d, elapsed=%lu ms",
+                  rt, rt > 0 ? out[0].data.fd : -1, trycle::GetCurrentMs() - start);
+
+    close(epfd);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+/**
+ * poll 与 recv 等待同一个 fd 的同一事件
+ * IOManager 的一次 idle 中，定时器先于 fd 事件入队：poll 的注册先触发，recv 随后注册同一事件并挂起，
+ * poll 被唤醒后收尾时只能注销自己的注册，不能把 recv 的删掉，否则 recv 永远等不到数据
+ */
+void test_poll_shared_event()
+{
+    static int fds[2] = {-1, -1};
+    static std::string s_data;
+    static std::atomic<bool> s_poll_done{false};
+    {
+        trycle::IOManager iom(1, false, "poll_shared");
+        iom.schedule([]()
+                     {
+                         ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+                         trycle::IOManager* iom = trycle::IOManager::GetThis();
+
+                         // 同一事件重复注册返回 false 而不是断言失败，按标识注销只删除自己的注册
+                         int token1 = 0;
+                         int token2 = 0;
+                         ASSERT(iom->tryAddEvent(fds[0], trycle::IOManager::READ, []() {}, &token1));
+                         ASSERT(!iom->tryAddEvent(fds[0], trycle::IOManager::READ, []() {}, &token2));
+                         ASSERT(!iom->removeEvent(fds[0], trycle::IOManager::READ, &token2));
+                         ASSERT(iom->hasEvent(fds[0], trycle::IOManager::READ));
+                         ASSERT(iom->removeEvent(fds[0], trycle::IOManager::READ, &token1));
+                         ASSERT(!iom->hasEvent(fds[0], trycle::IOManager::READ));
+
+                         struct pollfd pfd = {fds[0], POLLIN, 0};
+                         poll(&pfd, 1, 500);
+                         s_poll_done = true; });
+        usleep(50 * 1000);
+
+        // 工作线程忙碌期间，定时器到期、数据到达，两者在同一次 idle 中处理
+        iom.schedule([]()
+                     {
+                         uint64_t start = trycle::GetCurrentMs();
+                         while (trycle::GetCurrentMs() - start < 50)
+                         {
+                         } });
+        usleep(10 * 1000);
+        iom.addTimer(1, []()
+                     {
+                         timeval tv{1, 0};
+                         setsockopt(fds[0], SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+                         char buf[8];
+                         ASSERT(recv(fds[0], buf, sizeof(buf), 0) == 1);
+                         // poll 的注册已经触发，这里重新注册同一事件并挂起
+                         ssize_t n = recv(fds[0], buf, sizeof(buf), 0);
+                         if (n > 0)
+                         {
+                             s_data.assign(buf, n);
+                         } },
+                     false);
+        send_f(fds[1], "a", 1, 0);
+
+        usleep(150 * 1000);
+        send_f(fds[1], "b", 1, 0);
+    }
+    LOG_FMT_DEBUG(GET_ROOT_LOGGER, "poll shared event | recv=%s, poll_done=%d", s_data.c_str(), (int)s_poll_done);
+    ASSERT(s_data == "b");
+    ASSERT(s_poll_done);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+// accept 在没有连接时挂起协程，拿到的连接已登记且系统层面非阻塞
+void test_accept_pipe_dup()
+{
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(listen_fd, (sockaddr*)&addr, sizeof(addr));
+    listen(listen_fd, 16);
+    socklen_t len = sizeof(addr);
+    getsockname(listen_fd, (sockaddr*)&addr, &len);
+
+    static sockaddr_in s_addr;
+    s_addr = addr;
+    trycle::IOManager::GetThis()->schedule([]()
+                                           {
+                                               usleep(50 * 1000);
+                                               int fd = socket(AF_INET, SOCK_STREAM, 0);
+                                               connect(fd, (sockaddr*)&s_addr, sizeof(s_addr));
+                                               send(fd, "a", 1, 0);
+                                               close(fd); });
+
+    uint64_t start = trycle::GetCurrentMs();
+    int conn       = accept(listen_fd, nullptr, nullptr);
+    auto ctx       = trycle::FdMgr::GetSingleton()->get(conn);
+    LOG_FMT_DEBUG(GET_ROOT_LOGGER, "accept finish | fd=%d, elapsed=%lu ms, registered=%d, sys_nonblock=%d, user_nonblock=%d",
+                  conn, trycle::GetCurrentMs() - start, ctx != nullptr,
+                  (fcntl_f(conn, F_GETFL) & O_NONBLOCK) != 0, (fcntl(conn, F_GETFL) & O_NONBLOCK) != 0);
+
+    // dup2 复制属性，recv 在新 fd 上同样会挂起
+    int dup_fd = dup2(conn, conn + 100);
+    char c     = 0;
+    int rt     = recv(dup_fd, &c, 1, 0);
+    LOG_FMT_DEBUG(GET_ROOT_LOGGER, "dup2 recv | fd=%d, rt=%d, data=%c, registered=%d",
+                  dup_fd, rt, c, trycle::FdMgr::GetSingleton()->get(dup_fd) != nullptr);
+    close(dup_fd);
+    close(conn);
+    close(listen_fd);
+
+    // 管道读端没有数据时挂起，写端协程写入后唤醒
+    static int pipe_fds[2];
+    pipe(pipe_fds);
+    trycle::IOManager::GetThis()->schedule([]()
+                                           {
+                                               usleep(50 * 1000);
+                                               write(pipe_fds[1], "p", 1); });
+    start = trycle::GetCurrentMs();
+    rt    = read(pipe_fds[0], &c, 1);
+    LOG_FMT_DEBUG(GET_ROOT_LOGGER, "pipe read | rt=%d, data=%c, elapsed=%lu ms", rt, c, trycle::GetCurrentMs() - start);
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+}
+
 int main(int argc, char** argv)
 {
     printf("======================================\n");
@@ -80,6 +253,13 @@ int main(int argc, char** argv)
 
     // test_hook();
 
+    {
+        trycle::IOManager iom(1);
+        iom.schedule(&test_poll);
+        iom.schedule(&test_accept_pipe_dup);
+    }
+    test_poll_shared_event();
+
     trycle::IOManager iom(2);
     iom.schedule(&test_socket);
 
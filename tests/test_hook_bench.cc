@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "fd_manager.h"
+#include "hook.h"
+#include "initialize.h"
+#include "iomanager.h"
+#include "log.h"
+#include "macro.h"
+#include "util.h"
+
+static auto g_logger = GET_LOGGER("system");
+
+static const int LOOPS  = 100000;
+static const int ROUNDS = 5;
+
+// 每轮写一个字节再读回来，两次系统调用都能立即完成，测的是 hook 快路径的开销
+// 取多轮中的最小值，减少调度和缓存带来的抖动
+template <typename WriteFunc, typename ReadFunc>
+static double bench_pair(int wfd, int rfd, WriteFunc wfn, ReadFunc rfn)
+{
+    double best = 1e18;
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        char c         = 'x';
+        uint64_t start = trycle::GetMonotonicNs();
+        for (int i = 0; i < LOOPS; i++)
+        {
+            wfn(wfd, &c, 1);
+            rfn(rfd, &c, 1);
+        }
+        best = std::min(best, (double)(trycle::GetMonotonicNs() - start) / LOOPS / 2);
+    }
+    return best;
+}
+
+// getsockopt 本身很轻，更容易看出 hook 自身的开销
+template <typename GetSockOptFunc>
+static double bench_getsockopt(int fd, GetSockOptFunc fn)
+{
+    double best = 1e18;
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        int type       = 0;
+        socklen_t len  = sizeof(type);
+        uint64_t start = trycle::GetMonotonicNs();
+        for (int i = 0; i < LOOPS; i++)
+        {
+            fn(fd, SOL_SOCKET, SO_TYPE, &type, &len);
+        }
+        best = std::min(best, (double)(trycle::GetMonotonicNs() - start) / LOOPS);
+    }
+    return best;
+}
+
+void bench_hook()
+{
+    int fds[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    trycle::FdMgr::GetSingleton()->get(fds[0], true);
+    trycle::FdMgr::GetSingleton()->get(fds[1], true);
+
+    int pipe_fds[2];
+    ::pipe(pipe_fds);
+
+    double raw        = bench_pair(fds[1], fds[0], write_f, read_f);
+    double hooked     = bench_pair(fds[1], fds[0], ::write, ::read);
+    double pipe       = bench_pair(pipe_fds[1], pipe_fds[0], ::write, ::read);
+    double opt_raw    = bench_getsockopt(fds[0], getsockopt_f);
+    double opt_hooked = bench_getsockopt(fds[0], ::getsockopt);
+
+    trycle::set_enable_hook(false);
+    double disabled = bench_pair(fds[1], fds[0], ::write, ::read);
+    trycle::set_enable_hook(true);
+
+    LOG_FMT_INFO(g_logger, "hook bench read/write | raw=%.1f ns/call, hooked socket=%.1f ns/call (+%.1f), "
+                           "hooked pipe=%.1f ns/call, hook disabled=%.1f ns/call",
+                 raw, hooked, hooked - raw, pipe, disabled);
+    LOG_FMT_INFO(g_logger, "hook bench getsockopt | raw=%.1f ns/call, hooked=%.1f ns/call (+%.1f)",
+                 opt_raw, opt_hooked, opt_hooked - opt_raw);
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+    ::close(pipe_fds[0]);
+    ::close(pipe_fds[1]);
+}
+
+// 慢路径：EAGAIN 后挂起，SO_RCVTIMEO 到期返回 ETIMEDOUT
+void test_recv_timeout()
+{
+    int fds[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    trycle::FdMgr::GetSingleton()->get(fds[0], true);
+
+    timeval tv{0, 100 * 1000};
+    ::setsockopt(fds[0], SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    char c;
+    uint64_t start = trycle::GetCurrentMs();
+    ssize_t n      = ::recv(fds[0], &c, 1, 0);
+    int err        = errno;
+    LOG_FMT_INFO(g_logger, "recv timeout | n=%d, errno=%s, elapsed=%lu ms",
+                 (int)n, strerror(err), trycle::GetCurrentMs() - start);
+    ASSERT(n == -1 && err == ETIMEDOUT);
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+
+int main(int argc, char** argv)
+{
+    printf("======================================\n");
+
+    trycle::initialize();
+
+    printf("--------------------------------------\n");
+
+    trycle::IOManager iom(1, false, "hook_bench");
+    iom.schedule(bench_hook);
+    iom.schedule(test_recv_timeout);
+
+    printf("--------------------------------------\n");
+
+    return 0;
+}
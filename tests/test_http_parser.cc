@@ -0,0 +1,188 @@
+#include <string.h>
+#include <vector>
+
+#include "http_parser.h"
+#include "initialize.h"
+#include "log.h"
+#include "macro.h"
+#include "util.h"
+
+using namespace trycle::http;
+
+static auto g_logger = GET_LOGGER("system");
+
+static const char* s_get = "GET /index.html?a=1&b=2 HTTP/1.1\r\n"
+                           "Host: www.example.com\r\n"
+                           "User-Agent: curl/8.0\r\n"
+                           "Accept:   */*  \r\n"
+                           "\r\n";
+
+static const char* s_chunked = "POST /upload HTTP/1.1\r\n"
+                               "Host: x\r\n"
+                               "Transfer-Encoding: chunked\r\n"
+                               "\r\n"
+                               "5;ext=1\r\nhello\r\n"
+                               "6\r\n world\r\n"
+                               "0\r\n"
+                               "X-Trailer: t\r\n"
+                               "\r\n";
+
+static void check_get(HttpRequest& req)
+{
+    ASSERT(req.getMethod() == HttpMethod::GET);
+    ASSERT(req.getVersion() == 0x11 && req.isKeepAlive());
+    ASSERT(req.getPath() == "/index.html");
+    ASSERT(req.getQuery() == "a=1&b=2");
+    ASSERT(req.getTarget() == "/index.html?a=1&b=2");
+    ASSERT(req.getHeaderCount() == 3);
+    ASSERT(req.getHeader("host") == "www.example.com");
+    ASSERT(req.getHeader("ACCEPT") == "*/*");
+    ASSERT(req.getHeader("cookie", "none") == "none");
+    ASSERT(req.getBody().empty());
+}
+
+// 数据逐字节到达，每次都换到一块新的缓冲区，验证解析器只依赖偏移
+static HttpRequestParser::Status feed_bytewise(HttpRequestParser& parser, const std::string& data, std::vector<char>& buf)
+{
+    HttpRequestParser::Status st = HttpRequestParser::INCOMPLETE;
+    for (size_t i = 1; i <= data.size(); ++i)
+    {
+        std::vector<char> next(buf.begin(), buf.end());
+        next.push_back(data[i - 1]);
+        buf.swap(next);
+        st = parser.execute(buf.data(), buf.size());
+        if (st != HttpRequestParser::INCOMPLETE)
+        {
+            ASSERT(st == HttpRequestParser::ERROR || i == data.size());
+            break;
+        }
+    }
+    return st;
+}
+
+void test_basic()
+{
+    HttpRequestParser parser;
+    std::string data(s_get);
+    ASSERT(parser.execute(&data[0], data.size()) == HttpRequestParser::DONE);
+    ASSERT(parser.getConsumed() == data.size());
+    check_get(parser.getRequest());
+
+    parser.reset();
+    std::vector<char> buf;
+    ASSERT(feed_bytewise(parser, data, buf) == HttpRequestParser::DONE);
+    check_get(parser.getRequest());
+    LOG_FMT_INFO(g_logger, "basic ok\n%s", parser.getRequest().toString().c_str());
+}
+
+void test_chunked()
+{
+    HttpRequestParser parser;
+    std::string data(s_chunked);
+    ASSERT(parser.execute(&data[0], data.size()) == HttpRequestParser::DONE);
+    ASSERT(parser.getConsumed() == data.size());
+    ASSERT(parser.getRequest().isChunked());
+    ASSERT(parser.getRequest().getBody() == "hello world");
+
+    // 原地解码修改了 data，重新取一份
+    parser.reset();
+    std::vector<char> buf;
+    ASSERT(feed_bytewise(parser, s_chunked, buf) == HttpRequestParser::DONE);
+    ASSERT(parser.getRequest().getBody() == "hello world");
+    LOG_INFO(g_logger, "chunked ok");
+}
+
+// 流水线：一块数据中的多个请求依次解析
+void test_pipeline()
+{
+    std::string data = std::string(s_get) +
+                       "POST /echo HTTP/1.1\r\nContent-Length: 4\r\n\r\nping" +
+                       s_chunked +
+                       "GET /close HTTP/1.0\r\n\r\n";
+    HttpRequestParser parser;
+    size_t offset = 0;
+    std::vector<std::string> bodies;
+    std::vector<bool> keep_alives;
+    while (offset < data.size())
+    {
+        ASSERT(parser.execute(&data[offset], data.size() - offset) == HttpRequestParser::DONE);
+        bodies.push_back(parser.getRequest().getBody().toString());
+        keep_alives.push_back(parser.getRequest().isKeepAlive());
+        offset += parser.getConsumed();
+        parser.reset();
+    }
+    ASSERT(bodies.size() == 4);
+    ASSERT(bodies[1] == "ping" && bodies[2] == "hello world");
+    ASSERT(keep_alives[0] && !keep_alives[3]);
+    LOG_INFO(g_logger, "pipeline ok");
+}
+
+static HttpStatus parse_error(const std::string& request)
+{
+    HttpRequestParser parser;
+    std::string data(request);
+    HttpRequestParser::Status st = parser.execute(&data[0], data.size());
+    ASSERT(st == HttpRequestParser::ERROR);
+    return parser.getError();
+}
+
+void test_errors()
+{
+    ASSERT(parse_error("BREW /pot HTTP/1.1\r\n\r\n") == HttpStatus::NOT_IMPLEMENTED);
+    ASSERT(parse_error("GET / HTTP/2.0\r\n\r\n") == HttpStatus::HTTP_VERSION_NOT_SUPPORTED);
+    ASSERT(parse_error("GET /\r\n\r\n") == HttpStatus::BAD_REQUEST);
+    ASSERT(parse_error("GET / HTTP/1.1\r\nBad Header: x\r\n\r\n") == HttpStatus::BAD_REQUEST);
+    ASSERT(parse_error("POST / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n") == HttpStatus::BAD_REQUEST);
+    ASSERT(parse_error("POST / HTTP/1.1\r\nContent-Length: 1\r\nTransfer-Encoding: chunked\r\n\r\n") == HttpStatus::BAD_REQUEST);
+    ASSERT(parse_error("POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n") == HttpStatus::NOT_IMPLEMENTED);
+    ASSERT(parse_error("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n") == HttpStatus::BAD_REQUEST);
+    ASSERT(parse_error("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n1\r\nabc\r\n") == HttpStatus::BAD_REQUEST);
+    ASSERT(parse_error("GET / HTTP/1.1\r\nX: " + std::string(HttpRequestParser::GetMaxHeaderSize(), 'a')) ==
+           HttpStatus::REQUEST_HEADER_FIELDS_TOO_LARGE);
+    ASSERT(parse_error("POST / HTTP/1.1\r\nContent-Length: 99999999999\r\n\r\n") == HttpStatus::PAYLOAD_TOO_LARGE);
+    LOG_INFO(g_logger, "errors ok");
+}
+
+// 一个典型浏览器请求的解析耗时
+void bench_parse()
+{
+    std::string data = "GET /api/v1/items?id=42&verbose=true HTTP/1.1\r\n"
+                       "Host: api.example.com\r\n"
+                       "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36\r\n"
+                       "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+                       "Accept-Language: en-US,en;q=0.5\r\n"
+                       "Accept-Encoding: gzip, deflate, br\r\n"
+                       "Connection: keep-alive\r\n"
+                       "Cookie: session=0123456789abcdef; theme=dark\r\n"
+                       "\r\n";
+    const int LOOPS = 200000;
+    HttpRequestParser parser;
+    uint64_t start = trycle::GetMonotonicNs();
+    for (int i = 0; i < LOOPS; i++)
+    {
+        parser.reset();
+        parser.execute(&data[0], data.size());
+    }
+    double ns = (double)(trycle::GetMonotonicNs() - start) / LOOPS;
+    LOG_FMT_INFO(g_logger, "parse bench | %d bytes, %d headers, %.1f ns/request, %.1f MB/s",
+                 (int)data.size(), (int)parser.getRequest().getHeaderCount(), ns, data.size() / ns * 1000);
+}
+
+int main(int argc, char** argv)
+{
+    printf("======================================\n");
+
+    trycle::initialize();
+
+    printf("--------------------------------------\n");
+
+    test_basic();
+    test_chunked();
+    test_pipeline();
+    test_errors();
+    bench_parse();
+
+    printf("--------------------------------------\n");
+
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include <string.h>
+
+#include "address.h"
+#include "http_server.h"
+#include "initialize.h"
+#include "iomanager.h"
+#include "log.h"
+#include "macro.h"
+#include "socket.h"
+#include "util.h"
+
+using namespace trycle::http;
+
+static auto g_logger = GET_LOGGER("system");
+
+static const uint64_t BENCH_MS = 1000;
+
+static HttpServer::ptr create_server(trycle::IOManager* iom)
+{
+    auto server = std::make_shared<HttpServer>(true, iom, iom);
+    auto sd     = server->getServletDispatch();
+    sd->addServlet("/ping", [](HttpRequest& req, HttpResponse& rsp, HttpSession& session)
+                   {
+                       rsp.setHeader("content-type", "text/plain");
+                       rsp.setBody("pong");
+                       return 0; });
+    sd->addServlet("/echo", [](HttpRequest& req, HttpResponse& rsp, HttpSession& session)
+                   {
+                       rsp.setBody(req.getBody().toString());
+                       return 0; });
+    sd->addGlobServlet("/static/*", [](HttpRequest& req, HttpResponse& rsp, HttpSession& session)
+                       {
+                           rsp.setBody(std::string(4096, 's'));
+                           return 0; });
+    ASSERT(server->bind(trycle::Address::LookupAnyIpAddress("127.0.0.1:0")));
+    server->start();
+    return server;
+}
+
+// 读一个完整响应（头部加 content-length 长度的 body）
+static bool read_response(trycle::Socket::ptr sock, std::string& buffer, std::string& response)
+{
+    char buf[8192];
+    while (true)
+    {
+        size_t head_end = buffer.find("\r\n\r\n");
+        if (head_end != std::string::npos)
+        {
+            size_t length = 0;
+            size_t pos    = buffer.find("content-length: ");
+            if (pos != std::string::npos && pos < head_end)
+            {
+                length = strtoul(buffer.c_str() + pos + 16, nullptr, 10);
+            }
+            size_t total = head_end + 4 + length;
+            if (buffer.size() >= total)
+            {
+                response = buffer.substr(0, total);
+                buffer.erase(0, total);
+                return true;
+            }
+        }
+        ssize_t n = sock->recv(buf, sizeof(buf));
+        if (n <= 0)
+        {
+            return false;
+        }
+        buffer.append(buf, n);
+    }
+}
+
+static trycle::Socket::ptr connect_server(HttpServer::ptr server)
+{
+    auto addr = server->getListeners()[0]->getLocalAddress();
+    auto sock = trycle::Socket::CreateTCP(addr);
+    ASSERT(sock->connect(addr, 1000));
+    return sock;
+}
+
+void test_requests(HttpServer::ptr server)
+{
+    auto sock = connect_server(server);
+    std::string buffer, rsp;
+
+    std::string req = "GET /ping HTTP/1.1\r\nHost: x\r\n\r\n";
+    ASSERT(sock->send(req.data(), req.size()) == (ssize_t)req.size());
+    ASSERT(read_response(sock, buffer, rsp));
+    ASSERT(rsp.find("HTTP/1.1 200 OK\r\n") == 0 && rsp.substr(rsp.size() - 4) == "pong");
+
+    // 流水线：一次发出多个请求，响应按顺序返回
+    req = "POST /echo HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n3\r\ndef\r\n0\r\n\r\n"
+          "GET /nothing HTTP/1.1\r\n\r\n"
+          "GET /static/a.js HTTP/1.1\r\n\r\n"
+          "HEAD /ping HTTP/1.1\r\n\r\n";
+    ASSERT(sock->send(req.data(), req.size()) == (ssize_t)req.size());
+    ASSERT(read_response(sock, buffer, rsp) && rsp.substr(rsp.size() - 6) == "abcdef");
+    ASSERT(read_response(sock, buffer, rsp) && rsp.find("HTTP/1.1 404 Not Found\r\n") == 0);
+    ASSERT(read_response(sock, buffer, rsp) && rsp.size() > 4096);
+    // HEAD 只有头部，content-length 与 GET 相同
+    std::string head;
+    head.swap(buffer);
+    ASSERT(head.find("content-length: 4\r\n") != std::string::npos && head.find("\r\n\r\n") == head.size() - 4);
+
+    // HTTP/1.0 默认短连接
+    req = "GET /ping HTTP/1.0\r\n\r\n";
+    ASSERT(sock->send(req.data(), req.size()) == (ssize_t)req.size());
+    ASSERT(read_response(sock, buffer, rsp) && rsp.find("HTTP/1.0 200 OK\r\n") == 0);
+    char c;
+    ASSERT(sock->recv(&c, 1) == 0);
+
+    // 格式错误的请求得到 400 并断开
+    sock = connect_server(server);
+    req  = "GET / HTTP/1.1\r\nBad Header: x\r\n\r\n";
+    sock->send(req.data(), req.size());
+    ASSERT(read_response(sock, buffer, rsp) && rsp.find("HTTP/1.1 400 Bad Request\r\n") == 0);
+    ASSERT(rsp.find("connection: close\r\n") != std::string::npos);
+    LOG_INFO(g_logger, "http requests ok");
+}
+
+/**
+ * 类似 wrk -t1 -c<connections> 的压测：每个连接保持 depth 个未完成的请求，统计每秒完成的请求数
+ * 服务端只有一个线程（acceptor 和 worker 同一个 IOManager），客户端在另一个线程
+ */
+static uint64_t bench(int connections, int depth)
+{
+    trycle::IOManager server_iom(1, false, "http_bench");
+    auto server = create_server(&server_iom);
+    auto addr   = server->getListeners()[0]->getLocalAddress();
+
+    std::atomic<uint64_t> completed{0};
+    uint64_t start = trycle::GetCurrentMs();
+    {
+        trycle::IOManager client_iom(1, false, "http_client");
+        for (int i = 0; i < connections; i++)
+        {
+            client_iom.schedule([addr, depth, start, &completed]()
+                                {
+                                    auto sock = trycle::Socket::CreateTCP(addr);
+                                    ASSERT(sock->connect(addr, 1000));
+                                    std::string req;
+                                    for (int j = 0; j < depth; j++)
+                                    {
+                                        req += "GET /ping HTTP/1.1\r\nHost: localhost\r\n\r\n";
+                                    }
+                                    std::string buffer, rsp;
+                                    while (trycle::GetCurrentMs() - start < BENCH_MS)
+                                    {
+                                        ASSERT(sock->send(req.data(), req.size()) == (ssize_t)req.size());
+                                        for (int j = 0; j < depth; j++)
+                                        {
+                                            ASSERT(read_response(sock, buffer, rsp));
+                                        }
+                                        completed += depth;
+                                    } });
+        }
+    }
+    uint64_t elapsed = trycle::GetCurrentMs() - start;
+    server->stop();
+    uint64_t rps = completed * 1000 / elapsed;
+    LOG_FMT_INFO(g_logger, "http bench | connections=%d, pipeline depth=%d, %lu req/s on one server thread",
+                 connections, depth, rps);
+    return rps;
+}
+
+int main(int argc, char** argv)
+{
+    printf("======================================\n");
+
+    trycle::initialize();
+
+    printf("--------------------------------------\n");
+
+    {
+        trycle::IOManager iom(2, false, "http");
+        auto server = create_server(&iom);
+        iom.schedule([server]()
+                     {
+                         test_requests(server);
+                         server->stop(); });
+    }
+
+    bench(16, 1);
+    bench(16, 16);
+
+    printf("--------------------------------------\n");
+
+    return 0;
+}
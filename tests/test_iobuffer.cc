@@ -0,0 +1,177 @@
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "initialize.h"
+#include "iobuffer.h"
+#include "iomanager.h"
+#include "log.h"
+#include "macro.h"
+#include "util.h"
+
+static auto g_logger = GET_LOGGER("system");
+
+static std::string make_data(size_t len)
+{
+    std::string data(len, '\0');
+    for (size_t i = 0; i < len; ++i)
+    {
+        data[i] = 'a' + i % 26;
+    }
+    return data;
+}
+
+// append / prepend / consume / find 的语义，数据跨越多个块
+void test_basic()
+{
+    trycle::IOBuffer buf;
+    std::string body = make_data(trycle::IOBuffer::BLOCK_SIZE * 2 + 100);
+    buf.append(body);
+    ASSERT(buf.size() == body.size());
+    ASSERT(buf.getBlockCount() == 3);
+
+    // 头部在 body 之后才生成，prepend 不移动已有数据
+    std::string head = "HEAD\r\n";
+    buf.prepend(head);
+    buf.prepend("len:", 4);
+    ASSERT(buf.getBlockCount() == 4);
+    ASSERT(buf.toString() == "len:" + head + body);
+    ASSERT(buf.find('\n') == 9);
+    ASSERT(buf.find('z', 10) == 10 + 25);
+    ASSERT(buf.find('#') == -1);
+
+    char out[16];
+    ASSERT(buf.read(out, 10) == 10 && memcmp(out, "len:HEAD\r\n", 10) == 0);
+    ASSERT(buf.copyOut(out, 3, trycle::IOBuffer::BLOCK_SIZE) == 3);
+    ASSERT(memcmp(out, body.data() + trycle::IOBuffer::BLOCK_SIZE, 3) == 0);
+
+    buf.consume(trycle::IOBuffer::BLOCK_SIZE + 1);
+    ASSERT(buf.toString() == body.substr(trycle::IOBuffer::BLOCK_SIZE + 1));
+    ASSERT(buf.getBlockCount() == 2);
+    buf.consume(buf.size());
+    ASSERT(buf.empty() && buf.getBlockCount() == 0);
+}
+
+// splice：整块转移，块指针不变，数据不拷贝
+void test_splice()
+{
+    trycle::IOBuffer src, dst;
+    std::string data = make_data(trycle::IOBuffer::BLOCK_SIZE * 3);
+    src.append(data);
+
+    iovec before[8];
+    size_t cnt = src.getReadBuffers(before, 8);
+    ASSERT(cnt == 3);
+
+    dst.append("x", 1);
+    dst.splice(src);
+    ASSERT(src.empty() && src.getBlockCount() == 0);
+    ASSERT(dst.size() == data.size() + 1 && dst.getBlockCount() == 4);
+
+    iovec after[8];
+    ASSERT(dst.getReadBuffers(after, 8) == 4);
+    for (size_t i = 0; i < cnt; ++i)
+    {
+        ASSERT(after[i + 1].iov_base == before[i].iov_base);
+    }
+    ASSERT(dst.toString() == "x" + data);
+
+    // 部分转移：前两块直接转移，剩下的 10 字节拷贝
+    trycle::IOBuffer part;
+    dst.consume(1);
+    ASSERT(part.splice(dst, trycle::IOBuffer::BLOCK_SIZE * 2 + 10) == trycle::IOBuffer::BLOCK_SIZE * 2 + 10);
+    ASSERT(part.toString() == data.substr(0, trycle::IOBuffer::BLOCK_SIZE * 2 + 10));
+    ASSERT(dst.toString() == data.substr(trycle::IOBuffer::BLOCK_SIZE * 2 + 10));
+    ASSERT(part.getReadBuffers(after, 8) == 3 && after[0].iov_base == before[0].iov_base);
+}
+
+// readFd / writeFd：通过 hook 的 readv / writev 在 socketpair 上传输 1MB
+void test_fd()
+{
+    int fds[2];
+    ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    const size_t total = 1024 * 1024;
+    std::string data   = make_data(total);
+
+    trycle::IOManager::GetThis()->schedule([fds, data]()
+                                           {
+                                               trycle::IOBuffer out;
+                                               out.append(data);
+                                               while (!out.empty())
+                                               {
+                                                   ASSERT(out.writeFd(fds[0]) > 0);
+                                               }
+                                               close(fds[0]); });
+
+    trycle::IOBuffer in;
+    ssize_t n;
+    while ((n = in.readFd(fds[1])) > 0)
+    {
+    }
+    ASSERT(n == 0);
+    ASSERT(in.size() == total && in.toString() == data);
+    // readFd 多预留的块在 commit 时放回池中
+    ASSERT(in.getBlockCount() == total / trycle::IOBuffer::BLOCK_SIZE);
+    close(fds[1]);
+    LOG_FMT_INFO(g_logger, "fd | %zu bytes, %zu blocks", in.size(), in.getBlockCount());
+}
+
+// 拼接 16KB 消息：std::string 追加 vs IOBuffer 追加，块从池中复用
+void test_bench()
+{
+    const int rounds = 20000;
+    std::string piece(100, 'p');
+
+    uint64_t start = trycle::GetCurrentUs();
+    size_t total   = 0;
+    for (int i = 0; i < rounds; ++i)
+    {
+        std::string msg;
+        for (int j = 0; j < 160; ++j)
+        {
+            msg.append(piece);
+        }
+        total += msg.size();
+    }
+    uint64_t string_us = trycle::GetCurrentUs() - start;
+
+    auto before = trycle::SlabPool::GetStats();
+    start       = trycle::GetCurrentUs();
+    for (int i = 0; i < rounds; ++i)
+    {
+        trycle::IOBuffer msg;
+        for (int j = 0; j < 160; ++j)
+        {
+            msg.append(piece);
+        }
+        total -= msg.size();
+    }
+    uint64_t iobuffer_us = trycle::GetCurrentUs() - start;
+    ASSERT(total == 0);
+    // 块在 SlabPool 中反复复用，最多申请一个新的 slab
+    auto after = trycle::SlabPool::GetStats();
+    ASSERT(after.slabs - before.slabs <= 1);
+
+    LOG_FMT_INFO(g_logger, "bench | string %lu us, iobuffer %lu us, block allocs %lu, new slabs %lu",
+                 string_us, iobuffer_us, after.allocs - before.allocs, after.slabs - before.slabs);
+}
+
+int main(int argc, char** argv)
+{
+    printf("======================================\n");
+
+    trycle::initialize();
+
+    printf("--------------------------------------\n");
+
+    test_basic();
+    test_splice();
+    test_bench();
+
+    trycle::IOManager iom(1, false, "iobuffer");
+    iom.schedule(test_fd);
+
+    printf("--------------------------------------\n");
+
+    return 0;
+}
@@ -0,0 +1,158 @@
+#include <random>
+
+#include "config.h"
+#include "initialize.h"
+#include "ip_trie.h"
+#include "log.h"
+#include "macro.h"
+#include "util.h"
+
+static auto g_logger = GET_LOGGER("system");
+
+static trycle::SockAddr addr(const std::string& str)
+{
+    trycle::SockAddr result;
+    ASSERT_M(trycle::SockAddr::Parse(str, result), "parse failed: " + str);
+    return result;
+}
+
+static trycle::IpKey key_of(uint32_t v4)
+{
+    sockaddr_in in{};
+    in.sin_family      = AF_INET;
+    in.sin_addr.s_addr = htonl(v4);
+    trycle::IpKey key;
+    trycle::IpKey::FromSockAddr(trycle::SockAddr(in), key);
+    return key;
+}
+
+// 随机前缀与暴力匹配比较
+void test_trie_random()
+{
+    std::mt19937 rng(42);
+    struct Prefix
+    {
+        uint32_t ip;
+        int len;
+        int value;
+    };
+    std::vector<Prefix> prefixes;
+    trycle::IpPrefixTrie<int> trie;
+    for (int i = 0; i < 5000; i++)
+    {
+        int len     = rng() % 33;
+        uint32_t ip = len ? rng() & (0xffffffffu << (32 - len)) : 0;
+        prefixes.push_back({ip, len, i});
+        trie.insert(key_of(ip), len + 96, i);
+    }
+
+    // 同一前缀后插入的覆盖先插入的，所以暴力匹配时取最后一个最长的
+    for (int n = 0; n < 20000; n++)
+    {
+        uint32_t ip   = n % 2 ? rng() : prefixes[rng() % prefixes.size()].ip | (rng() & 0xff);
+        int best_len  = -1;
+        int best_val  = -1;
+        for (auto& p : prefixes)
+        {
+            uint32_t mask = p.len ? 0xffffffffu << (32 - p.len) : 0;
+            if ((ip & mask) == p.ip && p.len >= best_len)
+            {
+                best_len = p.len;
+                best_val = p.value;
+            }
+        }
+        const int* found = trie.lookup(key_of(ip));
+        ASSERT(best_val == -1 ? found == nullptr : (found && *found == best_val));
+    }
+    LOG_FMT_DEBUG(g_logger, "test_trie_random ok | prefixes=%d", (int)trie.size());
+}
+
+void test_acl()
+{
+    trycle::IpAcl acl;
+    ASSERT(acl.load({"10.0.0.0/8", "2001:db8::/32", "192.168.1.7"},
+                    {"10.1.0.0/16", "2001:db8:dead::/48", "0.0.0.0/0"},
+                    true));
+    ASSERT(acl.isAllowed(addr("10.2.3.4:80")));
+    ASSERT(!acl.isAllowed(addr("10.1.3.4:80")));
+    ASSERT(acl.isAllowed(addr("192.168.1.7")));
+    ASSERT(!acl.isAllowed(addr("192.168.1.8")));    // 0.0.0.0/0 拒绝所有其它 IPv4
+    ASSERT(acl.isAllowed(addr("[2001:db8:1::1]")));
+    ASSERT(!acl.isAllowed(addr("[2001:db8:dead::1]")));
+    ASSERT(acl.isAllowed(addr("[fe80::1]")));       // IPv6 走默认策略
+
+    // 格式错误时保留原来的表
+    std::string error;
+    ASSERT(!acl.load({"10.0.0.0/33"}, {}, false, &error) && error == "10.0.0.0/33");
+    ASSERT(acl.isAllowed(addr("10.2.3.4")));
+    LOG_FMT_DEBUG(g_logger, "test_acl ok | prefixes=%d", (int)acl.size());
+}
+
+// 修改配置后全局 ACL 整表替换
+void test_reload()
+{
+    auto acl = trycle::IpAclMgr::GetSingleton();
+    ASSERT(acl->isAllowed(addr("172.16.0.1")));
+    trycle::Config::lookUp<std::vector<std::string>>("acl.deny")->setVal({"172.16.0.0/12"});
+    ASSERT(!acl->isAllowed(addr("172.16.0.1")));
+    trycle::Config::lookUp<bool>("acl.default_allow")->setVal(false);
+    ASSERT(!acl->isAllowed(addr("8.8.8.8")));
+    trycle::Config::lookUp<std::vector<std::string>>("acl.allow")->setVal({"8.8.8.0/24"});
+    ASSERT(acl->isAllowed(addr("8.8.8.8")));
+    LOG_DEBUG(g_logger, "test_reload ok");
+}
+
+void bench_lookup()
+{
+    std::mt19937 rng(7);
+    std::vector<std::string> deny;
+    for (int i = 0; i < 10000; i++)
+    {
+        uint32_t ip = rng();
+        int len     = 16 + rng() % 17;
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u/%d", ip >> 24, (ip >> 16) & 0xff, (ip >> 8) & 0xff, ip & 0xff, len);
+        deny.push_back(buf);
+    }
+    trycle::IpAcl acl;
+    uint64_t start = trycle::GetMonotonicNs();
+    acl.load({}, deny);
+    uint64_t load_us = (trycle::GetMonotonicNs() - start) / 1000;
+
+    std::vector<trycle::SockAddr> addrs;
+    for (int i = 0; i < 1000; i++)
+    {
+        sockaddr_in in{};
+        in.sin_family      = AF_INET;
+        in.sin_addr.s_addr = rng();
+        addrs.push_back(trycle::SockAddr(in));
+    }
+    const int LOOPS = 1000000;
+    int denied      = 0;
+    start           = trycle::GetMonotonicNs();
+    for (int i = 0; i < LOOPS; i++)
+    {
+        denied += !acl.isAllowed(addrs[i % addrs.size()]);
+    }
+    double ns = (double)(trycle::GetMonotonicNs() - start) / LOOPS;
+    LOG_FMT_INFO(g_logger, "ip acl | %d prefixes loaded in %lu us, lookup %.1f ns, denied %d/%d",
+                 (int)acl.size(), load_us, ns, denied, LOOPS);
+}
+
+int main(int argc, char** argv)
+{
+    printf("======================================\n");
+
+    trycle::initialize();
+
+    printf("--------------------------------------\n");
+
+    test_trie_random();
+    test_acl();
+    test_reload();
+    bench_lookup();
+
+    printf("--------------------------------------\n");
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include <atomic>
+#include <unistd.h>
+
+#include "address.h"
+#include "initialize.h"
+#include "iomanager.h"
+#include "log.h"
+#include "macro.h"
+#include "resolver.h"
+#include "util.h"
+
+static auto g_logger = GET_LOGGER("system");
+
+// 多个协程同时解析同一个域名，只发起一次查询
+void test_coalesce()
+{
+    auto resolver = trycle::ResolverMgr::GetSingleton();
+    resolver->clear();
+    uint64_t miss = resolver->getMissCount();
+
+    static std::atomic<int> done{0};
+    trycle::IOManager iom(2, false, "resolver");
+    for (int i = 0; i < 50; i++)
+    {
+        iom.schedule([]()
+                     {
+                         std::vector<trycle::Address::ptr> result;
+                         ASSERT(trycle::Address::Lookup(result, "localhost:80"));
+                         ASSERT(std::dynamic_pointer_cast<trycle::IpAddress>(result[0])->getPort() == 80);
+                         ++done; });
+    }
+    iom.stop();
+    ASSERT(done == 50);
+    LOG_FMT_INFO(g_logger, "resolver coalesce | 50 lookups, miss=%lu, coalesced=%lu, hit=%lu",
+                 resolver->getMissCount() - miss, resolver->getCoalescedCount(), resolver->getHitCount());
+    ASSERT(resolver->getMissCount() - miss <= 2);
+}
+
+// 命中缓存时返回的是新对象，修改端口不影响缓存
+void test_cache()
+{
+    auto resolver = trycle::ResolverMgr::GetSingleton();
+    uint64_t hit  = resolver->getHitCount();
+    auto addr     = trycle::Address::LookupAnyIpAddress("localhost:80");
+    ASSERT(addr);
+    addr->setPort(1234);
+
+    uint64_t start = trycle::GetMonotonicNs();
+    auto addr2     = trycle::Address::LookupAnyIpAddress("localhost:80");
+    uint64_t ns    = trycle::GetMonotonicNs() - start;
+    ASSERT(addr2 && addr2->getPort() == 80);
+    ASSERT(resolver->getHitCount() - hit == 2);
+    LOG_FMT_INFO(g_logger, "resolver cache | hit lookup %lu ns", ns);
+}
+
+// 不存在的域名走负缓存
+void test_negative()
+{
+    auto resolver = trycle::ResolverMgr::GetSingleton();
+    std::vector<trycle::Address::ptr> result;
+    uint64_t start = trycle::GetCurrentMs();
+    bool rt        = trycle::Address::Lookup(result, "no-such-host.invalid");
+    uint64_t first = trycle::GetCurrentMs() - start;
+    ASSERT(!rt);
+
+    uint64_t hit = resolver->getHitCount();
+    start        = trycle::GetCurrentMs();
+    rt           = trycle::Address::Lookup(result, "no-such-host.invalid");
+    LOG_FMT_INFO(g_logger, "resolver negative | first=%lu ms, second=%lu ms, cached=%d",
+                 first, trycle::GetCurrentMs() - start, (int)(resolver->getHitCount() - hit));
+    ASSERT(!rt);
+}
+
+int main(int argc, char** argv)
+{
+    printf("======================================\n");
+
+    trycle::initialize();
+
+    printf("--------------------------------------\n");
+
+    test_coalesce();
+    test_cache();
+    test_negative();
+
+    printf("--------------------------------------\n");
+
+    return 0;
+}
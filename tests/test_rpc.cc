@@ -0,0 +1,266 @@
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+#include "initialize.h"
+#include "iomanager.h"
+#include "log.h"
+#include "macro.h"
+#include "rpc_client.h"
+#include "rpc_server.h"
+#include "util.h"
+
+using namespace trycle::rpc;
+
+static auto g_logger = GET_LOGGER("system");
+
+static RpcServer::ptr create_server(trycle::IOManager* iom)
+{
+    auto server = std::make_shared<RpcServer>(iom, iom);
+    server->registerMethod("echo", [](const std::string& req, std::string& rsp)
+                           {
+                               rsp = req;
+                               return RpcStatus::OK; });
+    server->registerMethod("sleep", [](const std::string& req, std::string& rsp)
+                           {
+                               usleep(100 * 1000);
+                               rsp = "slept";
+                               return RpcStatus::OK; });
+    // 处理中途让出，唤醒后可能换到其它工作线程上继续执行
+    server->registerMethod("nap", [](const std::string& req, std::string& rsp)
+                           {
+                               usleep(1000);
+                               rsp = req;
+                               return RpcStatus::OK; });
+    server->registerMethod("throw", [](const std::string& req, std::string& rsp) -> RpcStatus
+                           { throw std::runtime_error("bad input"); });
+    ASSERT(server->bind(trycle::Address::LookupAnyIpAddress("127.0.0.1:0")));
+    server->start();
+    return server;
+}
+
+// 帧按字节逐个到达时，直到最后一个字节才解出
+void test_frame()
+{
+    trycle::IOBuffer out;
+    RpcFrame request;
+    request.seq    = 7;
+    request.method = "echo";
+    request.body   = std::string(5000, 'b');
+    request.encode(out);
+    RpcFrame response;
+    response.type   = RpcFrame::RESPONSE;
+    response.seq    = 8;
+    response.status = RpcStatus::NOT_FOUND;
+    response.encode(out);
+
+    std::string wire = out.toString();
+    trycle::ByteArray in;
+    RpcFrame frame;
+    size_t i = 0;
+    for (; i < wire.size(); ++i)
+    {
+        in.write(&wire[i], 1);
+        if (frame.decode(in) == RpcFrame::DONE)
+        {
+            break;
+        }
+    }
+    ASSERT(i == 4 + 1 + 4 + 1 + 4 + 5000 - 1);
+    ASSERT(frame.type == RpcFrame::REQUEST && frame.seq == 7 && frame.method == "echo" && frame.body == request.body);
+    in.write(&wire[i + 1], wire.size() - i - 1);
+    ASSERT(frame.decode(in) == RpcFrame::DONE && in.getSize() == 0);
+    ASSERT(frame.type == RpcFrame::RESPONSE && frame.seq == 8 && frame.status == RpcStatus::NOT_FOUND && frame.body.empty());
+
+    // 超过上限的长度
+    uint32_t length = htonl(RpcFrame::GetMaxFrameSize() + 1);
+    in.write(&length, sizeof(length));
+    ASSERT(frame.decode(in) == RpcFrame::ERROR);
+}
+
+void test_calls(trycle::Address::ptr addr)
+{
+    auto client = RpcClient::Connect(addr, 1000);
+    ASSERT(client);
+
+    std::string rsp;
+    ASSERT(client->call("echo", "hello", rsp) == RpcStatus::OK && rsp == "hello");
+    std::string big(200 * 1024, 'x');
+    ASSERT(client->call("echo", big, rsp) == RpcStatus::OK && rsp == big);
+    ASSERT(client->call("missing", "", rsp) == RpcStatus::NOT_FOUND);
+    ASSERT(client->call("throw", "", rsp) == RpcStatus::INTERNAL_ERROR);
+
+    // 超时后到达的响应被丢弃，不影响之后的调用
+    ASSERT(client->call("sleep", "", rsp, 20) == RpcStatus::TIMEOUT);
+    ASSERT(client->getPendingCount() == 0);
+    usleep(150 * 1000);
+    ASSERT(client->call("echo", "after timeout", rsp) == RpcStatus::OK && rsp == "after timeout");
+
+    // 同一连接上 10 个并发的慢调用，总耗时接近一次调用
+    std::atomic<int> done{0};
+    uint64_t start = trycle::GetCurrentMs();
+    for (int i = 0; i < 10; ++i)
+    {
+        trycle::IOManager::GetThis()->schedule([client, &done]()
+                                               {
+                                                   std::string rsp;
+                                                   ASSERT(client->call("sleep", "", rsp) == RpcStatus::OK && rsp == "slept");
+                                                   ++done; });
+    }
+    while (done < 10)
+    {
+        usleep(5 * 1000);
+    }
+    uint64_t elapsed = trycle::GetCurrentMs() - start;
+    ASSERT(elapsed < 500);
+    LOG_FMT_INFO(g_logger, "calls | 10 concurrent sleep(100ms) calls in %lu ms", elapsed);
+
+    // 关闭时等待中的调用返回 CLOSED
+    trycle::IOManager::GetThis()->schedule([client]()
+                                           {
+                                               usleep(20 * 1000);
+                                               client->close(); });
+    ASSERT(client->call("sleep", "", rsp) == RpcStatus::CLOSED);
+    ASSERT(client->call("echo", "", rsp) == RpcStatus::CLOSED);
+}
+
+// 客户端发完请求就关闭写端，服务端仍然把已经收到的请求的响应写完再关闭连接
+void test_half_close(trycle::Address::ptr addr, const std::string& method, uint32_t count)
+{
+    auto sock = trycle::Socket::CreateTCP(addr);
+    ASSERT(sock->connect(addr, 1000));
+    auto conn = std::make_shared<RpcConnection>(sock);
+
+    RpcFrame frame;
+    frame.type   = RpcFrame::REQUEST;
+    frame.method = method;
+    for (uint32_t seq = 1; seq <= count; ++seq)
+    {
+        frame.seq  = seq;
+        frame.body = method == "sleep" ? "" : std::to_string(seq);
+        ASSERT(conn->send(frame));
+    }
+    conn->waitFlushed();
+    ASSERT(::shutdown(sock->getSocket(), SHUT_WR) == 0);
+
+    uint32_t responses = 0;
+    while (conn->recv(frame))
+    {
+        ASSERT(frame.type == RpcFrame::RESPONSE && frame.status == RpcStatus::OK);
+        ASSERT(frame.body == (method == "sleep" ? "slept" : std::to_string(frame.seq)));
+        ++responses;
+    }
+    LOG_FMT_INFO(g_logger, "half close | %s, %u responses after shutdown(SHUT_WR)", method.c_str(), responses);
+    ASSERT(responses == count);
+    conn->close();
+}
+
+// 多线程的工作 IOManager：请求处理协程和 handleClient 在不同线程上结束，连接仍然在全部响应之后关闭
+// echo 立即返回，最后一个响应和读到 EOF 几乎同时发生，nap 在处理中途换线程
+void test_half_close_mt()
+{
+    const int connections = 64;
+    trycle::IOManager server_iom(4, false, "rpc_server_mt");
+    auto server = create_server(&server_iom);
+    auto addr   = server->getListeners()[0]->getLocalAddress();
+    {
+        trycle::IOManager client_iom(4, false, "rpc_test_mt");
+        for (int i = 0; i < connections; ++i)
+        {
+            client_iom.schedule(std::bind(&test_half_close, addr, i % 2 ? "nap" : "echo", 20));
+        }
+    }
+
+    // 所有连接都已关闭，停止时不需要等 drain 超时
+    uint64_t start = trycle::GetCurrentMs();
+    server->stop(5000);
+    auto stats = server->getStats();
+    LOG_FMT_INFO(g_logger, "half close mt | stop %lu ms, %s", trycle::GetCurrentMs() - start, server->dump().c_str());
+    ASSERT(stats.active == 0 && stats.closed == (uint64_t)connections);
+    ASSERT(trycle::GetCurrentMs() - start < 1000);
+}
+
+/**
+ * 回环压测：一个连接上 concurrency 个协程不停地调用 echo，统计 QPS 和延迟分位数
+ * 服务端和客户端各一个线程
+ */
+void bench(trycle::Address::ptr addr, int concurrency, uint64_t duration_ms)
+{
+    std::vector<std::vector<uint32_t>> latencies(concurrency);
+    RpcConnection::ptr conn;
+    uint64_t start = trycle::GetCurrentMs();
+    {
+        trycle::IOManager client_iom(1, false, "rpc_client");
+        client_iom.schedule([addr, concurrency, duration_ms, start, &latencies, &conn]()
+                            {
+                                auto client = RpcClient::Connect(addr, 1000);
+                                ASSERT(client);
+                                conn = client->getConnection();
+                                std::atomic<int> running{concurrency};
+                                for (int i = 0; i < concurrency; ++i)
+                                {
+                                    trycle::IOManager::GetThis()->schedule([client, i, duration_ms, start, &latencies, &running]()
+                                                                           {
+                                                                               std::string req(64, 'r'), rsp;
+                                                                               while (trycle::GetCurrentMs() - start < duration_ms)
+                                                                               {
+                                                                                   uint64_t begin = trycle::GetCurrentUs();
+                                                                                   ASSERT(client->call("echo", req, rsp) == RpcStatus::OK);
+                                                                                   latencies[i].push_back(trycle::GetCurrentUs() - begin);
+                                                                               }
+                                                                               --running; });
+                                }
+                                while (running > 0)
+                                {
+                                    usleep(10 * 1000);
+                                }
+                                client->close(); });
+    }
+    uint64_t elapsed = trycle::GetCurrentMs() - start;
+
+    std::vector<uint32_t> all;
+    for (auto& v : latencies)
+    {
+        all.insert(all.end(), v.begin(), v.end());
+    }
+    std::sort(all.begin(), all.end());
+    ASSERT(!all.empty());
+    LOG_FMT_INFO(g_logger, "rpc bench | concurrency=%d on one connection, %lu calls/s, p50 %u us, p99 %u us, %.1f frames per writev",
+                 concurrency, all.size() * 1000 / elapsed, all[all.size() / 2], all[all.size() * 99 / 100],
+                 conn->getSentFrames() / (double)std::max<uint64_t>(conn->getWritevCount(), 1));
+}
+
+int main(int argc, char** argv)
+{
+    printf("======================================\n");
+
+    trycle::initialize();
+
+    printf("--------------------------------------\n");
+
+    test_frame();
+
+    trycle::IOManager server_iom(1, false, "rpc_server");
+    auto server = create_server(&server_iom);
+    auto addr   = server->getListeners()[0]->getLocalAddress();
+    {
+        trycle::IOManager client_iom(1, false, "rpc_test");
+        client_iom.schedule(std::bind(&test_calls, addr));
+        client_iom.schedule(std::bind(&test_half_close, addr, "sleep", 3));
+    }
+
+    test_half_close_mt();
+
+    bench(addr, 1, 1000);
+    bench(addr, 64, 1000);
+
+    server->stop(100);
+
+    printf("--------------------------------------\n");
+
+    return 0;
+}
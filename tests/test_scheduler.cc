@@ -1,6 +1,9 @@
+#include "config.h"
 #include "initialize.h"
 #include "log.h"
+#include "macro.h"
 #include "scheduler.h"
+#include <atomic>
 #include <chrono>
 
 static auto g_logger = GET_LOGGER("system");
@@ -9,6 +12,7 @@ void test_func1()
 {
 
     static int test_count = 5;
+    trycle::Fiber::GetThis()->setTag("test_func1");
     LOG_DEBUG(g_logger, "test func1 runing....-----------" + std::to_string(test_count));
     std::this_thread::sleep_for(std::chrono::seconds(1));
 
@@ -22,6 +26,7 @@ void test_func2()
 {
 
     static int test_count2 = 10;
+    trycle::Fiber::GetThis()->setTag("test_func2");
     LOG_DEBUG(g_logger, "test func2 runing...." + std::to_string(test_count2));
     // std::this_thread::sleep_for(std::chrono::seconds(1));
 
@@ -31,6 +36,127 @@ void test_func2()
     }
 }
 
+void busy_task()
+{
+    // 模拟 1ms 左右的计算
+    uint64_t start = trycle::GetCurrentUs();
+    while (trycle::GetCurrentUs() - start < 1000)
+    {
+    }
+}
+
+void test_priority()
+{
+    trycle::Scheduler sc(1, false, "Scheduler-priority");
+    sc.start();
+
+    // 大量后台任务排在前面，交互任务以 HIGH 优先级插队
+    for (int i = 0; i < 200; i++)
+    {
+        sc.schedule(&busy_task, -1, trycle::Scheduler::LOW);
+        if (i % 20 == 0)
+        {
+            sc.schedule(&busy_task, -1, trycle::Scheduler::HIGH);
+        }
+    }
+    sc.stop();
+
+    std::cout << sc.dumpQueueDelay() << std::endl;
+
+    // HIGH 任务插队执行，排队延迟远小于排在前面的 LOW 任务
+    trycle::QueueDelaySnapshot high = sc.getQueueDelay(trycle::Scheduler::HIGH);
+    trycle::QueueDelaySnapshot low  = sc.getQueueDelay(trycle::Scheduler::LOW);
+    ASSERT(high.count == 10 && low.count == 200);
+    ASSERT(high.avg_us * 4 < low.avg_us);
+}
+
+static std::atomic<bool> s_feeding{false};
+static std::atomic<uint64_t> s_high_runs{0};
+static std::atomic<uint64_t> s_low_ran_at{0};
+static std::atomic<uint64_t> s_high_runs_before_low{0};
+
+// 每个 HIGH 任务执行完再把自己排回队列，队列中始终有 HIGH 任务
+void high_feeder()
+{
+    busy_task();
+    ++s_high_runs;
+    if (s_feeding)
+    {
+        trycle::Scheduler::GetThis()->schedule(&high_feeder, -1, trycle::Scheduler::HIGH);
+    }
+}
+
+// HIGH 任务源源不断时，LOW 任务靠老化仍然能被执行
+void test_aging()
+{
+    uint64_t aging_ms = trycle::Config::lookUp<uint64_t>("scheduler.aging_ms")->getVal();
+    trycle::Scheduler sc(1, false, "Scheduler-aging");
+    sc.start();
+
+    s_feeding      = true;
+    uint64_t start = trycle::GetCurrentMs();
+    for (int i = 0; i < 4; i++)
+    {
+        sc.schedule(&high_feeder, -1, trycle::Scheduler::HIGH);
+    }
+    sc.schedule([start]()
+                {
+                    s_low_ran_at           = trycle::GetCurrentMs() - start;
+                    s_high_runs_before_low = s_high_runs.load(); },
+                -1, trycle::Scheduler::LOW);
+
+    // 持续供给的时间远超 LOW 提升到 HIGH 之上所需的老化时间
+    uint64_t feed_ms = aging_ms * 10;
+    std::this_thread::sleep_for(std::chrono::milliseconds(feed_ms));
+    s_feeding = false;
+    sc.stop();
+
+    LOG_FMT_INFO(g_logger, "aging | low ran at %lu ms, high runs before %lu, total %lu",
+                 s_low_ran_at.load(), s_high_runs_before_low.load(), s_high_runs.load());
+    ASSERT(s_low_ran_at > 0 && s_low_ran_at < feed_ms);
+    // LOW 任务执行前后都有 HIGH 任务在跑
+    ASSERT(s_high_runs_before_low > 0);
+    ASSERT(s_high_runs > s_high_runs_before_low);
+}
+
+// 被唤醒的 HOLD 协程：唤醒前计入 hold，入队后排队的时间计入 ready；协程数只计一次
+void test_wait_split()
+{
+    static trycle::Fiber::ptr s_waiter;
+    trycle::Scheduler sc(1, false, "Scheduler-wait");
+    sc.start();
+    sc.schedule([]()
+                {
+                    trycle::Fiber::GetThis()->setTag("wait_split");
+                    s_waiter = trycle::Fiber::GetThis();
+                    trycle::Fiber::YieldToHold(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    // 唯一的工作线程先执行 30ms 的任务，协程在队列中等待
+    sc.schedule([]()
+                {
+                    uint64_t start = trycle::GetCurrentMs();
+                    while (trycle::GetCurrentMs() - start < 30)
+                    {
+                    } });
+    sc.schedule(std::move(s_waiter));
+    sc.stop();
+
+    std::vector<trycle::FiberStatsSnapshot> stats;
+    trycle::Fiber::GetTagStats(stats);
+    bool found = false;
+    for (auto& item : stats)
+    {
+        if (item.tag == "wait_split")
+        {
+            found = true;
+            ASSERT(item.fibers == 1);
+            ASSERT(item.hold_ns >= 40 * 1000 * 1000);
+            ASSERT(item.ready_ns >= 20 * 1000 * 1000);
+        }
+    }
+    ASSERT(found);
+}
+
 int main(int argc, char** argv)
 {
     printf("======================================\n");
@@ -54,5 +180,11 @@ int main(int argc, char** argv)
 
     sc.stop();
 
+    std::cout << trycle::Scheduler::DumpTopConsumers(5) << std::endl;
+
+    test_priority();
+    test_aging();
+    test_wait_split();
+
     printf("--------------------------------------\n");
 }
\ No newline at end of file
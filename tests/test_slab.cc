@@ -0,0 +1,246 @@
+#include <atomic>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+#include "initialize.h"
+#include "iomanager.h"
+#include "log.h"
+#include "macro.h"
+#include "slab.h"
+#include "thread.h"
+#include "timer.h"
+#include "util.h"
+
+static auto g_logger = GET_LOGGER("system");
+
+static size_t get_rss_kb()
+{
+    size_t pages = 0, resident = 0;
+    FILE* fp     = fopen("/proc/self/statm", "r");
+    if (fp)
+    {
+        ASSERT(fscanf(fp, "%zu %zu", &pages, &resident) == 2);
+        fclose(fp);
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// 对齐、同线程归还后复用、超过 MAX_SIZE 的直接 malloc
+void test_basic()
+{
+    auto before = trycle::SlabPool::GetStats();
+    std::vector<void*> ptrs;
+    for (size_t size = 1; size <= trycle::SlabPool::SMALL_SIZE; size += 7)
+    {
+        void* p = trycle::SlabPool::Allocate(size);
+        ASSERT((uintptr_t)p % trycle::SlabPool::GRANULE == 0);
+        memset(p, 0xab, size);
+        ptrs.push_back(p);
+    }
+    void* first = ptrs[0];
+    // 逆序归还，最后归还的 first 最先被复用
+    for (size_t i = ptrs.size(); i > 0; --i)
+    {
+        trycle::SlabPool::Deallocate(ptrs[i - 1], 1 + (i - 1) * 7);
+    }
+    ASSERT(trycle::SlabPool::Allocate(16) == first);
+    trycle::SlabPool::Deallocate(first, 16);
+
+    // 大尺寸档位，IOBuffer 的块、Arena 的块都落在这里
+    size_t large_sizes[] = {trycle::SlabPool::SMALL_SIZE + 1, 4096 + 64, 16 * 1024 + 64, trycle::SlabPool::MAX_SIZE};
+    for (auto size : large_sizes)
+    {
+        void* p = trycle::SlabPool::Allocate(size);
+        ASSERT((uintptr_t)p % trycle::SlabPool::GRANULE == 0);
+        memset(p, 0xcd, size);
+        trycle::SlabPool::Deallocate(p, size);
+        ASSERT(trycle::SlabPool::Allocate(size) == p);
+        trycle::SlabPool::Deallocate(p, size);
+    }
+
+    void* large = trycle::SlabPool::Allocate(trycle::SlabPool::MAX_SIZE + 1);
+    trycle::SlabPool::Deallocate(large, trycle::SlabPool::MAX_SIZE + 1);
+
+    auto after = trycle::SlabPool::GetStats();
+    ASSERT(after.allocs - before.allocs == ptrs.size() + 1 + 2 * sizeof(large_sizes) / sizeof(large_sizes[0]));
+    ASSERT(after.frees - before.frees == ptrs.size() + 1 + 2 * sizeof(large_sizes) / sizeof(large_sizes[0]));
+    ASSERT(after.large - before.large == 1);
+
+    // 对象和控制块一次分配，weak_ptr 释放后才归还
+    auto before_shared = trycle::SlabPool::GetStats();
+    std::weak_ptr<trycle::LogEvent> weak;
+    {
+        auto event = MAKE_LOG_EVENT(trycle::LogLevel::INFO, "slab");
+        weak       = event;
+        ASSERT(event->getContent() == "slab");
+    }
+    ASSERT(weak.expired());
+    ASSERT(trycle::SlabPool::GetStats().frees == before_shared.frees);
+    weak.reset();
+    auto after_shared = trycle::SlabPool::GetStats();
+    ASSERT(after_shared.allocs - before_shared.allocs == 1);
+    ASSERT(after_shared.frees - before_shared.frees == 1);
+}
+
+// 其他线程归还的对象回到所属线程，线程退出后缓存由新线程接管
+void test_threads()
+{
+    const int count = 1000;
+    std::vector<void*> ptrs;
+    for (int i = 0; i < count; ++i)
+    {
+        ptrs.push_back(trycle::SlabPool::Allocate(100));
+    }
+
+    auto before = trycle::SlabPool::GetStats();
+    trycle::Thread freer("slab_free", [&ptrs]()
+                         {
+                             for (auto p : ptrs)
+                             {
+                                 trycle::SlabPool::Deallocate(p, 100);
+                             } });
+    freer.join();
+    auto after = trycle::SlabPool::GetStats();
+    ASSERT(after.remote_frees - before.remote_frees >= (uint64_t)count);
+
+    for (int i = 0; i < count; ++i)
+    {
+        ptrs[i] = trycle::SlabPool::Allocate(100);
+    }
+    for (auto p : ptrs)
+    {
+        trycle::SlabPool::Deallocate(p, 100);
+    }
+    // 取回的是其他线程归还的对象，没有申请新的 slab
+    ASSERT(trycle::SlabPool::GetStats().slabs == after.slabs);
+
+    // 线程反复创建退出，缓存数不增长
+    uint64_t caches = 0;
+    for (int i = 0; i < 5; ++i)
+    {
+        trycle::Thread t("slab_tmp", []()
+                         { trycle::SlabPool::Deallocate(trycle::SlabPool::Allocate(64), 64); });
+        t.join();
+        if (i == 0)
+        {
+            caches = trycle::SlabPool::GetStats().caches;
+        }
+    }
+    ASSERT(trycle::SlabPool::GetStats().caches == caches);
+}
+
+// 调度器的协程、定时器、日志事件走 slab
+void test_framework()
+{
+    auto before = trycle::SlabPool::GetStats();
+    {
+        trycle::IOManager iom(2, false, "slab");
+        for (int i = 0; i < 100; ++i)
+        {
+            iom.addTimer(1, []() {}, false);
+            iom.schedule([]() {});
+        }
+    }
+    auto after = trycle::SlabPool::GetStats();
+    LOG_FMT_INFO(g_logger, "framework | iomanager with 100 timers + 100 tasks: %lu slab allocs, %lu remote frees, %lu slabs",
+                 after.allocs - before.allocs, after.remote_frees - before.remote_frees, after.slabs - before.slabs);
+    ASSERT(after.allocs - before.allocs >= 100);
+}
+
+/**
+ * 压测：threads 个线程，每轮创建一批 Timer 和 LogEvent（连同 shared_ptr 控制块），
+ * 交给下一个线程释放，模拟协程、定时器在一个线程创建、在另一个线程销毁
+ */
+template <typename Factory>
+static void churn(const char* name, Factory factory)
+{
+    const int threads = 4;
+    const int rounds  = 2000;
+    const int batch   = 256;
+
+    typedef std::vector<std::shared_ptr<void>> Batch;
+    // 每个线程的收件箱，存放上一个线程交来的批次
+    std::vector<std::vector<Batch>> inboxes(threads);
+    std::vector<trycle::Mutex> mutexes(threads);
+
+    auto before_stats = trycle::SlabPool::GetStats();
+    size_t before_rss = get_rss_kb();
+    uint64_t start    = trycle::GetCurrentUs();
+
+    std::vector<trycle::Thread::ptr> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.push_back(std::make_shared<trycle::Thread>("churn", [&, t]()
+                                                           {
+                                                               for (int r = 0; r < rounds; ++r)
+                                                               {
+                                                                   Batch mine;
+                                                                   mine.reserve(batch);
+                                                                   for (int i = 0; i < batch; ++i)
+                                                                   {
+                                                                       mine.push_back(factory(i));
+                                                                   }
+                                                                   int next = (t + 1) % threads;
+                                                                   {
+                                                                       trycle::Mutex::Lock lock(&mutexes[next]);
+                                                                       inboxes[next].push_back(std::move(mine));
+                                                                   }
+                                                                   // 上一个线程交来的批次在本线程释放
+                                                                   std::vector<Batch> theirs;
+                                                                   trycle::Mutex::Lock lock(&mutexes[t]);
+                                                                   theirs.swap(inboxes[t]);
+                                                                   lock.unlock();
+                                                               } }));
+    }
+    for (auto& w : workers)
+    {
+        w->join();
+    }
+    inboxes.clear();
+
+    uint64_t elapsed = trycle::GetCurrentUs() - start;
+    auto after_stats = trycle::SlabPool::GetStats();
+    uint64_t allocs  = after_stats.allocs - before_stats.allocs;
+    uint64_t slabs   = after_stats.slabs - before_stats.slabs;
+    LOG_FMT_INFO(g_logger, "churn %s | %d objects in %lu ms, slab allocs %lu (mallocs avoided %lu), remote frees %lu, rss delta %ld KB",
+                 name, threads * rounds * batch, elapsed / 1000, allocs, allocs - slabs,
+                 after_stats.remote_frees - before_stats.remote_frees, (long)get_rss_kb() - (long)before_rss);
+}
+
+void bench()
+{
+    std::string content(64, 'c');
+    churn("make_shared", [&content](int i) -> std::shared_ptr<void>
+          {
+              if (i % 2)
+              {
+                  return std::make_shared<trycle::Timer>(i);
+              }
+              return std::make_shared<trycle::LogEvent>(__FILE__, __LINE__, 0, 0, 0, content, trycle::LogLevel::INFO); });
+    churn("slab", [&content](int i) -> std::shared_ptr<void>
+          {
+              if (i % 2)
+              {
+                  return trycle::MakeSlabShared<trycle::Timer>(i);
+              }
+              return trycle::MakeSlabShared<trycle::LogEvent>(__FILE__, __LINE__, 0, 0, 0, content, trycle::LogLevel::INFO); });
+}
+
+int main(int argc, char** argv)
+{
+    printf("======================================\n");
+
+    trycle::initialize();
+
+    printf("--------------------------------------\n");
+
+    test_basic();
+    test_threads();
+    test_framework();
+    bench();
+
+    printf("--------------------------------------\n");
+
+    return 0;
+}
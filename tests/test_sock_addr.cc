@@ -0,0 +1,118 @@
+#include <netdb.h>
+#include <string.h>
+#include <unordered_set>
+
+#include "address.h"
+#include "initialize.h"
+#include "log.h"
+#include "macro.h"
+#include "sock_addr.h"
+#include "util.h"
+
+static auto g_logger = GET_LOGGER("system");
+
+void test_parse()
+{
+    trycle::SockAddr addr;
+    ASSERT(trycle::SockAddr::Parse("10.0.0.1:80", addr));
+    ASSERT(addr.isV4() && addr.getPort() == 80 && addr.toString() == "10.0.0.1:80");
+
+    ASSERT(trycle::SockAddr::Parse("10.0.0.1", addr, 8080));
+    ASSERT(addr.getPort() == 8080);
+
+    ASSERT(trycle::SockAddr::Parse("[::1]:443", addr));
+    ASSERT(addr.isV6() && addr.getPort() == 443 && addr.toString() == "[::1]:443");
+
+    ASSERT(trycle::SockAddr::Parse("fe80::1", addr, 53));
+    ASSERT(addr.isV6() && addr.getPort() == 53);
+
+    // 非数字地址和格式错误
+    const char* bad[] = {"localhost:80", "10.0.0.1:", "10.0.0.1:65536", "10.0.0", "[::1", "[::1]80", "", "1.2.3.4:8x"};
+    for (auto str : bad)
+    {
+        ASSERT_M(!trycle::SockAddr::Parse(str, addr), std::string("should not parse: ") + str);
+    }
+    LOG_DEBUG(g_logger, "test_parse ok");
+}
+
+void test_compare_hash()
+{
+    trycle::SockAddr a, b, c;
+    trycle::SockAddr::Parse("192.168.1.1:80", a);
+    trycle::SockAddr::Parse("192.168.1.1:80", b);
+    trycle::SockAddr::Parse("192.168.1.1:81", c);
+    ASSERT(a == b && a != c && a < c && !(c < a));
+    ASSERT(std::hash<trycle::SockAddr>()(a) == std::hash<trycle::SockAddr>()(b));
+
+    std::unordered_set<trycle::SockAddr> set;
+    for (int i = 0; i < 1000; i++)
+    {
+        trycle::SockAddr addr;
+        trycle::SockAddr::Parse("10.0." + std::to_string(i / 256) + "." + std::to_string(i % 256), addr, 80);
+        set.insert(addr);
+        set.insert(addr);
+    }
+    ASSERT(set.size() == 1000);
+
+    // 与 Address 互相转换
+    auto address = a.toAddress();
+    ASSERT(address && std::dynamic_pointer_cast<trycle::Ipv4Address>(address));
+    ASSERT(trycle::SockAddr(*address) == a);
+    ASSERT(*address == *trycle::Address::Create(a.getAddr(), a.getAddrLen()));
+    LOG_FMT_DEBUG(g_logger, "test_compare_hash ok | %s", address->toString().c_str());
+}
+
+// 数字地址不再经过 getaddrinfo
+void bench_parse()
+{
+    const int LOOPS = 100000;
+    uint64_t start  = trycle::GetMonotonicNs();
+    for (int i = 0; i < LOOPS; i++)
+    {
+        trycle::SockAddr addr;
+        trycle::SockAddr::Parse("10.0.0.1:80", addr);
+    }
+    double fast = (double)(trycle::GetMonotonicNs() - start) / LOOPS;
+
+    start = trycle::GetMonotonicNs();
+    for (int i = 0; i < LOOPS; i++)
+    {
+        addrinfo hints, *results;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_flags  = AI_NUMERICHOST | AI_NUMERICSERV;
+        hints.ai_family = AF_UNSPEC;
+        if (getaddrinfo("10.0.0.1", "80", &hints, &results) == 0)
+        {
+            freeaddrinfo(results);
+        }
+    }
+    double gai = (double)(trycle::GetMonotonicNs() - start) / LOOPS;
+
+    start = trycle::GetMonotonicNs();
+    for (int i = 0; i < LOOPS; i++)
+    {
+        std::vector<trycle::Address::ptr> result;
+        trycle::Address::Lookup(result, "10.0.0.1:80");
+    }
+    double lookup = (double)(trycle::GetMonotonicNs() - start) / LOOPS;
+
+    LOG_FMT_INFO(g_logger, "numeric parse | SockAddr::Parse=%.1f ns, getaddrinfo(AI_NUMERICHOST)=%.1f ns, Address::Lookup=%.1f ns",
+                 fast, gai, lookup);
+}
+
+int main(int argc, char** argv)
+{
+    printf("======================================\n");
+
+    trycle::initialize();
+
+    printf("--------------------------------------\n");
+
+    test_parse();
+    test_compare_hash();
+    bench_parse();
+
+    printf("--------------------------------------\n");
+
+    return 0;
+}
@@ -0,0 +1,184 @@
+#include <atomic>
+#include <string.h>
+#include <unistd.h>
+
+#include "address.h"
+#include "initialize.h"
+#include "iomanager.h"
+#include "log.h"
+#include "macro.h"
+#include "socket.h"
+#include "thread.h"
+#include "util.h"
+
+static auto g_logger = GET_LOGGER("system");
+
+static trycle::Socket::ptr create_listener()
+{
+    auto addr = trycle::Address::LookupAnyIpAddress("127.0.0.1:0");
+    auto sock = trycle::Socket::CreateTCP(addr);
+    ASSERT(sock->bind(addr) && sock->listen());
+    return sock;
+}
+
+// 回环 echo：服务端 accept 后原样回发，客户端收发并校验
+void test_echo()
+{
+    auto server = create_listener();
+    auto local  = server->getLocalAddress();
+    LOG_FMT_INFO(g_logger, "listen | %s", server->toString().c_str());
+
+    trycle::IOManager::GetThis()->schedule([server]()
+                                           {
+                                               auto conn = server->accept();
+                                               ASSERT(conn);
+                                               // 监听在具体地址上，新连接的本地地址直接继承，不需要 getsockname
+                                               ASSERT(conn->getLocalAddress() == server->getLocalAddress());
+                                               ASSERT(conn->getNoDelay());
+                                               char buf[256];
+                                               ssize_t n;
+                                               while ((n = conn->recv(buf, sizeof(buf))) > 0)
+                                               {
+                                                   conn->send(buf, n);
+                                               }
+                                               LOG_FMT_INFO(g_logger, "server | %s closed", conn->toString().c_str()); });
+
+    auto client = trycle::Socket::CreateTCP(local);
+    ASSERT(client->connect(local, 1000));
+    ASSERT(client->getRemoteAddress()->toString() == local->toString());
+
+    const char* msgs[] = {"hello", "socket", "echo"};
+    for (const char* msg : msgs)
+    {
+        iovec iov[2];
+        char prefix  = '>';
+        iov[0]       = {&prefix, 1};
+        iov[1]       = {(void*)msg, strlen(msg)};
+        ssize_t want = 1 + strlen(msg);
+        ASSERT(client->send(iov, 2) == want);
+
+        std::string got;
+        char buf[256];
+        while ((ssize_t)got.size() < want)
+        {
+            ssize_t n = client->recv(buf, sizeof(buf));
+            ASSERT(n > 0);
+            got.append(buf, n);
+        }
+        ASSERT(got == std::string(">") + msg);
+    }
+    LOG_FMT_INFO(g_logger, "client | %s", client->toString().c_str());
+    client->close();
+}
+
+// 选项缓存：重复设置相同的值不会再调用 setsockopt
+void test_options()
+{
+    auto sock = trycle::Socket::CreateTCPSocket();
+    ASSERT(!sock->isValid());
+    ASSERT(sock->setReusePort(true) && sock->getReusePort());
+    ASSERT(sock->isValid() && sock->getNoDelay());
+
+    ASSERT(sock->setSendBufferSize(64 * 1024));
+    int actual = sock->getSendBufferSize();
+    ASSERT(actual >= 64 * 1024);
+    ASSERT(sock->setSendBufferSize(64 * 1024) && sock->getSendBufferSize() == actual);
+
+    uint64_t start = trycle::GetMonotonicNs();
+    for (int i = 0; i < 100000; i++)
+    {
+        sock->setNoDelay(true);
+    }
+    LOG_FMT_INFO(g_logger, "options | send buffer=%d, cached setNoDelay=%.1f ns/call",
+                 actual, (double)(trycle::GetMonotonicNs() - start) / 100000);
+}
+
+// 收超时写入 FdCtx，到期返回 ETIMEDOUT；cancelAll 唤醒阻塞的 recv
+void test_timeout_cancel()
+{
+    auto server = create_listener();
+    auto client = trycle::Socket::CreateTCP(server->getLocalAddress());
+    client->setRecvTimeout(100);
+    ASSERT(client->connect(server->getLocalAddress()));
+    auto conn = server->accept();
+    ASSERT(conn);
+
+    char c;
+    uint64_t start = trycle::GetCurrentMs();
+    ssize_t n      = client->recv(&c, 1);
+    int err        = errno;
+    LOG_FMT_INFO(g_logger, "recv timeout | n=%d, errno=%s, elapsed=%lu ms",
+                 (int)n, strerror(err), trycle::GetCurrentMs() - start);
+    ASSERT(n == -1 && err == ETIMEDOUT);
+
+    client->setRecvTimeout(-1);
+    trycle::IOManager::GetThis()->addTimer(50, [client]()
+                                           { client->cancelAll(); }, false);
+    start = trycle::GetCurrentMs();
+    n     = client->recv(&c, 1);
+    err   = errno;
+    LOG_FMT_INFO(g_logger, "recv cancel | n=%d, errno=%s, elapsed=%lu ms",
+                 (int)n, strerror(err), trycle::GetCurrentMs() - start);
+    ASSERT(n == -1 && err == ECANCELED);
+}
+
+// 读写取消互不影响；在没有 IOManager 的线程上取消，唤醒挂在 IOManager 上的协程
+void test_cancel_direction()
+{
+    auto server = create_listener();
+    auto client = trycle::Socket::CreateTCP(server->getLocalAddress());
+    ASSERT(client->connect(server->getLocalAddress()));
+    auto conn = server->accept();
+    ASSERT(conn);
+
+    std::atomic<int> read_err{0};
+    std::atomic<int> write_err{0};
+    trycle::IOManager::GetThis()->schedule([client, &read_err]()
+                                           {
+                                               char c;
+                                               ssize_t n = client->recv(&c, 1);
+                                               read_err  = n == -1 ? errno : -1; });
+    trycle::IOManager::GetThis()->schedule([client, &write_err]()
+                                           {
+                                               // 对端不读，写满缓冲区后挂起
+                                               std::string data(64 * 1024, 'w');
+                                               while (client->send(data.data(), data.size()) > 0)
+                                               {
+                                               }
+                                               write_err = errno; });
+    usleep(50 * 1000);
+    ASSERT(read_err == 0 && write_err == 0);
+
+    trycle::Thread writer_canceller("cancel_write", [client]()
+                                    { ASSERT(client->cancelWrite()); });
+    writer_canceller.join();
+    usleep(50 * 1000);
+    LOG_FMT_INFO(g_logger, "cancel write | write errno=%s, reader still waiting=%d",
+                 strerror(write_err), read_err == 0);
+    ASSERT(write_err == ECANCELED && read_err == 0);
+
+    trycle::Thread reader_canceller("cancel_read", [client]()
+                                    { ASSERT(client->cancelRead()); });
+    reader_canceller.join();
+    usleep(50 * 1000);
+    ASSERT(read_err == ECANCELED);
+}
+
+int main(int argc, char** argv)
+{
+    printf("======================================\n");
+
+    trycle::initialize();
+
+    printf("--------------------------------------\n");
+
+    trycle::IOManager iom(1, false, "socket");
+    iom.schedule(test_echo);
+    iom.schedule(test_options);
+    iom.schedule(test_timeout_cancel);
+    iom.schedule(test_cancel_direction);
+
+    printf("--------------------------------------\n");
+
+    return 0;
+}
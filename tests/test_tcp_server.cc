@@ -0,0 +1,207 @@
+#include <string.h>
+#include <sys/socket.h>
+
+#include "address.h"
+#include "initialize.h"
+#include "iomanager.h"
+#include "log.h"
+#include "macro.h"
+#include "socket.h"
+#include "tcp_server.h"
+#include "util.h"
+
+static auto g_logger = GET_LOGGER("system");
+
+// 按行回显，收到 EOF 或出错时返回
+class EchoServer : public trycle::TcpServer
+{
+public:
+    using TcpServer::TcpServer;
+
+protected:
+    void handleClient(trycle::Socket::ptr client) override
+    {
+        char buf[1024];
+        ssize_t n;
+        while ((n = client->recv(buf, sizeof(buf))) > 0)
+        {
+            if (client->send(buf, n) != n)
+            {
+                break;
+            }
+        }
+    }
+};
+
+static bool echo_once(trycle::Address::ptr addr, const std::string& msg)
+{
+    auto sock = trycle::Socket::CreateTCP(addr);
+    if (!sock->connect(addr, 1000) || sock->send(msg.data(), msg.size()) != (ssize_t)msg.size())
+    {
+        return false;
+    }
+    std::string got;
+    char buf[1024];
+    while (got.size() < msg.size())
+    {
+        ssize_t n = sock->recv(buf, sizeof(buf));
+        if (n <= 0)
+        {
+            return false;
+        }
+        got.append(buf, n);
+    }
+    return got == msg;
+}
+
+// 2 个 acceptor、2 个 worker IOManager（各 2 个线程），不同分发策略下的回显和计数
+void test_dispatch(trycle::TcpServer::Dispatch dispatch)
+{
+    trycle::IOManager acceptor1(1, false, "acceptor1");
+    trycle::IOManager acceptor2(1, false, "acceptor2");
+    trycle::IOManager worker1(2, false, "worker1");
+    trycle::IOManager worker2(2, false, "worker2");
+
+    auto server = std::make_shared<EchoServer>(std::vector<trycle::IOManager*>{&worker1, &worker2},
+                                               std::vector<trycle::IOManager*>{&acceptor1, &acceptor2});
+    server->setName("echo");
+    server->setDispatch(dispatch);
+    ASSERT(server->bind(trycle::Address::LookupAnyIpAddress("127.0.0.1:0")));
+    ASSERT(server->getListeners().size() == 2);
+    auto addr = server->getListeners()[0]->getLocalAddress();
+    ASSERT(addr->toString() == server->getListeners()[1]->getLocalAddress()->toString());
+    server->start();
+
+    const int CLIENTS = 64;
+    std::atomic<int> ok{0};
+    {
+        trycle::IOManager client(2, false, "client");
+        for (int i = 0; i < CLIENTS; i++)
+        {
+            client.schedule([addr, i, &ok]()
+                            {
+                                if (echo_once(addr, "hello " + std::to_string(i)))
+                                {
+                                    ++ok;
+                                } });
+        }
+    }
+    ASSERT(ok == CLIENTS);
+
+    server->stop();
+    auto stats = server->getStats();
+    LOG_FMT_INFO(g_logger, "dispatch=%d | %s", (int)dispatch, server->dump().c_str());
+    ASSERT(stats.accepted == CLIENTS && stats.closed == CLIENTS && stats.active == 0);
+}
+
+// 连接数上限：超过的连接被直接关闭
+void test_max_connections()
+{
+    trycle::IOManager iom(2, false, "limit");
+    auto server = std::make_shared<EchoServer>(&iom, &iom);
+    server->setMaxConnections(2);
+    ASSERT(server->bind(trycle::Address::LookupAnyIpAddress("127.0.0.1:0")));
+    auto addr = server->getListeners()[0]->getLocalAddress();
+    server->start();
+
+    trycle::IOManager client(1, false, "limit_client");
+    std::vector<trycle::Socket::ptr> held;
+    client.schedule([server, addr, &held]()
+                    {
+                        for (int i = 0; i < 2; i++)
+                        {
+                            auto sock = trycle::Socket::CreateTCP(addr);
+                            ASSERT(sock->connect(addr, 1000));
+                            held.push_back(sock);
+                        }
+                        // 等服务端把前两个连接计入 active
+                        while (server->getStats().active != 2)
+                        {
+                            usleep(1000);
+                        }
+                        auto extra = trycle::Socket::CreateTCP(addr);
+                        ASSERT(extra->connect(addr, 1000));
+                        char c;
+                        extra->setRecvTimeout(1000);
+                        ASSERT(extra->recv(&c, 1) == 0);
+                        for (auto& sock : held)
+                        {
+                            sock->close();
+                        } });
+    client.stop();
+
+    server->stop();
+    auto stats = server->getStats();
+    LOG_FMT_INFO(g_logger, "max connections | %s", server->dump().c_str());
+    ASSERT(stats.rejected == 1 && stats.peak == 2);
+}
+
+// 优雅停止：空闲连接在 drain 超时后被 shutdown，handleClient 返回
+void test_graceful_stop()
+{
+    trycle::IOManager iom(2, false, "drain");
+    auto server = std::make_shared<EchoServer>(&iom, &iom);
+    ASSERT(server->bind(trycle::Address::LookupAnyIpAddress("127.0.0.1:0")));
+    auto addr = server->getListeners()[0]->getLocalAddress();
+    server->start();
+
+    trycle::IOManager client(1, false, "drain_client");
+    client.schedule([addr]()
+                    {
+                        auto sock = trycle::Socket::CreateTCP(addr);
+                        ASSERT(sock->connect(addr, 1000));
+                        char c;
+                        // 服务端停止时被 shutdown，读到 EOF
+                        ASSERT(sock->recv(&c, 1) == 0); });
+    while (server->getStats().active != 1)
+    {
+        usleep(1000);
+    }
+
+    uint64_t start = trycle::GetCurrentMs();
+    server->stop(100);
+    uint64_t elapsed = trycle::GetCurrentMs() - start;
+    LOG_FMT_INFO(g_logger, "graceful stop | elapsed=%lu ms, %s", elapsed, server->dump().c_str());
+    ASSERT(elapsed >= 100 && server->getStats().active == 0);
+}
+
+// 监听 socket 失效（shutdown 后 accept 返回 EINVAL）时 acceptor 退出循环，而不是空转
+void test_broken_listener()
+{
+    trycle::IOManager iom(1, false, "broken");
+    auto server = std::make_shared<EchoServer>(&iom, &iom);
+    ASSERT(server->bind(trycle::Address::LookupAnyIpAddress("127.0.0.1:0")));
+    int listen_fd = server->getListeners()[0]->getSocket();
+    server->start();
+    usleep(50 * 1000);
+
+    ::shutdown(listen_fd, SHUT_RDWR);
+    usleep(200 * 1000);
+    auto stats = server->getStats();
+    LOG_FMT_INFO(g_logger, "broken listener | %s", server->dump().c_str());
+    ASSERT(stats.accept_errors >= 1 && stats.accept_errors <= 2);
+
+    uint64_t start = trycle::GetCurrentMs();
+    server->stop();
+    ASSERT(trycle::GetCurrentMs() - start < 1000);
+}
+
+int main(int argc, char** argv)
+{
+    printf("======================================\n");
+
+    trycle::initialize();
+
+    printf("--------------------------------------\n");
+
+    test_dispatch(trycle::TcpServer::ROUND_ROBIN);
+    test_dispatch(trycle::TcpServer::LEAST_CONNECTIONS);
+    test_dispatch(trycle::TcpServer::FD_HASH);
+    test_max_connections();
+    test_graceful_stop();
+    test_broken_listener();
+
+    printf("--------------------------------------\n");
+
+    return 0;
+}
@@ -0,0 +1,254 @@
+#include <arpa/inet.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "datagram.h"
+#include "initialize.h"
+#include "iomanager.h"
+#include "log.h"
+#include "macro.h"
+#include "util.h"
+
+static auto g_logger = GET_LOGGER("system");
+
+static const int BURST            = 32;
+static const size_t PAYLOAD       = 64;
+static const uint64_t DURATION_MS = 1000;
+
+static int create_udp(sockaddr_in& addr)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, (sockaddr*)&addr, sizeof(addr));
+    socklen_t len = sizeof(addr);
+    getsockname(fd, (sockaddr*)&addr, &len);
+    // 丢包时不至于一直挂起
+    timeval tv{0, 200 * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return fd;
+}
+
+// 每个报文开头是序号，其余字节由序号决定，回包可以逐字节核对
+static void fill_payload(char* data, uint64_t seq)
+{
+    memcpy(data, &seq, sizeof(seq));
+    memset(data + sizeof(seq), 'a' + seq % 26, PAYLOAD - sizeof(seq));
+}
+
+// 回包必须与发出的某个报文完全相同；超时后迟到的旧报文序号更小，也是合法的回包
+static void check_echo(const char* data, size_t len, uint64_t next_seq)
+{
+    ASSERT(len == PAYLOAD);
+    uint64_t seq;
+    memcpy(&seq, data, sizeof(seq));
+    ASSERT(seq < next_seq);
+    for (size_t i = sizeof(seq); i < PAYLOAD; i++)
+    {
+        ASSERT(data[i] == (char)('a' + seq % 26));
+    }
+}
+
+// 服务端：收到什么就回什么，fd 被关闭后退出
+static void echo_server(int fd, bool batch)
+{
+    if (batch)
+    {
+        trycle::DatagramBatch batch(BURST);
+        while (true)
+        {
+            int n = batch.recv(fd);
+            if (n < 0 && errno != ETIMEDOUT)
+            {
+                break;
+            }
+            if (n > 0)
+            {
+                batch.send(fd);
+            }
+        }
+        return;
+    }
+
+    char buf[2048];
+    while (true)
+    {
+        sockaddr_in from;
+        socklen_t len = sizeof(from);
+        ssize_t n     = recvfrom(fd, buf, sizeof(buf), 0, (sockaddr*)&from, &len);
+        if (n < 0 && errno != ETIMEDOUT)
+        {
+            break;
+        }
+        if (n > 0)
+        {
+            sendto(fd, buf, n, 0, (sockaddr*)&from, len);
+        }
+    }
+}
+
+// 客户端：每轮发 BURST 个报文，再收回 BURST 个回包，统计每秒回包数
+static uint64_t echo_client(int fd, const sockaddr_in& server, bool batch)
+{
+    char payload[PAYLOAD];
+    uint64_t seq    = 0;
+    uint64_t echoed = 0;
+    uint64_t start  = trycle::GetCurrentMs();
+    trycle::DatagramBatch out(BURST);
+    trycle::DatagramBatch in(BURST);
+    while (trycle::GetCurrentMs() - start < DURATION_MS)
+    {
+        int received = 0;
+        if (batch)
+        {
+            for (int i = 0; i < BURST; i++)
+            {
+                fill_payload(payload, seq++);
+                out.push(payload, sizeof(payload), (const sockaddr*)&server, sizeof(server));
+            }
+            out.send(fd);
+            while (received < BURST)
+            {
+                int n = in.recv(fd);
+                if (n <= 0)
+                {
+                    break;
+                }
+                for (int i = 0; i < n; i++)
+                {
+                    check_echo(in.data(i), in.length(i), seq);
+                }
+                received += n;
+            }
+        }
+        else
+        {
+            for (int i = 0; i < BURST; i++)
+            {
+                fill_payload(payload, seq++);
+                sendto(fd, payload, sizeof(payload), 0, (const sockaddr*)&server, sizeof(server));
+            }
+            char buf[2048];
+            while (received < BURST)
+            {
+                ssize_t n = recv(fd, buf, sizeof(buf), 0);
+                if (n <= 0)
+                {
+                    break;
+                }
+                check_echo(buf, n, seq);
+                ++received;
+            }
+        }
+        echoed += received;
+    }
+    return echoed * 1000 / (trycle::GetCurrentMs() - start);
+}
+
+// 单线程 IOManager 上同时跑服务端和客户端，得到的是每核的回包速率
+static void run_echo(bool batch)
+{
+    trycle::IOManager iom(1, false, batch ? "udp_batch" : "udp_single");
+    iom.schedule([batch]()
+                 {
+                     sockaddr_in server_addr, client_addr;
+                     int server = create_udp(server_addr);
+                     int client = create_udp(client_addr);
+                     trycle::IOManager::GetThis()->schedule([server, batch]()
+                                                            { echo_server(server, batch); });
+                     uint64_t pps = echo_client(client, server_addr, batch);
+                     ASSERT(pps > 0);
+                     LOG_FMT_INFO(g_logger, "udp echo %s | burst=%d, payload=%d, %lu echo/s per core",
+                                  batch ? "recvmmsg/sendmmsg" : "recvfrom/sendto", BURST, (int)PAYLOAD, pps);
+                     close(client);
+                     close(server); });
+}
+
+// GSO：一次提交 BURST 个报文的数据，内核切分；GRO：接收端可能把它们合并回一个槽位
+static void test_gso_gro()
+{
+    trycle::IOManager iom(1, false, "udp_gso");
+    iom.schedule([]()
+                 {
+                     sockaddr_in server_addr, client_addr;
+                     int server = create_udp(server_addr);
+                     int client = create_udp(client_addr);
+                     bool gro   = trycle::DatagramBatch::EnableGro(server);
+
+                     trycle::DatagramBatch out(1, BURST * PAYLOAD);
+                     std::string data(BURST * PAYLOAD, 'g');
+                     bool pushed = out.push(data.data(), data.size(), (const sockaddr*)&server_addr, sizeof(server_addr), PAYLOAD);
+                     ASSERT(pushed == trycle::DatagramBatch::SupportGso());
+                     if (!pushed)
+                     {
+                         LOG_INFO(g_logger, "udp gso | not supported by headers");
+                         close(client);
+                         close(server);
+                         return;
+                     }
+                     int sent = out.send(client);
+                     if (sent != 1)
+                     {
+                         LOG_FMT_INFO(g_logger, "udp gso | not supported by kernel, errno=%s", strerror(errno));
+                         close(client);
+                         close(server);
+                         return;
+                     }
+
+                     trycle::DatagramBatch in(BURST, BURST * PAYLOAD);
+                     size_t bytes = 0;
+                     int slots    = 0;
+                     uint16_t seg = 0;
+                     while (bytes < data.size())
+                     {
+                         int n = in.recv(server);
+                         if (n <= 0)
+                         {
+                             break;
+                         }
+                         for (int i = 0; i < n; i++)
+                         {
+                             // 内核按 gso_size 切分；GRO 合并的槽位按同样的段长记录，未合并的槽位正好一段
+                             if (in.segmentSize(i))
+                             {
+                                 ASSERT(gro && in.segmentSize(i) == PAYLOAD && in.length(i) % PAYLOAD == 0);
+                             }
+                             else
+                             {
+                                 ASSERT(in.length(i) == PAYLOAD);
+                             }
+                             ASSERT(std::string(in.data(i), in.length(i)) == std::string(in.length(i), 'g'));
+                             bytes += in.length(i);
+                             seg = std::max(seg, in.segmentSize(i));
+                         }
+                         slots += n;
+                     }
+                     LOG_FMT_INFO(g_logger, "udp gso/gro | sent 1 x %d bytes (gso_size=%d), gro=%d, received %d bytes in %d slots, gro segment=%d",
+                                  (int)data.size(), (int)PAYLOAD, gro, (int)bytes, slots, seg);
+                     ASSERT(bytes == data.size());
+                     if (!gro)
+                     {
+                         ASSERT(slots == BURST);
+                     }
+                     close(client);
+                     close(server); });
+}
+
+int main(int argc, char** argv)
+{
+    printf("======================================\n");
+
+    trycle::initialize();
+
+    printf("--------------------------------------\n");
+
+    run_echo(false);
+    run_echo(true);
+    test_gso_gro();
+
+    printf("--------------------------------------\n");
+
+    return 0;
+}
@@ -0,0 +1,300 @@
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "initialize.h"
+#include "iomanager.h"
+#include "log.h"
+#include "macro.h"
+#include "thread.h"
+#include "util.h"
+#include "zero_copy.h"
+
+static auto g_logger = GET_LOGGER("system");
+
+static const size_t FILE_SIZE  = 64 * 1024 * 1024;
+static const size_t PROXY_SIZE = 8 * 1024 * 1024;
+
+static int listen_loopback(sockaddr_in& addr)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, (sockaddr*)&addr, sizeof(addr));
+    socklen_t len = sizeof(addr);
+    getsockname(fd, (sockaddr*)&addr, &len);
+    listen(fd, 16);
+    return fd;
+}
+
+static int connect_to(const sockaddr_in& addr)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT(connect(fd, (const sockaddr*)&addr, sizeof(addr)) == 0);
+    return fd;
+}
+
+// 第 i 个字节的内容，接收端据此校验
+static char pattern(size_t i)
+{
+    return (char)(i * 131 + (i >> 12));
+}
+
+static int create_file(size_t size)
+{
+    char path[] = "/tmp/trycle_zero_copy_XXXXXX";
+    int fd      = mkstemp(path);
+    unlink(path);
+    std::string buf(1024 * 1024, 0);
+    for (size_t off = 0; off < size; off += buf.size())
+    {
+        for (size_t i = 0; i < buf.size(); i++)
+        {
+            buf[i] = pattern(off + i);
+        }
+        ASSERT(write(fd, buf.data(), buf.size()) == (ssize_t)buf.size());
+    }
+    return fd;
+}
+
+// hook 后的 write 和非阻塞写一样可能只写出一部分
+static bool write_all(int fd, const char* data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = write(fd, data, len);
+        if (n <= 0)
+        {
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+// 读到 EOF，抽样校验内容（逐字节校验会掩盖传输本身的开销），返回读到的字节数
+static size_t read_verify(int fd, size_t offset)
+{
+    std::string buf(256 * 1024, 0);
+    size_t total = 0;
+    while (true)
+    {
+        ssize_t n = read(fd, &buf[0], buf.size());
+        if (n <= 0)
+        {
+            break;
+        }
+        for (ssize_t i = 0; i < n; i += 61)
+        {
+            ASSERT(buf[i] == pattern(offset + total + i));
+        }
+        total += n;
+    }
+    return total;
+}
+
+// 传统做法：read 到用户态缓冲区再 write 出去
+static ssize_t copy_file(int fd_out, int file_fd, off_t offset, size_t len)
+{
+    std::string buf(256 * 1024, 0);
+    size_t sent = 0;
+    while (sent < len)
+    {
+        ssize_t n = pread(file_fd, &buf[0], std::min(buf.size(), len - sent), offset + sent);
+        if (n <= 0)
+        {
+            break;
+        }
+        if (!write_all(fd_out, buf.data(), n))
+        {
+            break;
+        }
+        sent += n;
+    }
+    return sent;
+}
+
+// 单线程上一个协程发文件，一个协程收并校验
+static void test_transfer_file(bool zero_copy)
+{
+    trycle::IOManager iom(1, false, zero_copy ? "sendfile" : "read_write");
+    iom.schedule([zero_copy]()
+                 {
+                     int file = create_file(FILE_SIZE);
+                     sockaddr_in addr;
+                     int listener = listen_loopback(addr);
+                     trycle::IOManager::GetThis()->schedule([addr]()
+                                                            {
+                                                                int fd = connect_to(addr);
+                                                                // 从偏移 1000 开始发
+                                                                size_t n = read_verify(fd, 1000);
+                                                                ASSERT(n == FILE_SIZE - 1000);
+                                                                close(fd); });
+                     int conn       = accept(listener, nullptr, nullptr);
+                     uint64_t start = trycle::GetMonotonicNs();
+                     ssize_t sent   = zero_copy ? trycle::transferFile(conn, file, 1000, FILE_SIZE)
+                                                : copy_file(conn, file, 1000, FILE_SIZE);
+                     uint64_t ns    = trycle::GetMonotonicNs() - start;
+                     ASSERT(sent == (ssize_t)(FILE_SIZE - 1000));
+                     LOG_FMT_INFO(g_logger, "file transfer %s | %d MB, %.1f MB/s",
+                                  zero_copy ? "sendfile" : "read/write", (int)(FILE_SIZE >> 20),
+                                  (double)sent / (1 << 20) / ns * 1e9);
+                     close(conn);
+                     close(listener);
+                     close(file); });
+}
+
+// 客户端 -> 代理 -> 回显服务端 -> 代理 -> 客户端，代理用 splice 转发
+static void test_proxy()
+{
+    trycle::IOManager iom(1, false, "splice_proxy");
+    iom.schedule([]()
+                 {
+                     sockaddr_in backend_addr, proxy_addr;
+                     int backend = listen_loopback(backend_addr);
+                     int proxy   = listen_loopback(proxy_addr);
+                     trycle::IOManager* iom = trycle::IOManager::GetThis();
+
+                     // 回显服务端
+                     iom->schedule([backend]()
+                                   {
+                                       int fd = accept(backend, nullptr, nullptr);
+                                       char buf[16 * 1024];
+                                       ssize_t n;
+                                       while ((n = read(fd, buf, sizeof(buf))) > 0)
+                                       {
+                                           ASSERT(write_all(fd, buf, n));
+                                       }
+                                       close(fd);
+                                       close(backend); });
+                     // 代理
+                     iom->schedule([proxy, backend_addr]()
+                                   {
+                                       int client = accept(proxy, nullptr, nullptr);
+                                       int server = connect_to(backend_addr);
+                                       ASSERT(trycle::spliceProxy(client, server));
+                                       close(proxy); });
+
+                     int fd = connect_to(proxy_addr);
+                     iom->schedule([fd]()
+                                   {
+                                       std::string buf(64 * 1024, 0);
+                                       for (size_t off = 0; off < PROXY_SIZE; off += buf.size())
+                                       {
+                                           for (size_t i = 0; i < buf.size(); i++)
+                                           {
+                                               buf[i] = pattern(off + i);
+                                           }
+                                           ASSERT(write_all(fd, buf.data(), buf.size()));
+                                       }
+                                       shutdown(fd, SHUT_WR); });
+                     uint64_t start = trycle::GetMonotonicNs();
+                     size_t n       = read_verify(fd, 0);
+                     uint64_t ns    = trycle::GetMonotonicNs() - start;
+                     ASSERT(n == PROXY_SIZE);
+                     LOG_FMT_INFO(g_logger, "splice proxy | echoed %d MB through proxy, %.1f MB/s",
+                                  (int)(PROXY_SIZE >> 20), (double)n / (1 << 20) / ns * 1e9);
+                     close(fd); });
+}
+
+// 大块数据走 MSG_ZEROCOPY，小块数据拷贝发送；flush 之后所有缓冲区都已释放
+static void test_msg_zerocopy()
+{
+    trycle::IOManager iom(1, false, "msg_zerocopy");
+    iom.schedule([]()
+                 {
+                     sockaddr_in addr;
+                     int listener = listen_loopback(addr);
+                     trycle::IOManager::GetThis()->schedule([addr]()
+                                                            {
+                                                                int fd = connect_to(addr);
+                                                                size_t n = read_verify(fd, 0);
+                                                                ASSERT(n == PROXY_SIZE);
+                                                                close(fd); });
+                     int conn    = accept(listener, nullptr, nullptr);
+                     auto sender = trycle::ZeroCopySender::Create(conn);
+
+                     // 每个 1MB 的块交给 sender 持有，这里不再保留引用
+                     std::weak_ptr<std::string> last;
+                     const size_t block = 1024 * 1024;
+                     for (size_t off = 0; off < PROXY_SIZE - block; off += block)
+                     {
+                         auto buf = std::make_shared<std::string>(block, 0);
+                         for (size_t i = 0; i < block; i++)
+                         {
+                             (*buf)[i] = pattern(off + i);
+                         }
+                         ASSERT(sender->send(buf, buf->data(), buf->size()) == (ssize_t)block);
+                         last = buf;
+                     }
+                     // 最后一块拆成小于阈值的小块，走普通拷贝
+                     std::string tail(1000, 0);
+                     for (size_t off = PROXY_SIZE - block; off < PROXY_SIZE; off += tail.size())
+                     {
+                         size_t len = std::min(tail.size(), PROXY_SIZE - off);
+                         for (size_t i = 0; i < len; i++)
+                         {
+                             tail[i] = pattern(off + i);
+                         }
+                         ASSERT(sender->send(nullptr, tail.data(), len) == (ssize_t)len);
+                     }
+
+                     bool flushed = sender->flush(5000);
+                     LOG_FMT_INFO(g_logger, "msg_zerocopy | enabled=%d, zerocopy sends=%lu, copy sends=%lu, "
+                                            "kernel copied=%lu, pending=%d, flushed=%d",
+                                  sender->isEnabled(), sender->getZeroCopyCount(), sender->getCopyCount(),
+                                  sender->getKernelCopiedCount(), (int)sender->getPendingCount(), flushed);
+                     ASSERT(flushed && sender->getPendingCount() == 0);
+                     if (sender->isEnabled())
+                     {
+                         ASSERT(last.expired());
+                     }
+                     close(conn);
+                     close(listener); });
+}
+
+// 没有开启 hook 的线程上，splice/tee 保持阻塞语义，等到数据再返回而不是 EAGAIN
+static void test_blocking_splice()
+{
+    int src[2], dst[2], copy[2];
+    ASSERT(pipe(src) == 0 && pipe(dst) == 0 && pipe(copy) == 0);
+    trycle::Thread writer("splice_writer", [&src]()
+                          {
+                              usleep(50 * 1000);
+                              ASSERT(write(src[1], "hello", 5) == 5); });
+    ASSERT(tee(src[0], copy[1], 5, 0) == 5);
+    ASSERT(splice(src[0], nullptr, dst[1], nullptr, 5, 0) == 5);
+    writer.join();
+
+    char buf[8] = {0};
+    ASSERT(read(dst[0], buf, sizeof(buf)) == 5 && memcmp(buf, "hello", 5) == 0);
+    ASSERT(read(copy[0], buf, sizeof(buf)) == 5 && memcmp(buf, "hello", 5) == 0);
+    for (int fd : {src[0], src[1], dst[0], dst[1], copy[0], copy[1]})
+    {
+        close(fd);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    printf("======================================\n");
+
+    trycle::initialize();
+
+    printf("--------------------------------------\n");
+
+    test_blocking_splice();
+    test_transfer_file(false);
+    test_transfer_file(true);
+    test_proxy();
+    test_msg_zerocopy();
+
+    printf("--------------------------------------\n");
+
+    return 0;
+}